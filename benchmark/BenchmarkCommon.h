@@ -0,0 +1,41 @@
+/*
+ * Thermal-FIST package
+ * 
+ * Copyright (c) 2014-2020 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#ifndef BENCHMARKCOMMON_H
+#define BENCHMARKCOMMON_H
+
+#include <string>
+
+#include "HRGBase/ThermalParticleSystem.h"
+#include "HRGBase/ThermalModelParameters.h"
+
+#include "ThermalFISTConfig.h"
+
+namespace thermalfist {
+
+	/// The particle list used in the benchmarks
+	inline std::string BenchmarkListFile()
+	{
+		return std::string(ThermalFIST_INPUT_FOLDER) + "/list/PDG2020/list.dat";
+	}
+
+	/// The PDG2020 particle list, loaded once. Benchmarks which modify the list work with a copy.
+	inline const ThermalParticleSystem& BenchmarkParticleList()
+	{
+		static const ThermalParticleSystem TPS(BenchmarkListFile());
+		return TPS;
+	}
+
+	/// Thermal parameters typical for heavy-ion collisions at the LHC
+	inline ThermalModelParameters BenchmarkParameters(double V = 4000.)
+	{
+		return ThermalModelParameters(0.155, 0., 0., 0., 1., V);
+	}
+
+} // namespace thermalfist
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2014-2020 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include "HRGBase.h"
+#include "HRGEventGenerator.h"
+#include "benchmark/benchmark.h"
+
+#include "BenchmarkCommon.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	enum GeneratorType { SphericalBlastWave, CylindricalBlastWave, CracowFreezeout, Hypersurface };
+
+	const char* GeneratorNames[] = { "SphericalBlastWave", "CylindricalBlastWave", "CracowFreezeout", "Hypersurface" };
+	const char* EnsembleNames[] = { "GCE", "CE", "SCE", "CCE" };
+
+	// Arguments: generator type, ensemble
+	// Events with decays, V = 1000 fm^3 in the GCE, V = 100 fm^3 with B = Q = S = 0 in the canonical ensembles
+	void BM_EventGenerator(benchmark::State& state)
+	{
+		GeneratorType type = static_cast<GeneratorType>(state.range(0));
+
+		ThermalParticleSystem TPS(BenchmarkParticleList());
+		TPS.SetResonanceWidthIntegrationType(ThermalParticle::BWTwoGamma);
+
+		EventGeneratorConfiguration config;
+		config.fEnsemble = static_cast<EventGeneratorConfiguration::Ensemble>(state.range(1));
+		config.fModelType = EventGeneratorConfiguration::PointParticle;
+		config.CFOParameters = BenchmarkParameters(1000.);
+		if (config.fEnsemble != EventGeneratorConfiguration::GCE) {
+			config.CFOParameters.V = config.CFOParameters.SVc = 100.;
+			config.B = config.Q = config.S = config.C = 0;
+		}
+
+		ParticlizationHypersurface surface;
+		EventGeneratorBase *generator = NULL;
+		if (type == SphericalBlastWave)
+			generator = new SphericalBlastWaveEventGenerator(&TPS, config, 0.120, 0.5);
+		else if (type == CylindricalBlastWave)
+			generator = new CylindricalBlastWaveEventGenerator(&TPS, config, 0.120, 0.5, 0.5, 1.);
+		else if (type == CracowFreezeout)
+			generator = new CracowFreezeoutEventGenerator(&TPS, config, 0.120, 1.5, 0.5);
+		else {
+			// R = 8 fm, tau = 5 fm/c, i.e. about 1000 fm^3
+			surface = CylindricalBlastWaveHypersurface(0.155, 0.5, 0.5, 1., 8., 5., 20, 16, 10);
+			generator = new HypersurfaceEventGenerator(&TPS, config, &surface);
+		}
+
+		RandomGenerators::SetSeed(1);
+
+		double multiplicity = 0.;
+		for (auto _ : state) {
+			SimpleEvent ev = generator->GetEvent(true);
+			multiplicity += ev.Particles.size();
+		}
+
+		state.SetItemsProcessed(state.iterations());
+		state.counters["multiplicity"] = multiplicity / state.iterations();
+		state.SetLabel(std::string(GeneratorNames[type]) + "/" + EnsembleNames[config.fEnsemble]);
+
+		delete generator;
+	}
+
+	void EventGeneratorArguments(benchmark::internal::Benchmark* b)
+	{
+		for (int type = SphericalBlastWave; type <= Hypersurface; ++type)
+			b->Args({ type, EventGeneratorConfiguration::GCE });
+		b->Args({ CylindricalBlastWave, EventGeneratorConfiguration::CE });
+		b->Args({ CylindricalBlastWave, EventGeneratorConfiguration::SCE });
+	}
+
+	BENCHMARK(BM_EventGenerator)->Apply(EventGeneratorArguments)->Unit(benchmark::kMicrosecond);
+
+} // namespace
@@ -0,0 +1,82 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2014-2020 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include <string>
+#include <vector>
+
+#include "HRGBase/IdealGasFunctions.h"
+#include "benchmark/benchmark.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	const char* QuantityNames[] = { "ParticleDensity", "EnergyDensity", "EntropyDensity", "Pressure", "chi2", "chi3", "chi4", "ScalarDensity" };
+
+	const char* StatisticsName(int statistics)
+	{
+		if (statistics == 1)
+			return "Fermi";
+		if (statistics == -1)
+			return "Bose";
+		return "Boltzmann";
+	}
+
+	// Arguments: quantity, calculation type, statistics
+	// Proton-like (Fermi) and kaon-like (Bose, Boltzmann) species at typical freeze-out conditions
+	void BM_IdealGasQuantity(benchmark::State& state)
+	{
+		IdealGasFunctions::Quantity quantity = static_cast<IdealGasFunctions::Quantity>(state.range(0));
+		IdealGasFunctions::QStatsCalculationType calctype = static_cast<IdealGasFunctions::QStatsCalculationType>(state.range(1));
+		int statistics = static_cast<int>(state.range(2));
+
+		double T = 0.155, mu = 0.100;
+		double m = (statistics == 1) ? 0.938 : 0.494;
+		double deg = 2.;
+
+		for (auto _ : state) {
+			benchmark::DoNotOptimize(IdealGasFunctions::IdealGasQuantity(quantity, calctype, statistics, T, mu, m, deg));
+		}
+
+		state.SetLabel(std::string(QuantityNames[quantity]) + "/"
+			+ (calctype == IdealGasFunctions::ClusterExpansion ? "ClusterExpansion" : "Quadratures") + "/"
+			+ StatisticsName(statistics));
+	}
+
+	void IdealGasQuantityArguments(benchmark::internal::Benchmark* b)
+	{
+		for (int quantity = IdealGasFunctions::ParticleDensity; quantity <= IdealGasFunctions::ScalarDensity; ++quantity)
+			for (int calctype = IdealGasFunctions::ClusterExpansion; calctype <= IdealGasFunctions::Quadratures; ++calctype)
+				for (int statistics = -1; statistics <= 1; ++statistics) {
+					// The calculation type is irrelevant for the Boltzmann statistics
+					if (statistics == 0 && calctype != IdealGasFunctions::ClusterExpansion)
+						continue;
+					b->Args({ quantity, calctype, statistics });
+				}
+	}
+
+	BENCHMARK(BM_IdealGasQuantity)->Apply(IdealGasQuantityArguments);
+
+	// Argument: statistics
+	// All susceptibilities up to sixth order at once
+	void BM_IdealGasSusceptibilities(benchmark::State& state)
+	{
+		int statistics = static_cast<int>(state.range(0));
+		double m = (statistics == 1) ? 0.938 : 0.494;
+		std::vector<double> chis;
+
+		for (auto _ : state) {
+			IdealGasFunctions::IdealGasSusceptibilities(6, IdealGasFunctions::ClusterExpansion, statistics, 0.155, 0.100, m, 2., chis);
+			benchmark::DoNotOptimize(chis.data());
+		}
+
+		state.SetLabel(StatisticsName(statistics));
+	}
+
+	BENCHMARK(BM_IdealGasSusceptibilities)->DenseRange(-1, 1);
+
+} // namespace
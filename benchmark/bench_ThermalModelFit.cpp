@@ -0,0 +1,51 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2014-2020 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include <string>
+#include <vector>
+
+#include "HRGBase.h"
+#include "HRGFit.h"
+#include "benchmark/benchmark.h"
+
+#include "BenchmarkCommon.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	// Fit of T and R to the ALICE Pb-Pb 2.76 TeV 0-10% yields, muB = 0
+	void BM_ThermalModelFit(benchmark::State& state)
+	{
+		// The data include light nuclei
+		ThermalParticleSystem TPS(ThermalFIST_DEFAULT_LIST_FILE);
+		ThermalModelIdeal model(&TPS);
+		model.SetParameters(BenchmarkParameters());
+		model.SetUseWidth(ThermalParticle::BWTwoGamma);
+
+		std::vector<FittedQuantity> quantities = ThermalModelFit::loadExpDataFromFile(std::string(ThermalFIST_INPUT_FOLDER) + "/data/ALICE-PbPb2.76TeV-0-10-all.dat");
+
+		ThermalModelFit fitter(&model);
+		fitter.SetQuantities(quantities);
+		fitter.SetParameterFitFlag("muB", false);
+		fitter.SetParameterValue("muB", 0.);
+
+		double chi2 = 0.;
+		for (auto _ : state) {
+			// Each fit starts from the same initial values
+			fitter.SetParameter("T", 0.155, 0.05, 0.100, 0.200);
+			fitter.SetParameter("R", 10.0, 1.0, 0.0, 30.0);
+			ThermalModelFitParameters result = fitter.PerformFit(false);
+			chi2 = result.chi2;
+		}
+
+		state.counters["chi2"] = chi2;
+	}
+
+	BENCHMARK(BM_ThermalModelFit)->Unit(benchmark::kMillisecond);
+
+} // namespace
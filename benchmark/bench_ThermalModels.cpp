@@ -0,0 +1,115 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2014-2020 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include "HRGBase.h"
+#include "HRGEV.h"
+#include "HRGVDW.h"
+#include "HRGVDW/ThermalModelVDWCanonicalStrangeness.h"
+#include "benchmark/benchmark.h"
+
+#include "BenchmarkCommon.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	/// Canonical correlation volume, in fm^3, kept small to limit the range of the conserved charges
+	const double CanonicalVolume = 100.;
+
+	/// Sets up the model with typical excluded volume or van der Waals parameters
+	void SetupModel(ThermalModelBase* model)
+	{
+		ThermalModelParameters params = BenchmarkParameters();
+		if (model->Ensemble() != ThermalModelBase::GCE) {
+			params.V = params.SVc = CanonicalVolume;
+			params.B = params.Q = params.S = params.C = 0;
+		}
+		model->SetParameters(params);
+
+		if (model->InteractionModel() == ThermalModelBase::DiagonalEV
+			|| model->InteractionModel() == ThermalModelBase::CrosstermsEV)
+			model->SetRadius(0.3);
+
+		// Nuclear matter parameters for baryon-baryon and antibaryon-antibaryon pairs
+		if (model->InteractionModel() == ThermalModelBase::QvdW) {
+			const ThermalParticleSystem* TPS = model->TPS();
+			for (int i = 0; i < TPS->ComponentsNumber(); ++i) {
+				for (int j = 0; j < TPS->ComponentsNumber(); ++j) {
+					int Bi = TPS->Particles()[i].BaryonCharge(), Bj = TPS->Particles()[j].BaryonCharge();
+					if (Bi != 0 && Bi == Bj) {
+						model->SetVirial(i, j, 3.42);
+						model->SetAttraction(i, j, 0.329);
+					}
+				}
+			}
+		}
+	}
+
+	template<class ThermalModel>
+	void BM_CalculateDensities(benchmark::State& state)
+	{
+		ThermalParticleSystem TPS(BenchmarkParticleList());
+		ThermalModel model(&TPS);
+		SetupModel(&model);
+
+		for (auto _ : state) {
+			model.CalculateDensities();
+			benchmark::DoNotOptimize(model.TotalDensities().data());
+		}
+	}
+
+	template<class ThermalModel>
+	void BM_CalculateFluctuations(benchmark::State& state)
+	{
+		ThermalParticleSystem TPS(BenchmarkParticleList());
+		ThermalModel model(&TPS);
+		SetupModel(&model);
+		model.CalculateDensities();
+
+		for (auto _ : state) {
+			model.CalculateFluctuations();
+			benchmark::ClobberMemory();
+		}
+	}
+
+#define THERMALFIST_MODEL_BENCHMARKS(ThermalModel) \
+	BENCHMARK_TEMPLATE(BM_CalculateDensities, ThermalModel)->Unit(benchmark::kMillisecond); \
+	BENCHMARK_TEMPLATE(BM_CalculateFluctuations, ThermalModel)->Unit(benchmark::kMillisecond);
+
+	THERMALFIST_MODEL_BENCHMARKS(ThermalModelIdeal)
+	THERMALFIST_MODEL_BENCHMARKS(ThermalModelEVDiagonal)
+	THERMALFIST_MODEL_BENCHMARKS(ThermalModelEVCrossterms)
+	THERMALFIST_MODEL_BENCHMARKS(ThermalModelVDW)
+	THERMALFIST_MODEL_BENCHMARKS(ThermalModelCanonical)
+
+	// The strangeness- and charm-canonical models do not compute fluctuations
+	BENCHMARK_TEMPLATE(BM_CalculateDensities, ThermalModelCanonicalStrangeness)->Unit(benchmark::kMillisecond);
+	BENCHMARK_TEMPLATE(BM_CalculateDensities, ThermalModelCanonicalCharm)->Unit(benchmark::kMillisecond);
+	BENCHMARK_TEMPLATE(BM_CalculateDensities, ThermalModelEVCanonicalStrangeness)->Unit(benchmark::kMillisecond);
+	BENCHMARK_TEMPLATE(BM_CalculateDensities, ThermalModelVDWCanonicalStrangeness)->Unit(benchmark::kMillisecond);
+
+	// Argument: canonical volume in fm^3
+	// Partition functions of the full canonical ensemble for exactly conserved B, Q, and S
+	void BM_CanonicalPartitionFunctions(benchmark::State& state)
+	{
+		ThermalParticleSystem TPS(BenchmarkParticleList());
+		ThermalModelCanonical model(&TPS);
+		ThermalModelParameters params = BenchmarkParameters(static_cast<double>(state.range(0)));
+		params.SVc = params.V;
+		params.B = params.Q = params.S = params.C = 0;
+		model.SetParameters(params);
+		model.CalculateQuantumNumbersRange();
+
+		for (auto _ : state) {
+			model.CalculatePartitionFunctions();
+			benchmark::ClobberMemory();
+		}
+	}
+
+	BENCHMARK(BM_CanonicalPartitionFunctions)->Arg(25)->Arg(100)->Unit(benchmark::kMillisecond);
+
+} // namespace
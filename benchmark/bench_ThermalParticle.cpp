@@ -0,0 +1,61 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2014-2020 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include <string>
+
+#include "HRGBase/ThermalParticleSystem.h"
+#include "benchmark/benchmark.h"
+
+#include "BenchmarkCommon.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	const char* WidthSchemeNames[] = { "ZeroWidth", "BWTwoGamma", "FullInterval", "FullIntervalWeighted", "eBW", "eBWconstBR" };
+
+	// Reading the particle list and the decays, including the decay chains
+	void BM_ThermalParticleSystemLoad(benchmark::State& state)
+	{
+		std::string listfile = BenchmarkListFile();
+		for (auto _ : state) {
+			ThermalParticleSystem TPS(listfile);
+			benchmark::DoNotOptimize(TPS.ComponentsNumber());
+		}
+	}
+
+	BENCHMARK(BM_ThermalParticleSystemLoad)->Unit(benchmark::kMillisecond);
+
+	// Arguments: width scheme, PDG ID of the particle
+	void BM_ThermalParticleDensity(benchmark::State& state)
+	{
+		ThermalParticle::ResonanceWidthIntegration scheme = static_cast<ThermalParticle::ResonanceWidthIntegration>(state.range(0));
+
+		ThermalParticleSystem TPS(BenchmarkParticleList());
+		TPS.SetResonanceWidthIntegrationType(scheme);
+		const ThermalParticle& part = TPS.ParticleByPDG(state.range(1));
+
+		ThermalModelParameters params = BenchmarkParameters();
+		for (auto _ : state) {
+			benchmark::DoNotOptimize(part.Density(params, IdealGasFunctions::ParticleDensity, true, 0.));
+		}
+
+		state.SetLabel(part.Name() + "/" + WidthSchemeNames[scheme]);
+	}
+
+	void ThermalParticleDensityArguments(benchmark::internal::Benchmark* b)
+	{
+		// rho(770)0 and Delta(1232)++
+		const long long pdgids[] = { 113, 2224 };
+		for (int scheme = ThermalParticle::ZeroWidth; scheme <= ThermalParticle::eBWconstBR; ++scheme)
+			for (int ip = 0; ip < 2; ++ip)
+				b->Args({ scheme, pdgids[ip] });
+	}
+
+	BENCHMARK(BM_ThermalParticleDensity)->Apply(ThermalParticleDensityArguments);
+
+} // namespace
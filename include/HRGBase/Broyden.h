@@ -61,6 +61,30 @@ namespace thermalfist {
      */
     virtual std::vector<double> Equations(const std::vector<double> &x) = 0;
 
+    /**
+     * Evaluates the l.h.s. of all the equations, 
+     * same as Equations(), but writes the result to a provided vector.
+     * The default implementation calls Equations(), a derived
+     * class may override it to avoid the memory allocations.
+     * 
+     * \param x Vector of the variables' values.
+     * \param f Vector where the l.h.s. are written, resized if necessary.
+     */
+    virtual void EvaluateEquations(const std::vector<double> &x, std::vector<double> &f) { f = Equations(x); }
+
+    /**
+     * \brief Creates an independent copy of the equations which 
+     *        can be evaluated concurrently with the original.
+     * 
+     * Used to evaluate the columns of the finite difference Jacobian 
+     * in parallel if OpenMP is used.
+     * The default implementation returns NULL, i.e. the equations
+     * are evaluated sequentially.
+     * 
+     * \return A new object which is to be deleted by the caller, or NULL if the equations cannot be cloned.
+     */
+    virtual BroydenEquations* Clone() const { return NULL; }
+
   protected:
     /// The number of equations
     int m_N;           
@@ -86,10 +110,10 @@ namespace thermalfist {
      * which implements the equations to be solved by
      * the Broyden's method.
      */
-    BroydenJacobian(BroydenEquations *eqs = NULL) : m_Equations(eqs), m_dx(EPS) { }
+    BroydenJacobian(BroydenEquations *eqs = NULL) : m_Equations(eqs), m_dx(EPS), m_EquationsCopiesCreated(false) { }
 
     /// Destructor.
-    virtual ~BroydenJacobian(void) { }
+    virtual ~BroydenJacobian(void) { ReleaseEquationsCopies(); }
 
     /**
      * \brief Evaluates the Jacobian for given values of the variables.
@@ -105,6 +129,15 @@ namespace thermalfist {
      */
     virtual std::vector<double> Jacobian(const std::vector<double> &x);
 
+    /**
+     * \brief Evaluates the Jacobian, same as Jacobian(), but writes
+     *        the result to a provided vector.
+     * 
+     * \param x   Vector of the variables' values.
+     * \param jac Vector where the matrix elements are written in a RowMajor ordering, resized if necessary.
+     */
+    virtual void EvaluateJacobian(const std::vector<double> &x, std::vector<double> &jac) { jac = Jacobian(x); }
+
     /**
      * \brief Set the finite variable difference value 
      *        used for calculating the Jacobian numerically.
@@ -118,15 +151,51 @@ namespace thermalfist {
      */
     double CurrentDx() const { return m_dx; }
 
+    /**
+     * \brief Deletes the copies of the equations used by FiniteDifferenceJacobian().
+     * 
+     * The copies are created at the first evaluation of the Jacobian
+     * and reused by the subsequent ones. Called by Broyden::Solve() when
+     * the solution is complete, so that each solution uses fresh copies.
+     */
+    void ReleaseEquationsCopies();
+
+  protected:
+    /**
+     * \brief Evaluates the Jacobian with finite differences.
+     * 
+     * The columns are evaluated in parallel if OpenMP is used
+     * and the equations can be cloned, see BroydenEquations::Clone().
+     * The copies of the equations are kept until ReleaseEquationsCopies() is called.
+     * 
+     * \param x   Vector of the variables' values.
+     * \param jac Vector where the matrix elements are written in a RowMajor ordering.
+     */
+    void FiniteDifferenceJacobian(const std::vector<double> &x, std::vector<double> &jac);
+
   private:
+    BroydenJacobian(const BroydenJacobian&);
+    BroydenJacobian& operator=(const BroydenJacobian&);
+
     /// Pointer to BroydenEquations object.
     BroydenEquations *m_Equations;  
     /// Finite variable difference value.
     double           m_dx;
+    /// Values of the equations at the unshifted variables
+    std::vector<double> m_fx;
+    /// Copies of the equations for the parallel evaluation of the columns
+    std::vector<BroydenEquations*> m_EquationsCopies;
+    /// Whether the equations could be copied
+    bool m_EquationsCopiesCreated;
   };
 
   /**
    * \brief Class implementing the Broyden method to solve a system of non-linear equations.
+   * 
+   * The Jacobian is LU-factorized once, the Broyden updates of its inverse are 
+   * stored as a product of rank-one (Sherman-Morrison) factors.
+   * Optionally, the steps are controlled by a backtracking line search on the norm of the equations,
+   * see UseLineSearch().
    */
   class Broyden
   {
@@ -194,7 +263,7 @@ namespace thermalfist {
      * then the Jacobian will be computed using finite
      * differences.
      */
-    Broyden(BroydenEquations *eqs = NULL, BroydenJacobian *jaco = NULL) : m_Equations(eqs), m_Jacobian(jaco), m_Iterations(0), m_MaxDifference(0.), m_UseNewton(false) { }
+    Broyden(BroydenEquations *eqs = NULL, BroydenJacobian *jaco = NULL) : m_Equations(eqs), m_Jacobian(jaco), m_Iterations(0), m_MaxDifference(0.), m_UseNewton(false), m_UseLineSearch(false) { }
     
     /**
      * \brief Destroy the Broyden object
@@ -254,13 +323,44 @@ namespace thermalfist {
      */
     bool UseNewton() const { return m_UseNewton; }
 
+    /**
+     * Specify whether to use the backtracking line search.
+     * 
+     * If set, the step is reduced if it
+     * does not decrease the norm of the equations. If no sufficient
+     * decrease is found, the Jacobian is re-evaluated
+     * and the step is repeated. If this does not help either, the full step is taken.
+     * 
+     * \param flag Use the line search if true, always take full steps otherwise (default).
+     */
+    void UseLineSearch(bool flag) { m_UseLineSearch = flag; }
+
+    /**
+     * \return true The line search is used
+     * \return false Full steps are always taken
+     */
+    bool UseLineSearch() const { return m_UseLineSearch; }
+
   protected:
+    /**
+     * \brief Performs the Broyden (or Newton) iterations.
+     * 
+     * \param x0             A vector of starting values of the variables.
+     * \param jacobian       The Jacobian at \p x0 in RowMajor ordering.
+     * \param jacobianEval   The object used to re-evaluate the Jacobian.
+     * \param solcrit        Criterium used to determine whether the desired accuracy is achieved.
+     * \param max_iterations Maximum number of iterations.
+     * \return std::vector<double> A vector of the variables' values which solve the equations.
+     */
+    std::vector<double> Iterate(const std::vector<double> &x0, std::vector<double> &jacobian, BroydenJacobian *jacobianEval, BroydenSolutionCriterium *solcrit, int max_iterations);
+
     BroydenEquations *m_Equations; 
     BroydenJacobian  *m_Jacobian;   
     int m_Iterations;              
     int m_MaxIterations;      
     double m_MaxDifference;         
     bool m_UseNewton;
+    bool m_UseLineSearch;
   };
 
 } // namespace thermalfist
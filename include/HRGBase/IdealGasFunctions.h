@@ -18,6 +18,9 @@
  * 
  */
 
+#include <vector>
+#include <cstddef>
+
 namespace thermalfist {
 
   /// \brief Contains implementation of the thermodynamic functions
@@ -39,6 +42,9 @@ namespace thermalfist {
 
     /// \brief Whether \mu > m Bose-Einstein condensation issue was encountered for a Bose gas
     extern bool calculationHadBECIssue;
+#ifdef USE_OPENMP
+#pragma omp threadprivate(calculationHadBECIssue)
+#endif
 
     /**
      * \brief Computes the particle number density of a Maxwell-Boltzmann gas.
@@ -204,6 +210,48 @@ namespace thermalfist {
      */
     double QuantumClusterExpansionChiN(int N, int statistics, double T, double mu, double m, double deg, int order = 1);
 
+    /**
+     * \brief A set of ideal gas thermodynamic functions computed together.
+     * 
+     */
+    struct IdealGasQuantities {
+      double n;     ///< Particle number density [fm-3]
+      double P;     ///< Pressure [GeV fm-3]
+      double e;     ///< Energy density [GeV fm-3]
+      double s;     ///< Entropy density [fm-3]
+      double ns;    ///< Scalar density [fm-3]
+      double chi2;  ///< 2nd order susceptibility
+      double chi3;  ///< 3rd order susceptibility
+      double chi4;  ///< 4th order susceptibility
+
+      IdealGasQuantities() : n(0.), P(0.), e(0.), s(0.), ns(0.), chi2(0.), chi3(0.), chi4(0.) { }
+
+      /// The value of the specified thermodynamic function
+      double Value(Quantity quantity) const;
+
+      /// Adds the thermodynamic functions from another set multiplied by a factor
+      void Add(const IdealGasQuantities& other, double factor = 1.);
+    };
+
+    /**
+     * \brief Computes all the thermodynamic functions of a quantum ideal gas using cluster expansion.
+     * 
+     * All the functions and all the terms of the cluster expansion are computed in a single pass.
+     * For each term only K_0 and K_1 are evaluated, 
+     * K_2 is obtained from the recurrence K_2(x) = K_0(x) + 2 K_1(x) / x.
+     * 
+     * \param statistics 0 -- Maxwell-Boltzmann, +1 -- Fermi-Dirac, -1 -- Bose-Einstein.
+     * \param T Temperature [GeV].
+     * \param mu Chemical potential [GeV].
+     * \param m  Particle's mass [GeV].
+     * \param deg Internal degeneracy factor.
+     * \param order Number of terms in the cluster expansion.
+     * \param terms If not NULL, filled with the individual terms of the cluster expansion,
+     *              (*terms)[i-1] being the i-th term.
+     * \return The thermodynamic functions, summed over all terms.
+     */
+    IdealGasQuantities QuantumClusterExpansionQuantities(int statistics, double T, double mu, double m, double deg, int order = 1, std::vector<IdealGasQuantities> *terms = NULL);
+
     /**
      * \brief Computes the particle number density of a quantum ideal gas using 32-point Gauss-Laguerre quadratures.
      * 
@@ -396,6 +444,51 @@ namespace thermalfist {
      * \return Computed thermodynamic function.
      */
     double IdealGasQuantity(Quantity quantity, QStatsCalculationType calctype, int statistics, double T, double mu, double m, double deg, int order = 1);
+
+    /// \brief Pointer to a function computing a fixed ideal gas quantity
+    ///        for fixed statistics and calculation type.
+    ///
+    /// The arguments are the temperature, the chemical potential, the mass,
+    /// the degeneracy factor, and the number of terms in the cluster expansion,
+    /// as in IdealGasQuantity().
+    typedef double (*IdealGasQuantityKernel)(double T, double mu, double m, double deg, int order);
+
+    /**
+     * \brief Returns the kernel which computes IdealGasQuantity()
+     *        for the specified quantity, calculation type, and statistics.
+     *
+     * The kernels are compile-time specializations of IdealGasQuantity()
+     * with no runtime dispatch on the function arguments.
+     * The kernel can be resolved once and then called
+     * for many values of the temperature, chemical potential, or mass,
+     * e.g. when integrating over the mass distribution of a resonance.
+     *
+     * \param quantity Identifies the thermodynamic function to calculate.
+     * \param calctype Method used to perform the calculation if quantum statistics used.
+     * \param statistics 0 -- Maxwell-Boltzmann, +1 -- Fermi-Dirac, -1 -- Bose-Einstein.
+     * \return The kernel, or NULL if the quantity or the statistics is unknown.
+     */
+    IdealGasQuantityKernel GetIdealGasQuantityKernel(Quantity quantity, QStatsCalculationType calctype, int statistics);
+
+    /**
+     * \brief Computes the susceptibilities \f$ \chi_1, \ldots, \chi_N \f$ of an ideal gas at once.
+     * 
+     * Computes \f$ \chi_n \equiv \frac{\partial^n p/T^4}{\partial (mu/T)^n} \f$ for n = 1..N,
+     * sharing the evaluation of the distribution function between all orders.
+     * In the case of quadratures the derivatives of the distribution function f
+     * are evaluated as polynomials in f, which allows arbitrary orders.
+     * 
+     * \param N          The highest order.
+     * \param calctype   Method used to perform the calculation if quantum statistics used.
+     * \param statistics 0 -- Maxwell-Boltzmann, +1 -- Fermi-Dirac, -1 -- Bose-Einstein.
+     * \param T          Temperature [GeV].
+     * \param mu         Chemical potential [GeV].
+     * \param m          Particle's mass [GeV].
+     * \param deg        Internal degeneracy factor.
+     * \param chis       The computed values, chis[n-1] is \f$ \chi_n \f$.
+     * \param order      Number of terms in the cluster expansion if this method is used.
+     */
+    void IdealGasSusceptibilities(int N, QStatsCalculationType calctype, int statistics, double T, double mu, double m, double deg, std::vector<double> & chis, int order = 1);
   }
 
 } // namespace thermalfist
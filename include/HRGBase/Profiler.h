@@ -0,0 +1,147 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2020 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/**
+ * \file Profiler.h
+ *
+ * \brief Contains the lightweight instrumentation facility
+ *        (scoped timers and counters) for the hot paths of the library.
+ *
+ * The instrumentation is placed in the library code through the
+ * THERMALFIST_PROFILE_SCOPE() and THERMALFIST_PROFILE_COUNT() macros.
+ * These expand to nothing unless the library is compiled with
+ * the USE_PROFILING flag (cmake option -DUSE_PROFILING=ON),
+ * thus there is no overhead in the default build.
+ *
+ * Example:
+ * ~~~.cpp
+ * thermalfist::Profiler::Reset();
+ * model.CalculateDensities();
+ * thermalfist::Profiler::PrintSummary();
+ * thermalfist::Profiler::WriteTraceEvents("trace.json");
+ * ~~~
+ *
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace thermalfist {
+
+  /// \brief Contains the routines for collecting and
+  ///        reporting the profiling data
+  ///
+  /// The timings and counters are accumulated separately for each thread
+  /// without any locking. The reports and Reset() read or modify the data
+  /// of all threads and should therefore only be called when no
+  /// profiled calculations are running concurrently.
+  namespace Profiler {
+
+    /// Whether the library has been compiled with the USE_PROFILING flag
+    bool IsCompiledIn();
+
+    /// \brief Switches the collection of profiling data on or off at runtime.
+    ///        The collection is on by default.
+    void SetEnabled(bool enabled);
+
+    /// Whether the profiling data is being collected
+    bool IsEnabled();
+
+    /// \brief Switches the recording of the individual timed scopes,
+    ///        used by WriteTraceEvents(), on or off.
+    ///        The recording is off by default.
+    ///
+    /// At most 10^6 scopes are recorded for each thread.
+    void SetTracing(bool tracing);
+
+    /// Whether the individual timed scopes are being recorded
+    bool IsTracing();
+
+    /// Clears all the collected timings, counters, and trace events
+    void Reset();
+
+    /// \brief Adds the value to the counter with the specified name
+    ///        for the current thread.
+    ///
+    /// \param name  Name of the counter. Must be a string with a static storage duration, e.g. a string literal.
+    /// \param value The increment
+    void AddCounter(const char* name, long long value = 1);
+
+    /// \brief Adds a timed scope to the statistics of the current thread.
+    ///
+    /// \param name   Name of the scope. Must be a string with a static storage duration, e.g. a string literal.
+    /// \param start  Start of the scope
+    /// \param finish End of the scope
+    void AddTiming(const char* name,
+      const std::chrono::steady_clock::time_point& start,
+      const std::chrono::steady_clock::time_point& finish);
+
+    /// \brief Prints the table with the number of calls and the total, mean, minimum,
+    ///        and maximum wall time of each timed scope, followed by the values of the counters.
+    ///
+    /// \param out       The output stream
+    /// \param perThread If true, a separate table is printed for each thread
+    ///                  in addition to the table aggregated over all threads
+    void PrintSummary(FILE* out = stdout, bool perThread = false);
+
+    /// \brief Writes the recorded timed scopes in the trace event format.
+    ///
+    /// The file can be viewed with chrome://tracing or https://ui.perfetto.dev.
+    /// Requires SetTracing(true) before the calculations.
+    ///
+    /// \param filename The output file name
+    /// \return true if the file was written successfully, false otherwise
+    bool WriteTraceEvents(const std::string& filename);
+
+    /// \brief Measures the wall time between its construction and destruction
+    ///        and adds it to the statistics of the timed scope with the specified name.
+    class ScopedTimer {
+    public:
+      /// \param name Name of the scope. Must be a string with a static storage duration, e.g. a string literal.
+      explicit ScopedTimer(const char* name) : m_Name(name), m_Active(IsEnabled()) {
+        if (m_Active)
+          m_Start = std::chrono::steady_clock::now();
+      }
+
+      ~ScopedTimer() {
+        if (m_Active)
+          AddTiming(m_Name, m_Start, std::chrono::steady_clock::now());
+      }
+
+    private:
+      ScopedTimer(const ScopedTimer&);
+      ScopedTimer& operator=(const ScopedTimer&);
+
+      const char* m_Name;
+      bool m_Active;
+      std::chrono::steady_clock::time_point m_Start;
+    };
+
+  } // namespace Profiler
+
+} // namespace thermalfist
+
+#define THERMALFIST_PROFILE_CONCAT_(a, b) a##b
+#define THERMALFIST_PROFILE_CONCAT(a, b) THERMALFIST_PROFILE_CONCAT_(a, b)
+
+#ifdef USE_PROFILING
+/// Times the enclosing scope under the specified name
+#define THERMALFIST_PROFILE_SCOPE(name) \
+  ::thermalfist::Profiler::ScopedTimer THERMALFIST_PROFILE_CONCAT(thermalfist_profile_timer_, __LINE__)(name)
+/// Adds the value to the counter with the specified name
+#define THERMALFIST_PROFILE_COUNT(name, value) \
+  do { if (::thermalfist::Profiler::IsEnabled()) ::thermalfist::Profiler::AddCounter(name, value); } while (0)
+#else
+#define THERMALFIST_PROFILE_SCOPE(name) do { } while (0)
+#define THERMALFIST_PROFILE_COUNT(name, value) do { } while (0)
+#endif
+
+#endif
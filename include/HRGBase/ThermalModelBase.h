@@ -8,9 +8,11 @@
 #ifndef THERMALMODELBASE_H
 #define THERMALMODELBASE_H
 
+#include <memory>
 #include <string>
 
 #include "HRGBase/ThermalParticleSystem.h"
+#include "HRGBase/ThermalModelResultCache.h"
 #include "HRGBase/xMath.h"
 #include "HRGBase/Broyden.h"
 
@@ -62,6 +64,34 @@ namespace thermalfist {
 
     virtual ~ThermalModelBase(void) { }
 
+    /**
+     * \brief Creates a copy of the model.
+     *
+     * The copy has the same settings, thermal parameters, and calculation results
+     * as the model, and can be used independently, e.g. in a separate thread.
+     *
+     * By default the copy shares the particle list with the model, which makes copying cheap.
+     * Calculations with models sharing a particle list can run concurrently as long as the
+     * particle list is not modified. In particular, SetStatistics(), SetUseWidth(),
+     * SetNormBratio() and similar methods of any of these models must not be called
+     * concurrently. Otherwise each model should have its own copy of the particle list.
+     *
+     * In the ThermalParticle::eBW scheme the thermal branching ratios are evaluated
+     * in the particle list by each calculation. If the model uses this scheme and
+     * TPS is NULL, the copy therefore gets its own copy of the particle list,
+     * which is owned and deleted by the copy. Later changes of the particle list of the model
+     * do not affect the copy then.
+     *
+     * The result cache (see SetResultCache()) is not shared with the copy.
+     *
+     * \param TPS The particle list to be used by the copy. If NULL, the particle list of the model is used.
+     *            Must contain the same particle species as the particle list of the model,
+     *            e.g. be a copy of it.
+     * \return    Pointer to the copy, which has to be deleted by the caller.
+     *            NULL if the model does not implement copying.
+     */
+    virtual ThermalModelBase* Clone(ThermalParticleSystem *TPS = NULL) const;
+
     /// Number of different particle species in the list
     int ComponentsNumber() const { return static_cast<int>(m_densities.size()); }
 
@@ -617,6 +647,48 @@ namespace thermalfist {
      */
     virtual void CalculateDensities();
 
+    /**
+     * \brief Calculates the primordial and final densities
+     *        of all species for a set of thermal parameters.
+     *
+     * The chemical potentials of the species at each point are determined from
+     * \f$ \mu_B,\,\mu_Q,\,\mu_S,\,\mu_C \f$ of the point as in FillChemicalPotentials(),
+     * or by ConstrainChemicalPotentials() if constrainChemicalPotentials is true.
+     * The final densities include the feeddown according to the stability flags.
+     *
+     * The base implementation evaluates the points one after another.
+     * The parameters and the chemical potentials of the model are
+     * restored afterwards, the calculated quantities are reset.
+     *
+     * \param params     The thermal parameters of the K points
+     * \param primordial K x N matrix of the primordial densities (fm\f$^{-3}\f$)
+     * \param totals     K x N matrix of the final densities (fm\f$^{-3}\f$)
+     * \param constrainChemicalPotentials Whether the chemical potentials are constrained at each point
+     */
+    virtual void CalculateDensitiesBatch(const std::vector<ThermalModelParameters> & params,
+      std::vector< std::vector<double> > & primordial,
+      std::vector< std::vector<double> > & totals,
+      bool constrainChemicalPotentials = false);
+
+    /**
+     * \brief Enables the memoization of the calculation results.
+     *
+     * If a cache is set, CalculateDensities() and ConstrainChemicalPotentials()
+     * first look up the results for the current model setup in the cache,
+     * and store them there after the calculation.
+     * The key includes the model type, the particle list,
+     * the interaction parameters, and all thermal parameters.
+     * Only the models which implement IsResultCacheSupported() use the cache.
+     *
+     * The cache is not owned by the model and can be shared by several models.
+     *
+     * \param cache Pointer to the cache, NULL disables the memoization
+     */
+    void SetResultCache(ThermalModelResultCache *cache) { m_ResultCache = cache; }
+
+    /// The result cache used by the model, NULL if not used
+    ThermalModelResultCache* ResultCache() const { return m_ResultCache; }
+
     /**
      * \brief Checks whether issues have occured
      *        during the calculation of particle densities
@@ -686,6 +758,9 @@ namespace thermalfist {
      * Phys.Rev. C 74, 044903 (2006), 
      * [https://arxiv.org/pdf/nucl-th/0606036.pdf](https://arxiv.org/pdf/nucl-th/0606036.pdf)
      * 
+     * By default only the diagonal elements are computed here, the off-diagonal
+     * ones are evaluated on request by TwoParticleSusceptibilityFinal().
+     * The full matrix is stored if SetDenseFinalCorrelations() is set to true.
      * 
      */
     virtual void CalculateTwoParticleFluctuationsDecays();
@@ -829,6 +904,18 @@ namespace thermalfist {
      */
     virtual std::vector<double> CalculateChargeFluctuations(const std::vector<double> &chgs, int order = 4);
 
+    /**
+     * \brief Calculates the diagonal susceptibilities of several "conserved" charges at once.
+     * 
+     * Same as CalculateChargeFluctuations() for each of the charge vectors.
+     * Models can override this method to share the calculation between the charges.
+     * 
+     * \param chgs  A set of vectors with conserved charge values for all species
+     * \param order Up to which order the susceptibilities are computed
+     * \return      The results of CalculateChargeFluctuations() for each of the charge vectors
+     */
+    virtual std::vector< std::vector<double> > CalculateChargeFluctuationsBatch(const std::vector< std::vector<double> > &chgs, int order = 4);
+
     //virtual double GetParticlePrimordialDensity(unsigned int);
     //virtual double GetParticleTotalDensity(unsigned int);
 
@@ -995,6 +1082,19 @@ namespace thermalfist {
     /// number densities were calculated
     bool IsGCECalculated() const { return m_GCECalculated; }
 
+    /**
+     * \brief Whether the full matrix of the final particle number correlations is stored.
+     * 
+     * If false (default), the correlations between different final 
+     * species are computed on request only, 
+     * see TwoParticleSusceptibilityFinal().
+     * Takes effect at the next CalculateFluctuations() call.
+     */
+    void SetDenseFinalCorrelations(bool dense) { m_DenseFinalCorrelations = dense; }
+
+    /// Whether the full matrix of the final particle number correlations is stored
+    bool DenseFinalCorrelations() const { return m_DenseFinalCorrelations; }
+
     /**
      * \brief Scaled variance of primordial particle
      *        number fluctuations for particle species id
@@ -1169,6 +1269,7 @@ namespace thermalfist {
     bool m_FeeddownCalculated;
     bool m_FluctuationsCalculated;
     bool m_GCECalculated;
+    bool m_DenseFinalCorrelations;
     bool m_UseWidth;
     bool m_NormBratio;
     bool m_QuantumStats;
@@ -1204,6 +1305,7 @@ namespace thermalfist {
     std::vector<double> m_kurttot;
 
     // 2nd order correlations of primordial and total numbers
+    // m_TotalCorrel is only filled if m_DenseFinalCorrelations is set
     std::vector< std::vector<double> > m_PrimCorrel;
     std::vector< std::vector<double> > m_TotalCorrel;
 
@@ -1235,18 +1337,99 @@ namespace thermalfist {
     /// Shift in chemical potential of particle species id due to interactions
     virtual double MuShift(int /*id*/) const { return 0.; }
 
+    /**
+     * \brief Applies the feeddown of the given type to the primordial densities.
+     *
+     * Uses the decay contributions of the particle list, i.e. the branching
+     * ratios are taken as they are.
+     *
+     * \param feeddown   The feeddown type
+     * \param primordial The primordial densities
+     * \param totals     The densities including the feeddown
+     */
+    void ApplyFeeddown(Feeddown::Type feeddown, const std::vector<double> & primordial, std::vector<double> & totals) const;
+
+    /**
+     * \brief Computes a single element of the final particle number correlation matrix.
+     *
+     * Uses the primordial correlations m_PrimCorrel and the decay contributions
+     * according to the stability flags. Only the resonances which feed
+     * into species i are considered for the correlations 
+     * induced by the probabilistic decays.
+     * For i != j the decay contributions are only included if both species are stable,
+     * otherwise the primordial correlation is returned.
+     *
+     * \param i 0-based index of the first species
+     * \param j 0-based index of the second species
+     * \return  The element of the correlation matrix, in the same units as m_PrimCorrel
+     */
+    double FinalCorrelation(int i, int j) const;
+
+    /**
+     * \brief Whether the results of the model can be stored in a ThermalModelResultCache.
+     *
+     * A model supports the cache if its internal state after CalculatePrimordialDensities()
+     * is fully described by the densities and by the vector filled in StoreResultCacheState().
+     * Derived classes with additional state have to override the three methods below.
+     */
+    virtual bool IsResultCacheSupported() const { return false; }
+
+    /// Appends the interaction parameters of the model to the cache key
+    virtual void AppendResultCacheKey(std::vector<double> & /*key*/) const { }
+
+    /// Stores the model specific internal state which follows CalculatePrimordialDensities()
+    virtual void StoreResultCacheState(std::vector<double> & /*state*/) const { }
+
+    /// Restores the model specific internal state stored by StoreResultCacheState()
+    virtual void RestoreResultCacheState(const std::vector<double> & /*state*/) { }
+
+    ThermalModelResultCache* m_ResultCache;
+
+    /**
+     * \brief Completes a copy of the model created by Clone().
+     *
+     * Binds the copy to the particle list TPS (if not NULL) or, in the eBW scheme,
+     * to a copy of the particle list of the model, and detaches the result cache.
+     */
+    void FinalizeClone(ThermalModelBase *clone, ThermalParticleSystem *TPS) const;
+
+    /// The particle list owned by the model, if it was created by Clone()
+    std::shared_ptr<ThermalParticleSystem> m_OwnTPS;
+
   private:
     void ResetChemicalPotentials();
 
+    /**
+     * \brief Fills the result cache key describing the current model setup.
+     *
+     * \param key         The key
+     * \param constraints Whether the key is for ConstrainChemicalPotentials(),
+     *                    otherwise for CalculateDensities()
+     * \return false if the current setup cannot be cached
+     */
+    bool ResultCacheKey(std::vector<double> & key, bool constraints) const;
+
+    /// Calls CalculatePrimordialDensities() and CalculateFeeddown(), timing each of them if profiling is enabled
+    void CalculatePrimordialAndFeeddown();
+
     double GetDensity(long long PDGID, const std::vector<double> *dens);
 
     class BroydenEquationsChem : public BroydenEquations
     {
     public:
-      BroydenEquationsChem(ThermalModelBase *model) : BroydenEquations(), m_THM(model) { m_N = 2; }
+      BroydenEquationsChem(ThermalModelBase *model) : BroydenEquations(), m_THM(model), m_Copy(NULL) { m_N = 2; }
+      ~BroydenEquationsChem() { delete m_Copy; }
       std::vector<double> Equations(const std::vector<double> &x);
+      void EvaluateEquations(const std::vector<double> &x, std::vector<double> &f);
+      /// Copy which works with its own copy of the HRG model
+      BroydenEquations* Clone() const;
     private:
+      BroydenEquationsChem(const BroydenEquationsChem&);
+      BroydenEquationsChem& operator=(const BroydenEquationsChem&);
+
       ThermalModelBase *m_THM;
+      /// The copy of the HRG model owned by a clone, NULL otherwise
+      ThermalModelBase *m_Copy;
     };
 
     class BroydenJacobianChem : public BroydenJacobian
@@ -1273,12 +1456,21 @@ namespace thermalfist {
     {
     public:
       BroydenEquationsChemTotals(const std::vector<int> & vConstr, const std::vector<int> & vType, const std::vector<double> & vTotals, ThermalModelBase *model);// : BroydenEquations(), m_THM(model) { m_N = 3; }
+      ~BroydenEquationsChemTotals() { delete m_Copy; }
       std::vector<double> Equations(const std::vector<double> &x);
+      void EvaluateEquations(const std::vector<double> &x, std::vector<double> &f);
+      /// Copy which works with its own copy of the HRG model
+      BroydenEquations* Clone() const;
     private:
+      BroydenEquationsChemTotals(const BroydenEquationsChemTotals&);
+      BroydenEquationsChemTotals& operator=(const BroydenEquationsChemTotals&);
+
       std::vector<int> m_Constr;
       std::vector<int> m_Type;
       std::vector<double> m_Totals;
       ThermalModelBase *m_THM;
+      /// The copy of the HRG model owned by a clone, NULL otherwise
+      ThermalModelBase *m_Copy;
     };
 
     class BroydenJacobianChemTotals : public BroydenJacobian
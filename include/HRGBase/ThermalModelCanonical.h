@@ -65,6 +65,16 @@ namespace thermalfist {
     public ThermalModelBase
   {
   public:
+    /**
+     * \brief The method used to compute the canonical partition functions.
+     *
+     */
+    enum PartitionFunctionMethod {
+      Auto,        ///< The cheaper of the two methods below, based on the system volume and the charge ranges
+      Quadrature,  ///< Numerical integration over the charge fugacities (Fourier integrals)
+      Recursion    ///< Exact recursive convolution over the charge lattice, suited for small systems
+    };
+
     /**
       * \brief Construct a new ThermalModelCanonical object.
       *
@@ -79,6 +89,13 @@ namespace thermalfist {
      */
     virtual ~ThermalModelCanonical(void);
 
+    /**
+     * \brief Creates a copy of the model.
+     *
+     * Overrides ThermalModelBase::Clone().
+     */
+    virtual ThermalModelCanonical* Clone(ThermalParticleSystem *TPS = NULL) const;
+
     /**
      * \brief Calculates the range of quantum numbers values
      *        for which it is necessary to compute the 
@@ -102,10 +119,40 @@ namespace thermalfist {
      * the integral over the baryon fugacity is performed analytically as
      * described in (https://arxiv.org/pdf/nucl-th/0112021.pdf)[https://arxiv.org/pdf/nucl-th/0112021.pdf].
      * 
-     * \param Vc 
+     * For small systems the partition functions can instead be evaluated exactly
+     * by expanding the generating function in the total number of particles, see
+     * SetPartitionFunctionMethod().
+     *
+     * The sums of the densities over the charge sectors are cached per unit volume,
+     * thus repeated calls which differ only by the volume do not recompute them.
+     *
+     * \param Vc
      */
     virtual void CalculatePartitionFunctions(double Vc = -1.);
 
+    /**
+     * \brief Calculates the canonical partition functions for several
+     *        values of the correlation volume at once.
+     * 
+     * The sums of the densities over the charge sectors depend only on the
+     * temperature and the chemical potentials and scale linearly with Vc.
+     * The integrand of the quadratures is therefore evaluated once
+     * per integration point for all the listed volumes.
+     * 
+     * The results are kept and used by the subsequent calls of
+     * CalculatePartitionFunctions() with one of the listed volumes,
+     * as long as the temperature, the chemical potentials, and the
+     * values of the conserved charges stay the same.
+     * This is useful e.g. for a scan over centrality classes.
+     * Volumes for which the exact recursion is used are not precomputed.
+     * 
+     * \param Vcs The correlation volumes (fm^3)
+     */
+    void PrecomputePartitionFunctions(const std::vector<double>& Vcs);
+
+    /// Clears the cached charge sector sums and the precomputed partition functions
+    void ClearPartitionFunctionsCache();
+
     /**
      * \brief Determines whether the specified ThermalParticle
      *        is treat canonically or grand-canonically in the present
@@ -181,6 +228,33 @@ namespace thermalfist {
      * \param The multiplier
      */
     void SetIntegrationIterationsMultiplier(int multiplier) { (multiplier > 0 ? m_IntegrationIterationsMultiplier = multiplier : m_IntegrationIterationsMultiplier = 1); }
+
+    /**
+     * \brief The method used to compute the canonical partition functions
+     *
+     */
+    PartitionFunctionMethod GetPartitionFunctionMethod() const { return m_PartitionFunctionMethod; }
+
+    /**
+     * \brief Sets the method used to compute the canonical partition functions
+     *
+     * The Recursion method builds the partition functions Z(B,Q,S,C) by
+     * the recursive convolution of the single-species generating functions
+     * in the total number of particles, P_N(K) = (1/N) sum_q f_q P_{N-1}(K - q).
+     * The expansion is truncated with a rigorous bound on the omitted terms, which makes the result
+     * exact to double precision. Its cost grows with the mean number of charged particles,
+     * i.e. with the volume, while the cost of the Quadrature method grows with the number of
+     * conserved charges and with SetIntegrationIterationsMultiplier().
+     *
+     * With the default Auto method the cheaper of the two is used at each calculation.
+     * The Recursion method falls back to the quadratures if the system is too large.
+     *
+     * \param method The method
+     */
+    void SetPartitionFunctionMethod(PartitionFunctionMethod method) { m_PartitionFunctionMethod = method; }
+
+    /// The method which was used in the last calculation of the partition functions
+    PartitionFunctionMethod PartitionFunctionMethodUsed() const { return m_PartitionFunctionMethodUsed; }
     
 
     // Override functions begin
@@ -233,6 +307,52 @@ namespace thermalfist {
     void CleanModelGCE();    /**< Cleares the ThermalModelIdeal copy */
     //@}
 
+    /// Number of quadrature intervals per charge fugacity
+    int QuadratureIntervals() const;
+
+    /// Sets up the analytic integration over the baryon fugacity and the chemical potentials of the conserved charges
+    void PrepareConservedCharges();
+
+    /// Fills the chemical potentials and the per unit volume sums over the charge sectors, reusing the cached ones if possible
+    void CalculateChargeSectorSums();
+
+    /// Everything the per unit volume sums over the charge sectors depend on
+    void ChargeSectorSumsKey(std::vector<double>& key) const;
+
+    /// Everything the precomputed partition functions depend on, apart from the volume
+    void PrecomputedPartitionFunctionsKey(std::vector<double>& key) const;
+
+    /// Whether the quadratures are to be used rather than the recursion for the given sums over the charge sectors
+    bool IsPartitionFunctionsQuadratureUsed(const std::vector<double>& Nsx, const std::vector<double>& Nsy) const;
+
+    /// Estimated number of operations of CalculatePartitionFunctionsQuadrature()
+    double PartitionFunctionsQuadratureCost() const;
+
+    /// Estimated number of operations of CalculatePartitionFunctionsRecursion()
+    double PartitionFunctionsRecursionCost(const std::vector<double>& Nsx, const std::vector<double>& Nsy) const;
+
+    /// Partition functions from the numerical integration over the charge fugacities for the volume Vc
+    void CalculatePartitionFunctionsQuadrature(double Vc);
+
+    /**
+     * \brief Numerical integration over the charge fugacities for several volumes at once.
+     * 
+     * \param Vcs            The correlation volumes
+     * \param PartialZ       The partition functions for each of the volumes
+     * \param MultExp        The factor exp(-MultExp) omitted in the partition functions for each of the volumes
+     * \param MultExpBanalyt Same as MultExp, for the analytic integration over the baryon fugacity
+     */
+    void CalculatePartitionFunctionsQuadrature(const std::vector<double>& Vcs, std::vector< std::vector<double> >& PartialZ, std::vector<double>& MultExp, std::vector<double>& MultExpBanalyt) const;
+
+    /// Exact partition functions from the recursion in the number of particles, false if not applicable
+    bool CalculatePartitionFunctionsRecursion(const std::vector<double>& Nsx, const std::vector<double>& Nsy);
+
+    /// Target values of the exactly conserved charges, zero for the charges not conserved exactly
+    std::vector<int> ChargeRecursionTarget() const;
+
+    /// Ranges of the charges for which the partition functions are needed
+    std::vector<int> ChargeRecursionRange() const;
+
   protected:
 
     /**
@@ -278,12 +398,34 @@ namespace thermalfist {
      */
     int m_IntegrationIterationsMultiplier;
 
+    /// The method used to compute the partition functions
+    PartitionFunctionMethod m_PartitionFunctionMethod;
+
+    /// The method used in the last calculation of the partition functions
+    PartitionFunctionMethod m_PartitionFunctionMethodUsed;
+
     int m_BMAX, m_QMAX, m_SMAX, m_CMAX;
     int m_BMAX_list, m_QMAX_list, m_SMAX_list, m_CMAX_list;
 
     double m_MultExp;
     double m_MultExpBanalyt;
 
+    //@{
+    /// Sums of the densities over the charge sectors per unit volume and the state they were computed for
+    std::vector<double> m_ChargeSectorSumsKey;
+    std::vector<double> m_Nsx1, m_Nsy1;
+    bool m_AllMuZero;
+    //@}
+
+    //@{
+    /// Partition functions precomputed with PrecomputePartitionFunctions()
+    std::vector<double> m_PrecomputedKey;
+    std::vector<double> m_PrecomputedVc;
+    std::vector< std::vector<double> > m_PrecomputedPartialZ;
+    std::vector<double> m_PrecomputedMultExp;
+    std::vector<double> m_PrecomputedMultExpBanalyt;
+    //@}
+
     ThermalModelIdeal *m_modelgce;
 
     int m_BCE, m_QCE, m_SCE, m_CCE;
@@ -47,6 +47,13 @@ namespace thermalfist {
      */
     virtual ~ThermalModelCanonicalCharm(void);
 
+    /**
+     * \brief Creates a copy of the model.
+     *
+     * Overrides ThermalModelBase::Clone().
+     */
+    virtual ThermalModelCanonicalCharm* Clone(ThermalParticleSystem *TPS = NULL) const;
+
     /// Calculates the grand-canonical energy densities
     void CalculateEnergyDensitiesGCE();
 
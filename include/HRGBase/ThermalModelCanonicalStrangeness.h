@@ -47,6 +47,13 @@ namespace thermalfist {
      */
     virtual ~ThermalModelCanonicalStrangeness(void);
 
+    /**
+     * \brief Creates a copy of the model.
+     *
+     * Overrides ThermalModelBase::Clone().
+     */
+    virtual ThermalModelCanonicalStrangeness* Clone(ThermalParticleSystem *TPS = NULL) const;
+
     /// Calculates the grand-canonical energy densities
     virtual void CalculateEnergyDensitiesGCE();
 
@@ -58,11 +65,20 @@ namespace thermalfist {
      * 
      * Uses the series over the Bessel functions 
      * as described in [https://arxiv.org/pdf/hep-ph/0106066.pdf](https://arxiv.org/pdf/hep-ph/0106066.pdf)
+     * The series is truncated adaptively, see CalculateZsums().
      * 
      * \param Vc The strangeness correlation volume (fm\f$^3\f$)
      */
     virtual void CalculateSums(double Vc);
 
+    /**
+     * \brief Estimate of the relative truncation error of the
+     *        partition functions computed in the last CalculateSums() call.
+     *
+     * Given by the relative contribution of the last included shell of terms.
+     */
+    double PartitionFunctionsTruncationError() const { return m_ZsumsError; }
+
     /// A vector of the grand-canonical particle number densities
     const std::vector<double>& DensitiesGCE() const { return m_densitiesGCE; }
 
@@ -132,6 +148,16 @@ namespace thermalfist {
     // Override functions end
 
   protected:
+    /**
+     * \brief Evaluates the Bessel series for the strangeness-canonical
+     *        partition functions from the partial sums m_partialS.
+     *
+     * The terms are summed over square shells of increasing size in the (m,n) plane
+     * until the shell contributions become negligible. The Bessel function values are
+     * computed only once per call.
+     */
+    void CalculateZsums();
+
     std::vector<double> m_densitiesGCE;
     std::vector<double> m_energydensitiesGCE;
     std::vector<double> m_pressuresGCE;
@@ -139,6 +165,7 @@ namespace thermalfist {
     std::map<int, int>  m_StrMap;
     std::vector<double> m_Zsum;
     std::vector<double> m_partialS;
+    double m_ZsumsError;
   };
 
 } // namespace thermalfist
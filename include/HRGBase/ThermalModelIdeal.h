@@ -15,6 +15,14 @@ namespace thermalfist {
   /**
    * \brief Class implementing the Ideal HRG model.
    * 
+   * The primordial densities of species obeying Maxwell-Boltzmann statistics
+   * depend on the chemical potentials and the fugacities \f$ \gamma_q,\,\gamma_S,\,\gamma_C \f$
+   * only through the factor \f$ \exp(\mu_i^{\rm eff} / T) \f$.
+   * When the temperature is unchanged, CalculatePrimordialDensities() therefore
+   * rescales the densities evaluated previously instead of repeating
+   * the (possibly width-integrated) ideal gas calculation.
+   * The reference values are invalidated when the temperature,
+   * the resonance width treatment, or the properties of a species change.
    */
   class ThermalModelIdeal : public ThermalModelBase
   {
@@ -33,16 +41,52 @@ namespace thermalfist {
      */
     virtual ~ThermalModelIdeal(void);
 
+    /**
+     * \brief Creates a copy of the model.
+     *
+     * Overrides ThermalModelBase::Clone().
+     */
+    virtual ThermalModelIdeal* Clone(ThermalParticleSystem *TPS = NULL) const;
+
     // Override functions begin
 
     virtual void CalculatePrimordialDensities();
 
+    /**
+     * \brief Calculates the primordial and final densities
+     *        of all species for a set of thermal parameters.
+     *
+     * Overrides ThermalModelBase::CalculateDensitiesBatch().
+     * The points are processed for each species in turn, in parallel over the species.
+     * For Maxwell-Boltzmann species the (width-integrated) density at zero chemical potential
+     * is evaluated once for each temperature and rescaled with the fugacity factor.
+     * The state of the model is not changed.
+     * Falls back to the base implementation if the chemical potentials are constrained
+     * or the eBW scheme is used.
+     */
+    virtual void CalculateDensitiesBatch(const std::vector<ThermalModelParameters> & params,
+      std::vector< std::vector<double> > & primordial,
+      std::vector< std::vector<double> > & totals,
+      bool constrainChemicalPotentials = false);
+
     virtual void CalculateTwoParticleCorrelations();
 
     virtual void CalculateFluctuations();
 
     virtual std::vector<double> CalculateChargeFluctuations(const std::vector<double> &chgs, int order = 4);
 
+    /**
+     * \brief Calculates the diagonal susceptibilities of several charges at once.
+     * 
+     * The susceptibilities of the charges are weighted sums of the 
+     * ideal gas susceptibilities of the individual species, 
+     * \f$ \chi_n^Q = \sum_i q_i^n \chi_n^{(i)} \f$.
+     * The latter are computed once for all charges and orders,
+     * in parallel over the species if OpenMP is used.
+     * Arbitrary orders are supported.
+     */
+    virtual std::vector< std::vector<double> > CalculateChargeFluctuationsBatch(const std::vector< std::vector<double> > &chgs, int order = 4);
+
     virtual double CalculateEnergyDensity();
 
     virtual double CalculateEntropyDensity();
@@ -62,6 +106,35 @@ namespace thermalfist {
     virtual double ParticleScalarDensity(int part);
 
     // Override functions end
+
+  protected:
+    /// The ideal HRG has no internal state besides the densities, see ThermalModelBase::SetResultCache()
+    virtual bool IsResultCacheSupported() const { return true; }
+
+  private:
+    /// Chemical potential of species i including the contributions of the fugacities \f$ \gamma_q,\,\gamma_S,\,\gamma_C \f$
+    double EffectiveChemicalPotential(int i) const;
+
+    /// Chemical potential mu of a species including the contributions of the fugacities \f$ \gamma_q,\,\gamma_S,\,\gamma_C \f$
+    static double EffectiveChemicalPotential(const ThermalParticle& part, const ThermalModelParameters& params, double mu);
+
+    /// Properties of species i which determine its density apart from T and the chemical potential
+    void SpeciesSignature(int i, double *signature) const;
+
+    /// Temperature of the reference densities
+    double m_ReferenceT;
+
+    /// Whether the resonance widths were used for the reference densities
+    bool m_ReferenceUseWidth;
+
+    /// Effective chemical potentials of the reference densities
+    std::vector<double> m_ReferenceMu;
+
+    /// Reference densities of Maxwell-Boltzmann species, zero if not available
+    std::vector<double> m_ReferenceDensities;
+
+    /// Signatures of the species for the reference densities
+    std::vector<double> m_ReferenceSignatures;
   };
 
 } // namespace thermalfist
@@ -0,0 +1,142 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2014-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#ifndef THERMALMODELRESULTCACHE_H
+#define THERMALMODELRESULTCACHE_H
+
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "HRGBase/ThermalModelParameters.h"
+
+namespace thermalfist {
+
+  /**
+   * \brief The results of a single thermal model calculation stored in a ThermalModelResultCache.
+   */
+  struct ThermalModelCachedResult {
+    ThermalModelParameters Parameters;                         ///< Thermal parameters, including the constrained chemical potentials
+    double MaxDiff;                                            ///< Accuracy of the solution of the model equations
+    std::vector<double> Densities;                             ///< Primordial densities
+    std::vector<double> TotalDensities;                        ///< Final densities according to the stability flags
+    std::vector< std::vector<double> > DensitiesByFeeddown;    ///< Final densities for all feeddown types
+    std::vector<double> State;                                 ///< Model specific internal state, e.g. the solved shifts of the chemical potentials
+
+    ThermalModelCachedResult() : MaxDiff(0.) { }
+  };
+
+  /**
+   * \brief A memoization cache for the results of thermal model calculations.
+   *
+   * The results are indexed by a key which is a vector of numbers describing
+   * the model setup completely (model type, particle list, interaction parameters,
+   * thermal parameters). The keys are stored as 128-bit hashes.
+   * The least recently used results are discarded when
+   * the number of stored results exceeds the capacity.
+   *
+   * Optionally, the results are also stored in a file (disk store).
+   * The file is append-only: new results are appended at the end, and the
+   * results appended by other processes sharing the same file are picked up on lookup.
+   * Each record starts with a marker and ends with a checksum of its contents.
+   * Incomplete or corrupted records, e.g. from interrupted or interleaved writes,
+   * are skipped, and the reading resumes at the next record marker.
+   * The native byte order is used.
+   *
+   * The same cache can be shared by several model objects, see ThermalModelBase::SetResultCache().
+   * The class is not thread-safe.
+   */
+  class ThermalModelResultCache
+  {
+  public:
+    /**
+     * \brief Construct a new ThermalModelResultCache object
+     *
+     * \param capacity Maximum number of results kept in memory
+     */
+    ThermalModelResultCache(int capacity = 1000);
+
+    /// Maximum number of results kept in memory
+    int Capacity() const { return m_Capacity; }
+
+    /// Sets the maximum number of results kept in memory
+    void SetCapacity(int capacity);
+
+    /// Number of results kept in memory
+    int Size() const { return static_cast<int>(m_Entries.size()); }
+
+    /// Removes all results from memory. The disk store is not affected.
+    void Clear();
+
+    /**
+     * \brief Attaches the disk store.
+     *
+     * The file is created if it does not exist.
+     *
+     * \param filename Path to the file
+     * \return true if the file could be opened and has the proper format
+     */
+    bool SetDiskStore(const std::string& filename);
+
+    /// Detaches the disk store
+    void CloseDiskStore();
+
+    /// Path to the disk store file, empty if the disk store is not used
+    const std::string& DiskStore() const { return m_DiskStore; }
+
+    /**
+     * \brief Looks up the result for the given key.
+     *
+     * \param key    The key
+     * \param result The stored result, if found
+     * \return true if the result was found
+     */
+    bool Lookup(const std::vector<double>& key, ThermalModelCachedResult& result);
+
+    /// Stores the result for the given key
+    void Insert(const std::vector<double>& key, const ThermalModelCachedResult& result);
+
+    /// Number of successful lookups
+    long long Hits() const { return m_Hits; }
+
+    /// Number of unsuccessful lookups
+    long long Misses() const { return m_Misses; }
+
+    /// Resets the lookup statistics
+    void ResetStatistics() { m_Hits = m_Misses = 0; }
+
+  private:
+    typedef std::pair<unsigned long long, unsigned long long> KeyHash;
+    typedef std::list< std::pair<KeyHash, ThermalModelCachedResult> > EntriesList;
+
+    static KeyHash Hash(const std::vector<double>& key);
+
+    void InsertInMemory(const KeyHash& hash, const ThermalModelCachedResult& result);
+
+    /// Indexes the records appended to the disk store since the last scan
+    void ScanDiskStore();
+
+    bool ReadDiskRecord(long long offset, long long size, ThermalModelCachedResult& result) const;
+
+    void AppendDiskRecord(const KeyHash& hash, const ThermalModelCachedResult& result);
+
+    int m_Capacity;
+    EntriesList m_Entries;
+    std::map<KeyHash, EntriesList::iterator> m_Index;
+
+    std::string m_DiskStore;
+    std::map< KeyHash, std::pair<long long, long long> > m_DiskIndex;
+    long long m_DiskScanned;
+
+    long long m_Hits, m_Misses;
+  };
+
+} // namespace thermalfist
+
+#endif
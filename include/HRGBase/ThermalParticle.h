@@ -120,6 +120,21 @@ namespace thermalfist {
     /// Fills coefficients for mass integration in the eBW scheme
     void FillCoefficientsDynamical();
 
+    /**
+     * \brief Fills the mass points and weights for the integration
+     *        over the mass distribution in the current width scheme
+     *
+     * Called by FillCoefficients() and FillCoefficientsDynamical().
+     */
+    void FillWidthIntegrationTable();
+
+    /// Mass points of the integration over the mass distribution in the current width scheme
+    const std::vector<double>& WidthIntegrationMasses() const { return m_xwidth; }
+
+    /// Weights of the integration over the mass distribution in the current width scheme,
+    /// including the branching ratio weights of the ThermalParticle::FullIntervalWeighted scheme
+    const std::vector<double>& WidthIntegrationWeights() const { return m_wwidth; }
+
     /// Total width (eBW scheme) at a given mass
     double TotalWidtheBW(double M) const;
 
@@ -200,6 +215,22 @@ namespace thermalfist {
      */
     double DensityCluster(int n, const ThermalModelParameters &params, IdealGasFunctions::Quantity type = IdealGasFunctions::ParticleDensity, bool useWidth = 0, double mu = 0.) const;
 
+    /**
+     * Computes all the terms in the cluster expansion for all the 
+     * thermodynamic functions at once.
+     * 
+     * The density, pressure, energy density, and scalar density in terms[n-1] 
+     * are the same as those returned by DensityCluster() for the n-th term.
+     * The Bessel functions are evaluated once per term
+     * instead of once per term and thermodynamic function.
+     * 
+     * \param params   Structure containing the temperature value and the chemical factors.
+     * \param terms    The computed terms, up to ClusterExpansionOrder().
+     * \param useWidth Whether finite widths are taken into account.
+     * \param mu       Chemical potential.
+     */
+    void ClusterExpansionTerms(const ThermalModelParameters &params, std::vector<IdealGasFunctions::IdealGasQuantities> &terms, bool useWidth = 0, double mu = 0.) const;
+
     /**
      * \brief Computes the ideal gas generalized susceptibility \f$ \chi_n \equiv \frac{\partial^n p/T^4}{\partial (mu/T)^n} \f$.
      * 
@@ -216,6 +247,20 @@ namespace thermalfist {
      */
     double chi(int index, const ThermalModelParameters &params, bool useWidth = 0, double mu = 0.) const;
 
+    /**
+     * \brief Computes the ideal gas generalized susceptibilities \f$ \chi_1, \ldots, \chi_N \f$ at once.
+     * 
+     * Same as chi() for all orders up to N, but evaluates the integrand
+     * only once for all orders. Arbitrary orders are supported.
+     * 
+     * \param N        The highest order.
+     * \param params   Structure containing the temperature value and the chemical factors.
+     * \param useWidth Whether finite widths are taken into account.
+     * \param mu       Chemical potential.
+     * \return         Vector of the susceptibilities, the element n-1 is \f$ \chi_n \f$.
+     */
+    std::vector<double> chis(int N, const ThermalModelParameters &params, bool useWidth = 0, double mu = 0.) const;
+
     /**
      * \brief Computes the scaled variance of particle number fluctuations
      *        in the ideal gas.
@@ -668,6 +713,16 @@ namespace thermalfist {
 
     std::vector<double> m_xalldyn, m_walldyn, m_densalldyn;
 
+    /**
+    *  Mass points and weights for the integration over the mass distribution
+    *  in the current width scheme, and the sum of the weights
+    */
+    std::vector<double> m_xwidth, m_wwidth;
+    double m_wwidthsum;
+
+    /// Integrates the ideal gas kernel over the mass distribution using the mass points and weights above
+    double IntegrateOverWidth(IdealGasFunctions::IdealGasQuantityKernel kernel, double T, double mu, int order) const;
+
 
     bool m_Stable;                /**< Flag whether particle is marked stable. */
     ParticleDecayType::DecayType m_DecayType;        /**< Type wrt to decay: Stable, Default (placeholder), Weak, Electromagnetic, Strong */
@@ -0,0 +1,152 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2016-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#ifndef INTERACTIONCOMPONENTS_H
+#define INTERACTIONCOMPONENTS_H
+
+#include <vector>
+
+/**
+ * \file InteractionComponents.h
+ *
+ * \brief Contains the block (component) decomposition of the
+ *        interaction parameters of the multi-component
+ *        excluded volume and QvdW models.
+ *
+ */
+
+namespace thermalfist {
+
+  /**
+   * \brief Partition of the particle species into components with
+   *        identical interaction parameters.
+   *
+   * Two species belong to the same component if the corresponding
+   * rows of the excluded volume matrix \f$ \tilde{b}_{ij} \f$ and of the
+   * symmetrized attraction matrix \f$ a_{ij} + a_{ji} \f$ coincide.
+   *
+   * In typical applications (e.g. baryon-baryon interactions only, or
+   * a few distinct eigenvolumes) the number of components K is much
+   * smaller than the number of species N. The matrices then have the
+   * block form \f$ \tilde{b} = P \, \tilde{b}^K \f$, with P the N x K
+   * indicator matrix of the components and \f$ \tilde{b}^K \f$ the K x N
+   * matrix of the representative rows, and the linear systems of the
+   * multi-component models can be reduced to K-dimensional ones.
+   */
+  class InteractionComponents
+  {
+  public:
+    /// Constructs an empty partition
+    InteractionComponents() { }
+
+    /**
+     * \brief Groups the species into components.
+     *
+     * \param b The excluded volume matrix \f$ \tilde{b}_{ij} \f$
+     * \param a The attraction matrix \f$ a_{ij} \f$. Can be empty.
+     */
+    InteractionComponents(const std::vector< std::vector<double> >& b,
+      const std::vector< std::vector<double> >& a = std::vector< std::vector<double> >());
+
+    /// Number of particle species N
+    int SpeciesNumber() const { return static_cast<int>(m_ComponentOf.size()); }
+
+    /// Number of components K
+    int ComponentsNumber() const { return static_cast<int>(m_Members.size()); }
+
+    /// 0-based index of the component of species i
+    int Component(int i) const { return m_ComponentOf[i]; }
+
+    /// Vector of component indices of all species
+    const std::vector<int>& ComponentMap() const { return m_ComponentOf; }
+
+    /// Indices of the species in the k-th component
+    const std::vector<int>& Members(int k) const { return m_Members[k]; }
+
+    /// Index of a species which represents the k-th component
+    int Representative(int k) const { return m_Members[k][0]; }
+
+    /// Indices of the representative species of all components
+    std::vector<int> Representatives() const;
+
+    /// Whether the reduced linear algebra is expected to pay off, i.e. \f$ 2K \leq N \f$
+    bool IsReducible() const { return 2 * ComponentsNumber() <= SpeciesNumber(); }
+
+  private:
+    std::vector<int> m_ComponentOf;
+    std::vector< std::vector<int> > m_Members;
+  };
+
+  /**
+   * \brief Solves the linear system for the responses of the densities
+   *        and of the shifted chemical potentials in the
+   *        multi-component EV and QvdW models.
+   *
+   * The system reads
+   * \f[
+   *   \delta n_i + n_i^{\rm id} \sum_j \tilde{b}_{ji} \delta n_j + c_i \, \delta \mu^*_i = x_i,
+   * \f]
+   * \f[
+   *   - \sum_j (a_{ij} + a_{ji}) \delta n_j + \delta \mu^*_i + \sum_j \tilde{b}_{ij} n_j^{\rm id} \delta \mu^*_j = y_i.
+   * \f]
+   *
+   * If the interactions have only few components (InteractionComponents::IsReducible())
+   * the system is solved through the Woodbury identity: the factorization
+   * involves a 2K x 2K matrix and each solution costs O(NK) operations.
+   * Otherwise the full 2N x 2N system is factorized.
+   *
+   * The object is not copyable. Solve() can be called from several threads.
+   */
+  class InteractionResponseSolver
+  {
+  public:
+    /**
+     * \brief Prepares the factorization of the linear system.
+     *
+     * \param components The components of the interaction matrices
+     * \param b          The excluded volume matrix \f$ \tilde{b}_{ij} \f$
+     * \param a          The attraction matrix \f$ a_{ij} \f$. Can be empty.
+     * \param nid        The ideal gas densities \f$ n_i^{\rm id} \f$
+     * \param c          The coefficients \f$ c_i \f$
+     */
+    InteractionResponseSolver(const InteractionComponents& components,
+      const std::vector< std::vector<double> >& b,
+      const std::vector< std::vector<double> >& a,
+      const std::vector<double>& nid,
+      const std::vector<double>& c);
+
+    ~InteractionResponseSolver();
+
+    /// Whether the reduced 2K x 2K system is used
+    bool IsReduced() const { return m_Reduced; }
+
+    /**
+     * \brief Solves the system for the given right-hand side.
+     *
+     * \param x    The right-hand side of the first N equations
+     * \param y    The right-hand side of the last N equations
+     * \param dn   The solution \f$ \delta n_i \f$
+     * \param dmu  The solution \f$ \delta \mu^*_i \f$
+     */
+    void Solve(const std::vector<double>& x, const std::vector<double>& y,
+      std::vector<double>& dn, std::vector<double>& dmu) const;
+
+  private:
+    InteractionResponseSolver(const InteractionResponseSolver&);
+    InteractionResponseSolver& operator=(const InteractionResponseSolver&);
+
+    struct Decomposition;
+
+    InteractionComponents m_Components;
+    bool m_Reduced;
+    std::vector<double> m_nid, m_c;
+    Decomposition* m_Decomposition;
+  };
+
+} // namespace thermalfist
+
+#endif
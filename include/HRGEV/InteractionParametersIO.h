@@ -0,0 +1,85 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2020 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#ifndef INTERACTIONPARAMETERSIO_H
+#define INTERACTIONPARAMETERSIO_H
+
+#include <string>
+#include <vector>
+
+/**
+ * \file InteractionParametersIO.h
+ *
+ * \brief Contains the routines for reading and writing the pairwise
+ *        interaction parameters of the Crossterms excluded volume
+ *        and the QvdW models in a compact binary format.
+ *
+ * The binary file stores only the non-default (non-zero) parameters,
+ * identified by the PDG IDs of the particle pairs, in one of two layouts:
+ *
+ *   - sparse: a list of the particle pairs with non-zero parameters;
+ *   - block: a class index for each interacting particle species
+ *     together with the dense matrices of the parameters between the classes.
+ *     Species in the same class have identical rows and columns of the
+ *     parameter matrices. This layout is chosen if there are few distinct classes,
+ *     e.g. for the baryon-baryon QvdW interactions.
+ *
+ * The writer picks the smaller of the two layouts. All the numbers are written in
+ * the native byte order, the file is read with a single bulk read and no text parsing.
+ * ThermalModelEVCrossterms::ReadInteractionParameters() and
+ * ThermalModelVDW::ReadInteractionParameters() recognize the binary files
+ * automatically. The EVTablesGenerator routine converts between
+ * the text and the binary formats.
+ *
+ */
+
+namespace thermalfist {
+
+  class ThermalParticleSystem;
+
+  /// \brief Routines for the binary files with the interaction parameters
+  namespace InteractionParametersIO {
+
+    /// Whether the file exists and is in the binary format
+    bool IsBinaryFile(const std::string &filename);
+
+    /**
+     * \brief Reads the interaction parameters from a binary file.
+     *
+     * The parameters of the particle pairs not listed in the file,
+     * or involving species absent from the particle list, are set to zero.
+     *
+     * \param filename The file name
+     * \param TPS      The particle list
+     * \param b        The excluded volume matrix \f$ b_{ij} \f$, resized to N x N
+     * \param a        The attraction matrix \f$ a_{ij} \f$, resized to N x N.
+     *                 If NULL, the attraction parameters are ignored.
+     * \return true if the file was read successfully, false otherwise
+     */
+    bool ReadBinary(const std::string &filename, ThermalParticleSystem *TPS,
+      std::vector< std::vector<double> > &b,
+      std::vector< std::vector<double> > *a = NULL);
+
+    /**
+     * \brief Writes the interaction parameters to a binary file.
+     *
+     * \param filename The file name
+     * \param TPS      The particle list
+     * \param b        The excluded volume matrix \f$ b_{ij} \f$
+     * \param a        The attraction matrix \f$ a_{ij} \f$.
+     *                 If NULL or all zero, only the excluded volume parameters are written.
+     * \return true if the file was written successfully, false otherwise
+     */
+    bool WriteBinary(const std::string &filename, ThermalParticleSystem *TPS,
+      const std::vector< std::vector<double> > &b,
+      const std::vector< std::vector<double> > *a = NULL);
+
+  } // namespace InteractionParametersIO
+
+} // namespace thermalfist
+
+#endif
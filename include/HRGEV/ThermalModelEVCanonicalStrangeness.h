@@ -50,6 +50,13 @@ namespace thermalfist {
      */
     virtual ~ThermalModelEVCanonicalStrangeness(void);
 
+    /**
+     * \brief Creates a copy of the model.
+     *
+     * Overrides ThermalModelBase::Clone().
+     */
+    virtual ThermalModelEVCanonicalStrangeness* Clone(ThermalParticleSystem *TPS = NULL) const;
+
     /// \copydoc thermalfist::ThermalModelEVDiagonal::FillVirialEV()
     void FillVirialEV(const std::vector<double> & vi = std::vector<double>(0));
 
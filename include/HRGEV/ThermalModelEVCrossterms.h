@@ -9,6 +9,7 @@
 #define THERMALMODELEVCROSSTERMS_H
 
 #include "HRGBase/ThermalModelBase.h"
+#include "HRGEV/InteractionComponents.h"
 
 namespace thermalfist {
 
@@ -50,10 +51,18 @@ namespace thermalfist {
      */
     virtual ~ThermalModelEVCrossterms(void);
 
+    /**
+     * \brief Creates a copy of the model.
+     *
+     * Overrides ThermalModelBase::Clone().
+     */
+    virtual ThermalModelEVCrossterms* Clone(ThermalParticleSystem *TPS = NULL) const;
+
     // Override functions begin
 
     virtual void FillVirial(const std::vector<double> & ri = std::vector<double>(0));
 
+    /// Reads the parameters from a text file or from a binary file written by InteractionParametersIO::WriteBinary()
     virtual void ReadInteractionParameters(const std::string &filename);
 
     virtual void WriteInteractionParameters(const std::string &filename);
@@ -191,18 +200,37 @@ namespace thermalfist {
      */
     virtual double MuShift(int i) const;
 
+    // Result cache, see ThermalModelBase::SetResultCache()
+
+    virtual bool IsResultCacheSupported() const { return true; }
+
+    virtual void AppendResultCacheKey(std::vector<double> & key) const;
+
+    virtual void StoreResultCacheState(std::vector<double> & state) const;
+
+    virtual void RestoreResultCacheState(const std::vector<double> & state);
+
     std::vector<double> m_densitiesid;            /**< Vector of ideal gas densities with shifted chemical potentials */
     std::vector<double> m_Ps;                     /**< Vector of (solved) partial pressures */
     std::vector< std::vector<double> > m_Virial;  /**< Matrix of virial (excluded-volume) coefficients \f$ \tilde{b}_{ij} \f$ */
     double m_Pressure;                            /**< The (solved) total pressure */
     double m_TotalEntropyDensity;                 /**< The (solved) entropy pressure */
 
+    /// Component decomposition of m_Virial, empty if it has to be recomputed
+    InteractionComponents m_Components;
+
+    /// Component decomposition of the excluded volume matrix, computed on demand
+    const InteractionComponents& Components();
+
   private:
     class BroydenEquationsCRS : public BroydenEquations
     {
     public:
       BroydenEquationsCRS(ThermalModelEVCrossterms *model) : BroydenEquations(), m_THM(model) { m_N = model->Densities().size(); }
       std::vector<double> Equations(const std::vector<double> &x);
+      void EvaluateEquations(const std::vector<double> &x, std::vector<double> &f);
+      /// The equations only read the model, the copy shares it
+      BroydenEquations* Clone() const { return new BroydenEquationsCRS(m_THM); }
     private:
       ThermalModelEVCrossterms *m_THM;
     };
@@ -212,6 +240,9 @@ namespace thermalfist {
     public:
       BroydenEquationsCRSDEV(ThermalModelEVCrossterms *model) : BroydenEquations(), m_THM(model) { m_N = 1; }
       std::vector<double> Equations(const std::vector<double> &x);
+      void EvaluateEquations(const std::vector<double> &x, std::vector<double> &f);
+      /// The equations only read the model, the copy shares it
+      BroydenEquations* Clone() const { return new BroydenEquationsCRSDEV(m_THM); }
     private:
       ThermalModelEVCrossterms *m_THM;
     };
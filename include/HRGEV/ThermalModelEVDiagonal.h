@@ -59,6 +59,13 @@ namespace thermalfist {
      */
     virtual ~ThermalModelEVDiagonal(void);
 
+    /**
+     * \brief Creates a copy of the model.
+     *
+     * Overrides ThermalModelBase::Clone().
+     */
+    virtual ThermalModelEVDiagonal* Clone(ThermalParticleSystem *TPS = NULL) const;
+
     /**
      * \brief Same as FillVirial() but uses the diagonal excluded-volume
      *        coefficients \f$ v_i \equiv b_{ii} \f$ as input instead of radii.
@@ -250,6 +257,16 @@ namespace thermalfist {
      */
     virtual double MuShift(int i) const;
 
+    // Result cache, see ThermalModelBase::SetResultCache()
+
+    virtual bool IsResultCacheSupported() const { return true; }
+
+    virtual void AppendResultCacheKey(std::vector<double> & key) const;
+
+    virtual void StoreResultCacheState(std::vector<double> & state) const;
+
+    virtual void RestoreResultCacheState(const std::vector<double> & state);
+
     std::vector<double> m_densitiesid;             /**< Vector of ideal gas densities with shifted chemical potentials */
     std::vector<double> m_densitiesidnoshift;      /**< Vector of ideal gas densities without shifted chemical potentials */
     std::vector<double> m_v;                       /**< Vector of eigenvolumes of all hadrons */
@@ -265,6 +282,9 @@ namespace thermalfist {
     public:
       BroydenEquationsDEV(ThermalModelEVDiagonal *model) : BroydenEquations(), m_THM(model) { m_N = 1; m_mnc = 1.; }
       std::vector<double> Equations(const std::vector<double> &x);
+      void EvaluateEquations(const std::vector<double> &x, std::vector<double> &f);
+      /// The equations only read the model, the copy shares it
+      BroydenEquations* Clone() const { return new BroydenEquationsDEV(*this); }
       void SetMnc(double mnc) { m_mnc = mnc; }
     private:
       ThermalModelEVDiagonal *m_THM;
@@ -296,6 +316,9 @@ namespace thermalfist {
     public:
       BroydenEquationsDEVOrig(ThermalModelEVDiagonal *model) : BroydenEquations(), m_THM(model) { m_N = 1; }
       std::vector<double> Equations(const std::vector<double> &x);
+      void EvaluateEquations(const std::vector<double> &x, std::vector<double> &f);
+      /// The equations only read the model, the copy shares it
+      BroydenEquations* Clone() const { return new BroydenEquationsDEVOrig(*this); }
     private:
       ThermalModelEVDiagonal *m_THM;
     };
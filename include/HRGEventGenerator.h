@@ -15,3 +15,4 @@
 #include "HRGEventGenerator/SREventGenerator.h"
 #include "HRGEventGenerator/SSHEventGenerator.h"
 #include "HRGEventGenerator/CracowFreezeoutEventGenerator.h"
+#include "HRGEventGenerator/HypersurfaceEventGenerator.h"
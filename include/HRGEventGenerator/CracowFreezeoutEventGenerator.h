@@ -51,6 +51,10 @@ namespace thermalfist {
     double GetTkin() const { return m_T; }
     double GetRoverTauH() const { return m_RoverTauH; }
     double GetEtaMax() const { return m_EtaMax; }
+  protected:
+    /// Creates the momentum generator of the i-th species
+    RandomGenerators::ParticleMomentumGenerator* CreateMomentumGenerator(int i) const;
+
   private:
     double m_T, m_RoverTauH, m_EtaMax;
   };
@@ -66,6 +66,10 @@ namespace thermalfist {
     double GetBetaSurface() const { return m_BetaS; }
     double GetNPow() const { return m_n; }
     double GetEtaMax() const { return m_EtaMax; }
+  protected:
+    /// Creates the momentum generator of the i-th species
+    RandomGenerators::ParticleMomentumGenerator* CreateMomentumGenerator(int i) const;
+
   private:
     double m_T, m_BetaS, m_EtaMax, m_n;
   };
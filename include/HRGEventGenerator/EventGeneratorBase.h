@@ -10,6 +10,10 @@
 
 
 #include <sstream>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
 
 #include "HRGEventGenerator/SimpleEvent.h"
 #include "HRGEventGenerator/Acceptance.h"
@@ -90,7 +94,7 @@ namespace thermalfist {
   {
   public:
     /// Constructor
-    EventGeneratorBase() { m_THM = NULL; fCEAccepted = fCETotal = 0; }
+    EventGeneratorBase() { m_THM = NULL; fCEAccepted = fCETotal = 0; m_AcceptanceYcm = 0.; m_GeneratorsT = 0.; }
 
     /// Destructor
     virtual ~EventGeneratorBase();
@@ -98,6 +102,32 @@ namespace thermalfist {
     /// Clears the momentum generators for all particles
     void ClearMomentumGenerators();
 
+    /**
+     * \brief Momentum generator of the i-th species.
+     *
+     * The generator is constructed on first use. Species with identical
+     * MomentumGeneratorKey() share a single generator instance.
+     * Safe to call from several threads simultaneously.
+     */
+    RandomGenerators::ParticleMomentumGenerator* GetMomentumGenerator(int i) const;
+
+    /**
+     * \brief Resonance mass generator of the i-th species.
+     *
+     * The generator is constructed on first use. Species with identical
+     * mass distributions share a single generator instance.
+     * Safe to call from several threads simultaneously.
+     */
+    RandomGenerators::ThermalBreitWignerGenerator* GetBWGenerator(int i) const;
+
+    /**
+     * \brief Constructs in advance the generators of all species.
+     *
+     * Optional, the generators are otherwise constructed on demand
+     * during the event generation. Runs in parallel if OpenMP is enabled.
+     */
+    void PrepareMomentumGenerators() const;
+
     /// Sets the projectile laboratory kinetic energy per nucleon of the collision
     void SetCollisionKineticEnergy(double ekin) {
       SetCollisionCMSEnergy(sqrt(2.*xMath::mnucleon()*(ekin + 2. * xMath::mnucleon())));
@@ -170,6 +200,50 @@ namespace thermalfist {
 
     
 
+    /**
+     * \brief Enables the accepted-particle fast path.
+     *
+     * For every species i with a non-NULL acceptance function acceptance[i]
+     * only the particles which pass the y-pT acceptance are generated.
+     * First, the momentum-integrated acceptance probability \f$ \bar{p}_i \f$
+     * is precomputed by quadrature over the momentum distribution
+     * (RandomGenerators::ParticleMomentumGenerator::AcceptedFraction()),
+     * or by Monte Carlo for the momentum generators and mass distributions where no quadrature is available.
+     * In each event the sampled primordial
+     * multiplicity \f$ N_i \f$ is then thinned binomially,
+     * \f$ N_i^{\rm acc} \sim {\rm Bin}(N_i, \bar{p}_i) \f$,
+     * and the momenta of the accepted particles are drawn from the
+     * acceptance-weighted distribution \f$ f_i(p) \, A_i(y,p_T) / \bar{p}_i \f$.
+     *
+     * As the momenta of particles are independent of the multiplicities in all the
+     * supported ensembles, this procedure is exact (up to the Monte Carlo error of \f$ \bar{p}_i \f$)
+     * for the accepted primordial particles of stable species.
+     *
+     * For species with a fixed mass whose momentum generator provides the y-pT density
+     * (RandomGenerators::ParticleMomentumGenerator::YPtDensity()), the acceptance-weighted
+     * distribution is tabulated in y and \f$ \exp(-p_T) \f$ and the momenta of the accepted particles
+     * are sampled from the table directly (RandomGenerators::InverseCDFTable2D), at a cost per
+     * accepted particle which does not depend on \f$ \bar{p}_i \f$.
+     * The distribution is then reproduced up to the bilinear interpolation error of the table.
+     * Otherwise (finite resonance widths, Bose-Einstein condensation, or other momentum generators) the momenta are obtained by rejection,
+     * which takes about \f$ 1/\bar{p}_i \f$ momentum draws per accepted particle.
+     * The fast path is not applied to unstable species, since the acceptance of their
+     * decay products depends on the parent momentum. Particles of a fast-path species
+     * which are produced in resonance decays are not filtered by the acceptance.
+     *
+     * \param acceptance  Acceptance function for each species, NULL for species to be generated in full.
+     *                    The objects must persist while the fast path is used.
+     * \param ycm         Center-of-mass rapidity, the acceptance is evaluated at y + ycm
+     * \param samples     Number of Monte Carlo samples used to evaluate \f$ \bar{p}_i \f$ where no quadrature is available
+     */
+    void SetAcceptedParticlesFastPath(const std::vector<Acceptance::AcceptanceFunction*>& acceptance, double ycm = 0., int samples = 100000);
+
+    /// Switches off the accepted-particle fast path
+    void ClearAcceptedParticlesFastPath();
+
+    /// Momentum-integrated acceptance probability of the i-th species, unity if the fast path is not used for it
+    double AcceptanceProbability(int i) const;
+
     /// Helper variable to monitor the Acceptance rate of the rejection
     /// sampling used for canonical ensemble and/or eigenvolumes.
     static int fCEAccepted, fCETotal;
@@ -262,20 +336,96 @@ namespace thermalfist {
     /// \return A vector of the sampled multiplicities
     std::vector<int> GenerateTotalsCCESubVolume(double VolumeSC) const;
 
+    /// Samples the mass of a particle of the i-th species, taking into account the resonance width
+    double SampleParticleMass(int i) const;
+
+    /// Whether the particle of the i-th species with the given momentum passes the fast-path acceptance
+    bool AcceptParticle(int i, const std::vector<double>& momentum, double mass) const;
+
+    /**
+     * \brief Resets the momentum and resonance mass generators.
+     *
+     * Existing generators are destroyed. The new ones are created
+     * on demand by GetMomentumGenerator() and GetBWGenerator().
+     * The temperature and chemical potentials of the thermal model are
+     * stored at this point, see GeneratorTemperature() and GeneratorChemicalPotential(),
+     * so that the generators do not depend on when they are first used.
+     * The particle list itself is used as is at construction time and must
+     * not be modified before a new call to SetMomentumGenerators().
+     */
+    void ResetMomentumGenerators();
+
+    /// Temperature of the thermal model at the last call to ResetMomentumGenerators()
+    double GeneratorTemperature() const { return m_GeneratorsT; }
+
+    /// Chemical potential of the i-th species at the last call to ResetMomentumGenerators()
+    double GeneratorChemicalPotential(int i) const { return m_GeneratorsMu[i]; }
+
+    /**
+     * \brief Creates a new momentum generator for the i-th species.
+     *
+     * Called on first use of the generator, possibly from several threads.
+     * Should use GeneratorTemperature() and GeneratorChemicalPotential()
+     * rather than the current state of the thermal model.
+     */
+    virtual RandomGenerators::ParticleMomentumGenerator* CreateMomentumGenerator(int /*i*/) const { return NULL; }
+
+    /**
+     * \brief Parameters which fully determine the momentum generator of the i-th species.
+     *
+     * Species with equal keys share the same generator.
+     * The default implementation returns the mass, statistics,
+     * and chemical potential, which is appropriate when the
+     * remaining parameters of the generator are common to all species.
+     * An empty key means that the generator is not shared.
+     */
+    virtual std::vector<double> MomentumGeneratorKey(int i) const;
+
+    /// Creates a new resonance mass generator for the i-th species
+    virtual RandomGenerators::ThermalBreitWignerGenerator* CreateBWGenerator(int i) const;
+
+    /// Parameters which fully determine the resonance mass distribution of the i-th species
+    std::vector<double> BWGeneratorKey(int i) const;
+
     EventGeneratorConfiguration m_Config;
     ThermalModelBase *m_THM;
 
     /// Ideal gas densities used for sampling an interacting HRG
     std::vector<double> m_DensitiesIdeal;
 
-    /// Vector of momentum generators for each particle species
-    std::vector<RandomGenerators::ParticleMomentumGenerator*>    m_MomentumGens;
+    /// Vector of momentum generators for each particle species, NULL if not yet constructed
+    mutable std::vector< std::atomic<RandomGenerators::ParticleMomentumGenerator*> >    m_MomentumGens;
 
-    /// Vector of particle mass generators for each particle species
+    /// Vector of particle mass generators for each particle species, NULL if not yet constructed
     /// Used if finite resonance widths are considered
-    std::vector<RandomGenerators::ThermalBreitWignerGenerator*>  m_BWGens;
+    mutable std::vector< std::atomic<RandomGenerators::ThermalBreitWignerGenerator*> >  m_BWGens;
+
+    /// Acceptance functions used in the accepted-particle fast path
+    std::vector<const Acceptance::AcceptanceFunction*> m_AcceptanceFast;
+
+    /// Momentum-integrated acceptance probabilities for the accepted-particle fast path
+    std::vector<double> m_AcceptanceProbabilities;
+
+    /// Center-of-mass rapidity for the accepted-particle fast path
+    double m_AcceptanceYcm;
+
+    /// Tabulated y-pT distributions of the accepted particles for the accepted-particle fast path,
+    /// NULL where the momenta are sampled by rejection
+    std::vector< std::shared_ptr<const RandomGenerators::InverseCDFTable2D> > m_AcceptedMomentumTables;
 
   private:
+    //@{
+    /// Generators owned by the event generator, and the generators shared between species
+    mutable std::vector<RandomGenerators::ParticleMomentumGenerator*> m_OwnedMomentumGens;
+    mutable std::vector<RandomGenerators::ThermalBreitWignerGenerator*> m_OwnedBWGens;
+    mutable std::map< std::vector<double>, RandomGenerators::ParticleMomentumGenerator* > m_SharedMomentumGens;
+    mutable std::map< std::vector<double>, RandomGenerators::ThermalBreitWignerGenerator* > m_SharedBWGens;
+    mutable std::mutex m_GeneratorsMutex;
+
+    /// Thermal parameters stored by ResetMomentumGenerators()
+    double m_GeneratorsT;
+    std::vector<double> m_GeneratorsMu;
+    //@}
 
     /// Currently not used
     //static SimpleEvent PerformDecaysAlternativeWay(const SimpleEvent& evtin, ThermalParticleSystem* TPS);
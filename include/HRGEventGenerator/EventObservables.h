@@ -0,0 +1,304 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2014-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#ifndef EVENTOBSERVABLES_H
+#define EVENTOBSERVABLES_H
+
+#include <vector>
+#include <map>
+
+#include "HRGBase/ThermalParticleSystem.h"
+#include "HRGEventGenerator/SimpleEvent.h"
+
+namespace thermalfist {
+
+  /**
+   * \brief Streaming accumulator of the (weighted) moments of a single event-by-event quantity.
+   *
+   * Stores the mean and the weighted sums of the powers of the deviations
+   * from the mean up to 12th order, which is sufficient to evaluate the
+   * cumulants up to 6th order together with their statistical errors.
+   * The sums are updated in a single pass with the formulas of
+   * P. Pebay, SAND2008-6212, which avoids the cancellations of the
+   * raw power sums for large means.
+   * Two accumulators filled independently (e.g. in different threads)
+   * can be combined with Merge().
+   *
+   * Errors are evaluated with the delta method, using the effective
+   * number of events \f$ (\sum w)^2 / \sum w^2 \f$ for weighted events.
+   */
+  class MomentsAccumulator
+  {
+  public:
+    /// Highest order of the moments which are accumulated
+    static const int MaxMoment = 12;
+
+    MomentsAccumulator() { Reset(); }
+
+    /// Clears all the accumulated sums
+    void Reset();
+
+    /// Adds a single event with value x and weight w
+    void Add(double x, double w = 1.);
+
+    /// Adds the sums accumulated in another accumulator
+    void Merge(const MomentsAccumulator& other);
+
+    /// Number of added events
+    long long Events() const { return m_Events; }
+
+    /// Sum of the event weights
+    double SumOfWeights() const { return m_Sums[0]; }
+
+    /// Effective number of events \f$ (\sum w)^2 / \sum w^2 \f$
+    double EffectiveEvents() const;
+
+    /// Weighted average \f$ \langle x^k \rangle \f$, k <= MaxMoment
+    double RawMoment(int k) const;
+
+    /// Central moment \f$ \langle (x - \langle x \rangle)^k \rangle \f$, k <= MaxMoment
+    double CentralMoment(int k) const;
+
+    /// Cumulant \f$ \kappa_k \f$, k = 1..6
+    double Cumulant(int k) const;
+
+    double Mean() const { return m_Mean; }
+    double MeanError() const;
+    double Variance() const { return CentralMoment(2); }
+    double VarianceError() const;
+    double ScaledVariance() const { return Variance() / Mean(); }
+    double ScaledVarianceError() const { return VarianceError() / Mean(); }
+
+    /// Skewness-like ratio \f$ \kappa_3 / \kappa_2 \f$
+    double C3C2() const;
+    double C3C2Error() const;
+
+    /// Kurtosis-like ratio \f$ \kappa_4 / \kappa_2 \f$
+    double C4C2() const;
+    double C4C2Error() const;
+
+    /// Hyperskewness-like ratio \f$ \kappa_5 / \kappa_2 \f$
+    double C5C2() const;
+    double C5C2Error() const;
+
+    /// Hyperkurtosis-like ratio \f$ \kappa_6 / \kappa_2 \f$
+    double C6C2() const;
+    double C6C2Error() const;
+
+  private:
+    /// Central moments normalized by powers of the standard deviation, mn[k] = m_k / sigma^k
+    std::vector<double> NormalizedCentralMoments() const;
+
+    /**
+     * Adds a set with the sum of weights W, the mean mean, and the sums of the powers
+     * of the deviations from the mean sums (sums[0] = W, sums[1] = 0).
+     */
+    void Combine(double W, double mean, const double *sums);
+
+    /// m_Sums[0] is the sum of weights, m_Sums[k] = \sum w (x - m_Mean)^k for k >= 2
+    double    m_Sums[MaxMoment + 1];
+    double    m_Mean;
+    double    m_W2Sum;
+    long long m_Events;
+  };
+
+  /**
+   * \brief A simple weighted histogram with equidistant bins.
+   *
+   * Values outside the [xmin, xmax) range are counted
+   * in the underflow/overflow bins.
+   */
+  class Histogram1D
+  {
+  public:
+    Histogram1D(double xmin = 0., double xmax = 1., int nbins = 1);
+
+    /// Adds value x with weight w, NaN values are ignored
+    void Fill(double x, double w = 1.);
+
+    /// Clears the histogram contents while keeping the binning
+    void Reset();
+
+    /// Adds the contents of another histogram with the same binning
+    void Merge(const Histogram1D& other);
+
+    int Bins() const { return m_Bins; }
+    double Xmin() const { return m_Xmin; }
+    double Xmax() const { return m_Xmax; }
+    double BinWidth() const { return m_dx; }
+    double BinCenter(int bin) const { return m_Xmin + (bin + 0.5) * m_dx; }
+
+    /// Sum of weights in the given bin
+    double BinContent(int bin) const { return m_Content[bin]; }
+
+    /// Statistical error of the bin content, \f$ \sqrt{\sum w^2} \f$
+    double BinError(int bin) const;
+
+    double Underflow() const { return m_Underflow; }
+    double Overflow() const { return m_Overflow; }
+
+  private:
+    double m_Xmin, m_Xmax, m_dx;
+    int    m_Bins;
+    std::vector<double> m_Content;
+    std::vector<double> m_Content2;
+    double m_Underflow, m_Overflow;
+  };
+
+  /**
+   * \brief Streaming event-by-event analysis of the generated events.
+   *
+   * Accumulates, on the fly, the multiplicity moments of selected
+   * particle species and of the net conserved charges (B, Q, S, C),
+   * the two-particle correlations between all these observables,
+   * as well as the pT, rapidity, and mT - m spectra of the selected species.
+   * Events are not stored, thus arbitrarily large samples can be analyzed.
+   *
+   * The class is not thread-safe. For parallel event generation one
+   * accumulator per thread should be created, e.g. as copies of a single
+   * prototype, and the partial results combined at the end with Merge()
+   * or Reduce():
+   *
+   * \code
+   * EventObservablesAccumulator proto(&TPS, config);
+   * std::vector<EventObservablesAccumulator> partial(nthreads, proto);
+   * // in thread ithr: partial[ithr].AddEvent(generator.GetEvent());
+   * EventObservablesAccumulator total = EventObservablesAccumulator::Reduce(partial);
+   * \endcode
+   *
+   * Each event enters with its weight SimpleEvent::weight.
+   */
+  class EventObservablesAccumulator
+  {
+  public:
+    /// Settings of the accumulated observables
+    struct Config {
+      /// PDG codes of the particle species for which multiplicity moments and spectra are collected
+      std::vector<long long> pdgs;
+      /// Collect the moments of net baryon, electric charge, strangeness, and charm
+      bool computeNetCharges;
+      /// Collect the two-particle correlations between all observables
+      bool computeCorrelations;
+      /// Collect the pT, y, and mT-m spectra of the selected species
+      bool computeSpectra;
+      int    ptBins; ///< Number of pT bins
+      double ptMax;  ///< Maximum pT (GeV)
+      int    yBins;  ///< Number of rapidity bins
+      double yMin;   ///< Minimum rapidity
+      double yMax;   ///< Maximum rapidity
+      int    mtBins; ///< Number of mT - m bins
+      double mtMax;  ///< Maximum mT - m (GeV)
+      Config() :
+        pdgs(),
+        computeNetCharges(true),
+        computeCorrelations(true),
+        computeSpectra(true),
+        ptBins(100), ptMax(2.5),
+        yBins(100), yMin(-5.), yMax(5.),
+        mtBins(100), mtMax(2.5) { }
+    };
+
+    /**
+     * \brief Construct a new EventObservablesAccumulator object
+     *
+     * \param TPS    Particle list used to determine the conserved charges of particles.
+     *               Can be NULL, in which case net-charge moments are not collected.
+     * \param config Settings of the accumulated observables
+     */
+    EventObservablesAccumulator(ThermalParticleSystem *TPS = NULL, const Config& config = Config());
+
+    /// Adds a single event
+    void AddEvent(const SimpleEvent& evt);
+
+    /// Clears all the accumulated statistics
+    void Reset();
+
+    /// Adds the statistics accumulated in another accumulator with the same configuration
+    void Merge(const EventObservablesAccumulator& other);
+
+    /**
+     * \brief Combines a set of per-thread partial results.
+     *
+     * Pairs of partial results are merged in parallel in a tree-like fashion
+     * if the library is compiled with OpenMP.
+     */
+    static EventObservablesAccumulator Reduce(const std::vector<EventObservablesAccumulator>& parts);
+
+    const Config& Configuration() const { return m_Config; }
+
+    /// Number of accumulated events
+    long long Events() const { return m_Events; }
+
+    /// Sum of the event weights
+    double SumOfWeights() const { return m_WeightSum; }
+
+    /// Number of observables: selected species followed by the four net charges (if computed)
+    int ObservablesNumber() const { return static_cast<int>(m_Moments.size()); }
+
+    /// Index of the observable corresponding to the selected species with the given PDG code, -1 if not selected
+    int SpeciesIndex(long long pdg) const;
+
+    /// Index of the observable corresponding to the net charge, -1 if not computed
+    int NetChargeIndex(ConservedCharge::Name chg) const;
+
+    /// Moments of the i-th observable
+    const MomentsAccumulator& Moments(int i) const { return m_Moments[i]; }
+
+    /// Multiplicity moments of the species with the given PDG code
+    const MomentsAccumulator& MomentsByPdg(long long pdg) const;
+
+    /// Net-charge moments
+    const MomentsAccumulator& NetChargeMoments(ConservedCharge::Name chg) const;
+
+    /// Covariance \f$ \langle N_i N_j \rangle - \langle N_i \rangle \langle N_j \rangle \f$ of two observables
+    double Covariance(int i, int j) const;
+
+    /// Pearson correlation coefficient of two observables
+    double PearsonCorrelation(int i, int j) const;
+
+    /// Transverse momentum histogram of the i-th selected species
+    const Histogram1D& PtHistogram(int i) const { return m_PtHist[i]; }
+
+    /// Rapidity histogram of the i-th selected species
+    const Histogram1D& RapidityHistogram(int i) const { return m_YHist[i]; }
+
+    /// mT - m histogram of the i-th selected species
+    const Histogram1D& MtHistogram(int i) const { return m_MtHist[i]; }
+
+    /// Per-event differential yield dN/dx in the given bin of a histogram filled by this accumulator
+    double PerEventYield(const Histogram1D& hist, int bin) const;
+
+    /// Error of PerEventYield()
+    double PerEventYieldError(const Histogram1D& hist, int bin) const;
+
+  private:
+    /// Index in the m_Moments array and charges of a known PDG code
+    struct SpeciesInfo {
+      int    index;
+      int    charges[4];
+    };
+
+    Config m_Config;
+    std::map<long long, SpeciesInfo> m_Species;
+    int m_TrackedNumber;
+
+    long long m_Events;
+    double m_WeightSum;
+
+    std::vector<MomentsAccumulator> m_Moments;
+    /// Upper triangle of weighted sums of \f$ (N_i - \langle N_i \rangle)(N_j - \langle N_j \rangle) \f$, i < j
+    std::vector<double> m_CrossSums;
+
+    std::vector<Histogram1D> m_PtHist, m_YHist, m_MtHist;
+
+    /// Buffer for event-by-event values of the observables
+    std::vector<double> m_Values;
+  };
+
+} // namespace thermalfist
+
+#endif
@@ -10,6 +10,7 @@
 
 //#include "HRGEventGenerator/RandomGenerators.h"
 #include <cmath>
+#include <vector>
 
 namespace thermalfist {
 
@@ -88,6 +89,14 @@ namespace thermalfist {
     */
     virtual double InverseZetaDistribution(double xi) const { return 0.; }
 
+    /**
+    *  \brief Parameters which fully determine the \zeta distribution.
+    *
+    *  Used to share tabulated \zeta distributions between momentum generators.
+    *  An empty vector (default) means that the tables are not shared.
+    */
+    virtual std::vector<double> ZetaDistributionKey() const { return std::vector<double>(); }
+
 
   protected:
     /**
@@ -151,6 +160,8 @@ namespace thermalfist {
 
     virtual double ZetaProbability(double zeta) const;
 
+    virtual std::vector<double> ZetaDistributionKey() const;
+
   protected:
     virtual double ComputeProbabilitydMaximum() { return ZetaProbability(1.); }
 
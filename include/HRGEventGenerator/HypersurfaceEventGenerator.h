@@ -0,0 +1,259 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2014-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#ifndef HYPERSURFACEEVENTGENERATOR_H
+#define HYPERSURFACEEVENTGENERATOR_H
+
+#include <string>
+#include <vector>
+
+#include "HRGEventGenerator/EventGeneratorBase.h"
+#include "HRGEventGenerator/RandomGenerators.h"
+
+namespace thermalfist {
+
+  /**
+   * \brief A single element (cell) of a particlization hypersurface.
+   *
+   * The vector components refer to the local frame comoving with the
+   * longitudinal Bjorken flow at the space-time rapidity eta of the cell.
+   * For hypersurfaces given in Milne coordinates \f$ (\tau, x, y, \eta_s) \f$
+   * this means that the \f$ \eta_s \f$ components are scaled by \f$ \tau \f$:
+   * \f$ d\sigma_3 = d\sigma_\eta / \tau \f$, \f$ u^3 = \tau u^\eta \f$.
+   */
+  struct ParticlizationHypersurfaceElement {
+    double tau, x, y, eta;    ///< Space-time coordinates (fm/c, fm, fm, space-time rapidity)
+    double dsigma[4];         ///< Covariant normal vector \f$ d\sigma_\mu \f$ (fm^3)
+    double u[4];              ///< Contravariant flow four-velocity \f$ u^\mu \f$
+    double T;                 ///< Temperature (GeV)
+    double muB, muQ, muS;     ///< Chemical potentials (GeV)
+  };
+
+  /// A particlization hypersurface as a list of its elements
+  typedef std::vector<ParticlizationHypersurfaceElement> ParticlizationHypersurface;
+
+  /**
+   * \brief Reads a particlization hypersurface from a binary file.
+   *
+   * The file starts with the 8-character signature "TFHYPSRF",
+   * followed by the number of elements as a 64-bit integer
+   * and the elements themselves, each as 16 double precision numbers
+   * in the order of the fields of ParticlizationHypersurfaceElement.
+   * The native byte order is used.
+   *
+   * \param filename Path to the file
+   * \param surface  The hypersurface read
+   * \return true if the file was read successfully
+   */
+  bool ReadParticlizationHypersurfaceBinary(const std::string& filename, ParticlizationHypersurface& surface);
+
+  /// Writes a particlization hypersurface in the binary format of ReadParticlizationHypersurfaceBinary()
+  bool WriteParticlizationHypersurfaceBinary(const std::string& filename, const ParticlizationHypersurface& surface);
+
+  /**
+   * \brief Constructs the constant proper time hypersurface of the longitudinally symmetric blast-wave model.
+   *
+   * The flow profile is \f$ \beta_T = \beta_s (r/R)^n \f$, uniform in space-time rapidity
+   * within \f$ |\eta_s| < \eta_{\rm max} \f$. The resulting spectra coincide with
+   * those of CylindricalBlastWaveEventGenerator.
+   *
+   * \param T      Temperature (GeV)
+   * \param betas  Transverse flow velocity at the surface
+   * \param etamax Space-time rapidity cut-off
+   * \param npow   Power in the transverse flow profile
+   * \param R      Transverse radius (fm)
+   * \param tau    Proper time (fm/c)
+   * \param nr     Number of cells in the radial direction
+   * \param nphi   Number of cells in the azimuthal direction
+   * \param neta   Number of cells in the space-time rapidity direction
+   * \param muB    Baryon chemical potential (GeV)
+   * \param muQ    Electric charge chemical potential (GeV)
+   * \param muS    Strangeness chemical potential (GeV)
+   */
+  ParticlizationHypersurface CylindricalBlastWaveHypersurface(double T, double betas, double etamax, double npow,
+    double R, double tau, int nr = 100, int nphi = 32, int neta = 32,
+    double muB = 0., double muQ = 0., double muS = 0.);
+
+  /**
+   * \brief Hypersurface cells grouped by their thermodynamic parameters.
+   *
+   * Used by HypersurfaceEventGenerator and HypersurfaceMomentumGenerator.
+   */
+  struct HypersurfaceCellClasses {
+    /// Thermodynamic parameters (T, muB, muQ, muS) of each class, averaged over its cells
+    std::vector<ThermalModelParameters> Parameters;
+    /// Indices of the cells belonging to each class
+    std::vector< std::vector<int> > Cells;
+    /// Samplers of the cells within each class, proportional to \f$ u^\mu d\sigma_\mu + |d\sigma^*| \f$
+    std::vector<RandomGenerators::AliasTable> CellSamplers;
+    /// Effective volume \f$ \sum \max(0, u^\mu d\sigma_\mu) \f$ of each class
+    std::vector<double> Volumes;
+    /// Majorant volume \f$ \sum (u^\mu d\sigma_\mu + |d\sigma^*|) \f$ of each class
+    std::vector<double> MajorantVolumes;
+    /// Volume \f$ \sum u^\mu d\sigma_\mu \f$ of the cells of each class where \f$ p^\mu d\sigma_\mu > 0 \f$ for all momenta,
+    /// i.e. \f$ u^\mu d\sigma_\mu \geq |d\sigma^*| \f$
+    std::vector<double> TimelikeVolumes;
+    /// \f$ |d\sigma^*| \f$ of the remaining cells of each class where \f$ p^\mu d\sigma_\mu \f$ changes sign, binned linearly
+    /// in \f$ u^\mu d\sigma_\mu / |d\sigma^*| \in (-1,1) \f$. Empty if there are no such cells.
+    std::vector< std::vector<double> > SpacelikeWeights;
+  };
+
+  namespace RandomGenerators {
+
+    /**
+     * \brief Samples the momentum of a particle emitted from a particlization hypersurface
+     *        in accordance with the Cooper-Frye formula.
+     *
+     * A cell is chosen with a probability proportional to the particle density
+     * times the majorant volume \f$ u^\mu d\sigma_\mu + |d\sigma^*| \f$, the momentum is sampled
+     * from the thermal distribution in the local rest frame, boosted with the flow velocity,
+     * and accepted with the probability \f$ \max(0, p^\mu d\sigma_\mu) / [E^* (u^\mu d\sigma_\mu + |d\sigma^*|)] \f$.
+     * Here \f$ |d\sigma^*| \f$ is the length of the spatial part of \f$ d\sigma_\mu \f$ in the local rest frame.
+     * Negative Cooper-Frye contributions are thus discarded.
+     */
+    class HypersurfaceMomentumGenerator
+      : public ParticleMomentumGenerator
+    {
+    public:
+      /**
+       * \brief Construct a new HypersurfaceMomentumGenerator object
+       *
+       * \param surface    The hypersurface
+       * \param classes    The hypersurface cells grouped by their thermodynamic parameters
+       * \param mass       Particle mass (in GeV)
+       * \param statistics Statistics (0: Maxwell-Boltzmann, +1: Fermi-Dirac, -1: Bose-Einstein)
+       * \param densities  Particle number density in each class of cells
+       * \param mus        Chemical potential of the particle in each class of cells
+       */
+      HypersurfaceMomentumGenerator(const ParticlizationHypersurface* surface,
+        const HypersurfaceCellClasses* classes,
+        double mass, int statistics,
+        const std::vector<double>& densities,
+        const std::vector<double>& mus);
+
+      ~HypersurfaceMomentumGenerator() { }
+
+      std::vector<double> GetMomentum(double mass = -1.) const;
+
+    private:
+      const ParticlizationHypersurface* m_Surface;
+      const HypersurfaceCellClasses* m_Classes;
+      double m_Mass;
+      AliasTable m_ClassSampler;
+      std::vector<ThermalMomentumGenerator> m_Generators;
+    };
+
+  }
+
+  /**
+   * \brief Class implementing the Thermal Event Generator for
+   *        particlization of a general (e.g. hydrodynamic) freeze-out hypersurface.
+   *
+   * The particles are sampled in accordance with the Cooper-Frye formula,
+   * with the negative contributions \f$ p^\mu d\sigma_\mu < 0 \f$ discarded.
+   * The mean multiplicity of each species is thus
+   * \f$ \langle N_i \rangle = \sum_{\rm cells} n_i(T,\mu) \, \langle \max(0, p^\mu d\sigma_\mu) / E^* \rangle \f$,
+   * with the densities \f$ n_i \f$ evaluated by the thermal model
+   * specified in the event generator configuration and the average taken over
+   * the thermal distribution in the local rest frame.
+   * For the cells with \f$ u^\mu d\sigma_\mu \geq |d\sigma^*| \f$, which includes all cells with a timelike normal vector,
+   * the average equals \f$ u^\mu d\sigma_\mu \f$, for the remaining cells it depends on the particle species.
+   *
+   * The cells are grouped into classes by their thermodynamic parameters (T, muB, muQ, muS),
+   * binned with a given tolerance, and the densities are evaluated once for each class
+   * using the parameters averaged over its cells.
+   * If all the cells share the same parameters and \f$ p^\mu d\sigma_\mu > 0 \f$ everywhere,
+   * the multiplicities are sampled from the statistical ensemble specified in the configuration, with the
+   * volume equal to the total effective volume of the hypersurface.
+   * Otherwise the mean multiplicities are not proportional to a common volume
+   * and are sampled from the grand-canonical ensemble.
+   * In the latter case the resonance masses are sampled using the
+   * volume-averaged thermal parameters.
+   *
+   * The precomputations are parallelized with OpenMP.
+   * The hypersurface object must persist while the event generator is used.
+   */
+  class HypersurfaceEventGenerator : public EventGeneratorBase
+  {
+  public:
+    /**
+     * \brief Construct a new HypersurfaceEventGenerator object
+     *
+     * \param TPS     A pointer to the particle list
+     * \param config  Event generator configuration. The thermal parameters and
+     *                the volume are taken from the hypersurface.
+     * \param surface A pointer to the hypersurface
+     * \param tolerance Width (in GeV) of the bins in T, muB, muQ, and muS used to group the cells into classes.
+     *                  Zero groups only the cells with identical parameters.
+     */
+    HypersurfaceEventGenerator(ThermalParticleSystem *TPS = NULL,
+      const EventGeneratorConfiguration& config = EventGeneratorConfiguration(),
+      const ParticlizationHypersurface* surface = NULL,
+      double tolerance = 1.e-3);
+
+    ~HypersurfaceEventGenerator() { }
+
+    /// The hypersurface
+    const ParticlizationHypersurface* Hypersurface() const { return m_Surface; }
+
+    /// Total effective volume \f$ \sum \max(0, u^\mu d\sigma_\mu) \f$ of the hypersurface (fm^3)
+    double EffectiveVolume() const;
+
+    /// Width of the bins in T and mu used to group the cells into classes (GeV)
+    double ClassTolerance() const { return m_ClassTolerance; }
+
+    /// Whether the hypersurface has cells where \f$ p^\mu d\sigma_\mu \f$ changes sign
+    bool HasSpacelikeCells() const;
+
+    /// Number of groups of cells with distinct thermodynamic parameters
+    int ThermodynamicClassesNumber() const { return static_cast<int>(m_Classes.Parameters.size()); }
+
+    /// Mean primordial multiplicity of the i-th species
+    double MeanYield(int i) const { return m_MeanYields[i]; }
+
+    /// Sets up the random generators of particle momenta
+    /// and resonances masses
+    void SetMomentumGenerators();
+
+    virtual SimpleEvent GetEvent(bool PerformDecays = true) const;
+
+  protected:
+    /// Creates the momentum generator of the i-th species
+    RandomGenerators::ParticleMomentumGenerator* CreateMomentumGenerator(int i) const;
+
+    /// Species with the same mass, statistics, and densities in all cell classes share a generator
+    std::vector<double> MomentumGeneratorKey(int i) const;
+
+  private:
+    /// Groups the cells of the hypersurface by their thermodynamic parameters
+    void ProcessHypersurface();
+
+    /// Evaluates the densities and chemical potentials of all species in all cell classes
+    void CalculateClassDensities();
+
+    /// Evaluates the densities and chemical potentials of all species in the k-th cell class using the given model
+    void CalculateClassDensities(ThermalModelBase *model, int k);
+
+    /// Volume of the k-th cell class entering the Cooper-Frye yield of the i-th species, \f$ \sum \langle \max(0, p^\mu d\sigma_\mu) / E^* \rangle \f$
+    double CooperFryeVolume(int i, int k) const;
+
+    const ParticlizationHypersurface* m_Surface;
+    double m_ClassTolerance;
+    HypersurfaceCellClasses m_Classes;
+
+    /// Particle densities in each cell class, [class][species]
+    std::vector< std::vector<double> > m_ClassDensities;
+
+    /// Chemical potentials in each cell class, [class][species]
+    std::vector< std::vector<double> > m_ClassChemicalPotentials;
+
+    std::vector<double> m_MeanYields;
+  };
+
+} // namespace thermalfist
+
+#endif
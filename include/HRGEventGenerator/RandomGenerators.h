@@ -9,6 +9,10 @@
 #define RANDOMGENERATORS_H
 
 #include <cmath>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
 
 #include "MersenneTwister.h"
 #include "HRGEventGenerator/MomentumDistribution.h"
@@ -37,6 +41,15 @@ namespace thermalfist {
     /// \param rangen A Mersenne Twister random number generator to use
     int RandomPoisson(double mean, MTRand &rangen);
 
+    /// \brief Generates random integer distributed by binomial distribution
+    ///        with n trials and success probability p
+    /// Uses randgenMT
+    int RandomBinomial(int n, double p);
+
+    /// \brief Same as RandomBinomial(int,double) but uses the provided instance
+    ///        of the  Mersenne Twister random number generator
+    int RandomBinomial(int n, double p, MTRand &rangen);
+
     /// \brief Probability of a Skellam distributed random variable with Poisson means
     ///        mu1 and mu2 to have the value of k.
     double SkellamProbability(int k, double mu1, double mu2);
@@ -91,6 +104,178 @@ namespace thermalfist {
     };
 
 
+    /**
+     * \brief Tabulated inverse cumulative distribution function of a one-dimensional distribution.
+     *
+     * The (unnormalized) probability density is tabulated on an equidistant grid
+     * and interpolated linearly between the nodes. Random numbers are then obtained
+     * by inverting the resulting piecewise-quadratic CDF, which requires a single
+     * uniform random number and no rejection.
+     *
+     * The grid is refined by successive doubling until the maximum change
+     * of the normalized CDF between two successive refinements drops below
+     * the requested tolerance, or the maximum number of points is reached.
+     * The achieved accuracy is available through Accuracy().
+     */
+    class InverseCDFTable
+    {
+    public:
+      InverseCDFTable() : m_Xmin(0.), m_Xmax(1.), m_dx(1.), m_Total(0.), m_Accuracy(1.) { }
+
+      /**
+       * \brief Construct a new InverseCDFTable object
+       *
+       * \param f         Unnormalized probability density. Negative or non-finite values are treated as zero.
+       * \param xmin      Lower limit of the support
+       * \param xmax      Upper limit of the support
+       * \param tolerance Required accuracy of the normalized CDF
+       * \param maxpoints Maximum number of grid points
+       */
+      InverseCDFTable(const std::function<double(double)>& f, double xmin, double xmax, double tolerance = 1.e-6, int maxpoints = (1 << 16));
+
+      /// Returns the value of x corresponding to CDF(x) = xi, 0 <= xi <= 1
+      double Sample(double xi) const;
+
+      /// Samples a random number from the tabulated distribution
+      double GetRandom(MTRand &rangen = randgenMT) const { return Sample(rangen.rand()); }
+
+      /// The integral of the tabulated density over the support
+      double Normalization() const { return m_Total; }
+
+      /// The maximum change of the normalized CDF at the last grid refinement
+      double Accuracy() const { return m_Accuracy; }
+
+      /// Number of grid points
+      int Points() const { return static_cast<int>(m_f.size()); }
+
+      /// Whether the table can be used for sampling
+      bool IsValid() const { return m_Total > 0. && m_Total == m_Total; }
+
+    private:
+      double m_Xmin, m_Xmax, m_dx;
+      std::vector<double> m_f;
+      std::vector<double> m_CDF;
+      double m_Total;
+      double m_Accuracy;
+    };
+
+    /**
+     * \brief Returns a tabulated inverse CDF from the process-wide cache, building it if necessary.
+     *
+     * Tables are identified by a tag (the distribution type) and a vector of
+     * parameters (e.g. mass, temperature, flow velocity) which fully determine the density.
+     * The cache is thread-safe, and the tables can be shared between
+     * momentum generators of different particle species.
+     *
+     * \param tag       Distribution type
+     * \param key       Parameters of the distribution
+     * \param f         Unnormalized probability density, used if the table is not cached yet
+     * \param xmin      Lower limit of the support
+     * \param xmax      Upper limit of the support
+     * \param tolerance Required accuracy of the normalized CDF
+     * \param maxpoints Maximum number of grid points
+     */
+    std::shared_ptr<const InverseCDFTable> GetCachedInverseCDFTable(const std::string& tag, const std::vector<double>& key,
+      const std::function<double(double)>& f, double xmin, double xmax, double tolerance = 1.e-6, int maxpoints = (1 << 16));
+
+    /// \brief Removes all the tables from the inverse CDF cache.
+    /// Tables still used by existing generators remain valid.
+    void ClearInverseCDFTableCache();
+
+    /**
+     * \brief Alias table for sampling from a discrete distribution.
+     *
+     * Implements the alias method of Walker in the formulation of Vose.
+     * The table is constructed in O(n) time, each random index
+     * is then sampled in O(1) time using a single uniform random number.
+     */
+    class AliasTable
+    {
+    public:
+      AliasTable() : m_Total(0.) { }
+
+      /**
+       * \brief Construct a new AliasTable object
+       *
+       * \param weights Unnormalized probabilities of the indices. Negative or non-finite values are treated as zero.
+       */
+      AliasTable(const std::vector<double>& weights);
+
+      /// Returns the index corresponding to the uniform random number xi, 0 <= xi < 1
+      int Sample(double xi) const;
+
+      /// Samples a random index
+      int GetRandom(MTRand &rangen = randgenMT) const { return Sample(rangen.randExc()); }
+
+      /// Sum of the weights
+      double Normalization() const { return m_Total; }
+
+      /// Number of indices
+      int Size() const { return static_cast<int>(m_Probabilities.size()); }
+
+      /// Whether the table can be used for sampling
+      bool IsValid() const { return m_Total > 0.; }
+
+    private:
+      std::vector<double> m_Probabilities;
+      std::vector<int>    m_Aliases;
+      double m_Total;
+    };
+
+    /**
+     * \brief Tabulated two-dimensional distribution, sampled without rejection.
+     *
+     * The (unnormalized) probability density is tabulated on an equidistant
+     * rectangular grid and interpolated bilinearly within each cell.
+     * A cell is chosen with the alias method, the point within the cell is then
+     * obtained by inverting the linear marginal distribution in x and the linear
+     * conditional distribution in y. The bilinear interpolant is thus sampled exactly
+     * using three uniform random numbers.
+     */
+    class InverseCDFTable2D
+    {
+    public:
+      InverseCDFTable2D() : m_Xmin(0.), m_Ymin(0.), m_dx(1.), m_dy(1.), m_Nx(0), m_Ny(0) { }
+
+      /**
+       * \brief Construct a new InverseCDFTable2D object
+       *
+       * \param f     Unnormalized probability density at the grid nodes, f[ix][iy] corresponds to
+       *              x = xmin + ix * (xmax - xmin) / (f.size() - 1) and y = ymin + iy * (ymax - ymin) / (f[ix].size() - 1).
+       *              Negative or non-finite values are treated as zero.
+       * \param xmin  Lower limit of the support in x
+       * \param xmax  Upper limit of the support in x
+       * \param ymin  Lower limit of the support in y
+       * \param ymax  Upper limit of the support in y
+       */
+      InverseCDFTable2D(const std::vector< std::vector<double> >& f, double xmin, double xmax, double ymin, double ymax);
+
+      /// Returns the point (x,y) corresponding to the uniform random numbers xi1 (cell, 0 <= xi1 < 1), xi2 and xi3 (position within the cell)
+      void Sample(double xi1, double xi2, double xi3, double& x, double& y) const;
+
+      /// Samples a random point from the tabulated distribution
+      void GetRandom(double& x, double& y, MTRand &rangen = randgenMT) const {
+        double xi1 = rangen.randExc();
+        double xi2 = rangen.randDblExc();
+        double xi3 = rangen.randDblExc();
+        Sample(xi1, xi2, xi3, x, y);
+      }
+
+      /// The integral of the tabulated density over the support
+      double Normalization() const { return m_Cells.Normalization() * m_dx * m_dy; }
+
+      /// Whether the table can be used for sampling
+      bool IsValid() const { return m_Cells.IsValid(); }
+
+    private:
+      double Value(int ix, int iy) const { return m_f[ix * (m_Ny + 1) + iy]; }
+
+      double m_Xmin, m_Ymin, m_dx, m_dy;
+      int m_Nx, m_Ny;
+      std::vector<double> m_f;
+      AliasTable m_Cells;
+    };
+
     /// \brief Base class for Monte Carlo sampling of particle momenta
     class ParticleMomentumGenerator
     {
@@ -106,6 +291,31 @@ namespace thermalfist {
       /// \return std::vector<double> A vector containing the sampled
       ///         \f$p_x\f$, \f$p_y\f$, \f$p_z\f$ components of the three-momentum
       virtual std::vector<double> GetMomentum(double mass = -1.) const = 0;
+
+      /**
+       * \brief Fraction of the sampled particles which pass a y-pT acceptance
+       *
+       * Evaluates \f$ \int dy \, dp_T \, \rho(y,p_T) \, A(y,p_T) \f$ by quadrature,
+       * where \f$ \rho \f$ is the normalized distribution of the momenta returned by GetMomentum().
+       *
+       * \param acceptance The acceptance function \f$ A(y,p_T) \f$
+       * \param mass The mass of a particle. If negative value provided, defaults to the pole/vacuum mass
+       * \return The accepted fraction, or a negative value if the quadrature is not available for this generator
+       */
+      virtual double AcceptedFraction(const std::function<double(double, double)>& /*acceptance*/, double /*mass*/ = -1.) const { return -1.; }
+
+      /**
+       * \brief Tabulates the y-pT distribution of the momenta returned by GetMomentum()
+       *
+       * The distribution in the azimuthal angle is assumed to be uniform.
+       *
+       * \param ys      Rapidity values
+       * \param pts     Transverse momentum values
+       * \param density Filled with the unnormalized density \f$ dN / dy dp_T \f$, density[iy][ipt] corresponds to ys[iy] and pts[ipt]
+       * \param mass    The mass of a particle. If negative value provided, defaults to the pole/vacuum mass
+       * \return Whether the density is available for this generator
+       */
+      virtual bool YPtDensity(const std::vector<double>& /*ys*/, const std::vector<double>& /*pts*/, std::vector< std::vector<double> >& /*density*/, double /*mass*/ = -1.) const { return false; }
     };
 
 
@@ -133,16 +343,23 @@ namespace thermalfist {
       {
         //FixParameters();
         m_Max = ComputeMaximum(m_Mass);
+        FixTable();
       }
 
       /**
       *  \brief Samples the momentum of a particle
       *
+      *  For the default mass the tabulated inverse CDF is used,
+      *  otherwise the momentum is sampled by rejection.
+      *
       *  \param mass Particle mass used for sampling.
       *              If a negative value is provided, the default (e.g. pole) mass is used.
       */
       double GetP(double mass = -1.) const;
 
+      /// Unnormalized occupation number of a particle with energy E in the local rest frame
+      double Occupation(double E) const { return 1. / (exp((E - m_Mu) / m_T) + m_Statistics); }
+
     private:
       /// Unnormalized probability density of x = exp(-p)
       double g(double x, double mass = -1.) const;
@@ -151,10 +368,15 @@ namespace thermalfist {
 
       void FixParameters();
 
+      /// Tabulates the inverse CDF of x = exp(-p) for the default mass
+      void FixTable();
+
       double m_Mass, m_T, m_Mu;
       int m_Statistics;
 
       double m_Max;
+
+      std::shared_ptr<const InverseCDFTable> m_Table;
     };
 
 
@@ -277,6 +499,10 @@ namespace thermalfist {
 
       virtual std::vector<double> GetMomentum(double mass = -1.) const;
 
+      virtual double AcceptedFraction(const std::function<double(double, double)>& acceptance, double mass = -1.) const;
+
+      virtual bool YPtDensity(const std::vector<double>& ys, const std::vector<double>& pts, std::vector< std::vector<double> >& density, double mass = -1.) const;
+
       // Override functions end
 
     private:
@@ -322,19 +548,25 @@ namespace thermalfist {
 
       virtual std::vector<double> GetMomentum(double mass = -1.) const;
 
+      virtual double AcceptedFraction(const std::function<double(double, double)>& acceptance, double mass = -1.) const;
+
+      virtual bool YPtDensity(const std::vector<double>& ys, const std::vector<double>& pts, std::vector< std::vector<double> >& density, double mass = -1.) const;
+
       // Override functions end
 
     protected:
      /**
      * \brief Samples zeta for use in Monte Carlo event generator.
      *
-     * Uses rejection sampling.
+     * Uses the explicit inverse of the zeta distribution if available,
+     * the tabulated inverse CDF otherwise.
      *
      */
      virtual double GetRandomZeta(MTRand& rangen = RandomGenerators::randgenMT) const;
 
     private:
       BoostInvariantFreezeoutParametrization* m_FreezeoutModel;
+      std::shared_ptr<const InverseCDFTable> m_ZetaTable;
       ThermalMomentumGenerator m_Generator;
       double m_Tkin;
       double m_EtaMax;
@@ -597,32 +829,16 @@ namespace thermalfist {
         return m_distr.dndpt(-log(x)) / x;
       }
 
-      double g2(double x) const {
-        return m_dndpt.f(x);
-      }
-
-      void FixParameters();
-
+      /// Tabulates the inverse CDFs of x = exp(-pT) and of the rapidity at fixed pT
       void FixParameters2();
 
-      // Finds the maximum of g(x) using the ternary search
-      void FindMaximumPt();
-
-      void FindMaximumY(double pt);
-
-      void FindMaximumY2(double pt);
-
       // Generates random pt and y
-      std::pair<double, double> GetRandom(double mass = -1.);
-
       std::pair<double, double> GetRandom2(double mass = -1.) const;
 
       double m_T, m_BetaS, m_EtaMax, m_n, m_Mass;
-      double m_MaxY, m_MaxPt;
       SSHDistribution m_distr;
-      SplineFunction m_dndpt;
-      std::vector<SplineFunction> m_dndy;
-      std::vector<double> m_MaxYs;
+      std::shared_ptr<const InverseCDFTable> m_PtTable;
+      std::vector< std::shared_ptr<const InverseCDFTable> > m_YTables;
       double m_dPt;
       double m_dy;
     };
@@ -56,6 +56,10 @@ namespace thermalfist {
     double GetTkin() { return m_T; }
     double GetBeta() { return m_Beta; }
 
+  protected:
+    /// Creates the momentum generator of the i-th species
+    RandomGenerators::ParticleMomentumGenerator* CreateMomentumGenerator(int i) const;
+
   private:
     double m_T;
     double m_Beta;
@@ -197,6 +197,28 @@ namespace thermalfist {
      */
     ThermalModelFitParameters PerformFit(bool verbose = true, bool AsymmErrors = false);
 
+    /**
+     * \brief Prepares the model and the fit parameters for the \f$ \chi^2 \f$ evaluation.
+     * 
+     * Called by PerformFit(). Fixes the parameters which the data are insensitive to,
+     * creates the PCE model if needed, and calculates the number of degrees of freedom.
+     * Has to be called before EvaluateChi2() is used outside of PerformFit().
+     */
+    void PrepareFit();
+
+    /**
+     * \brief Evaluates the \f$ \chi^2 \f$ of the data description for a given set of thermal parameters.
+     * 
+     * This is the function minimized in PerformFit().
+     * Returns \f$ 10^{12} \f$ for parameters that are unphysical or lead to Bose-Einstein condensation.
+     * 
+     * \param par     The values of T, muB, gammaS, R, Rc, gammaq, muQ, muS, muC, gammaC, Tkin, in this order.
+     *                 The values of the parameters which are not fitted are used as well.
+     * \param verbose If true, the result is printed on screen
+     * \return double  The \f$ \chi^2 \f$ value
+     */
+    double EvaluateChi2(const std::vector<double>& par, bool verbose = false);
+
     /// Number of degrees of freedom in the fit
     int GetNdf() const;
 
@@ -0,0 +1,234 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2014-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#ifndef THERMALMODELFITMCMC_H
+#define THERMALMODELFITMCMC_H
+
+/**
+ * \file ThermalModelFitMCMC.h
+ * \brief ThermalModelFitMCMC class
+ *
+ */
+
+#include <string>
+#include <vector>
+
+#include "MersenneTwister.h"
+
+#include "HRGFit/ThermalModelFit.h"
+
+namespace thermalfist {
+
+  /**
+   * \brief Samples the posterior distribution of the thermal fit parameters
+   *        with the affine-invariant ensemble sampler (stretch move) of Goodman and Weare.
+   *
+   * The likelihood is \f$ \exp(-\chi^2/2) \f$, with \f$ \chi^2 \f$ evaluated
+   * by ThermalModelFit::EvaluateChi2(). The prior is flat within the bounds
+   * [xmin, xmax] of each fitted parameter. Only the parameters flagged
+   * as fitted in the ThermalModelFit object are sampled.
+   *
+   * The ensemble is split into two halves which are updated in turn,
+   * the walkers within a half are evaluated in parallel if
+   * the library is built with OpenMP and several ThermalModelFit objects are provided,
+   * one per thread. The ThermalModelFit objects must be set up identically, but each
+   * has to use its own ThermalModelBase object, e.g. created with ThermalModelBase::Clone(). A ThermalModelResultCache can
+   * be attached to each of these models.
+   * The random numbers are drawn outside of the parallel region, thus the chain does
+   * not depend on the number of threads.
+   *
+   * The chain is kept in memory and can optionally be streamed to a binary file
+   * (see SetOutputFile()), from which a run can be resumed.
+   *
+   * Usage example:
+   * \code
+   * ThermalModelFit fit(&model);
+   * // ... set up the data and the parameters
+   * ThermalModelFitMCMC mcmc(&fit, 32);
+   * mcmc.Initialize();
+   * mcmc.Run(5000);
+   * ThermalModelFitParameters posterior = mcmc.PosteriorParameters(1000);
+   * \endcode
+   */
+  class ThermalModelFitMCMC
+  {
+  public:
+    /**
+     * \brief Construct a new ThermalModelFitMCMC object which evaluates the walkers sequentially.
+     *
+     * \param fit     The thermal fit object
+     * \param walkers Number of walkers in the ensemble
+     * \param seed    Seed of the random number generator
+     */
+    ThermalModelFitMCMC(ThermalModelFit *fit, int walkers = 32, unsigned int seed = 1);
+
+    /**
+     * \brief Construct a new ThermalModelFitMCMC object which evaluates the walkers in parallel.
+     *
+     * \param fits    Identically set up thermal fit objects, one per thread, each with its own model
+     * \param walkers Number of walkers in the ensemble
+     * \param seed    Seed of the random number generator
+     */
+    ThermalModelFitMCMC(const std::vector<ThermalModelFit*> & fits, int walkers = 32, unsigned int seed = 1);
+
+    ~ThermalModelFitMCMC();
+
+    /// The stretch move scale parameter a, 2 by default
+    void SetStretchParameter(double a) { m_StretchParameter = a; }
+    double StretchParameter() const { return m_StretchParameter; }
+
+    /**
+     * \brief Prepares the fits and places the walkers around the initial values of the fit parameters.
+     *
+     * The walkers are drawn from a normal distribution with a width
+     * given by the parameter errors times the spread, and truncated to the parameter bounds.
+     * Clears the chain.
+     *
+     * \param spread Width of the initial distribution of the walkers in units of the parameter errors
+     */
+    void Initialize(double spread = 0.1);
+
+    /**
+     * \brief Streams the chain to a binary file.
+     *
+     * The file starts with the signature "TFMCMC01", the number of parameters D and of walkers W (32-bit integers),
+     * and the indices of the sampled parameters in ThermalModelFitParameters::ParameterList (32-bit integers).
+     * Each step of the chain is then stored as W records of D parameter values and the \f$ \chi^2 \f$ (doubles).
+     *
+     * If resume is true and the file contains a chain of the same ensemble, the chain is loaded,
+     * the walkers are placed at their last positions, and subsequent steps are appended to the file.
+     * The \f$ \chi^2 \f$ of the walkers is then taken from the file and not re-evaluated.
+     * Otherwise, the file is overwritten with the chain in memory,
+     * and Initialize() is called if it has not been called before.
+     *
+     * \param filename Path to the file
+     * \param resume   Whether to resume the chain stored in the file
+     * \return true if successful
+     */
+    bool SetOutputFile(const std::string & filename, bool resume = false);
+
+    /**
+     * \brief Advances the ensemble by a given number of steps.
+     *
+     * \param steps   Number of steps
+     * \param verbose Whether to print the progress on screen
+     */
+    void Run(int steps, bool verbose = false);
+
+    /// Number of sampled parameters
+    int Dimension() const { return static_cast<int>(m_Indices.size()); }
+
+    /// Number of walkers
+    int Walkers() const { return m_Walkers; }
+
+    /// Number of steps in the chain
+    int Steps() const { return m_Steps; }
+
+    /// Names of the sampled parameters
+    std::vector<std::string> ParameterNames() const;
+
+    /**
+     * \brief Samples of a parameter from all walkers.
+     *
+     * \param parameter 0-based index of the sampled parameter
+     * \param burnin    Number of initial steps to discard
+     * \param thin      Only every thin-th step is used
+     */
+    std::vector<double> Samples(int parameter, int burnin = 0, int thin = 1) const;
+
+    /// The value of the parameter of a walker at a given step
+    double Value(int step, int walker, int parameter) const { return m_Chain[(static_cast<size_t>(step) * m_Walkers + walker) * Dimension() + parameter]; }
+
+    /// The \f$ \chi^2 \f$ of a walker at a given step
+    double Chi2(int step, int walker) const { return m_Chi2[static_cast<size_t>(step) * m_Walkers + walker]; }
+
+    /// Fraction of accepted proposals since the last Initialize()
+    double AcceptanceFraction() const;
+
+    /**
+     * \brief Integrated autocorrelation times of the sampled parameters (in steps).
+     *
+     * Estimated from the autocorrelation function averaged over the walkers,
+     * with the automatic windowing procedure of Sokal.
+     * The number of independent samples is roughly the number of samples divided by this time.
+     *
+     * \param burnin Number of initial steps to discard
+     */
+    std::vector<double> AutocorrelationTimes(int burnin = 0) const;
+
+    /**
+     * \brief Summary of the posterior distribution.
+     *
+     * For each sampled parameter the value is the median, the error is the standard deviation,
+     * and the asymmetric errors correspond to the 16% and 84% quantiles.
+     * The \f$ \chi^2 \f$ is the smallest one in the chain.
+     *
+     * \param burnin Number of initial steps to discard
+     * \param thin   Only every thin-th step is used
+     */
+    ThermalModelFitParameters PosteriorParameters(int burnin = 0, int thin = 1) const;
+
+    /**
+     * \brief Reads the chain from a file written by ThermalModelFitMCMC.
+     *
+     * An incomplete last step is ignored.
+     *
+     * \param filename  Path to the file
+     * \param indices   Indices of the sampled parameters in ThermalModelFitParameters::ParameterList
+     * \param walkers   Number of walkers
+     * \param chain     Parameter values, the walker index runs faster than the step index
+     * \param chi2      The \f$ \chi^2 \f$ values
+     * \return true if the file was read successfully
+     */
+    static bool ReadChainFile(const std::string & filename, std::vector<int> & indices, int & walkers,
+      std::vector<double> & chain, std::vector<double> & chi2);
+
+  private:
+    ThermalModelFitMCMC(const ThermalModelFitMCMC&);
+    ThermalModelFitMCMC& operator=(const ThermalModelFitMCMC&);
+
+    void Init(int walkers);
+
+    /// Prepares the fits and sets up the sampled parameters and their bounds, without placing the walkers
+    void PrepareParameters();
+
+    /// Evaluates the chi2 of the points using the available fit objects
+    void EvaluateChi2(const std::vector< std::vector<double> > & points, std::vector<double> & chi2);
+
+    /// Whether the point is within the parameter bounds
+    bool IsInBounds(const std::vector<double> & point) const;
+
+    /// Appends the current state of the walkers to the chain
+    void RecordStep();
+
+    std::vector<ThermalModelFit*> m_Fits;
+    int m_Walkers;
+    double m_StretchParameter;
+    MTRand m_RandomGenerator;
+
+    /// Indices of the sampled parameters in ThermalModelFitParameters::ParameterList
+    std::vector<int> m_Indices;
+    /// Indices of the sampled parameters in the argument of ThermalModelFit::EvaluateChi2()
+    std::vector<int> m_Chi2Indices;
+    /// The argument of ThermalModelFit::EvaluateChi2() with the values of the parameters that are not sampled
+    std::vector<double> m_BaseParameters;
+    std::vector<double> m_Lower, m_Upper;
+
+    std::vector< std::vector<double> > m_Positions;
+    std::vector<double> m_PositionsChi2;
+
+    int m_Steps;
+    std::vector<double> m_Chain;
+    std::vector<double> m_Chi2;
+    long long m_Proposed, m_Accepted;
+
+    std::string m_OutputFile;
+  };
+
+} // namespace thermalfist
+
+#endif
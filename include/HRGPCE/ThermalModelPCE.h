@@ -49,6 +49,22 @@ namespace thermalfist {
       AtFixedVolume = 1
     };
 
+    /**
+     * \brief The PCE solution at a single point of a trajectory.
+     * 
+     * Filled by CalculatePCETrajectory()
+     */
+    struct PCETrajectoryPoint {
+      /// Thermal parameters, including the temperature and the volume
+      ThermalModelParameters Parameters;
+      /// Chemical potentials of all species
+      std::vector<double> ChemicalPotentials;
+      /// Primordial yields of all species
+      std::vector<double> PrimordialYields;
+      /// Final yields of all species, with feeddown according to the stability flags
+      std::vector<double> TotalYields;
+    };
+
 
     /**
      * \brief Construct a new ThermalModelPCE object
@@ -150,6 +166,39 @@ namespace thermalfist {
      */
     virtual void CalculatePCE(double param, PCEMode mode = AtFixedTemperature);
 
+    /**
+     * \brief Solves the equations of partial chemical equilibrium along a trajectory, 
+     * e.g. from the chemical to the kinetic freeze-out.
+     *
+     * The points are evaluated in the given order, each one starting from the solution at the previous point.
+     * If the analytic Jacobian is available (see UseAnalyticJacobian()), the system is continued 
+     * along the trajectory as an ODE: the initial guess is obtained
+     * by a linear extrapolation of the previous solution using the Jacobian, which is also
+     * reused as the starting Jacobian for the Broyden's method.
+     * Otherwise, CalculatePCE() is called at each point.
+     * 
+     * After the call the model corresponds to the last point of the trajectory.
+     *
+     * \param params Values of the temperature (in GeV) or of the volume (in fm^3), depending on \p mode
+     * \param mode   Whether the PCE is evaluated at fixed temperature (default) or at a fixed volume
+     * \return       The PCE solutions at all the points
+     */
+    std::vector<PCETrajectoryPoint> CalculatePCETrajectory(const std::vector<double> &params, PCEMode mode = AtFixedTemperature);
+
+    //@{
+      /**
+       * \brief Whether the Jacobian of the PCE equations is computed analytically.
+       *
+       * The analytic Jacobian is available for the ideal HRG model in the grand canonical ensemble.
+       * It is built from the particle number susceptibilities of all species and the PCE effective charges.
+       * Otherwise, or if this flag is not set, the Jacobian is computed by finite differences.
+       *
+       * \param flag Whether the analytic Jacobian is used. True by default.
+       */
+    void UseAnalyticJacobian(bool flag) { m_UseAnalyticJacobian = flag; }
+    bool UseAnalyticJacobian() const { return m_UseAnalyticJacobian; }
+    //@}
+
     /**
      * \return Vector of chemical potentials of all particles species, as resulted from the last CalculatePCE() call
      */
@@ -190,6 +239,38 @@ namespace thermalfist {
     
 
   protected:
+    /**
+     * \brief Solves the PCE equations starting from the given values of the variables
+     *
+     * \param x0       Initial values of the chemical potentials of the stable species, 
+     *                 followed by the volume (AtFixedTemperature) or the temperature (AtFixedVolume)
+     * \param mode     The PCE mode
+     * \param jacobian The initial Jacobian in RowMajor ordering. If empty, the Jacobian is computed at \p x0
+     */
+    void SolvePCE(const std::vector<double> &x0, PCEMode mode, const std::vector<double> &jacobian = std::vector<double>());
+
+    /// Sets the state of the HRG model and computes the primordial densities for the given values of the PCE variables
+    void SetPCEVariables(const std::vector<double> &x, int mode);
+
+    /// The current values of the PCE variables
+    std::vector<double> PCEVariables(int mode) const;
+
+    /// Whether the analytic Jacobian can be used with the present HRG model
+    bool IsAnalyticJacobianAvailable() const;
+
+    /**
+     * \brief Computes the derivatives of the PCE equations at the current state of the HRG model.
+     * 
+     * \param dFdmu Derivatives with respect to the chemical potentials of the stable species
+     * \param dFdT  Derivatives with respect to the temperature
+     * \param dFdV  Derivatives with respect to the volume
+     */
+    void CalculateEquationsDerivatives(std::vector< std::vector<double> > &dFdmu, std::vector<double> &dFdT, std::vector<double> &dFdV) const;
+
+    /// The Jacobian of the PCE equations (RowMajor ordering) and 
+    /// the derivatives with respect to the parameter held fixed in a given mode
+    void CalculateJacobian(int mode, std::vector<double> &jacobian, std::vector<double> &dFdparam) const;
+
     ThermalModelBase *m_model;
 
     /// Whether nuclear abundances are calculated via the Saha equation
@@ -206,6 +287,9 @@ namespace thermalfist {
     /// Whether PCE has been calculated
     bool m_IsCalculated;
 
+    /// Whether the analytic Jacobian is used
+    bool m_UseAnalyticJacobian;
+
     /// PCE configuration, list of stable species etc.
     bool m_StabilityFlagsSet;
     std::vector<int> m_StabilityFlags;
@@ -228,11 +312,33 @@ namespace thermalfist {
     class BroydenEquationsPCE : public BroydenEquations
     {
     public:
-      BroydenEquationsPCE(ThermalModelPCE *model, int mode = 0) : BroydenEquations(), m_THM(model), m_Mode(mode) { m_N = m_THM->m_StableComponentsNumber + 1; }
+      BroydenEquationsPCE(ThermalModelPCE *model, int mode = 0) : BroydenEquations(), m_THM(model), m_Mode(mode), m_Copy(NULL) { m_N = m_THM->m_StableComponentsNumber + 1; }
+      ~BroydenEquationsPCE();
       std::vector<double> Equations(const std::vector<double> &x);
+      void EvaluateEquations(const std::vector<double> &x, std::vector<double> &f);
+      /// Copy which works with its own copy of the PCE and HRG models
+      BroydenEquations* Clone() const;
+    private:
+      BroydenEquationsPCE(const BroydenEquationsPCE&);
+      BroydenEquationsPCE& operator=(const BroydenEquationsPCE&);
+
+      ThermalModelPCE *m_THM;
+      int m_Mode;
+      /// The copy of the PCE model owned by a clone, NULL otherwise
+      ThermalModelPCE *m_Copy;
+    };
+
+    class BroydenJacobianPCE : public BroydenJacobian
+    {
+    public:
+      BroydenJacobianPCE(ThermalModelPCE *model, int mode = 0) : BroydenJacobian(), m_THM(model), m_Mode(mode) { }
+      /// The Jacobian returned by the next call of Jacobian(), instead of evaluating it
+      void SetInitialJacobian(const std::vector<double> &jacobian) { m_InitialJacobian = jacobian; }
+      std::vector<double> Jacobian(const std::vector<double> &x);
     private:
       ThermalModelPCE *m_THM;
       int m_Mode;
+      std::vector<double> m_InitialJacobian;
     };
 
   };
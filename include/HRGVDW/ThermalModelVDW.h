@@ -9,6 +9,7 @@
 #define THERMALMODELVDW_H
 
 #include "HRGBase/ThermalModelBase.h"
+#include "HRGEV/InteractionComponents.h"
 
 namespace thermalfist {
 
@@ -49,6 +50,13 @@ namespace thermalfist {
      * 
      */
     virtual ~ThermalModelVDW(void);
+
+    /**
+     * \brief Creates a copy of the model.
+     *
+     * Overrides ThermalModelBase::Clone().
+     */
+    virtual ThermalModelVDW* Clone(ThermalParticleSystem *TPS = NULL) const;
     
     /**
      * \brief Same as FillVirial() but uses the matrix of excluded-volume
@@ -66,7 +74,7 @@ namespace thermalfist {
      * \param j    0-based index of the second particle species
      * \param dbdT \f$ d \tilde{b}_{ij} / dT \f$ in the units of fm\f$^3\f$ GeV\f$^{-1}\f$
      */
-    void SetVirialdT(int i, int j, double dbdT) { if (i >= 0 && i < static_cast<int>(m_VirialdT.size()) && j >= 0 && j < static_cast<int>(m_VirialdT[i].size())) m_VirialdT[i][j] = dbdT; }
+    void SetVirialdT(int i, int j, double dbdT) { if (i >= 0 && i < static_cast<int>(m_VirialdT.size()) && j >= 0 && j < static_cast<int>(m_VirialdT[i].size())) { m_VirialdT[i][j] = dbdT; ClearSolutionsCache(); } }
     
     /**
      * \brief Set the temperature derivative
@@ -76,7 +84,7 @@ namespace thermalfist {
      * \param j    0-based index of the second particle species
      * \param dadT \f$ d a_{ij} / dT \f$ in the units of fm\f$^3\f$
      */
-    void SetAttractiondT(int i, int j, double dadT) { if (i >= 0 && i < static_cast<int>(m_AttrdT.size()) && j >= 0 && j < static_cast<int>(m_AttrdT[i].size()))     m_AttrdT[i][j] = dadT; }
+    void SetAttractiondT(int i, int j, double dadT) { if (i >= 0 && i < static_cast<int>(m_AttrdT.size()) && j >= 0 && j < static_cast<int>(m_AttrdT[i].size()))     { m_AttrdT[i][j] = dadT; ClearSolutionsCache(); } }
 
     /**
      * \brief The temperature derivative
@@ -104,7 +112,7 @@ namespace thermalfist {
      * 
      * \param Tdep true -- considered, false -- not considered
      */
-    void SetTemperatureDependentAB(bool Tdep) { m_TemperatureDependentAB = Tdep; }
+    void SetTemperatureDependentAB(bool Tdep) { m_TemperatureDependentAB = Tdep; ClearSolutionsCache(); }
    
     /**
      * \brief Whether temperature depedence of
@@ -137,6 +145,29 @@ namespace thermalfist {
      */
     bool UseMultipleSolutionsMode() const { return m_SearchMultipleSolutions; }
 
+    /**
+     * \brief Whether the solutions found in the multiple solutions mode
+     *        are tracked across neighbouring values of the thermal parameters.
+     *
+     * If enabled, the branches of solutions found at the previous
+     * values of T and chemical potentials serve as initial guesses
+     * at the next, nearby, point. The full search over the initial guesses
+     * is only repeated when the number of branches changes, i.e. in the
+     * vicinity of the spinodals. This considerably speeds up scans
+     * of the phase diagram. False by default.
+     *
+     * The cached solutions are discarded whenever the interaction parameters change.
+     *
+     * \param track Whether the solutions should be tracked
+     */
+    void SetSolutionsTracking(bool track) { m_SolutionsTracking = track; if (!track) ClearSolutionsCache(); }
+
+    /// Whether the solutions found in the multiple solutions mode are tracked
+    bool SolutionsTracking() const { return m_SolutionsTracking; }
+
+    /// Clears the solutions cached for the tracking of the branches
+    void ClearSolutionsCache() { m_CachedSolutions.clear(); }
+
     /// The shifted chemical potential of particle species i.
     double MuStar(int i) const { return m_MuStar[i]; }
 
@@ -157,13 +188,14 @@ namespace thermalfist {
 
     void FillAttraction(const std::vector< std::vector<double> > & aij = std::vector< std::vector<double> >(0));
 
+    /// Reads the parameters from a text file or from a binary file written by InteractionParametersIO::WriteBinary()
     virtual void ReadInteractionParameters(const std::string &filename);
 
     virtual void WriteInteractionParameters(const std::string &filename);
 
-    void SetVirial(int i, int j, double b) { if (i >= 0 && i < static_cast<int>(m_Virial.size()) && j >= 0 && j < static_cast<int>(m_Virial[i].size())) m_Virial[i][j] = b; }
+    void SetVirial(int i, int j, double b) { if (i >= 0 && i < static_cast<int>(m_Virial.size()) && j >= 0 && j < static_cast<int>(m_Virial[i].size())) { m_Virial[i][j] = b; ClearSolutionsCache(); } }
     
-    void SetAttraction(int i, int j, double a) { if (i >= 0 && i < static_cast<int>(m_Attr.size()) && j >= 0 && j < static_cast<int>(m_Attr[i].size()))     m_Attr[i][j] = a; }
+    void SetAttraction(int i, int j, double a) { if (i >= 0 && i < static_cast<int>(m_Attr.size()) && j >= 0 && j < static_cast<int>(m_Attr[i].size()))     { m_Attr[i][j] = a; ClearSolutionsCache(); } }
 
     double VirialCoefficient(int i, int j) const;
 
@@ -223,6 +255,23 @@ namespace thermalfist {
      */
     virtual std::vector<double> SearchSingleSolution(const std::vector<double> & muStarInit);
 
+    /**
+     * \brief Solves the transcendental equations with the
+     *        Broyden's method for a given initial guess.
+     *
+     * Does not modify the state of the object, thus can be
+     * called from several threads simultaneously.
+     *
+     * \param dmuInit Initial guess for the shifts of the chemical potentials, one per interaction component
+     * \param dmuSol  The solved shifts of the chemical potentials
+     * \param maxdiff The final accuracy of the Broyden's method
+     * \return        Whether the Broyden's method converged
+     */
+    bool SolveFromInitialGuess(const std::vector<double> & dmuInit, std::vector<double> & dmuSol, double & maxdiff);
+
+    /// The pressure for the given shifts of the chemical potentials of the interaction components
+    double PressureForShifts(const std::vector<double> & dmustar);
+
     /**
      * \brief Uses the Broyden method with different initial guesses
      *        to look for different possible solutions
@@ -230,6 +279,11 @@ namespace thermalfist {
      *        shifted chemical potentials
      * 
      * Looks for the solution with the largest pressure.
+     * The initial guesses are processed in parallel, starting from
+     * the two ends of the range, followed by successive bisections.
+     * The search stops once a bisection level with at least four
+     * initial guesses yields no new solutions.
+     * See also SetSolutionsTracking().
      * 
      * \param iters Number of different initial guesses to try
      * \return std::vector<double> The solution with the largest pressure among those which were found
@@ -250,6 +304,16 @@ namespace thermalfist {
      */
     virtual double MuShift(int id) const;
 
+    // Result cache, see ThermalModelBase::SetResultCache()
+
+    virtual bool IsResultCacheSupported() const { return true; }
+
+    virtual void AppendResultCacheKey(std::vector<double> & key) const;
+
+    virtual void StoreResultCacheState(std::vector<double> & state) const;
+
+    virtual void RestoreResultCacheState(const std::vector<double> & state);
+
     /// Vector of ideal gas densities with shifted chemical potentials
     std::vector<double> m_DensitiesId;
 
@@ -289,7 +353,42 @@ namespace thermalfist {
 
     std::vector< std::vector<int> > m_dMuStarIndices;
 
+    /// Species grouped by identical rows of \f$ \tilde{b}_{ij} \f$ and \f$ a_{ij} + a_{ji} \f$
+    InteractionComponents m_Components;
+
+    /// Groups the species into m_Components and fills the
+    /// m_MapTodMuStar, m_MapFromdMuStar, and m_dMuStarIndices maps
+    void FillInteractionComponents();
+
+    /// Whether the solutions in the multiple solutions mode are tracked
+    bool   m_SolutionsTracking;
+
+    /// Thermal parameters (T, muB, muQ, muS, muC) of the cached solutions
+    std::vector<double> m_CachedSolutionsParameters;
+
+    /// Interaction components of the cached solutions
+    std::vector<int> m_CachedSolutionsComponents;
+
+    /// Cached distinct solutions for the shifts of the chemical potentials of the components
+    std::vector< std::vector<double> > m_CachedSolutions;
+
   private:
+    /// A solution of the QvdW equations found in the multiple solutions mode
+    struct VDWSolution {
+      std::vector<double> dMuStar;  ///< Shifts of the chemical potentials of the components
+      double Pressure;              ///< Pressure (GeV/fm^3)
+      double MaxDiff;               ///< Final accuracy of the Broyden's method
+    };
+
+    /**
+     * \brief Solves the equations for a set of initial guesses in parallel.
+     *
+     * New distinct solutions are appended to solutions.
+     *
+     * \return For each initial guess, the index of the found solution in solutions, or -1
+     */
+    std::vector<int> SolveForInitialGuesses(const std::vector< std::vector<double> > & guesses, std::vector<VDWSolution> & solutions);
+
     std::vector< std::vector<double> > m_chi;
 
     std::vector<double> m_chiarb;
@@ -304,8 +403,13 @@ namespace thermalfist {
     public:
       BroydenEquationsVDW(ThermalModelVDW *model) : BroydenEquations(), m_THM(model) { m_N = model->m_MapFromdMuStar.size(); }
       std::vector<double> Equations(const std::vector<double> &x);
+      void EvaluateEquations(const std::vector<double> &x, std::vector<double> &f);
+      /// The equations only read the model, the copy shares it
+      BroydenEquations* Clone() const { return new BroydenEquationsVDW(m_THM); }
     private:
       ThermalModelVDW *m_THM;
+      /// Ideal gas pressures and densities at the shifted chemical potentials, reused between the evaluations
+      std::vector<double> m_Ps, m_ns;
     };
 
     class BroydenJacobianVDW : public BroydenJacobian
@@ -49,6 +49,13 @@ namespace thermalfist {
      * 
      */
     virtual ~ThermalModelVDWCanonicalStrangeness(void);
+
+    /**
+     * \brief Creates a copy of the model.
+     *
+     * Overrides ThermalModelBase::Clone().
+     */
+    virtual ThermalModelVDWCanonicalStrangeness* Clone(ThermalParticleSystem *TPS = NULL) const;
     
     /// \copydoc thermalfist::ThermalModelVDW::FillVirialEV()
     void FillVirialEV(const std::vector< std::vector<double> > & bij = std::vector< std::vector<double> >(0));
@@ -7,11 +7,17 @@
  */
 #include "HRGBase/Broyden.h"
 
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
 #include <stdio.h>
 #include <cmath>
+#include <algorithm>
 
 #include <Eigen/Dense>
 
+#include "HRGBase/Profiler.h"
 
 using namespace Eigen;
 
@@ -24,8 +30,31 @@ namespace thermalfist {
   const int    Broyden::MAX_ITERS   = 200;
 
 
+  namespace {
+    /// Maximum number of step reductions in the line search
+    const int MaxLineSearchSteps = 10;
+
+    /// Applies the inverse Jacobian stored as the LU decomposition and a product of rank-one updates
+    VectorXd ApplyInverseJacobian(const PartialPivLU<MatrixXd>& lu, const vector<VectorXd>& us, const vector<VectorXd>& vs, const VectorXd& f)
+    {
+      VectorXd ret = lu.solve(f);
+      for (size_t k = 0; k < us.size(); ++k)
+        ret += us[k] * vs[k].dot(ret);
+      return ret;
+    }
+  }
+
   std::vector<double> BroydenJacobian::Jacobian(const std::vector<double>& x)
   {
+    std::vector<double> Jac;
+    FiniteDifferenceJacobian(x, Jac);
+    return Jac;
+  }
+
+  void BroydenJacobian::FiniteDifferenceJacobian(const std::vector<double>& x, std::vector<double>& jac)
+  {
+    THERMALFIST_PROFILE_SCOPE("BroydenJacobian::FiniteDifferenceJacobian");
+
     if (m_Equations == NULL) {
       printf("**ERROR** BroydenJacobian::Jacobian: Equations to solve not specified!\n");
       exit(1);
@@ -40,8 +69,6 @@ namespace thermalfist {
 
     std::vector<double> h = x;
 
-    std::vector< std::vector<double> > xh(N);
-
     for (size_t i = 0; i < x.size(); ++i) {
       h[i] = m_dx*abs(h[i]);
       if (h[i] == 0.0) h[i] = m_dx;
@@ -49,33 +76,58 @@ namespace thermalfist {
       //h[i] = max(m_dx, h[i]);
     }
 
-    for (size_t i = 0; i < x.size(); ++i) {
-      xh[i].resize(N);
-      for (size_t j = 0; j < x.size(); ++j) {
-        if (i != j)
-          xh[i][j] = x[j];
-        else
-          xh[i][j] = x[j] + h[j];
+    jac.resize(N*N);
+
+    m_Equations->EvaluateEquations(x, m_fx);
+
+    // Independent copies of the equations for the parallel evaluation of the columns,
+    // created once and reused until ReleaseEquationsCopies()
+#ifdef USE_OPENMP
+    if (!m_EquationsCopiesCreated) {
+      int maxthreads = std::min(omp_get_max_threads(), N);
+      for (int ithread = 1; ithread < maxthreads; ++ithread) {
+        BroydenEquations *clone = m_Equations->Clone();
+        if (clone == NULL)
+          break;
+        m_EquationsCopies.push_back(clone);
       }
+      m_EquationsCopiesCreated = true;
     }
+#endif
+    std::vector<BroydenEquations*> eqs(1, m_Equations);
+    eqs.insert(eqs.end(), m_EquationsCopies.begin(), m_EquationsCopies.end());
+    int nthreads = eqs.size();
 
-    std::vector<double> Jac(N*N);
-
-    std::vector<double> fx = m_Equations->Equations(x);
+    std::vector< std::vector<double> > xh(nthreads, x), fh(nthreads, std::vector<double>(N));
 
+#ifdef USE_OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic)
+#endif
     for (int j = 0; j < N; ++j) {
-      std::vector<double> dfdxj = m_Equations->Equations(xh[j]);
-      for (size_t i = 0; i < dfdxj.size(); ++i) {
-        dfdxj[i] = (dfdxj[i] - fx[i]) / h[j];
-        Jac[i*N + j] = dfdxj[i];
-      }
+      int tid = 0;
+#ifdef USE_OPENMP
+      tid = omp_get_thread_num();
+#endif
+      xh[tid][j] = x[j] + h[j];
+      eqs[tid]->EvaluateEquations(xh[tid], fh[tid]);
+      xh[tid][j] = x[j];
+      for (int i = 0; i < N; ++i)
+        jac[i*N + j] = (fh[tid][i] - m_fx[i]) / h[j];
     }
-    
-    return Jac;
+  }
+
+  void BroydenJacobian::ReleaseEquationsCopies()
+  {
+    for (size_t i = 0; i < m_EquationsCopies.size(); ++i)
+      delete m_EquationsCopies[i];
+    m_EquationsCopies.clear();
+    m_EquationsCopiesCreated = false;
   }
 
   std::vector<double> Broyden::Solve(const std::vector<double> &x0, BroydenSolutionCriterium *solcrit, int max_iterations)
   {
+    THERMALFIST_PROFILE_SCOPE("Broyden::Solve");
+
     if (m_Equations == NULL) {
       printf("**ERROR** Broyden::Solve: Equations to solve not specified!\n");
       exit(1);
@@ -96,36 +148,114 @@ namespace thermalfist {
       JacobianInUse = new BroydenJacobian(m_Equations);
       UseDefaultJacobian = true;
     }
+
+    std::vector<double> Jac;
+    JacobianInUse->EvaluateJacobian(x0, Jac);
+    THERMALFIST_PROFILE_COUNT("Broyden: Jacobian evaluations", 1);
+
+    std::vector<double> xcur = Iterate(x0, Jac, JacobianInUse, SolutionCriterium, max_iterations);
+
+    if (UseDefaultSolutionCriterium) {
+      delete SolutionCriterium;
+      SolutionCriterium = NULL;
+    }
+    if (UseDefaultJacobian) {
+      delete JacobianInUse;
+      JacobianInUse = NULL;
+    }
+    else {
+      JacobianInUse->ReleaseEquationsCopies();
+    }
+    return xcur;
+  }
+
+  std::vector<double> Broyden::Iterate(const std::vector<double>& x0, std::vector<double>& jacobian, BroydenJacobian * jacobianEval, BroydenSolutionCriterium * solcrit, int max_iterations)
+  {
     m_Iterations = 0;
     double &maxdiff = m_MaxDifference;
     int N = m_Equations->Dimension();
-    std::vector<double> xcur = x0, tmpvec, xdeltavec = x0;
-    VectorXd xold(N), xnew(N), xdelta(N);
-    VectorXd fold(N), fnew(N), fdelta(N);
+    std::vector<double> xcur = x0, fcur(N), xdeltavec(N, 0.);
 
-    xold = VectorXd::Map(&xcur[0], xcur.size());
+    PartialPivLU<MatrixXd> lu(Eigen::Map< Matrix<double, Dynamic, Dynamic, RowMajor> >(&jacobian[0], N, N));
 
-    MatrixXd Jac = Eigen::Map< Matrix<double, Dynamic, Dynamic, RowMajor> >(&JacobianInUse->Jacobian(xcur)[0], N, N);
-
-    if (Jac.determinant() == 0.0)
+    if (lu.determinant() == 0.0)
     {
       printf("**WARNING** Singular Jacobian in Broyden::Solve\n");
       return xcur;
     }
 
-    MatrixXd Jinv = Jac.inverse();
-    tmpvec = m_Equations->Equations(xcur);
-    fold   = VectorXd::Map(&tmpvec[0], tmpvec.size());
+    // Broyden updates of the inverse Jacobian, J^{-1} -> (1 + u v^T) J^{-1}
+    vector<VectorXd> us, vs;
 
-    for (m_Iterations = 1; m_Iterations < max_iterations; ++m_Iterations) {
-      xnew = xold - Jinv * fold;
+    VectorXd xold(N), xnew(N), xdelta(N), step(N);
+    VectorXd fold(N), fnew(N), fdelta(N);
+    VectorXd xfull(N), ffull(N);
 
-      VectorXd::Map(&xcur[0], xcur.size()) = xnew;
+    m_Equations->EvaluateEquations(xcur, fcur);
+    xold = VectorXd::Map(&xcur[0], N);
+    fold = VectorXd::Map(&fcur[0], N);
+    double normold = fold.squaredNorm();
 
-      tmpvec = m_Equations->Equations(xcur);
-      fnew   = VectorXd::Map(&tmpvec[0], tmpvec.size());
+    // Whether the Jacobian was evaluated at xold, rather than updated
+    bool jacobianFresh = true;
+    // Whether the last evaluation of the equations corresponds to xcur
+    bool stateAtCurrent = true;
+
+    for (m_Iterations = 1; m_Iterations < max_iterations; ++m_Iterations) {
+      step = -ApplyInverseJacobian(lu, us, vs, fold);
+
+      bool accepted = !m_UseLineSearch;
+      double lambda = 1.;
+      for (int ils = 0; ils <= (m_UseLineSearch ? MaxLineSearchSteps : 0); ++ils) {
+        xnew = xold + lambda * step;
+        VectorXd::Map(&xcur[0], N) = xnew;
+        m_Equations->EvaluateEquations(xcur, fcur);
+        fnew = VectorXd::Map(&fcur[0], N);
+
+        if (accepted)
+          break;
+
+        if (ils == 0) {
+          xfull = xnew;
+          ffull = fnew;
+        }
+
+        double normnew = fnew.squaredNorm();
+        if (normnew == normnew && normnew <= (1. - 1.e-4 * lambda) * normold) {
+          accepted = true;
+          break;
+        }
+
+        lambda *= 0.5;
+      }
+
+      if (!accepted) {
+        if (!jacobianFresh && jacobianEval != NULL) {
+          // Re-evaluate the Jacobian and repeat the step
+          VectorXd::Map(&xcur[0], N) = xold;
+          jacobianEval->EvaluateJacobian(xcur, jacobian);
+          THERMALFIST_PROFILE_COUNT("Broyden: Jacobian evaluations", 1);
+          THERMALFIST_PROFILE_COUNT("Broyden: failed line searches", 1);
+          lu.compute(Eigen::Map< Matrix<double, Dynamic, Dynamic, RowMajor> >(&jacobian[0], N, N));
+          us.clear();
+          vs.clear();
+          jacobianFresh = true;
+          stateAtCurrent = false;
+          if (lu.determinant() == 0.0) {
+            printf("**WARNING** Singular Jacobian in Broyden::Solve\n");
+            break;
+          }
+          continue;
+        }
+
+        // No decrease found, take the full step
+        xnew = xfull;
+        VectorXd::Map(&xcur[0], N) = xnew;
+        m_Equations->EvaluateEquations(xcur, fcur);
+        fnew = VectorXd::Map(&fcur[0], N);
+      }
+      stateAtCurrent = true;
 
-      
       maxdiff = 0.;
       for (size_t i = 0; i < xcur.size(); ++i) {
         maxdiff = std::max(maxdiff, fabs(fnew[i]));
@@ -136,40 +266,44 @@ namespace thermalfist {
 
       VectorXd::Map(&xdeltavec[0], xdeltavec.size()) = xdelta;
 
-      if (SolutionCriterium->IsSolved(xcur, tmpvec, xdeltavec))
+      if (solcrit->IsSolved(xcur, fcur, xdeltavec))
         break;
-      //if (maxdiff < relative_error) break;
 
       if (!m_UseNewton) // Use Broyden's method
       {
-        
-        double norm = 0.;
-        for (int i = 0; i < N; ++i)
-          for (int j = 0; j < N; ++j)
-            norm += xdelta[i] * Jinv(i, j) * fdelta[j];
-        VectorXd p1(N);
-        p1 = (xdelta - Jinv * fdelta);
-        for (int i = 0; i < N; ++i) p1[i] *= 1. / norm;
-        Jinv = Jinv + (p1 * xdelta.transpose()) * Jinv;
+        // Sherman-Morrison update of the inverse Jacobian
+        VectorXd Jfdelta = ApplyInverseJacobian(lu, us, vs, fdelta);
+        double norm = xdelta.dot(Jfdelta);
+        if (norm != 0. && norm == norm) {
+          us.push_back((xdelta - Jfdelta) / norm);
+          vs.push_back(xdelta);
+        }
+        jacobianFresh = false;
       }
       else // Use Newton's method
       {
-        Jac = Eigen::Map< Matrix<double, Dynamic, Dynamic, RowMajor> >(&JacobianInUse->Jacobian(xcur)[0], N, N);
-        Jinv = Jac.inverse();
+        jacobianEval->EvaluateJacobian(xcur, jacobian);
+        THERMALFIST_PROFILE_COUNT("Broyden: Jacobian evaluations", 1);
+        lu.compute(Eigen::Map< Matrix<double, Dynamic, Dynamic, RowMajor> >(&jacobian[0], N, N));
+        us.clear();
+        vs.clear();
+        jacobianFresh = true;
+        stateAtCurrent = false;
       }
 
       xold = xnew;
       fold = fnew;
+      normold = fold.squaredNorm();
     }
 
-    if (UseDefaultSolutionCriterium) {
-      delete SolutionCriterium;
-      SolutionCriterium = NULL;
-    }
-    if (UseDefaultJacobian) {
-      delete JacobianInUse;
-      JacobianInUse = NULL;
+    // Make sure the equations were last evaluated at the returned values of the variables
+    if (!stateAtCurrent) {
+      VectorXd::Map(&xcur[0], N) = xold;
+      m_Equations->EvaluateEquations(xcur, fcur);
     }
+
+    THERMALFIST_PROFILE_COUNT("Broyden: iterations", m_Iterations);
+
     return xcur;
   }
 
@@ -24,6 +24,9 @@ namespace thermalfist {
   namespace IdealGasFunctions {
 
     bool calculationHadBECIssue = false;
+#ifdef USE_OPENMP
+#pragma omp threadprivate(calculationHadBECIssue)
+#endif
 
     double BoltzmannDensity(double T, double mu, double m, double deg) {
       if (m == 0.)
@@ -111,31 +114,19 @@ namespace thermalfist {
 
     double QuantumClusterExpansionEnergyDensity(int statistics, double T, double mu, double m, double deg, int order)
     {
-      double sign = 1.;
-      bool signchange = true;
-      if (statistics == 1) //Fermi
-        signchange = true;
-      else if (statistics == -1) //Bose
-        signchange = false;
-      else
+      if (statistics != 1 && statistics != -1)
         return BoltzmannEnergyDensity(T, mu, m, deg);
 
-      double tfug = exp((mu - m) / T);
-      double cfug = tfug;
-      double moverT = m / T;
-      double ret = 0.;
-      for (int i = 1; i <= order; ++i) {
-        ret += sign * (xMath::BesselKexp(1, i*moverT) + 3. * xMath::BesselKexp(2, i*moverT) / moverT / static_cast<double>(i)) * cfug / static_cast<double>(i);
-        cfug *= tfug;
-        if (signchange) sign = -sign;
-      }
-      ret *= deg * m * m * m * T / 2. / xMath::Pi() / xMath::Pi() * xMath::GeVtoifm3();
-      return ret;
+      // K_1 and K_2 are both needed, computed from a single evaluation of K_0 and K_1
+      return QuantumClusterExpansionQuantities(statistics, T, mu, m, deg, order).e;
     }
 
     double QuantumClusterExpansionEntropyDensity(int statistics, double T, double mu, double m, double deg, int order)
     {
-      return (QuantumClusterExpansionPressure(statistics, T, mu, m, deg, order) + QuantumClusterExpansionEnergyDensity(statistics, T, mu, m, deg, order) - mu * QuantumClusterExpansionDensity(statistics, T, mu, m, deg, order)) / T;
+      if (statistics != 1 && statistics != -1)
+        return BoltzmannEntropyDensity(T, mu, m, deg);
+
+      return QuantumClusterExpansionQuantities(statistics, T, mu, m, deg, order).s;
     }
 
     double QuantumClusterExpansionScalarDensity(int statistics, double T, double mu, double m, double deg, int order)
@@ -191,6 +182,88 @@ namespace thermalfist {
       return QuantumClusterExpansionTdndmu(N - 1, statistics, T, mu, m, deg, order) / pow(T, 3) / xMath::GeVtoifm3();
     }
 
+    double IdealGasQuantities::Value(Quantity quantity) const
+    {
+      switch (quantity) {
+        case ParticleDensity: return n;
+        case Pressure:        return P;
+        case EnergyDensity:   return e;
+        case EntropyDensity:  return s;
+        case ScalarDensity:   return ns;
+        // The enumerators are hidden by the members with the same names
+        case IdealGasFunctions::chi2: return chi2;
+        case IdealGasFunctions::chi3: return chi3;
+        case IdealGasFunctions::chi4: return chi4;
+      }
+      return 0.;
+    }
+
+    void IdealGasQuantities::Add(const IdealGasQuantities & other, double factor)
+    {
+      n += factor * other.n;
+      P += factor * other.P;
+      e += factor * other.e;
+      s += factor * other.s;
+      ns += factor * other.ns;
+      chi2 += factor * other.chi2;
+      chi3 += factor * other.chi3;
+      chi4 += factor * other.chi4;
+    }
+
+    IdealGasQuantities QuantumClusterExpansionQuantities(int statistics, double T, double mu, double m, double deg, int order, std::vector<IdealGasQuantities>* terms)
+    {
+      // Maxwell-Boltzmann statistics is the first term of the expansion
+      if (statistics == 0)
+        order = 1;
+      if (order < 0)
+        order = 0;
+
+      if (terms != NULL)
+        terms->resize(order);
+
+      double sign = 1.;
+      bool signchange = (statistics == 1);
+
+      double tfug = exp((mu - m) / T);
+      double cfug = tfug;
+      double moverT = m / T;
+      double pref = deg * m * m * T / 2. / xMath::Pi() / xMath::Pi() * xMath::GeVtoifm3();
+      double chinorm = 1. / pow(T, 3) / xMath::GeVtoifm3();
+
+      IdealGasQuantities ret;
+      for (int i = 1; i <= order; ++i) {
+        double x = i * moverT;
+        double K1 = 0., K2 = 0., K2overx = 0.;
+        if (x > 0.) {
+          // Same upward recurrence as in xMath::BesselKexp()
+          K1 = xMath::BesselK1exp(x);
+          K2 = xMath::BesselK0exp(x) + (2. / x) * K1;
+          K2overx = K2 / x;
+        }
+
+        double coef = sign * cfug * pref;
+        double di = static_cast<double>(i);
+
+        IdealGasQuantities term;
+        term.n = coef * K2 / di;
+        term.P = coef * K2 * T / di / di;
+        term.e = coef * m * (K1 + 3. * K2overx) / di;
+        term.s = (term.P + term.e - mu * term.n) / T;
+        term.ns = coef * K1 / di;
+        term.chi2 = coef * K2 * chinorm;
+        term.chi3 = term.chi2 * di;
+        term.chi4 = term.chi3 * di;
+
+        ret.Add(term);
+        if (terms != NULL)
+          (*terms)[i - 1] = term;
+
+        cfug *= tfug;
+        if (signchange) sign = -sign;
+      }
+      return ret;
+    }
+
 
     // Gauss-Legendre 32-point quadrature for [0,1] interval
     const double *legx32 = NumericalIntegration::coefficients_xleg32_zeroone;
@@ -637,66 +710,188 @@ namespace thermalfist {
       return FermiNumericalIntegrationLargeMuTdndmu(N - 1, T, mu, m, deg) / pow(T, 3) / xMath::GeVtoifm3();
     }
 
+    namespace {
+      /// Compile-time specialization of IdealGasQuantity(), the dispatch below is resolved by the compiler
+      template<Quantity quantity, QStatsCalculationType calctype, int statistics>
+      double IdealGasQuantityKernelT(double T, double mu, double m, double deg, int order)
+      {
+        if (statistics == 0) {
+          switch (quantity) {
+          case ParticleDensity: return BoltzmannDensity(T, mu, m, deg);
+          case Pressure:        return BoltzmannPressure(T, mu, m, deg);
+          case EnergyDensity:   return BoltzmannEnergyDensity(T, mu, m, deg);
+          case EntropyDensity:  return BoltzmannEntropyDensity(T, mu, m, deg);
+          case ScalarDensity:   return BoltzmannScalarDensity(T, mu, m, deg);
+          case chi2:            return BoltzmannChiN(2, T, mu, m, deg);
+          case chi3:            return BoltzmannChiN(3, T, mu, m, deg);
+          case chi4:            return BoltzmannChiN(4, T, mu, m, deg);
+          }
+        }
+        else if (calctype == ClusterExpansion) {
+          switch (quantity) {
+          case ParticleDensity: return QuantumClusterExpansionDensity(statistics, T, mu, m, deg, order);
+          case Pressure:        return QuantumClusterExpansionPressure(statistics, T, mu, m, deg, order);
+          case EnergyDensity:   return QuantumClusterExpansionEnergyDensity(statistics, T, mu, m, deg, order);
+          case EntropyDensity:  return QuantumClusterExpansionEntropyDensity(statistics, T, mu, m, deg, order);
+          case ScalarDensity:   return QuantumClusterExpansionScalarDensity(statistics, T, mu, m, deg, order);
+          case chi2:            return QuantumClusterExpansionChiN(2, statistics, T, mu, m, deg, order);
+          case chi3:            return QuantumClusterExpansionChiN(3, statistics, T, mu, m, deg, order);
+          case chi4:            return QuantumClusterExpansionChiN(4, statistics, T, mu, m, deg, order);
+          }
+        }
+        else {
+          switch (quantity) {
+          case ParticleDensity: return QuantumNumericalIntegrationDensity(statistics, T, mu, m, deg);
+          case Pressure:        return QuantumNumericalIntegrationPressure(statistics, T, mu, m, deg);
+          case EnergyDensity:   return QuantumNumericalIntegrationEnergyDensity(statistics, T, mu, m, deg);
+          case EntropyDensity:  return QuantumNumericalIntegrationEntropyDensity(statistics, T, mu, m, deg);
+          case ScalarDensity:   return QuantumNumericalIntegrationScalarDensity(statistics, T, mu, m, deg);
+          case chi2:            return QuantumNumericalIntegrationChiN(2, statistics, T, mu, m, deg);
+          case chi3:            return QuantumNumericalIntegrationChiN(3, statistics, T, mu, m, deg);
+          case chi4:            return QuantumNumericalIntegrationChiN(4, statistics, T, mu, m, deg);
+          }
+        }
+        return 0.;
+      }
+
+      template<QStatsCalculationType calctype, int statistics>
+      IdealGasQuantityKernel KernelForQuantity(Quantity quantity)
+      {
+        switch (quantity) {
+        case ParticleDensity: return &IdealGasQuantityKernelT<ParticleDensity, calctype, statistics>;
+        case Pressure:        return &IdealGasQuantityKernelT<Pressure, calctype, statistics>;
+        case EnergyDensity:   return &IdealGasQuantityKernelT<EnergyDensity, calctype, statistics>;
+        case EntropyDensity:  return &IdealGasQuantityKernelT<EntropyDensity, calctype, statistics>;
+        case ScalarDensity:   return &IdealGasQuantityKernelT<ScalarDensity, calctype, statistics>;
+        case chi2:            return &IdealGasQuantityKernelT<chi2, calctype, statistics>;
+        case chi3:            return &IdealGasQuantityKernelT<chi3, calctype, statistics>;
+        case chi4:            return &IdealGasQuantityKernelT<chi4, calctype, statistics>;
+        }
+        return NULL;
+      }
+
+      template<int statistics>
+      IdealGasQuantityKernel KernelForCalculationType(Quantity quantity, QStatsCalculationType calctype)
+      {
+        if (calctype == ClusterExpansion)
+          return KernelForQuantity<ClusterExpansion, statistics>(quantity);
+        return KernelForQuantity<Quadratures, statistics>(quantity);
+      }
+    }
+
+    IdealGasQuantityKernel GetIdealGasQuantityKernel(Quantity quantity, QStatsCalculationType calctype, int statistics)
+    {
+      if (statistics == 0)
+        return KernelForCalculationType<0>(quantity, calctype);
+      if (statistics == 1)
+        return KernelForCalculationType<1>(quantity, calctype);
+      if (statistics == -1)
+        return KernelForCalculationType<-1>(quantity, calctype);
+      return NULL;
+    }
+
     double IdealGasQuantity(Quantity quantity, QStatsCalculationType calctype, int statistics, double T, double mu, double m, double deg, int order)
     {
+      IdealGasQuantityKernel kernel = GetIdealGasQuantityKernel(quantity, calctype, statistics);
+      if (kernel == NULL) {
+        printf("**WARNING** IdealGasFunctions::IdealGasQuantity: Unknown quantity or statistics\n");
+        return 0.;
+      }
+      return kernel(T, mu, m, deg, order);
+    }
+
+    void IdealGasSusceptibilities(int N, QStatsCalculationType calctype, int statistics, double T, double mu, double m, double deg, std::vector<double>& chis, int order)
+    {
+      chis.assign(N > 0 ? N : 0, 0.);
+      if (N < 1)
+        return;
+
+      double norm = 1. / pow(T, 3) / xMath::GeVtoifm3();
+
+      // All susceptibilities are equal to n/T^3
       if (statistics == 0) {
-        if (quantity == ParticleDensity)
-          return BoltzmannDensity(T, mu, m, deg);
-        if (quantity == Pressure)
-          return BoltzmannPressure(T, mu, m, deg);
-        if (quantity == EnergyDensity)
-          return BoltzmannEnergyDensity(T, mu, m, deg);
-        if (quantity == EntropyDensity)
-          return BoltzmannEntropyDensity(T, mu, m, deg);
-        if (quantity == ScalarDensity)
-          return BoltzmannScalarDensity(T, mu, m, deg);
-        if (quantity == chi2)
-          return BoltzmannChiN(2, T, mu, m, deg);
-        if (quantity == chi3)
-          return BoltzmannChiN(3, T, mu, m, deg);
-        if (quantity == chi4)
-          return BoltzmannChiN(4, T, mu, m, deg);
-      }
-      else {
-        if (calctype == ClusterExpansion) {
-          if (quantity == ParticleDensity)
-            return QuantumClusterExpansionDensity(statistics, T, mu, m, deg, order);
-          if (quantity == Pressure)
-            return QuantumClusterExpansionPressure(statistics, T, mu, m, deg, order);
-          if (quantity == EnergyDensity)
-            return QuantumClusterExpansionEnergyDensity(statistics, T, mu, m, deg, order);
-          if (quantity == EntropyDensity)
-            return QuantumClusterExpansionEntropyDensity(statistics, T, mu, m, deg, order);
-          if (quantity == ScalarDensity)
-            return QuantumClusterExpansionScalarDensity(statistics, T, mu, m, deg, order);
-          if (quantity == chi2)
-            return QuantumClusterExpansionChiN(2, statistics, T, mu, m, deg, order);
-          if (quantity == chi3)
-            return QuantumClusterExpansionChiN(3, statistics, T, mu, m, deg, order);
-          if (quantity == chi4)
-            return QuantumClusterExpansionChiN(4, statistics, T, mu, m, deg, order);
+        double dens = BoltzmannDensity(T, mu, m, deg) * norm;
+        for (int n = 0; n < N; ++n)
+          chis[n] = dens;
+        return;
+      }
+
+      // Each order brings a factor i to the i-th term, same as in QuantumClusterExpansionTdndmu()
+      if (calctype == ClusterExpansion) {
+        double sign = 1.;
+        bool signchange = (statistics == 1);
+        double tfug = exp((mu - m) / T);
+        double cfug = tfug;
+        double moverT = m / T;
+        for (int i = 1; i <= order; ++i) {
+          double term = sign * xMath::BesselKexp(2, i*moverT) * cfug;
+          double ipow = 1. / i;
+          for (int n = 0; n < N; ++n) {
+            chis[n] += term * ipow;
+            ipow *= i;
+          }
+          cfug *= tfug;
+          if (signchange) sign = -sign;
         }
-        else {
-          if (quantity == ParticleDensity)
-            return QuantumNumericalIntegrationDensity(statistics, T, mu, m, deg);
-          if (quantity == Pressure)
-            return QuantumNumericalIntegrationPressure(statistics, T, mu, m, deg);
-          if (quantity == EnergyDensity)
-            return QuantumNumericalIntegrationEnergyDensity(statistics, T, mu, m, deg);
-          if (quantity == EntropyDensity)
-            return QuantumNumericalIntegrationEntropyDensity(statistics, T, mu, m, deg);
-          if (quantity == ScalarDensity)
-            return QuantumNumericalIntegrationScalarDensity(statistics, T, mu, m, deg);
-          if (quantity == chi2)
-            return QuantumNumericalIntegrationChiN(2, statistics, T, mu, m, deg);
-          if (quantity == chi3)
-            return QuantumNumericalIntegrationChiN(3, statistics, T, mu, m, deg);
-          if (quantity == chi4)
-            return QuantumNumericalIntegrationChiN(4, statistics, T, mu, m, deg);
+        double pref = deg * m * m * T / 2. / xMath::Pi() / xMath::Pi() * xMath::GeVtoifm3() * norm;
+        for (int n = 0; n < N; ++n)
+          chis[n] *= pref;
+        return;
+      }
+
+      if (statistics == -1 && mu > m) {
+        printf("**WARNING** IdealGasSusceptibilities: Bose-Einstein condensation\n");
+        calculationHadBECIssue = true;
+        return;
+      }
+
+      // d^k f / d(mu/T)^k as polynomials in f = 1 / (exp((E-mu)/T) + statistics),
+      // using df / d(mu/T) = f (1 - statistics * f)
+      vector< vector<double> > coefs(N);
+      coefs[0].assign(2, 0.);
+      coefs[0][1] = 1.;
+      for (int k = 1; k < N; ++k) {
+        coefs[k].assign(k + 2, 0.);
+        for (int j = 1; j <= k; ++j) {
+          coefs[k][j] += j * coefs[k - 1][j];
+          coefs[k][j + 1] -= statistics * j * coefs[k - 1][j];
         }
       }
-      printf("**WARNING** IdealGasFunctions::IdealGasQuantity: Unknown quantity\n");
-      return 0.;
+
+      // Quadrature nodes: momentum, weight times p^2 dp
+      vector<double> ps, ws;
+      double moverT = m / T;
+      double muoverT = mu / T;
+      double pf = 0.;
+      if (statistics == 1 && mu > m) {
+        pf = sqrt(mu*mu - m * m);
+        for (int i = 0; i < 32; i++) {
+          ps.push_back(pf * legx32[i]);
+          ws.push_back(legw32[i] * pf * legx32[i] * pf * legx32[i] * pf);
+        }
+      }
+      for (int i = 0; i < 32; i++) {
+        double tx = pf / T + lagx32[i];
+        ps.push_back(T * tx);
+        ws.push_back(lagw32[i] * T * tx * T * tx * T);
+      }
+
+      for (size_t i = 0; i < ps.size(); ++i) {
+        double f = 1. / (exp(sqrt(ps[i] * ps[i] / T / T + moverT * moverT) - muoverT) + statistics);
+        for (int k = 0; k < N; ++k) {
+          double val = 0.;
+          for (int j = static_cast<int>(coefs[k].size()) - 1; j >= 1; --j)
+            val = (val + coefs[k][j]) * f;
+          chis[k] += ws[i] * val;
+        }
+      }
+
+      for (int n = 0; n < N; ++n)
+        chis[n] *= deg / 2. / xMath::Pi() / xMath::Pi() * xMath::GeVtoifm3() * norm;
+
+      // The density at mu > m is computed more accurately by the dedicated routine
+      if (statistics == 1 && mu > m)
+        chis[0] = FermiNumericalIntegrationLargeMuDensity(T, mu, m, deg) * norm;
     }
 
   } // namespace IdealGasFunctions
@@ -0,0 +1,244 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2020 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include "HRGBase/Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace thermalfist {
+
+  namespace Profiler {
+
+    namespace {
+
+      /// Maximum number of the recorded trace events per thread
+      const size_t MaxTraceEvents = 1000000;
+
+      struct TimerStats {
+        long long calls;
+        double total, min, max;  // in seconds
+        TimerStats() : calls(0), total(0.), min(0.), max(0.) { }
+        void Add(double t) {
+          if (calls == 0 || t < min) min = t;
+          if (calls == 0 || t > max) max = t;
+          total += t;
+          calls++;
+        }
+        void Merge(const TimerStats& other) {
+          if (other.calls == 0) return;
+          if (calls == 0 || other.min < min) min = other.min;
+          if (calls == 0 || other.max > max) max = other.max;
+          total += other.total;
+          calls += other.calls;
+        }
+      };
+
+      struct TraceEvent {
+        const char* name;
+        double ts, dur;  // in microseconds
+      };
+
+      /// Profiling data of a single thread. Keyed by the pointer to the name,
+      /// identical names from different translation units are merged in the reports.
+      struct ThreadData {
+        int index;
+        std::map<const char*, TimerStats> timers;
+        std::map<const char*, long long> counters;
+        std::vector<TraceEvent> events;
+      };
+
+      std::atomic<bool> s_Enabled(true);
+      std::atomic<bool> s_Tracing(false);
+
+      /// Owns the data of all the threads, including those which have finished
+      std::mutex s_RegistryMutex;
+      std::vector<ThreadData*> s_Registry;
+
+      std::chrono::steady_clock::time_point s_Origin = std::chrono::steady_clock::now();
+
+      thread_local ThreadData* t_Data = NULL;
+
+      ThreadData& CurrentThreadData() {
+        if (t_Data == NULL) {
+          std::lock_guard<std::mutex> lock(s_RegistryMutex);
+          t_Data = new ThreadData();
+          t_Data->index = static_cast<int>(s_Registry.size());
+          s_Registry.push_back(t_Data);
+        }
+        return *t_Data;
+      }
+
+      bool CompareByTotal(const std::pair<std::string, TimerStats>& a, const std::pair<std::string, TimerStats>& b) {
+        return a.second.total > b.second.total;
+      }
+
+      void PrintTable(FILE* out,
+        const std::map<std::string, TimerStats>& timers,
+        const std::map<std::string, long long>& counters) {
+        std::vector< std::pair<std::string, TimerStats> > sorted(timers.begin(), timers.end());
+        std::stable_sort(sorted.begin(), sorted.end(), CompareByTotal);
+
+        fprintf(out, "%-50s %12s %14s %14s %14s %14s\n", "Scope", "Calls", "Total [ms]", "Mean [ms]", "Min [ms]", "Max [ms]");
+        for (size_t i = 0; i < sorted.size(); ++i) {
+          const TimerStats& st = sorted[i].second;
+          fprintf(out, "%-50s %12lld %14.3lf %14.5lf %14.5lf %14.5lf\n",
+            sorted[i].first.c_str(), st.calls,
+            1.e3 * st.total, 1.e3 * st.total / static_cast<double>(st.calls),
+            1.e3 * st.min, 1.e3 * st.max);
+        }
+
+        if (!counters.empty()) {
+          fprintf(out, "%-50s %12s\n", "Counter", "Value");
+          for (std::map<std::string, long long>::const_iterator it = counters.begin(); it != counters.end(); ++it)
+            fprintf(out, "%-50s %12lld\n", it->first.c_str(), it->second);
+        }
+      }
+
+      void AddThreadData(const ThreadData& data,
+        std::map<std::string, TimerStats>& timers,
+        std::map<std::string, long long>& counters) {
+        for (std::map<const char*, TimerStats>::const_iterator it = data.timers.begin(); it != data.timers.end(); ++it)
+          timers[it->first].Merge(it->second);
+        for (std::map<const char*, long long>::const_iterator it = data.counters.begin(); it != data.counters.end(); ++it)
+          counters[it->first] += it->second;
+      }
+
+      void WriteJSONString(FILE* out, const char* str) {
+        fputc('"', out);
+        for (const char* c = str; *c; ++c) {
+          if (*c == '"' || *c == '\\')
+            fputc('\\', out);
+          fputc(*c, out);
+        }
+        fputc('"', out);
+      }
+
+    } // anonymous namespace
+
+    bool IsCompiledIn()
+    {
+#ifdef USE_PROFILING
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    void SetEnabled(bool enabled)
+    {
+      s_Enabled = enabled;
+    }
+
+    bool IsEnabled()
+    {
+      return s_Enabled.load(std::memory_order_relaxed);
+    }
+
+    void SetTracing(bool tracing)
+    {
+      s_Tracing = tracing;
+    }
+
+    bool IsTracing()
+    {
+      return s_Tracing.load(std::memory_order_relaxed);
+    }
+
+    void Reset()
+    {
+      std::lock_guard<std::mutex> lock(s_RegistryMutex);
+      for (size_t i = 0; i < s_Registry.size(); ++i) {
+        s_Registry[i]->timers.clear();
+        s_Registry[i]->counters.clear();
+        std::vector<TraceEvent>().swap(s_Registry[i]->events);
+      }
+      s_Origin = std::chrono::steady_clock::now();
+    }
+
+    void AddCounter(const char* name, long long value)
+    {
+      CurrentThreadData().counters[name] += value;
+    }
+
+    void AddTiming(const char* name,
+      const std::chrono::steady_clock::time_point& start,
+      const std::chrono::steady_clock::time_point& finish)
+    {
+      ThreadData& data = CurrentThreadData();
+      data.timers[name].Add(std::chrono::duration<double>(finish - start).count());
+
+      if (IsTracing() && data.events.size() < MaxTraceEvents) {
+        TraceEvent ev;
+        ev.name = name;
+        ev.ts = std::chrono::duration<double, std::micro>(start - s_Origin).count();
+        ev.dur = std::chrono::duration<double, std::micro>(finish - start).count();
+        data.events.push_back(ev);
+      }
+    }
+
+    void PrintSummary(FILE* out, bool perThread)
+    {
+      std::lock_guard<std::mutex> lock(s_RegistryMutex);
+
+      if (!IsCompiledIn())
+        fprintf(out, "**WARNING** Profiler::PrintSummary(): The library was compiled without the USE_PROFILING flag, no data collected\n");
+
+      std::map<std::string, TimerStats> timers;
+      std::map<std::string, long long> counters;
+      for (size_t i = 0; i < s_Registry.size(); ++i)
+        AddThreadData(*s_Registry[i], timers, counters);
+
+      fprintf(out, "Thermal-FIST profiling summary, number of threads: %d\n", static_cast<int>(s_Registry.size()));
+      PrintTable(out, timers, counters);
+
+      if (perThread) {
+        for (size_t i = 0; i < s_Registry.size(); ++i) {
+          std::map<std::string, TimerStats> thtimers;
+          std::map<std::string, long long> thcounters;
+          AddThreadData(*s_Registry[i], thtimers, thcounters);
+          fprintf(out, "\nThread %d\n", s_Registry[i]->index);
+          PrintTable(out, thtimers, thcounters);
+        }
+      }
+    }
+
+    bool WriteTraceEvents(const std::string& filename)
+    {
+      FILE* f = fopen(filename.c_str(), "w");
+      if (f == NULL) {
+        printf("**WARNING** Profiler::WriteTraceEvents(): Cannot open file %s for writing\n", filename.c_str());
+        return false;
+      }
+
+      std::lock_guard<std::mutex> lock(s_RegistryMutex);
+
+      fprintf(f, "{\"traceEvents\":[");
+      bool first = true;
+      for (size_t i = 0; i < s_Registry.size(); ++i) {
+        const ThreadData& data = *s_Registry[i];
+        for (size_t iev = 0; iev < data.events.size(); ++iev) {
+          const TraceEvent& ev = data.events[iev];
+          fprintf(f, "%s\n{\"name\":", first ? "" : ",");
+          WriteJSONString(f, ev.name);
+          fprintf(f, ",\"cat\":\"ThermalFIST\",\"ph\":\"X\",\"ts\":%.3lf,\"dur\":%.3lf,\"pid\":1,\"tid\":%d}",
+            ev.ts, ev.dur, data.index);
+          first = false;
+        }
+      }
+      fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+      fclose(f);
+      return true;
+    }
+
+  } // namespace Profiler
+
+} // namespace thermalfist
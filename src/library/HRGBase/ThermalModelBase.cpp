@@ -12,6 +12,7 @@
 
 #include <Eigen/Dense>
 
+#include "HRGBase/Profiler.h"
 #include "HRGBase/Utility.h"
 #include "HRGBase/ThermalParticleSystem.h"
 
@@ -30,6 +31,7 @@ namespace thermalfist {
     m_FeeddownCalculated(false),
     m_FluctuationsCalculated(false),
     m_GCECalculated(false),
+    m_DenseFinalCorrelations(false),
     m_NormBratio(false),
     m_QuantumStats(true),
     m_MaxDiff(0.),
@@ -40,6 +42,7 @@ namespace thermalfist {
     
     m_QBgoal = 0.4;
     m_SBgoal = 50.;
+    m_ResultCache = NULL;
     m_Chem.resize(m_TPS->Particles().size());
     m_Volume = params.V;
     m_densities.resize(m_TPS->Particles().size());
@@ -70,7 +73,7 @@ namespace thermalfist {
     }
 
     m_PrimCorrel = std::vector< std::vector<double> >(TPS()->ComponentsNumber(), std::vector<double>(TPS()->ComponentsNumber(), 0.));
-    m_TotalCorrel = std::vector< std::vector<double> >(TPS()->ComponentsNumber(), std::vector<double>(TPS()->ComponentsNumber(), 0.));
+    m_TotalCorrel.clear();
     m_PrimChargesCorrel = std::vector< std::vector<double> >(TPS()->ComponentsNumber(), std::vector<double>(4, 0.));
     m_FinalChargesCorrel = std::vector< std::vector<double> >(TPS()->ComponentsNumber(), std::vector<double>(4, 0.));
 
@@ -87,6 +90,30 @@ namespace thermalfist {
   }
 
 
+  ThermalModelBase* ThermalModelBase::Clone(ThermalParticleSystem* /*TPS*/) const
+  {
+    printf("**WARNING** %s::Clone(): Copying is not implemented for this model\n", m_TAG.c_str());
+    return NULL;
+  }
+
+  void ThermalModelBase::FinalizeClone(ThermalModelBase* clone, ThermalParticleSystem* TPS) const
+  {
+    clone->m_OwnTPS.reset();
+    if (TPS != NULL) {
+      if (TPS->ComponentsNumber() != m_TPS->ComponentsNumber()) {
+        printf("**ERROR** %s::Clone(): The particle list of the copy does not match the particle list of the model!\n", m_TAG.c_str());
+        exit(1);
+      }
+      clone->m_TPS = TPS;
+    }
+    else if (m_UseWidth && m_TPS->ResonanceWidthIntegrationType() == ThermalParticle::eBW) {
+      // CalculateFeeddown() modifies the thermal branching ratios in the particle list
+      clone->m_OwnTPS = std::make_shared<ThermalParticleSystem>(*m_TPS);
+      clone->m_TPS = clone->m_OwnTPS.get();
+    }
+    clone->m_ResultCache = NULL;
+  }
+
   void ThermalModelBase::FillVirial(const std::vector<double>& /*ri*/)
   {
   }
@@ -328,7 +355,7 @@ namespace thermalfist {
     m_kurtprim.resize(m_TPS->Particles().size());
     m_kurttot.resize(m_TPS->Particles().size());
     m_PrimCorrel = std::vector< std::vector<double> >(TPS()->ComponentsNumber(), std::vector<double>(TPS()->ComponentsNumber(), 0.));
-    m_TotalCorrel = std::vector< std::vector<double> >(TPS()->ComponentsNumber(), std::vector<double>(TPS()->ComponentsNumber(), 0.));
+    m_TotalCorrel.clear();
     m_PrimChargesCorrel = std::vector< std::vector<double> >(TPS()->ComponentsNumber(), std::vector<double>(4, 0.));
     m_FinalChargesCorrel = std::vector< std::vector<double> >(TPS()->ComponentsNumber(), std::vector<double>(4, 0.));
     ResetCalculatedFlags();
@@ -406,36 +433,64 @@ namespace thermalfist {
     m_densitiesbyfeeddown[static_cast<int>(Feeddown::Primordial)] = m_densities;
 
     // According to stability flags
-    int feed_index = static_cast<int>(Feeddown::StabilityFlag);
+    ApplyFeeddown(Feeddown::StabilityFlag, m_densities, m_densitiestotal);
+    m_densitiesbyfeeddown[static_cast<int>(Feeddown::StabilityFlag)] = m_densitiestotal;
+
+    // Weak, EM, strong
+    for (int feed_index = static_cast<int>(Feeddown::Weak); feed_index <= static_cast<int>(Feeddown::Strong); ++feed_index)
+      ApplyFeeddown(static_cast<Feeddown::Type>(feed_index), m_densities, m_densitiesbyfeeddown[feed_index]);
+
+    m_FeeddownCalculated = true;
+  }
+
+  void ThermalModelBase::ApplyFeeddown(Feeddown::Type feeddown, const std::vector<double>& primordial, std::vector<double>& totals) const
+  {
+    int feed_index = static_cast<int>(feeddown);
+    totals.resize(primordial.size());
     for (int i = 0; i < m_TPS->ComponentsNumber(); ++i) {
-      m_densitiestotal[i] = m_densities[i];
-      //const std::vector< std::pair<double, int> >& decayContributions = m_TPS->Particles()[i].DecayContributionsByFeeddown()[feed_index];
+      totals[i] = primordial[i];
+      if (feeddown == Feeddown::Primordial)
+        continue;
       const ThermalParticleSystem::DecayContributionsToParticle& decayContributions = m_TPS->DecayContributionsByFeeddown()[feed_index][i];
       for (size_t j = 0; j < decayContributions.size(); ++j)
-        if (i != decayContributions[j].second) 
-          m_densitiestotal[i] += decayContributions[j].first * m_densities[decayContributions[j].second];
+        if (i != decayContributions[j].second)
+          totals[i] += decayContributions[j].first * primordial[decayContributions[j].second];
     }
+  }
 
-    m_densitiesbyfeeddown[feed_index] = m_densitiestotal;
 
-    // Weak, EM, strong
-    for (feed_index = static_cast<int>(Feeddown::Weak); feed_index <= static_cast<int>(Feeddown::Strong); ++feed_index) {
-      for (int i = 0; i < m_TPS->ComponentsNumber(); ++i) {
-        m_densitiesbyfeeddown[feed_index][i] = m_densities[i];
-        //const std::vector< std::pair<double, int> >& decayContributions = m_TPS->Particles()[i].DecayContributionsByFeeddown()[feed_index];
-        const ThermalParticleSystem::DecayContributionsToParticle& decayContributions = m_TPS->DecayContributionsByFeeddown()[feed_index][i];
-        for (size_t j = 0; j < decayContributions.size(); ++j)
-          if (i != decayContributions[j].second)
-            m_densitiesbyfeeddown[feed_index][i] += decayContributions[j].first * m_densities[decayContributions[j].second];
+  void ThermalModelBase::ConstrainChemicalPotentials(bool resetInitialValues)
+  {
+    vector<double> key;
+    if (resetInitialValues && m_ResultCache != NULL && ResultCacheKey(key, true)) {
+      ThermalModelCachedResult result;
+      if (m_ResultCache->Lookup(key, result) && result.State.size() == 4) {
+        m_Parameters.muB = result.Parameters.muB;
+        m_Parameters.muQ = result.Parameters.muQ;
+        m_Parameters.muS = result.Parameters.muS;
+        m_Parameters.muC = result.Parameters.muC;
+        m_ConstrainMuB = (result.State[0] != 0.);
+        m_ConstrainMuQ = (result.State[1] != 0.);
+        m_ConstrainMuS = (result.State[2] != 0.);
+        m_ConstrainMuC = (result.State[3] != 0.);
+        FillChemicalPotentials();
+        CalculateDensities();
+        return;
       }
-    }
 
-    m_FeeddownCalculated = true;
-  }
+      FixParameters();
 
+      result = ThermalModelCachedResult();
+      result.Parameters = m_Parameters;
+      result.MaxDiff = m_MaxDiff;
+      result.State.push_back(m_ConstrainMuB);
+      result.State.push_back(m_ConstrainMuQ);
+      result.State.push_back(m_ConstrainMuS);
+      result.State.push_back(m_ConstrainMuC);
+      m_ResultCache->Insert(key, result);
+      return;
+    }
 
-  void ThermalModelBase::ConstrainChemicalPotentials(bool resetInitialValues)
-  {
     if (resetInitialValues)
       FixParameters();
     else
@@ -578,9 +633,169 @@ namespace thermalfist {
 
   void ThermalModelBase::CalculateDensities()
   {
-    CalculatePrimordialDensities();
+    THERMALFIST_PROFILE_SCOPE("ThermalModelBase::CalculateDensities");
+
+    vector<double> key;
+    if (m_ResultCache != NULL && ResultCacheKey(key, false)) {
+      ThermalModelCachedResult result;
+      if (m_ResultCache->Lookup(key, result)) {
+        THERMALFIST_PROFILE_COUNT("ThermalModelBase::CalculateDensities: cache hits", 1);
+        m_densities = result.Densities;
+        m_densitiestotal = result.TotalDensities;
+        m_densitiesbyfeeddown = result.DensitiesByFeeddown;
+        m_MaxDiff = result.MaxDiff;
+        RestoreResultCacheState(result.State);
+        m_FluctuationsCalculated = false;
+        m_Calculated = true;
+        m_FeeddownCalculated = true;
+        ValidateCalculation();
+        return;
+      }
 
-    CalculateFeeddown();
+      CalculatePrimordialAndFeeddown();
+
+      result.Parameters = m_Parameters;
+      result.MaxDiff = m_MaxDiff;
+      result.Densities = m_densities;
+      result.TotalDensities = m_densitiestotal;
+      result.DensitiesByFeeddown = m_densitiesbyfeeddown;
+      StoreResultCacheState(result.State);
+      m_ResultCache->Insert(key, result);
+      return;
+    }
+
+    CalculatePrimordialAndFeeddown();
+  }
+
+  void ThermalModelBase::CalculatePrimordialAndFeeddown()
+  {
+    {
+      THERMALFIST_PROFILE_SCOPE("ThermalModelBase::CalculatePrimordialDensities");
+      CalculatePrimordialDensities();
+    }
+
+    {
+      THERMALFIST_PROFILE_SCOPE("ThermalModelBase::CalculateFeeddown");
+      CalculateFeeddown();
+    }
+  }
+
+  void ThermalModelBase::CalculateDensitiesBatch(const std::vector<ThermalModelParameters>& params,
+    std::vector< std::vector<double> >& primordial,
+    std::vector< std::vector<double> >& totals,
+    bool constrainChemicalPotentials)
+  {
+    ThermalModelParameters paramsOrig = m_Parameters;
+    vector<double> chemOrig = m_Chem;
+
+    primordial.resize(params.size());
+    totals.resize(params.size());
+    for (size_t k = 0; k < params.size(); ++k) {
+      SetParameters(params[k]);
+      if (constrainChemicalPotentials)
+        ConstrainChemicalPotentials();
+      else
+        FillChemicalPotentials();
+      CalculateDensities();
+      primordial[k] = m_densities;
+      totals[k] = m_densitiestotal;
+    }
+
+    SetParameters(paramsOrig);
+    m_Chem = chemOrig;
+  }
+
+  bool ThermalModelBase::ResultCacheKey(std::vector<double>& key, bool constraints) const
+  {
+    if (!IsResultCacheSupported())
+      return false;
+
+    // The thermal branching ratios are modified by CalculateFeeddown() in the eBW scheme
+    if (m_UseWidth && m_TPS->ResonanceWidthIntegrationType() == ThermalParticle::eBW)
+      return false;
+
+    if (constraints && m_PCE)
+      return false;
+
+    key.clear();
+    key.push_back(constraints ? 1. : 0.);
+
+    // Model
+    for (size_t i = 0; i < m_TAG.size(); ++i)
+      key.push_back(m_TAG[i]);
+    key.push_back(m_Ensemble);
+    key.push_back(m_InteractionModel);
+    key.push_back(m_QuantumStats);
+    key.push_back(m_UseWidth);
+    key.push_back(m_NormBratio);
+    key.push_back(m_PCE);
+    key.push_back(m_TPS->ResonanceWidthIntegrationType());
+
+    // Parameters
+    key.push_back(m_Parameters.T);
+    key.push_back(m_Parameters.muB);
+    key.push_back(m_Parameters.muS);
+    key.push_back(m_Parameters.muQ);
+    key.push_back(m_Parameters.muC);
+    key.push_back(m_Parameters.gammaq);
+    key.push_back(m_Parameters.gammaS);
+    key.push_back(m_Parameters.gammaC);
+    key.push_back(m_Parameters.V);
+    key.push_back(m_Parameters.SVc);
+    key.push_back(m_Parameters.B);
+    key.push_back(m_Parameters.Q);
+    key.push_back(m_Parameters.S);
+    key.push_back(m_Parameters.C);
+
+    if (constraints) {
+      key.push_back(m_ConstrainMuB);
+      key.push_back(m_ConstrainMuQ);
+      key.push_back(m_ConstrainMuS);
+      key.push_back(m_ConstrainMuC);
+      key.push_back(m_QBgoal);
+      key.push_back(m_SBgoal);
+    }
+    else {
+      key.insert(key.end(), m_Chem.begin(), m_Chem.end());
+    }
+
+    // Particle list
+    for (int i = 0; i < m_TPS->ComponentsNumber(); ++i) {
+      const ThermalParticle &part = m_TPS->Particles()[i];
+      key.push_back(static_cast<double>(part.PdgId()));
+      key.push_back(part.Degeneracy());
+      key.push_back(part.Statistics());
+      key.push_back(part.Mass());
+      key.push_back(part.BaryonCharge());
+      key.push_back(part.ElectricCharge());
+      key.push_back(part.Strangeness());
+      key.push_back(part.Charm());
+      key.push_back(part.AbsoluteQuark());
+      key.push_back(part.AbsoluteStrangeness());
+      key.push_back(part.AbsoluteCharm());
+      key.push_back(part.ArbitraryCharge());
+      key.push_back(part.ResonanceWidth());
+      key.push_back(part.DecayThresholdMass());
+      key.push_back(part.GetResonanceWidthShape());
+      key.push_back(part.GetResonanceWidthIntegrationType());
+      key.push_back(part.CalculationType());
+      key.push_back(part.ClusterExpansionOrder());
+      key.push_back(part.IsStable());
+      key.push_back(part.DecayType());
+      key.push_back(static_cast<double>(part.Decays().size()));
+      for (size_t j = 0; j < part.Decays().size(); ++j) {
+        const ParticleDecayChannel &decay = part.Decays()[j];
+        key.push_back(decay.mBratio);
+        key.push_back(static_cast<double>(decay.mDaughters.size()));
+        for (size_t k = 0; k < decay.mDaughters.size(); ++k)
+          key.push_back(static_cast<double>(decay.mDaughters[k]));
+      }
+    }
+
+    // Interactions
+    AppendResultCacheKey(key);
+
+    return true;
   }
 
   void ThermalModelBase::ValidateCalculation()
@@ -608,6 +823,14 @@ namespace thermalfist {
     printf("**WARNING** %s::CalculateChargeFluctuations(const std::vector<double>& chgs, int order) not implemented!\n", m_TAG.c_str());
     return std::vector<double>();
   }
+  std::vector< std::vector<double> > ThermalModelBase::CalculateChargeFluctuationsBatch(const std::vector< std::vector<double> >& chgs, int order)
+  {
+    vector< vector<double> > ret(chgs.size());
+    for (size_t k = 0; k < chgs.size(); ++k)
+      ret[k] = CalculateChargeFluctuations(chgs[k], order);
+    return ret;
+  }
+
 
   double ThermalModelBase::CalculateHadronDensity() {
     if (!m_Calculated) CalculateDensities();
@@ -876,86 +1099,103 @@ namespace thermalfist {
   
     int NN = m_densities.size();
 
-    // Fluctuations for all
-    for (int i = 0; i < NN; ++i)
-      //for(int j=0;j<NN;++j) 
-    {
-      m_TotalCorrel[i][i] = m_PrimCorrel[i][i];
-      //for (int r = 0; r < m_TPS->Particles()[i].DecayContributions().size(); ++r) {
-      const ThermalParticleSystem::DecayContributionsToParticle& decayContributions = m_TPS->DecayContributionsByFeeddown()[Feeddown::StabilityFlag][i];
-      for (size_t r = 0; r < decayContributions.size(); ++r) {
-        int rr = decayContributions[r].second;
-      
-        m_TotalCorrel[i][i] += m_densities[rr] / m_Parameters.T * m_TPS->DecayCumulants()[i][r].first[1];
-        //m_TotalCorrel[i][i] += m_densities[rr] / m_Parameters.T * m_TPS->Particles()[i].DecayCumulants()[r].first[1];
-      
-        m_TotalCorrel[i][i] += 2. * m_PrimCorrel[i][rr] * decayContributions[r].first;
-      
-        for (size_t r2 = 0; r2 < decayContributions.size(); ++r2) {
-          int rr2 = decayContributions[r2].second;
-          m_TotalCorrel[i][i] += m_PrimCorrel[rr][rr2] * decayContributions[r].first * decayContributions[r2].first;
-        }
-      }
-    }
+    if (m_DenseFinalCorrelations) {
+      // Pairs involving unstable species keep the primordial correlations
+      m_TotalCorrel = m_PrimCorrel;
 
+      // Fluctuations for all
+      for (int i = 0; i < NN; ++i)
+        m_TotalCorrel[i][i] = FinalCorrelation(i, i);
 
-    // Correlations only for stable
-    for (int i = 0; i < NN; ++i) {
-      if (m_TPS->Particles()[i].IsStable()) {
-        for (int j = 0; j < NN; ++j) {
-          if (j != i && m_TPS->Particles()[j].IsStable()) {
-            m_TotalCorrel[i][j] = m_PrimCorrel[i][j];
-
-            const ThermalParticleSystem::DecayContributionsToParticle& decayContributionsI = m_TPS->DecayContributionsByFeeddown()[Feeddown::StabilityFlag][i];
-            const ThermalParticleSystem::DecayContributionsToParticle& decayContributionsJ = m_TPS->DecayContributionsByFeeddown()[Feeddown::StabilityFlag][j];
-            
-            for (size_t r = 0; r < decayContributionsJ.size(); ++r) {
-              int rr = decayContributionsJ[r].second;
-              m_TotalCorrel[i][j] += m_PrimCorrel[i][rr] * decayContributionsJ[r].first;
-            }
-
-            for (size_t r = 0; r < decayContributionsI.size(); ++r) {
-              int rr = decayContributionsI[r].second;
-              m_TotalCorrel[i][j] += m_PrimCorrel[j][rr] * decayContributionsI[r].first;
-            }
-
-            for (size_t r = 0; r < decayContributionsI.size(); ++r) {
-              int rr = decayContributionsI[r].second;
-
-              for (size_t r2 = 0; r2 < decayContributionsJ.size(); ++r2) {
-                int rr2 = decayContributionsJ[r2].second;
-                m_TotalCorrel[i][j] += m_PrimCorrel[rr][rr2] * decayContributionsI[r].first * decayContributionsJ[r2].first;
-              }
-            }
-
-          
-            for (int r = 0; r < m_TPS->ComponentsNumber(); ++r) {
-              if (r != i && r != j) { // && !m_TPS->Particles()[r].IsStable()) {
-                double nij = 0., ni = 0., nj = 0., dnij = 0.;
-                //const ThermalParticle &tpart = m_TPS->Particle(r);
-                const ThermalParticleSystem::ResonanceFinalStatesDistribution &decayDistributions = m_TPS->ResonanceFinalStatesDistributions()[r];
-                for (size_t br = 0; br < decayDistributions.size(); ++br) {
-                  nij += decayDistributions[br].first * decayDistributions[br].second[i] * decayDistributions[br].second[j];
-                  ni  += decayDistributions[br].first * decayDistributions[br].second[i];
-                  nj  += decayDistributions[br].first * decayDistributions[br].second[j];
-                }
-                dnij = nij - ni * nj;
-                m_TotalCorrel[i][j] += m_densities[r] / m_Parameters.T * dnij;
-              }
-            }
-
+      // Correlations only for stable
+      for (int i = 0; i < NN; ++i) {
+        if (m_TPS->Particles()[i].IsStable()) {
+          for (int j = 0; j < NN; ++j) {
+            if (j != i && m_TPS->Particles()[j].IsStable())
+              m_TotalCorrel[i][j] = FinalCorrelation(i, j);
           }
         }
       }
     }
+    else {
+      // Off-diagonal elements are computed on request
+      std::vector< std::vector<double> >().swap(m_TotalCorrel);
+    }
 
     for (int i = 0; i < NN; ++i) {
-      m_wtot[i] = m_TotalCorrel[i][i];
+      m_wtot[i] = m_DenseFinalCorrelations ? m_TotalCorrel[i][i] : FinalCorrelation(i, i);
       if (m_densitiestotal[i] > 0.) m_wtot[i] *= m_Parameters.T / m_densitiestotal[i];
       else m_wtot[i] = 1.;
     }
   }
 
+  double ThermalModelBase::FinalCorrelation(int i, int j) const
+  {
+    const ThermalParticleSystem::DecayContributionsToParticle& decayContributionsI = m_TPS->DecayContributionsByFeeddown()[Feeddown::StabilityFlag][i];
+
+    if (i == j) {
+      double ret = m_PrimCorrel[i][i];
+      for (size_t r = 0; r < decayContributionsI.size(); ++r) {
+        int rr = decayContributionsI[r].second;
+
+        ret += m_densities[rr] / m_Parameters.T * m_TPS->DecayCumulants()[i][r].first[1];
+
+        ret += 2. * m_PrimCorrel[i][rr] * decayContributionsI[r].first;
+
+        for (size_t r2 = 0; r2 < decayContributionsI.size(); ++r2) {
+          int rr2 = decayContributionsI[r2].second;
+          ret += m_PrimCorrel[rr][rr2] * decayContributionsI[r].first * decayContributionsI[r2].first;
+        }
+      }
+      return ret;
+    }
+
+    if (!m_TPS->Particles()[i].IsStable() || !m_TPS->Particles()[j].IsStable())
+      return m_PrimCorrel[i][j];
+
+    const ThermalParticleSystem::DecayContributionsToParticle& decayContributionsJ = m_TPS->DecayContributionsByFeeddown()[Feeddown::StabilityFlag][j];
+
+    double ret = m_PrimCorrel[i][j];
+
+    for (size_t r = 0; r < decayContributionsJ.size(); ++r) {
+      int rr = decayContributionsJ[r].second;
+      ret += m_PrimCorrel[i][rr] * decayContributionsJ[r].first;
+    }
+
+    for (size_t r = 0; r < decayContributionsI.size(); ++r) {
+      int rr = decayContributionsI[r].second;
+      ret += m_PrimCorrel[j][rr] * decayContributionsI[r].first;
+    }
+
+    for (size_t r = 0; r < decayContributionsI.size(); ++r) {
+      int rr = decayContributionsI[r].second;
+
+      for (size_t r2 = 0; r2 < decayContributionsJ.size(); ++r2) {
+        int rr2 = decayContributionsJ[r2].second;
+        ret += m_PrimCorrel[rr][rr2] * decayContributionsI[r].first * decayContributionsJ[r2].first;
+      }
+    }
+
+    // Correlations from the probabilistic decays, 
+    // only the resonances which feed into species i contribute
+    for (size_t r = 0; r < decayContributionsI.size(); ++r) {
+      int rr = decayContributionsI[r].second;
+      if (rr == i || rr == j)
+        continue;
+      double nij = 0., ni = 0., nj = 0., dnij = 0.;
+      const ThermalParticleSystem::ResonanceFinalStatesDistribution &decayDistributions = m_TPS->ResonanceFinalStatesDistributions()[rr];
+      for (size_t br = 0; br < decayDistributions.size(); ++br) {
+        nij += decayDistributions[br].first * decayDistributions[br].second[i] * decayDistributions[br].second[j];
+        ni  += decayDistributions[br].first * decayDistributions[br].second[i];
+        nj  += decayDistributions[br].first * decayDistributions[br].second[j];
+      }
+      dnij = nij - ni * nj;
+      ret += m_densities[rr] / m_Parameters.T * dnij;
+    }
+
+    return ret;
+  }
+
   double ThermalModelBase::TwoParticleSusceptibilityPrimordial(int i, int j) const
   {
     if (!IsFluctuationsCalculated()) {
@@ -1034,7 +1274,8 @@ namespace thermalfist {
       exit(1);
     }
 
-    return m_TotalCorrel[i][j] / m_Parameters.T / m_Parameters.T / xMath::GeVtoifm() / xMath::GeVtoifm() / xMath::GeVtoifm();
+    double correl = !m_TotalCorrel.empty() ? m_TotalCorrel[i][j] : FinalCorrelation(i, j);
+    return correl / m_Parameters.T / m_Parameters.T / xMath::GeVtoifm() / xMath::GeVtoifm() / xMath::GeVtoifm();
   }
 
   double ThermalModelBase::TwoParticleSusceptibilityFinalByPdg(long long id1, long long id2)
@@ -1197,36 +1438,41 @@ namespace thermalfist {
       m_ProxySusc[i].resize(4);
 
     // Up to 3, no charm here yet
-    for (int i = 0; i < 3; ++i) {
-      for (int j = 0; j < 3; ++j) {
+    // Proxies: net protons, net charge, net kaons
+    int NN = m_PrimCorrel.size();
+    vector< vector<int> > proxycharges(NN, vector<int>(3, 0));
+    vector<int> proxyspecies;
+    for (int k = 0; k < NN; ++k) {
+      const ThermalParticle &part = m_TPS->Particles()[k];
+      if (!part.IsStable())
+        continue;
+      proxycharges[k][0] = 1 * (part.PdgId() == 2212) - 1 * (part.PdgId() == -2212);
+      proxycharges[k][1] = part.ElectricCharge();
+      proxycharges[k][2] = 1 * (part.PdgId() == 321) - 1 * (part.PdgId() == -321);
+      if (proxycharges[k][0] != 0 || proxycharges[k][1] != 0 || proxycharges[k][2] != 0)
+        proxyspecies.push_back(k);
+    }
+
+    for (int i = 0; i < 3; ++i)
+      for (int j = 0; j < 3; ++j)
         m_ProxySusc[i][j] = 0.;
-        for (size_t k = 0; k < m_TotalCorrel.size(); ++k) {
-          if (m_TPS->Particles()[k].IsStable()) {
-            int c1 = 0;
-            //if (i == 0) c1 = m_TPS->Particles()[k].BaryonCharge();
-            if (i == 0) c1 = 1 * (m_TPS->Particles()[k].PdgId() == 2212) - 1 * (m_TPS->Particles()[k].PdgId() == -2212);
-            if (i == 1) c1 = m_TPS->Particles()[k].ElectricCharge();
-            //if (i == 1) c1 = 1 * (m_TPS->Particles()[k].PdgId() == 211) - 1 * (m_TPS->Particles()[k].PdgId() == -211);
-            if (i == 2) c1 = 1 * (m_TPS->Particles()[k].PdgId() == 321) - 1 * (m_TPS->Particles()[k].PdgId() == -321);
-            if (i == 3) c1 = m_TPS->Particles()[k].Charm();
-            for (size_t kp = 0; kp < m_TotalCorrel.size(); ++kp) {
-              if (m_TPS->Particles()[kp].IsStable()) {
-                int c2 = 0;
-                //if (j == 0) c2 = m_TPS->Particles()[kp].BaryonCharge();
-                if (j == 0) c2 = 1 * (m_TPS->Particles()[kp].PdgId() == 2212) - 1 * (m_TPS->Particles()[kp].PdgId() == -2212);
-                if (j == 1) c2 = m_TPS->Particles()[kp].ElectricCharge();
-                //if (j == 1) c2 = 1 * (m_TPS->Particles()[kp].PdgId() == 211) - 1 * (m_TPS->Particles()[kp].PdgId() == -211);
-                if (j == 2) c2 = 1 * (m_TPS->Particles()[kp].PdgId() == 321) - 1 * (m_TPS->Particles()[kp].PdgId() == -321);
-                if (j == 3) c2 = m_TPS->Particles()[kp].Charm();
-                m_ProxySusc[i][j] += c1 * c2 * m_TotalCorrel[k][kp];
-              }
-            }
-          }
-        }
-        m_ProxySusc[i][j] = m_ProxySusc[i][j] / m_Parameters.T / m_Parameters.T / xMath::GeVtoifm() / xMath::GeVtoifm() / xMath::GeVtoifm();
+
+    // Each pair of species is evaluated once for all the proxies
+    for (size_t ik = 0; ik < proxyspecies.size(); ++ik) {
+      int k = proxyspecies[ik];
+      for (size_t ikp = 0; ikp < proxyspecies.size(); ++ikp) {
+        int kp = proxyspecies[ikp];
+        double correl = !m_TotalCorrel.empty() ? m_TotalCorrel[k][kp] : FinalCorrelation(k, kp);
+        for (int i = 0; i < 3; ++i)
+          for (int j = 0; j < 3; ++j)
+            m_ProxySusc[i][j] += proxycharges[k][i] * proxycharges[kp][j] * correl;
       }
     }
 
+    for (int i = 0; i < 3; ++i)
+      for (int j = 0; j < 3; ++j)
+        m_ProxySusc[i][j] = m_ProxySusc[i][j] / m_Parameters.T / m_Parameters.T / xMath::GeVtoifm() / xMath::GeVtoifm() / xMath::GeVtoifm();
+
     //printf("chi2netp/chi2skellam = %lf\n", m_ProxySusc[0][0] / (m_densitiestotal[m_TPS->PdgToId(2212)] + m_densitiestotal[m_TPS->PdgToId(-2212)]) * pow(m_Parameters.T * xMath::GeVtoifm(), 3));
     //printf("chi2netpi/chi2skellam = %lf\n", m_ProxySusc[1][1] / (m_densitiestotal[m_TPS->PdgToId(211)] + m_densitiestotal[m_TPS->PdgToId(-211)]) * pow(m_Parameters.T * xMath::GeVtoifm(), 3));
   }
@@ -1249,12 +1495,16 @@ namespace thermalfist {
     for (size_t i = 0; i < TPS()->ComponentsNumber(); ++i) {
       if (m_TPS->Particles()[i].IsStable()) {
         int c1 = 1;
-        for (int chg = 0; chg < 4; ++chg) {
-          for (size_t j = 0; j < TPS()->ComponentsNumber(); ++j) {
-            if (m_TPS->Particles()[j].IsStable()) {
-              int c2 = TPS()->Particle(j).ConservedCharge((ConservedCharge::Name)chg);
-              m_FinalChargesCorrel[i][chg] += c1 * c2 * m_TotalCorrel[i][j];
-            }
+        for (size_t j = 0; j < TPS()->ComponentsNumber(); ++j) {
+          const ThermalParticle &partj = TPS()->Particle(j);
+          if (!partj.IsStable())
+            continue;
+          if (partj.BaryonCharge() == 0 && partj.ElectricCharge() == 0 && partj.Strangeness() == 0 && partj.Charm() == 0)
+            continue;
+          double correl = !m_TotalCorrel.empty() ? m_TotalCorrel[i][j] : FinalCorrelation(i, j);
+          for (int chg = 0; chg < 4; ++chg) {
+            int c2 = partj.ConservedCharge((ConservedCharge::Name)chg);
+            m_FinalChargesCorrel[i][chg] += c1 * c2 * correl;
           }
         }
       }
@@ -1267,7 +1517,14 @@ namespace thermalfist {
 
   std::vector<double> ThermalModelBase::BroydenEquationsChem::Equations(const std::vector<double>& x)
   {
-    std::vector<double> ret(m_N, 0.);
+    std::vector<double> ret;
+    EvaluateEquations(x, ret);
+    return ret;
+  }
+
+  void ThermalModelBase::BroydenEquationsChem::EvaluateEquations(const std::vector<double>& x, std::vector<double>& ret)
+  {
+    ret.assign(m_N, 0.);
 
     int i1 = 0;
     if (m_THM->ConstrainMuB()) { m_THM->SetBaryonChemicalPotential(x[i1]); i1++; }
@@ -1322,7 +1579,17 @@ namespace thermalfist {
 
       i1++;
     }
+  }
 
+  BroydenEquations* ThermalModelBase::BroydenEquationsChem::Clone() const
+  {
+    ThermalModelBase *model = m_THM->Clone();
+    if (model == NULL)
+      return NULL;
+
+    BroydenEquationsChem *ret = new BroydenEquationsChem(model);
+    ret->m_N = m_N;
+    ret->m_Copy = model;
     return ret;
   }
 
@@ -1556,6 +1823,8 @@ namespace thermalfist {
 
   std::vector<double> ThermalModelBase::BroydenChem::Solve(const std::vector<double>& x0, BroydenSolutionCriterium * solcrit, int max_iterations)
   {
+    THERMALFIST_PROFILE_SCOPE("ThermalModelBase::BroydenChem::Solve");
+
     if (m_Equations == NULL) {
       printf("**ERROR** Broyden::Solve: Equations to solve not specified!\n");
       exit(1);
@@ -1590,18 +1859,12 @@ namespace thermalfist {
       UseDefaultJacobian = true;
     }
     m_Iterations = 0;
-    double &maxdiff = m_MaxDifference;
     int N = m_Equations->Dimension();
 
-    
-
-    std::vector<double> tmpvec, xdeltavec = xcur;
-    VectorXd xold(N), xnew(N), xdelta(N);
-    VectorXd fold(N), fnew(N), fdelta(N);
-
-    xold = VectorXd::Map(&xcur[0], xcur.size());
-
-    MatrixXd Jac = Eigen::Map< Matrix<double, Dynamic, Dynamic, RowMajor> >(&JacobianInUse->Jacobian(xcur)[0], N, N);
+    std::vector<double> jacvec;
+    JacobianInUse->EvaluateJacobian(xcur, jacvec);
+    THERMALFIST_PROFILE_COUNT("Broyden: Jacobian evaluations", 1);
+    MatrixXd Jac = Eigen::Map< Matrix<double, Dynamic, Dynamic, RowMajor> >(&jacvec[0], N, N);
 
     bool constrmuB = m_THM->ConstrainMuB();
     bool constrmuQ = m_THM->ConstrainMuQ();
@@ -1649,59 +1912,7 @@ namespace thermalfist {
       return ret;
     }
 
-    if (Jac.determinant() == 0.0)
-    {
-      printf("**WARNING** Singular Jacobian in Broyden::Solve\n");
-      return xcur;
-    }
-
-    MatrixXd Jinv = Jac.inverse();
-    tmpvec = m_Equations->Equations(xcur);
-    fold = VectorXd::Map(&tmpvec[0], tmpvec.size());
-
-    for (m_Iterations = 1; m_Iterations < max_iterations; ++m_Iterations) {
-      xnew = xold - Jinv * fold;
-
-      VectorXd::Map(&xcur[0], xcur.size()) = xnew;
-
-      tmpvec = m_Equations->Equations(xcur);
-      fnew = VectorXd::Map(&tmpvec[0], tmpvec.size());
-
-
-      maxdiff = 0.;
-      for (size_t i = 0; i < xcur.size(); ++i) {
-        maxdiff = std::max(maxdiff, fabs(fnew[i]));
-      }
-
-      xdelta = xnew - xold;
-      fdelta = fnew - fold;
-
-      VectorXd::Map(&xdeltavec[0], xdeltavec.size()) = xdelta;
-
-      if (SolutionCriterium->IsSolved(xcur, tmpvec, xdeltavec))
-        break;
-
-      if (!m_UseNewton) // Use Broyden's method
-      {
-
-        double norm = 0.;
-        for (int i = 0; i < N; ++i)
-          for (int j = 0; j < N; ++j)
-            norm += xdelta[i] * Jinv(i, j) * fdelta[j];
-        VectorXd p1(N);
-        p1 = (xdelta - Jinv * fdelta);
-        for (int i = 0; i < N; ++i) p1[i] *= 1. / norm;
-        Jinv = Jinv + (p1 * xdelta.transpose()) * Jinv;
-      }
-      else // Use Newton's method
-      {
-        Jac = Eigen::Map< Matrix<double, Dynamic, Dynamic, RowMajor> >(&JacobianInUse->Jacobian(xcur)[0], N, N);
-        Jinv = Jac.inverse();
-      }
-
-      xold = xnew;
-      fold = fnew;
-    }
+    xcur = Iterate(xcur, jacvec, JacobianInUse, SolutionCriterium, max_iterations);
 
     if (m_Iterations == max_iterations) {
       printf("**WARNING** Reached maximum number of iterations in Broyden procedure\n");
@@ -1720,7 +1931,7 @@ namespace thermalfist {
 
 
   ThermalModelBase::BroydenEquationsChemTotals::BroydenEquationsChemTotals(const std::vector<int>& vConstr, const std::vector<int>& vType, const std::vector<double>& vTotals, ThermalModelBase * model) :
-    BroydenEquations(), m_Constr(vConstr), m_Type(vType), m_Totals(vTotals), m_THM(model)
+    BroydenEquations(), m_Constr(vConstr), m_Type(vType), m_Totals(vTotals), m_THM(model), m_Copy(NULL)
   {
     m_N = 0;
     for (size_t i = 0; i < m_Constr.size(); ++i)
@@ -1729,7 +1940,14 @@ namespace thermalfist {
 
   std::vector<double> ThermalModelBase::BroydenEquationsChemTotals::Equations(const std::vector<double>& x)
   {
-    std::vector<double> ret(m_N, 0.);
+    std::vector<double> ret;
+    EvaluateEquations(x, ret);
+    return ret;
+  }
+
+  void ThermalModelBase::BroydenEquationsChemTotals::EvaluateEquations(const std::vector<double>& x, std::vector<double>& ret)
+  {
+    ret.assign(m_N, 0.);
 
     int i1 = 0;
     for (int i = 0; i < 4; ++i) {
@@ -1744,7 +1962,7 @@ namespace thermalfist {
     m_THM->FillChemicalPotentials();
     m_THM->CalculatePrimordialDensities();
 
-    vector<double> dens(4, 0.), absdens(4, 0.);
+    double dens[4] = { 0., 0., 0., 0. }, absdens[4] = { 0., 0., 0., 0. };
     if (m_Constr[0]) {
       dens[0] = m_THM->CalculateBaryonDensity();
       absdens[0] = m_THM->CalculateAbsoluteBaryonDensity();
@@ -1773,7 +1991,16 @@ namespace thermalfist {
         i1++;
       }
     }
+  }
+
+  BroydenEquations* ThermalModelBase::BroydenEquationsChemTotals::Clone() const
+  {
+    ThermalModelBase *model = m_THM->Clone();
+    if (model == NULL)
+      return NULL;
 
+    BroydenEquationsChemTotals *ret = new BroydenEquationsChemTotals(m_Constr, m_Type, m_Totals, model);
+    ret->m_Copy = model;
     return ret;
   }
 
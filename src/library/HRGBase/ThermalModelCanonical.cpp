@@ -11,16 +11,312 @@
 #include <cmath>
 #include <cstdlib>
 #include <algorithm>
+#include <limits>
 
 #include "HRGBase/xMath.h"
 #include "HRGBase/NumericalIntegration.h"
+#include "HRGBase/Profiler.h"
 
 using namespace std;
 
 namespace thermalfist {
 
+  namespace {
+
+    /**
+     * Exact evaluation of the canonical partition functions for small systems.
+     *
+     * The generating function exp[sum_q f_q exp(i q phi)] is expanded in the total number
+     * of particles (clusters), Z(K) = sum_N P_N(K), where
+     * P_N(K) = (1/N) sum_q f_q P_{N-1}(K - q) and P_0(K) = delta_{K,0}.
+     *
+     * Two truncations are made, each with a rigorous bound on the omitted contributions:
+     *   - the sum is truncated at N = nterms, the omitted terms are bounded by the Poisson tail
+     *     sum_{N > nterms} Lambda^N / N!, Lambda = sum_q |f_q|;
+     *   - the charges are restricted to |K_c| <= R_c. The omitted configurations are bounded
+     *     by the Chernoff bound exp[sum_q |f_q| exp(t |q_c|) - t R_c], t > 0.
+     *     The latter accounts for the small weights of the species with large charges, e.g. light nuclei.
+     *
+     * At each N only the charges from which the target charges can still be reached are kept.
+     */
+    class ChargeRecursion {
+    public:
+      /// Relative cost of a trigonometric function evaluation and a multiply-add
+      static const double TrigonometricCost;
+      /// Relative accuracy of the partition function at the target charges
+      static const double Tolerance;
+      /// Maximum number of passes with refined truncations
+      static const int MaxPasses;
+
+      ChargeRecursion(const vector<QuantumNumbers>& QNvec, const map<QuantumNumbers, int>& QNMap,
+        const vector<double>& Nsx, const vector<double>& Nsy,
+        const vector<int>& target, const vector<int>& range) :
+        m_Lambda(0.), m_nterms(0), m_volume(0)
+      {
+        for (size_t i = 0; i < QNvec.size(); ++i) {
+          const QuantumNumbers& qn = QNvec[i];
+          if (qn.B == 0 && qn.Q == 0 && qn.S == 0 && qn.C == 0)
+            continue;
+
+          // Coefficient of exp(i q phi) in sum_q [Nsx_q cos(q phi) + i Nsy_q sin(q phi)]
+          double f = 0.5 * (Nsx[i] + Nsy[i]);
+          map<QuantumNumbers, int>::const_iterator it = QNMap.find(QuantumNumbers(-qn.B, -qn.Q, -qn.S, -qn.C));
+          if (it != QNMap.end())
+            f += 0.5 * (Nsx[it->second] - Nsy[it->second]);
+          if (f == 0.)
+            continue;
+
+          int q[4] = { qn.B, qn.Q, qn.S, qn.C };
+          m_Charges.push_back(vector<int>(q, q + 4));
+          m_f.push_back(f);
+          m_Lambda += fabs(f);
+        }
+
+        for (int c = 0; c < 4; ++c) {
+          m_qmax[c] = 0;
+          for (size_t is = 0; is < m_Charges.size(); ++is)
+            m_qmax[c] = max(m_qmax[c], abs(m_Charges[is][c]));
+          m_tlo[c] = target[c] - range[c];
+          m_thi[c] = target[c] + range[c];
+          m_R[c] = m_lo[c] = m_hi[c] = 0;
+          m_stride[c] = 0;
+        }
+      }
+
+      /// Whether the terms of the expansion can be evaluated without an overflow
+      bool IsApplicable() const { return m_Lambda <= MaxLambda && m_Lambda == m_Lambda; }
+
+      double Lambda() const { return m_Lambda; }
+
+      /**
+       * Gaussian (central limit) estimate of the (unnormalized) partition function at the given charges.
+       * Correlations between the charges are neglected.
+       */
+      double EstimateCoefficient(const vector<int>& target) const {
+        double sumf = 0.;
+        for (size_t is = 0; is < m_f.size(); ++is)
+          sumf += m_f[is];
+        double ret = exp(sumf);
+        for (int c = 0; c < 4; ++c) {
+          double mean = 0., var = 0.;
+          for (size_t is = 0; is < m_f.size(); ++is) {
+            mean += m_f[is] * m_Charges[is][c];
+            var += fabs(m_f[is]) * m_Charges[is][c] * m_Charges[is][c];
+          }
+          if (var == 0.)
+            continue;
+          ret *= exp(-(target[c] - mean) * (target[c] - mean) / 2. / var) / sqrt(2. * xMath::Pi() * var);
+        }
+        return min(ret, exp(m_Lambda));
+      }
+
+      /**
+       * Chooses the truncations for the accuracy Tolerance relative to scale.
+       * Returns false if the required charge lattice is too large.
+       */
+      bool Prepare(double scale) {
+        double bound = 0.1 * Tolerance * scale;
+
+        m_nterms = static_cast<int>(m_Lambda);
+        while (m_nterms < MaxTerms && PoissonTail(m_nterms) > bound)
+          m_nterms++;
+
+        m_volume = 1;
+        for (int c = 3; c >= 0; --c) {
+          m_R[c] = ChargeRadius(c, bound);
+          m_lo[c] = min(-m_R[c], m_tlo[c]);
+          m_hi[c] = max(m_R[c], m_thi[c]);
+          // Padding for the charges shifted by one particle
+          int size = m_hi[c] - m_lo[c] + 1 + 2 * m_qmax[c];
+          m_stride[c] = m_volume;
+          m_volume *= size;
+          if (m_volume > MaxVolume)
+            return false;
+        }
+        return true;
+      }
+
+      /// Upper bound for the omitted contributions
+      double TailBound() const {
+        double ret = PoissonTail(m_nterms);
+        for (int c = 0; c < 4; ++c)
+          ret += ChernoffBound(c, m_R[c]);
+        return ret;
+      }
+
+      /// Number of multiply-adds
+      double Cost() const {
+        double ret = 0.;
+        for (int N = 1; N <= m_nterms; ++N) {
+          int lo[4], hi[4];
+          ActiveRange(N, lo, hi);
+          double vol = 1.;
+          for (int c = 0; c < 4; ++c)
+            vol *= max(0, hi[c] - lo[c] + 1);
+          ret += vol;
+        }
+        return ret * m_f.size();
+      }
+
+      void Calculate() {
+        vector<long long> offsets(m_f.size(), 0);
+        for (size_t is = 0; is < m_f.size(); ++is)
+          for (int c = 0; c < 4; ++c)
+            offsets[is] += m_Charges[is][c] * m_stride[c];
+
+        m_Z.assign(m_volume, 0.);
+        vector<double> prev(m_volume, 0.), cur(m_volume, 0.);
+        int prevlo[4], prevhi[4], curlo[4], curhi[4];
+
+        ActiveRange(0, prevlo, prevhi);
+        if (!IsEmpty(prevlo, prevhi)) {
+          long long ind0 = Index(0, 0, 0, 0);
+          prev[ind0] = 1.;
+          m_Z[ind0] = 1.;
+        }
+        for (int c = 0; c < 4; ++c) {
+          curlo[c] = 1;
+          curhi[c] = 0;
+        }
+
+        for (int N = 1; N <= m_nterms; ++N) {
+          // Clear the terms of order N - 2
+          if (!IsEmpty(curlo, curhi)) {
+            for (int iB = curlo[0]; iB <= curhi[0]; ++iB)
+              for (int iQ = curlo[1]; iQ <= curhi[1]; ++iQ)
+                for (int iS = curlo[2]; iS <= curhi[2]; ++iS)
+                  for (int iC = curlo[3]; iC <= curhi[3]; ++iC)
+                    cur[Index(iB, iQ, iS, iC)] = 0.;
+          }
+
+          ActiveRange(N, curlo, curhi);
+          if (!IsEmpty(curlo, curhi)) {
+            double invN = 1. / N;
+            for (int iB = curlo[0]; iB <= curhi[0]; ++iB)
+              for (int iQ = curlo[1]; iQ <= curhi[1]; ++iQ)
+                for (int iS = curlo[2]; iS <= curhi[2]; ++iS)
+                  for (int iC = curlo[3]; iC <= curhi[3]; ++iC) {
+                    long long ind = Index(iB, iQ, iS, iC);
+                    double val = 0.;
+                    for (size_t is = 0; is < m_f.size(); ++is)
+                      val += m_f[is] * prev[ind - offsets[is]];
+                    val *= invN;
+                    cur[ind] = val;
+                    m_Z[ind] += val;
+                  }
+          }
+
+          prev.swap(cur);
+          for (int c = 0; c < 4; ++c) {
+            swap(prevlo[c], curlo[c]);
+            swap(prevhi[c], curhi[c]);
+          }
+        }
+      }
+
+      /// The (unnormalized) partition function at the given charges
+      double Coefficient(int B, int Q, int S, int C) const {
+        int K[4] = { B, Q, S, C };
+        for (int c = 0; c < 4; ++c)
+          if (K[c] < m_lo[c] || K[c] > m_hi[c])
+            return 0.;
+        if (m_Z.empty())
+          return 0.;
+        return m_Z[Index(B, Q, S, C)];
+      }
+
+    private:
+      static const double MaxLambda;
+      static const int MaxTerms;
+      static const long long MaxVolume;
+
+      /// sum_{N > nterms} Lambda^N / N!
+      double PoissonTail(int nterms) const {
+        double term = 1.;
+        for (int N = 1; N <= nterms; ++N)
+          term *= m_Lambda / N;
+        double ret = 0.;
+        for (int N = nterms + 1; ; ++N) {
+          term *= m_Lambda / N;
+          ret += term;
+          if (term == 0. || (N > m_Lambda && term < 1.e-17 * ret))
+            break;
+        }
+        return ret;
+      }
+
+      /// sum_q |f_q| exp(t |q_c|)
+      double ChernoffExponent(int c, double t) const {
+        double ret = 0.;
+        for (size_t is = 0; is < m_f.size(); ++is)
+          ret += fabs(m_f[is]) * exp(t * abs(m_Charges[is][c]));
+        return ret;
+      }
+
+      /// Bound on the configurations with the sum of |q_c| exceeding R
+      double ChernoffBound(int c, int R) const {
+        if (m_qmax[c] == 0)
+          return 0.;
+        double ret = exp(m_Lambda);
+        for (double t = 0.01; t < 20.; t *= 1.05)
+          ret = min(ret, exp(ChernoffExponent(c, t) - t * (R + 1)));
+        return ret;
+      }
+
+      /// Smallest R for which ChernoffBound(c, R) <= bound
+      int ChargeRadius(int c, double bound) const {
+        if (m_qmax[c] == 0)
+          return 0;
+        double Rmin = 1.e100;
+        for (double t = 0.01; t < 20.; t *= 1.05)
+          Rmin = min(Rmin, (ChernoffExponent(c, t) - log(bound)) / t);
+        // The charges cannot exceed nterms * qmax in any case
+        return static_cast<int>(min(ceil(Rmin), static_cast<double>(m_nterms * m_qmax[c])));
+      }
+
+      /// Charges which contribute at order N and from which the target charges are reachable
+      void ActiveRange(int N, int lo[4], int hi[4]) const {
+        for (int c = 0; c < 4; ++c) {
+          lo[c] = max(m_lo[c], max(-N * m_qmax[c], m_tlo[c] - (m_nterms - N) * m_qmax[c]));
+          hi[c] = min(m_hi[c], min(N * m_qmax[c], m_thi[c] + (m_nterms - N) * m_qmax[c]));
+        }
+      }
+
+      static bool IsEmpty(const int lo[4], const int hi[4]) {
+        for (int c = 0; c < 4; ++c)
+          if (lo[c] > hi[c])
+            return true;
+        return false;
+      }
+
+      long long Index(int B, int Q, int S, int C) const {
+        return (B - m_lo[0] + m_qmax[0]) * m_stride[0] + (Q - m_lo[1] + m_qmax[1]) * m_stride[1]
+          + (S - m_lo[2] + m_qmax[2]) * m_stride[2] + (C - m_lo[3] + m_qmax[3]) * m_stride[3];
+      }
+
+      vector< vector<int> > m_Charges;
+      vector<double> m_f;
+      double m_Lambda;
+      int m_nterms;
+      int m_qmax[4], m_tlo[4], m_thi[4], m_R[4];
+      int m_lo[4], m_hi[4];
+      long long m_stride[4];
+      long long m_volume;
+      vector<double> m_Z;
+    };
+
+    const double ChargeRecursion::TrigonometricCost = 10.;
+    const double ChargeRecursion::Tolerance = 1.e-15;
+    const int ChargeRecursion::MaxPasses = 3;
+    const double ChargeRecursion::MaxLambda = 500.;
+    const int ChargeRecursion::MaxTerms = 5000;
+    const long long ChargeRecursion::MaxVolume = 4000000;
+
+  } // anonymous namespace
+
   ThermalModelCanonical::ThermalModelCanonical(ThermalParticleSystem *TPS_, const ThermalModelParameters& params) :
-    ThermalModelBase(TPS_, params), m_BCE(1), m_QCE(1), m_SCE(1), m_CCE(1), m_IntegrationIterationsMultiplier(1)
+    ThermalModelBase(TPS_, params), m_BCE(1), m_QCE(1), m_SCE(1), m_CCE(1), m_IntegrationIterationsMultiplier(1),
+    m_PartitionFunctionMethod(Auto), m_PartitionFunctionMethodUsed(Quadrature), m_AllMuZero(true)
   {
 
     m_TAG = "ThermalModelCanonical";
@@ -39,8 +335,19 @@ namespace thermalfist {
     CleanModelGCE();
   }
 
+  ThermalModelCanonical* ThermalModelCanonical::Clone(ThermalParticleSystem* TPS) const
+  {
+    ThermalModelCanonical *ret = new ThermalModelCanonical(*this);
+    // The auxiliary model owned by the original is recreated when needed
+    ret->m_modelgce = NULL;
+
+    FinalizeClone(ret, TPS);
+    return ret;
+  }
+
   void ThermalModelCanonical::ChangeTPS(ThermalParticleSystem *TPS_) {
     ThermalModelBase::ChangeTPS(TPS_);
+    ClearPartitionFunctionsCache();
   }
 
   void ThermalModelCanonical::CalculateQuantumNumbersRange(bool computeFluctuations)
@@ -90,6 +397,8 @@ namespace thermalfist {
 
     printf("BMAX = %d\tQMAX = %d\tSMAX = %d\tCMAX = %d\n", m_BMAX, m_QMAX, m_SMAX, m_CMAX);
 
+    ClearPartitionFunctionsCache();
+
     m_QNMap.clear();
     m_QNvec.resize(0);
 
@@ -125,6 +434,7 @@ namespace thermalfist {
         m_TPS->Particle(i).SetCalculationType(IdealGasFunctions::ClusterExpansion);
     }
     m_PartialZ.clear();
+    ClearPartitionFunctionsCache();
     //CalculateQuantumNumbersRange();
   }
 
@@ -150,32 +460,11 @@ namespace thermalfist {
   void ThermalModelCanonical::CalculatePrimordialDensities() {
     m_FluctuationsCalculated = false;
 
-    if (m_PartialZ.size() == 0)
-      CalculateQuantumNumbersRange();
-
-    if (m_BMAX_list == 1 && m_BCE && m_QCE && m_SCE && m_CCE && !UsePartialChemicalEquilibrium()) {
-      m_Banalyt = true;
-      m_Parameters.muB = 0.0;
-      m_Parameters.muQ = 0.0;
-      m_Parameters.muS = 0.0;
-      m_Parameters.muC = 0.0;
-    }
-    else {
-      m_Banalyt = false;
-      if (m_BCE)
-        m_Parameters.muB = 0.0;
-      if (m_QCE)
-        m_Parameters.muQ = 0.0;
-      if (m_SCE)
-        m_Parameters.muS = 0.0;
-      if (m_CCE)
-        m_Parameters.muC = 0.0;
-
-      //PrepareModelGCE(); // Plan B, may work better when quantum numbers are large
-    }
+    PrepareConservedCharges();
 
     CalculatePartitionFunctions();
 
+    vector<IdealGasFunctions::IdealGasQuantities> terms;
     for (size_t i = 0; i < m_densities.size(); ++i) {
       ThermalParticle &tpart = m_TPS->Particle(i);
       m_densities[i] = 0.;
@@ -192,10 +481,11 @@ namespace thermalfist {
           m_densities[i] = m_Corr[ind] * tpart.DensityCluster(1, m_Parameters, IdealGasFunctions::ParticleDensity, m_UseWidth, m_Chem[i]);
       }
       else {
+        tpart.ClusterExpansionTerms(m_Parameters, terms, m_UseWidth, m_Chem[i]);
         for (int n = 1; n <= tpart.ClusterExpansionOrder(); ++n) {
           int ind = m_QNMap[QuantumNumbers(m_BCE*n*tpart.BaryonCharge(), m_QCE*n*tpart.ElectricCharge(), m_SCE*n*tpart.Strangeness(), m_CCE*n*tpart.Charm())];
           if (ind < static_cast<int>(m_Corr.size()))
-            m_densities[i] += m_Corr[ind] * tpart.DensityCluster(n, m_Parameters, IdealGasFunctions::ParticleDensity, m_UseWidth, m_Chem[i]);
+            m_densities[i] += m_Corr[ind] * terms[n - 1].n;
         }
       }
     }
@@ -204,6 +494,33 @@ namespace thermalfist {
     ValidateCalculation();
   }
 
+  void ThermalModelCanonical::PrepareConservedCharges()
+  {
+    if (m_PartialZ.size() == 0)
+      CalculateQuantumNumbersRange();
+
+    if (m_BMAX_list == 1 && m_BCE && m_QCE && m_SCE && m_CCE && !UsePartialChemicalEquilibrium()) {
+      m_Banalyt = true;
+      m_Parameters.muB = 0.0;
+      m_Parameters.muQ = 0.0;
+      m_Parameters.muS = 0.0;
+      m_Parameters.muC = 0.0;
+    }
+    else {
+      m_Banalyt = false;
+      if (m_BCE)
+        m_Parameters.muB = 0.0;
+      if (m_QCE)
+        m_Parameters.muQ = 0.0;
+      if (m_SCE)
+        m_Parameters.muS = 0.0;
+      if (m_CCE)
+        m_Parameters.muC = 0.0;
+
+      //PrepareModelGCE(); // Plan B, may work better when quantum numbers are large
+    }
+  }
+
   void ThermalModelCanonical::ValidateCalculation()
   {
     ThermalModelBase::ValidateCalculation();
@@ -288,9 +605,95 @@ Obtained: %lf\n\
 
   void ThermalModelCanonical::CalculatePartitionFunctions(double Vc)
   {
+    THERMALFIST_PROFILE_SCOPE("ThermalModelCanonical::CalculatePartitionFunctions");
+
     if (Vc < 0.0)
       Vc = m_Parameters.SVc;
 
+    CalculateChargeSectorSums();
+
+    // Partition functions precomputed for this volume
+    int iVc = -1;
+    if (m_PrecomputedVc.size() > 0) {
+      vector<double> key;
+      PrecomputedPartitionFunctionsKey(key);
+      if (key == m_PrecomputedKey) {
+        for (size_t i = 0; i < m_PrecomputedVc.size(); ++i) {
+          if (m_PrecomputedVc[i] == Vc) {
+            iVc = static_cast<int>(i);
+            break;
+          }
+        }
+      }
+    }
+
+    m_PartitionFunctionMethodUsed = Quadrature;
+    if (iVc != -1) {
+      m_PartialZ = m_PrecomputedPartialZ[iVc];
+      m_MultExp = m_PrecomputedMultExp[iVc];
+      m_MultExpBanalyt = m_PrecomputedMultExpBanalyt[iVc];
+    }
+    else {
+      vector<double> Nsx(m_Nsx1.size()), Nsy(m_Nsy1.size());
+      for (size_t i = 0; i < Nsx.size(); ++i) {
+        Nsx[i] = Vc * m_Nsx1[i];
+        Nsy[i] = Vc * m_Nsy1[i];
+      }
+
+      if (!IsPartitionFunctionsQuadratureUsed(Nsx, Nsy) && CalculatePartitionFunctionsRecursion(Nsx, Nsy))
+        m_PartitionFunctionMethodUsed = Recursion;
+      else
+        CalculatePartitionFunctionsQuadrature(Vc);
+    }
+
+    m_Corr.resize(m_PartialZ.size());
+    for (size_t iN = 0; iN < m_PartialZ.size(); ++iN) {
+      m_Corr[iN] = m_PartialZ[iN] / m_PartialZ[m_QNMap[QuantumNumbers(0, 0, 0, 0)]];
+    }
+  }
+
+  void ThermalModelCanonical::PrecomputePartitionFunctions(const std::vector<double>& Vcs)
+  {
+    THERMALFIST_PROFILE_SCOPE("ThermalModelCanonical::PrecomputePartitionFunctions");
+
+    PrepareConservedCharges();
+    CalculateChargeSectorSums();
+
+    m_PrecomputedVc.clear();
+    for (size_t iV = 0; iV < Vcs.size(); ++iV) {
+      double Vc = Vcs[iV];
+      if (Vc < 0.0)
+        continue;
+
+      vector<double> Nsx(m_Nsx1.size()), Nsy(m_Nsy1.size());
+      for (size_t i = 0; i < Nsx.size(); ++i) {
+        Nsx[i] = Vc * m_Nsx1[i];
+        Nsy[i] = Vc * m_Nsy1[i];
+      }
+
+      if (IsPartitionFunctionsQuadratureUsed(Nsx, Nsy))
+        m_PrecomputedVc.push_back(Vc);
+    }
+
+    CalculatePartitionFunctionsQuadrature(m_PrecomputedVc, m_PrecomputedPartialZ, m_PrecomputedMultExp, m_PrecomputedMultExpBanalyt);
+    PrecomputedPartitionFunctionsKey(m_PrecomputedKey);
+  }
+
+  void ThermalModelCanonical::ClearPartitionFunctionsCache()
+  {
+    m_ChargeSectorSumsKey.clear();
+    m_Nsx1.clear();
+    m_Nsy1.clear();
+
+    m_PrecomputedKey.clear();
+    m_PrecomputedVc.clear();
+    m_PrecomputedPartialZ.clear();
+    m_PrecomputedMultExp.clear();
+    m_PrecomputedMultExpBanalyt.clear();
+  }
+
+  void ThermalModelCanonical::CalculateChargeSectorSums()
+  {
     if (!UsePartialChemicalEquilibrium()) 
       FillChemicalPotentials();
     else {
@@ -306,6 +709,11 @@ Obtained: %lf\n\
       }
     }
 
+    vector<double> key;
+    ChargeSectorSumsKey(key);
+    if (key == m_ChargeSectorSumsKey)
+      return;
+
     bool AllMuZero = true;
     for (int i = 0; i < m_TPS->ComponentsNumber(); ++i) {
       ThermalParticle &tpart = m_TPS->Particle(i);
@@ -316,8 +724,12 @@ Obtained: %lf\n\
       }
     }
 
-    vector<double> Nsx(m_PartialZ.size(), 0.);
-    vector<double> Nsy(m_PartialZ.size(), 0.);
+    vector<double> &Nsx = m_Nsx1;
+    vector<double> &Nsy = m_Nsy1;
+    Nsx.assign(m_PartialZ.size(), 0.);
+    Nsy.assign(m_PartialZ.size(), 0.);
+
+    vector<IdealGasFunctions::IdealGasQuantities> terms;
 
     for (int i = 0; i < m_TPS->ComponentsNumber(); ++i) {
       ThermalParticle &tpart = m_TPS->Particle(i);
@@ -348,17 +760,19 @@ Obtained: %lf\n\
         }
       }
       else {
+        // All the terms of the cluster expansion at once
+        tpart.ClusterExpansionTerms(m_Parameters, terms, m_UseWidth, UsePartialChemicalEquilibrium() ? m_Chem[i] : 0.);
         for (int n = 1; n <= tpart.ClusterExpansionOrder(); ++n) {
           int ind = m_QNMap[QuantumNumbers(m_BCE*n*tpart.BaryonCharge(), m_QCE*n*tpart.ElectricCharge(), m_SCE*n*tpart.Strangeness(), m_CCE*n*tpart.Charm())];
           if (ind < static_cast<int>(Nsx.size())) {
             if (!UsePartialChemicalEquilibrium()) {
-              double tdens = tpart.DensityCluster(n, m_Parameters, IdealGasFunctions::ParticleDensity, m_UseWidth, 0.) / static_cast<double>(n); // TODO: Check
+              double tdens = terms[n - 1].n / static_cast<double>(n); // TODO: Check
               Nsx[ind] += tdens * cosh(n * m_Chem[i] / m_Parameters.T);
               Nsy[ind] += tdens * sinh(n * m_Chem[i] / m_Parameters.T);
             }
             // Currently only works at mu = 0!!
             else {
-              double tdens = tpart.DensityCluster(n, m_Parameters, IdealGasFunctions::ParticleDensity, m_UseWidth, m_Chem[i]) / static_cast<double>(n); // TODO: Check
+              double tdens = terms[n - 1].n / static_cast<double>(n); // TODO: Check
               Nsx[ind] += tdens;
             }
           }
@@ -366,40 +780,238 @@ Obtained: %lf\n\
       }
     }
 
-    for (int i = 0; i < static_cast<int>(Nsx.size()); ++i) {
-      Nsx[i] *= Vc;
-      Nsy[i] *= Vc;
-      m_PartialZ[i] = 0.;
+    m_AllMuZero = AllMuZero;
+    m_ChargeSectorSumsKey = key;
+  }
+
+  void ThermalModelCanonical::ChargeSectorSumsKey(std::vector<double>& key) const
+  {
+    key.clear();
+
+    key.push_back(m_QuantumStats);
+    key.push_back(m_UseWidth);
+    key.push_back(m_PCE);
+    key.push_back(m_TPS->ResonanceWidthIntegrationType());
+    key.push_back(m_BCE);
+    key.push_back(m_QCE);
+    key.push_back(m_SCE);
+    key.push_back(m_CCE);
+    key.push_back(m_BMAX);
+    key.push_back(m_QMAX);
+    key.push_back(m_SMAX);
+    key.push_back(m_CMAX);
+
+    key.push_back(m_Parameters.T);
+    key.push_back(m_Parameters.muB);
+    key.push_back(m_Parameters.muS);
+    key.push_back(m_Parameters.muQ);
+    key.push_back(m_Parameters.muC);
+    key.push_back(m_Parameters.gammaq);
+    key.push_back(m_Parameters.gammaS);
+    key.push_back(m_Parameters.gammaC);
+    key.insert(key.end(), m_Chem.begin(), m_Chem.end());
+
+    for (int i = 0; i < m_TPS->ComponentsNumber(); ++i) {
+      const ThermalParticle &part = m_TPS->Particles()[i];
+      key.push_back(part.Degeneracy());
+      key.push_back(part.Statistics());
+      key.push_back(part.Mass());
+      key.push_back(part.BaryonCharge());
+      key.push_back(part.ElectricCharge());
+      key.push_back(part.Strangeness());
+      key.push_back(part.Charm());
+      key.push_back(part.AbsoluteQuark());
+      key.push_back(part.AbsoluteStrangeness());
+      key.push_back(part.AbsoluteCharm());
+      key.push_back(part.ResonanceWidth());
+      key.push_back(part.DecayThresholdMass());
+      key.push_back(part.GetResonanceWidthShape());
+      key.push_back(part.GetResonanceWidthIntegrationType());
+      key.push_back(part.CalculationType());
+      key.push_back(part.ClusterExpansionOrder());
     }
+  }
+
+  void ThermalModelCanonical::PrecomputedPartitionFunctionsKey(std::vector<double>& key) const
+  {
+    key = m_ChargeSectorSumsKey;
+    key.push_back(m_Parameters.B);
+    key.push_back(m_Parameters.Q);
+    key.push_back(m_Parameters.S);
+    key.push_back(m_Parameters.C);
+    key.push_back(m_Banalyt);
+    key.push_back(m_PartitionFunctionMethod);
+    key.push_back(QuadratureIntervals());
+  }
+
+  bool ThermalModelCanonical::IsPartitionFunctionsQuadratureUsed(const std::vector<double>& Nsx, const std::vector<double>& Nsy) const
+  {
+    if (m_PartitionFunctionMethod == Auto)
+      return !(PartitionFunctionsRecursionCost(Nsx, Nsy) < PartitionFunctionsQuadratureCost());
+    return (m_PartitionFunctionMethod != Recursion);
+  }
 
+  int ThermalModelCanonical::QuadratureIntervals() const
+  {
     int nmax = max(3, (int)sqrt(m_Parameters.B*m_Parameters.B + m_Parameters.Q*m_Parameters.Q + m_Parameters.S*m_Parameters.S + m_Parameters.C*m_Parameters.C));
     if (m_Parameters.B == 0 && m_Parameters.Q == 0 && m_Parameters.S == 0 && m_Parameters.C == 0)
       nmax = 4;
 
-
-    
-    int nmaxB = max(4, m_Parameters.B);
-    int nmaxQ = max(4, m_Parameters.Q);
-    int nmaxS = max(4, m_Parameters.S);
-    int nmaxC = max(4, m_Parameters.C);
-
     // UPDATE: allow to increase the number of interations externally
     nmax *= m_IntegrationIterationsMultiplier;
-    nmaxB = nmaxQ = nmaxS = nmaxC = nmax;
 
+    return nmax;
+  }
 
+  double ThermalModelCanonical::PartitionFunctionsQuadratureCost() const
+  {
+    // 10-point Gauss-Legendre quadrature on each interval
+    int nmax = QuadratureIntervals();
+    double points = 1.;
+    if (m_BMAX != 0 && !m_Banalyt)
+      points *= 2 * nmax * 10;
+    if (m_QMAX != 0)
+      points *= nmax * 10;
+    if (m_SMAX != 0)
+      points *= 2 * nmax * 10;
+    if (m_CMAX != 0)
+      points *= 2 * nmax * 10;
+
+    // Two passes over the quantum numbers per point, each with trigonometric functions
+    return points * 2. * m_PartialZ.size() * ChargeRecursion::TrigonometricCost;
+  }
 
+  double ThermalModelCanonical::PartitionFunctionsRecursionCost(const std::vector<double>& Nsx, const std::vector<double>& Nsy) const
+  {
+    ChargeRecursion recursion(m_QNvec, m_QNMap, Nsx, Nsy, ChargeRecursionTarget(), ChargeRecursionRange());
+    if (!recursion.IsApplicable())
+      return numeric_limits<double>::infinity();
+
+    // Follows the passes of CalculatePartitionFunctionsRecursion(),
+    // with the partition function at the target charges estimated instead of calculated
+    double Ztarget = recursion.EstimateCoefficient(ChargeRecursionTarget());
+    double scale = exp(recursion.Lambda());
+    double ret = 0.;
+    bool converged = false;
+    for (int pass = 0; pass < ChargeRecursion::MaxPasses && !converged; ++pass) {
+      if (!recursion.Prepare(scale))
+        return numeric_limits<double>::infinity();
+      ret += recursion.Cost();
+      converged = (recursion.TailBound() <= ChargeRecursion::Tolerance * Ztarget);
+      scale = Ztarget;
+    }
+    if (!converged)
+      return numeric_limits<double>::infinity();
+    return ret;
+  }
 
+  bool ThermalModelCanonical::CalculatePartitionFunctionsRecursion(const std::vector<double>& Nsx, const std::vector<double>& Nsy)
+  {
+    ChargeRecursion recursion(m_QNvec, m_QNMap, Nsx, Nsy, ChargeRecursionTarget(), ChargeRecursionRange());
+    if (!recursion.IsApplicable())
+      return false;
+
+    // The truncation is chosen relative to the partition function at the target charges,
+    // which is only known after the first pass
+    vector<int> target = ChargeRecursionTarget();
+    double scale = exp(recursion.Lambda());
+    bool converged = false;
+    for (int pass = 0; pass < ChargeRecursion::MaxPasses && !converged; ++pass) {
+      if (!recursion.Prepare(scale))
+        return false;
+      recursion.Calculate();
+      double Ztarget = fabs(recursion.Coefficient(target[0], target[1], target[2], target[3]));
+      if (Ztarget == 0.)
+        return false;
+      converged = (recursion.TailBound() <= ChargeRecursion::Tolerance * Ztarget);
+      scale = Ztarget;
+    }
+    if (!converged)
+      return false;
 
+    // Z = exp(Nsx at zero charges) * Coefficient, the factor exp(-m_MultExp) is common with the quadratures
+    double norm = 0.;
     m_MultExp = 0.;
     m_MultExpBanalyt = 0.;
+    for (size_t i = 0; i < m_PartialZ.size(); ++i) {
+      m_MultExp += Nsx[i];
+      if (m_QNvec[i].B != 0 || m_QNvec[i].Q != 0 || m_QNvec[i].S != 0 || m_QNvec[i].C != 0)
+        norm -= Nsx[i];
+    }
+
+    for (size_t iN = 0; iN < m_PartialZ.size(); ++iN) {
+      m_PartialZ[iN] = exp(norm) * recursion.Coefficient(
+        target[0] - m_QNvec[iN].B,
+        target[1] - m_QNvec[iN].Q,
+        target[2] - m_QNvec[iN].S,
+        target[3] - m_QNvec[iN].C);
+    }
+
+    return true;
+  }
+
+  std::vector<int> ThermalModelCanonical::ChargeRecursionTarget() const
+  {
+    // Charges which are not conserved exactly are ignored, as in the quadratures
+    vector<int> ret(4, 0);
+    if (m_BMAX != 0) ret[0] = m_Parameters.B;
+    if (m_QMAX != 0) ret[1] = m_Parameters.Q;
+    if (m_SMAX != 0) ret[2] = m_Parameters.S;
+    if (m_CMAX != 0) ret[3] = m_Parameters.C;
+    return ret;
+  }
+
+  std::vector<int> ThermalModelCanonical::ChargeRecursionRange() const
+  {
+    vector<int> ret(4);
+    ret[0] = m_BMAX;
+    ret[1] = m_QMAX;
+    ret[2] = m_SMAX;
+    ret[3] = m_CMAX;
+    return ret;
+  }
+
+  void ThermalModelCanonical::CalculatePartitionFunctionsQuadrature(double Vc)
+  {
+    vector<double> Vcs(1, Vc), MultExp, MultExpBanalyt;
+    vector< vector<double> > PartialZ;
+    CalculatePartitionFunctionsQuadrature(Vcs, PartialZ, MultExp, MultExpBanalyt);
+    m_PartialZ = PartialZ[0];
+    m_MultExp = MultExp[0];
+    m_MultExpBanalyt = MultExpBanalyt[0];
+  }
+
+  void ThermalModelCanonical::CalculatePartitionFunctionsQuadrature(const std::vector<double>& Vcs, std::vector< std::vector<double> >& PartialZ, std::vector<double>& MultExp, std::vector<double>& MultExpBanalyt) const
+  {
+    // Nsx and Nsy are proportional to the volume, everything below is per unit volume
+    const vector<double> &Nsx = m_Nsx1;
+    const vector<double> &Nsy = m_Nsy1;
+    const bool AllMuZero = m_AllMuZero;
+    const size_t nV = Vcs.size();
+
+    PartialZ.assign(nV, vector<double>(m_PartialZ.size(), 0.));
+
+    int nmax = QuadratureIntervals();
+    int nmaxB = nmax, nmaxQ = nmax, nmaxS = nmax, nmaxC = nmax;
+
+    double MultExp1 = 0., MultExpBanalyt1 = 0.;
     for (size_t i = 0; i < m_PartialZ.size(); ++i) {
       if (!m_Banalyt || m_QNvec[i].B == 0)
-        m_MultExp += Nsx[i];
+        MultExp1 += Nsx[i];
       if (m_Banalyt && (m_QNvec[i].B == 1 || m_QNvec[i].B == -1))
-        m_MultExpBanalyt += Nsx[i];
+        MultExpBanalyt1 += Nsx[i];
+    }
+
+    MultExp.resize(nV);
+    MultExpBanalyt.resize(nV);
+    for (size_t iV = 0; iV < nV; ++iV) {
+      MultExp[iV] = Vcs[iV] * MultExp1;
+      MultExpBanalyt[iV] = Vcs[iV] * MultExpBanalyt1;
     }
 
+    // Phase factors of the integrand, these do not depend on the volume
+    vector<double> cosg(m_PartialZ.size(), 0.), sing(m_PartialZ.size(), 0.);
+
     double dphiB = xMath::Pi() / nmaxB;
     int maxB = 2 * nmaxB;
     if (m_BMAX == 0 || m_Banalyt)
@@ -527,6 +1139,8 @@ Obtained: %lf\n\
                       warg = atan2(wy, wx);
                     }
 
+                    double weight = wlegB[iBt] * wlegS[iSt] * wlegQ[iQt] * wlegC[iCt];
+
                     for (size_t iN = 0; iN < m_PartialZ.size(); ++iN) {
                       int tBg = m_Parameters.B - m_QNvec[iN].B;
                       int tQg = m_Parameters.Q - m_QNvec[iN].Q;
@@ -534,19 +1148,36 @@ Obtained: %lf\n\
                       int tCg = m_Parameters.C - m_QNvec[iN].C;
 
                       if (m_Banalyt) {
-                        //m_PartialZ[iN] += wlegB[iBt] * wlegS[iSt] * wlegQ[iQt] * wlegC[iCt] * cos(tBg*xlegB[iBt] + tSg * xlegS[iSt] + tQg * xlegQ[iQt] + tCg * xlegC[iCt] - tBg * warg) * exp(mx) * xMath::BesselI(tBg, 2. * wmod);
-                        m_PartialZ[iN] += wlegB[iBt] * wlegS[iSt] * wlegQ[iQt] * wlegC[iCt] * 
-                          cos(tBg * xlegB[iBt] + tSg * xlegS[iSt] + tQg * xlegQ[iQt] + tCg * xlegC[iCt] - tBg * warg) * 
-                          exp(mx + 2. * wmod - m_MultExpBanalyt) * 
-                          xMath::BesselIexp(tBg, 2. * wmod);
+                        cosg[iN] = cos(tBg * xlegB[iBt] + tSg * xlegS[iSt] + tQg * xlegQ[iQt] + tCg * xlegC[iCt] - tBg * warg);
                       }
                       else {
-                        if (AllMuZero)
-                          m_PartialZ[iN] += wlegB[iBt] * wlegS[iSt] * wlegQ[iQt] * wlegC[iCt] * cos(tBg*xlegB[iBt] + tSg * xlegS[iSt] + tQg * xlegQ[iQt] + tCg * xlegC[iCt]) * exp(mx);
-                        else
-                          m_PartialZ[iN] += wlegB[iBt] * wlegS[iSt] * wlegQ[iQt] * wlegC[iCt] * exp(mx)
-                          * (cos(tBg*xlegB[iBt] + tSg * xlegS[iSt] + tQg * xlegQ[iQt] + tCg * xlegC[iCt]) * cos(my)
-                            + sin(tBg*xlegB[iBt] + tSg * xlegS[iSt] + tQg * xlegQ[iQt] + tCg * xlegC[iCt]) * sin(my));
+                        cosg[iN] = cos(tBg*xlegB[iBt] + tSg * xlegS[iSt] + tQg * xlegQ[iQt] + tCg * xlegC[iCt]);
+                        if (!AllMuZero)
+                          sing[iN] = sin(tBg*xlegB[iBt] + tSg * xlegS[iSt] + tQg * xlegQ[iQt] + tCg * xlegC[iCt]);
+                      }
+                    }
+
+                    for (size_t iV = 0; iV < nV; ++iV) {
+                      double Vc = Vcs[iV];
+                      vector<double> &Z = PartialZ[iV];
+
+                      if (m_Banalyt) {
+                        //Z[iN] += weight * cos(tBg*xlegB[iBt] + tSg * xlegS[iSt] + tQg * xlegQ[iQt] + tCg * xlegC[iCt] - tBg * warg) * exp(mx) * xMath::BesselI(tBg, 2. * wmod);
+                        double factor = weight * exp(Vc * (mx + 2. * wmod) - MultExpBanalyt[iV]);
+                        for (size_t iN = 0; iN < m_PartialZ.size(); ++iN)
+                          Z[iN] += factor * cosg[iN] * xMath::BesselIexp(m_Parameters.B - m_QNvec[iN].B, 2. * Vc * wmod);
+                      }
+                      else {
+                        double factor = weight * exp(Vc * mx);
+                        if (AllMuZero) {
+                          for (size_t iN = 0; iN < m_PartialZ.size(); ++iN)
+                            Z[iN] += factor * cosg[iN];
+                        }
+                        else {
+                          double cosmy = cos(Vc * my), sinmy = sin(Vc * my);
+                          for (size_t iN = 0; iN < m_PartialZ.size(); ++iN)
+                            Z[iN] += factor * (cosg[iN] * cosmy + sing[iN] * sinmy);
+                        }
                       }
                     }
                   }
@@ -561,23 +1192,20 @@ Obtained: %lf\n\
       }
     }
 
-    for (size_t iN = 0; iN < m_PartialZ.size(); ++iN) {
-      if (m_BMAX != 0 && m_BMAX != 1 && !m_Banalyt) // TODO: cross-check
-        m_PartialZ[iN] /= 2. * xMath::Pi();
-      if (m_QMAX != 0) {
-        m_PartialZ[iN] /= 2. * xMath::Pi();
-        m_PartialZ[iN] *= 2.; /// TODO: Extra cross-check the factor 2, can be important for entropy density, irrelevant for everything else
+    for (size_t iV = 0; iV < nV; ++iV) {
+      vector<double> &Z = PartialZ[iV];
+      for (size_t iN = 0; iN < m_PartialZ.size(); ++iN) {
+        if (m_BMAX != 0 && !m_Banalyt)
+          Z[iN] /= 2. * xMath::Pi();
+        if (m_QMAX != 0) {
+          Z[iN] /= 2. * xMath::Pi();
+          Z[iN] *= 2.; /// TODO: Extra cross-check the factor 2, can be important for entropy density, irrelevant for everything else
+        }
+        if (m_SMAX != 0)
+          Z[iN] /= 2. * xMath::Pi();
+        if (m_CMAX != 0)
+          Z[iN] /= 2. * xMath::Pi();
       }
-      if (m_SMAX != 0)
-        m_PartialZ[iN] /= 2. * xMath::Pi();
-      if (m_CMAX != 0)
-        m_PartialZ[iN] /= 2. * xMath::Pi();
-    }
-
-
-    m_Corr.resize(m_PartialZ.size());
-    for (size_t iN = 0; iN < m_PartialZ.size(); ++iN) {
-      m_Corr[iN] = m_PartialZ[iN] / m_PartialZ[m_QNMap[QuantumNumbers(0, 0, 0, 0)]];
     }
   }
 
@@ -603,11 +1231,14 @@ Obtained: %lf\n\
         ret3 = -m_Corr[ind] * m_Parameters.SVc * tpart.DensityCluster(1, m_Parameters, IdealGasFunctions::ParticleDensity, m_UseWidth, m_Chem[part]);
     }
     else {
+      vector<IdealGasFunctions::IdealGasQuantities> terms;
+      tpart.ClusterExpansionTerms(m_Parameters, terms, m_UseWidth, m_Chem[part]);
+
       double ret1num = 0., ret1zn = 0.;
       for (int n = 1; n <= tpart.ClusterExpansionOrder(); ++n) {
         int ind = m_QNMap[QuantumNumbers(m_BCE*n*tpart.BaryonCharge(), m_QCE*n*tpart.ElectricCharge(), m_SCE*n*tpart.Strangeness(), m_CCE*n*tpart.Charm())];
 
-        double densityClusterN = tpart.DensityCluster(n, m_Parameters, IdealGasFunctions::ParticleDensity, m_UseWidth, m_Chem[part]);
+        double densityClusterN = terms[n - 1].n;
 
         if (ind < static_cast<int>(m_Corr.size())) {
           ret1num += m_Corr[ind] * n * densityClusterN;
@@ -618,7 +1249,7 @@ Obtained: %lf\n\
           if (m_QNMap.count(QuantumNumbers(m_BCE*(n + n2)*tpart.BaryonCharge(), m_QCE*(n + n2)*tpart.ElectricCharge(), m_SCE*(n + n2)*tpart.Strangeness(), m_CCE*(n + n2)*tpart.Charm())) != 0) {
             int ind2 = m_QNMap[QuantumNumbers(m_BCE*(n + n2)*tpart.BaryonCharge(), m_QCE*(n + n2)*tpart.ElectricCharge(), m_SCE*(n + n2)*tpart.Strangeness(), m_CCE*(n + n2)*tpart.Charm())];
             if (ind < static_cast<int>(m_Corr.size()) && ind2 < static_cast<int>(m_Corr.size()))
-              ret2 += densityClusterN * m_Corr[ind2] * m_Parameters.SVc * tpart.DensityCluster(n2, m_Parameters, IdealGasFunctions::ParticleDensity, m_UseWidth, m_Chem[part]);
+              ret2 += densityClusterN * m_Corr[ind2] * m_Parameters.SVc * terms[n2 - 1].n;
           }
         }
       }
@@ -643,6 +1274,23 @@ Obtained: %lf\n\
     for (int i = 0; i < NN; ++i)
       yld[i] = m_densities[i] * m_Parameters.SVc;
 
+    // Densities of the terms of the cluster expansion, computed once for each particle
+    vector< vector<double> > densityCluster(NN);
+    vector<IdealGasFunctions::IdealGasQuantities> terms;
+    for (int i = 0; i < NN; ++i) {
+      ThermalParticle &tpart = m_TPS->Particle(i);
+      if (!IsParticleCanonical(tpart))
+        continue;
+      if (tpart.Statistics() == 0 || tpart.CalculationType() != IdealGasFunctions::ClusterExpansion) {
+        densityCluster[i].push_back(tpart.DensityCluster(1, m_Parameters, IdealGasFunctions::ParticleDensity, m_UseWidth, m_Chem[i]));
+      }
+      else {
+        tpart.ClusterExpansionTerms(m_Parameters, terms, m_UseWidth, m_Chem[i]);
+        for (size_t n = 0; n < terms.size(); ++n)
+          densityCluster[i].push_back(terms[n].n);
+      }
+    }
+
     for (int i = 0; i < NN; ++i) {
       ThermalParticle &tpart = m_TPS->Particle(i);
       if (!IsParticleCanonical(tpart)) {
@@ -657,7 +1305,7 @@ Obtained: %lf\n\
         for (int n = 1; n <= tpart.ClusterExpansionOrder(); ++n) {
           int ind = m_QNMap[QuantumNumbers(m_BCE*n*tpart.BaryonCharge(), m_QCE*n*tpart.ElectricCharge(), m_SCE*n*tpart.Strangeness(), m_CCE*n*tpart.Charm())];
 
-          double densityClusterN = tpart.DensityCluster(n, m_Parameters, IdealGasFunctions::ParticleDensity, m_UseWidth, m_Chem[i]);
+          double densityClusterN = densityCluster[i][n - 1];
 
           if (ind < static_cast<int>(m_Corr.size()))
             ret1num[i] += m_Corr[ind] * n * densityClusterN * m_Parameters.SVc;
@@ -690,8 +1338,8 @@ Obtained: %lf\n\
                 m_SCE*(n1*tpart1.Strangeness() + n2 * tpart2.Strangeness()),
                 m_CCE*(n1*tpart1.Charm() + n2 * tpart2.Charm()))];
 
-              double densityClusterN1 = tpart1.DensityCluster(n1, m_Parameters, IdealGasFunctions::ParticleDensity, m_UseWidth, m_Chem[i]);
-              double densityClusterN2 = tpart2.DensityCluster(n2, m_Parameters, IdealGasFunctions::ParticleDensity, m_UseWidth, m_Chem[j]);
+              double densityClusterN1 = densityCluster[i][n1 - 1];
+              double densityClusterN2 = densityCluster[j][n2 - 1];
 
               if (ind < static_cast<int>(m_Corr.size()))
                 ret2num[i][j] += m_Corr[ind] * densityClusterN1 * densityClusterN2 * m_Parameters.SVc * m_Parameters.SVc;
@@ -705,7 +1353,6 @@ Obtained: %lf\n\
     m_PrimCorrel.resize(NN);
     for (int i = 0; i < NN; ++i)
       m_PrimCorrel[i].resize(NN);
-    m_TotalCorrel = m_PrimCorrel;
 
     for (int i = 0; i < NN; ++i) {
       for (int j = 0; j < NN; ++j) {
@@ -749,6 +1396,8 @@ Obtained: %lf\n\
     if (!m_Calculated) CalculateDensities();
     double ret = 0.;
 
+    vector<IdealGasFunctions::IdealGasQuantities> terms;
+
     for (int i = 0; i < m_TPS->ComponentsNumber(); ++i) {
       ThermalParticle &tpart = m_TPS->Particle(i);
       {
@@ -763,10 +1412,11 @@ Obtained: %lf\n\
             ret += m_Corr[ind] * tpart.DensityCluster(1, m_Parameters, IdealGasFunctions::EnergyDensity, m_UseWidth, m_Chem[i]);
         }
         else {
+          tpart.ClusterExpansionTerms(m_Parameters, terms, m_UseWidth, m_Chem[i]);
           for (int n = 1; n <= tpart.ClusterExpansionOrder(); ++n) {
             int ind = m_QNMap[QuantumNumbers(n*tpart.BaryonCharge(), n*tpart.ElectricCharge(), n*tpart.Strangeness(), n*tpart.Charm())];
             if (ind < static_cast<int>(m_Corr.size()))
-              ret += m_Corr[ind] * tpart.DensityCluster(n, m_Parameters, IdealGasFunctions::EnergyDensity, m_UseWidth, m_Chem[i]);
+              ret += m_Corr[ind] * terms[n - 1].e;
           }
         }
       }
@@ -779,6 +1429,8 @@ Obtained: %lf\n\
     if (!m_Calculated) CalculateDensities();
     double ret = 0.;
 
+    vector<IdealGasFunctions::IdealGasQuantities> terms;
+
     for (int i = 0; i < m_TPS->ComponentsNumber(); ++i) {
       ThermalParticle &tpart = m_TPS->Particle(i);
       {
@@ -793,11 +1445,12 @@ Obtained: %lf\n\
             ret += m_Corr[ind] * tpart.DensityCluster(1, m_Parameters, IdealGasFunctions::Pressure, m_UseWidth, m_Chem[i]);
         }
         else {
+          tpart.ClusterExpansionTerms(m_Parameters, terms, m_UseWidth, m_Chem[i]);
           for (int n = 1; n <= tpart.ClusterExpansionOrder(); ++n) {
             int ind = m_QNMap[QuantumNumbers(n*tpart.BaryonCharge(), n*tpart.ElectricCharge(), n*tpart.Strangeness(), n*tpart.Charm())];
 
             if (ind < static_cast<int>(m_Corr.size()))
-              ret += m_Corr[ind] * tpart.DensityCluster(n, m_Parameters, IdealGasFunctions::Pressure, m_UseWidth, m_Chem[i]);
+              ret += m_Corr[ind] * terms[n - 1].P;
           }
         }
       }
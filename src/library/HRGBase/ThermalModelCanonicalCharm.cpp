@@ -40,6 +40,13 @@ namespace thermalfist {
   {
   }
 
+  ThermalModelCanonicalCharm* ThermalModelCanonicalCharm::Clone(ThermalParticleSystem* TPS) const
+  {
+    ThermalModelCanonicalCharm *ret = new ThermalModelCanonicalCharm(*this);
+    FinalizeClone(ret, TPS);
+    return ret;
+  }
+
 
   void ThermalModelCanonicalCharm::SetParameters(const ThermalModelParameters& params) {
     ThermalModelBase::SetParameters(params);
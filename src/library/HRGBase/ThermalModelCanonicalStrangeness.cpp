@@ -7,12 +7,56 @@
  */
 #include "HRGBase/ThermalModelCanonicalStrangeness.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
 #include "HRGBase/xMath.h"
 
 using namespace std;
 
 namespace thermalfist {
 
+  namespace {
+    /// Relative contribution of a shell of terms below which the Bessel series is truncated
+    const double ZsumsTolerance = 1.e-15;
+
+    /// Maximum number of shells of terms in the Bessel series
+    const int ZsumsMaxShells = 500;
+
+    /**
+     * The factors I_|k|(x) y^k of the strangeness-canonical Bessel series.
+     * Each value is computed once and cached, the undefined
+     * values (e.g. when no antiparticles are present) are set to zero.
+     */
+    class BesselSeriesTerms {
+    public:
+      BesselSeriesTerms(double x, double y) : m_x(x), m_y(y) { }
+
+      double operator()(int k) {
+        int ak = abs(k);
+        if (ak >= static_cast<int>(m_Positive.size())) {
+          int kmin = m_Positive.size();
+          int kmax = max(2 * ak, ak + 16);
+          m_Positive.resize(kmax + 1);
+          m_Negative.resize(kmax + 1);
+          for (int l = kmin; l <= kmax; ++l) {
+            double Il = xMath::BesselI(l, m_x);
+            m_Positive[l] = Regularize(Il * pow(m_y, l));
+            m_Negative[l] = Regularize(Il * pow(m_y, -l));
+          }
+        }
+        return (k >= 0) ? m_Positive[ak] : m_Negative[ak];
+      }
+
+    private:
+      static double Regularize(double val) { return (val != val) ? 0. : val; }
+
+      double m_x, m_y;
+      vector<double> m_Positive, m_Negative;
+    };
+  }
+
   ThermalModelCanonicalStrangeness::ThermalModelCanonicalStrangeness(ThermalParticleSystem *TPS_, const ThermalModelParameters& params) :
     ThermalModelBase(TPS_, params)
   {
@@ -34,6 +78,8 @@ namespace thermalfist {
 
     m_TAG = "ThermalModelCanonicalStrangeness";
 
+    m_ZsumsError = 0.;
+
     m_Ensemble = SCE;
     m_InteractionModel = Ideal;
   }
@@ -42,6 +88,13 @@ namespace thermalfist {
   {
   }
 
+  ThermalModelCanonicalStrangeness* ThermalModelCanonicalStrangeness::Clone(ThermalParticleSystem* TPS) const
+  {
+    ThermalModelCanonicalStrangeness *ret = new ThermalModelCanonicalStrangeness(*this);
+    FinalizeClone(ret, TPS);
+    return ret;
+  }
+
 
   void ThermalModelCanonicalStrangeness::SetParameters(const ThermalModelParameters& params) {
     ThermalModelBase::SetParameters(params);
@@ -99,10 +152,7 @@ namespace thermalfist {
     if (!m_GCECalculated)
       CalculateDensitiesGCE();
 
-    m_Zsum.resize(m_StrVals.size());
-
     m_partialS.resize(m_StrVals.size());
-    vector<double> xi(3, 0.), yi(3, 0.);
 
     for (size_t i = 0; i < m_StrVals.size(); ++i) {
       m_partialS[i] = 0.;
@@ -111,30 +161,71 @@ namespace thermalfist {
           m_partialS[i] += m_densitiesGCE[j] * Vc;
     }
 
+    CalculateZsums();
+  }
+
+  void ThermalModelCanonicalStrangeness::CalculateZsums()
+  {
+    m_Zsum.resize(m_StrVals.size());
+    m_ZsumsError = 0.;
+
+    vector<BesselSeriesTerms> terms;
+    int Lmin = 0;
     for (int i = 0; i < 3; ++i) {
-      xi[i] = 2. * sqrt(m_partialS[m_StrMap[i + 1]] * m_partialS[m_StrMap[-(i + 1)]]);
-      yi[i] = sqrt(m_partialS[m_StrMap[i + 1]] / m_partialS[m_StrMap[-(i + 1)]]);
+      double Splus = m_partialS[m_StrMap[i + 1]], Sminus = m_partialS[m_StrMap[-(i + 1)]];
+      terms.push_back(BesselSeriesTerms(2. * sqrt(Splus * Sminus), sqrt(Splus / Sminus)));
+      // The terms of the series peak around the mean numbers of (anti)particles
+      Lmin = max(Lmin, static_cast<int>(ceil(max(Splus, Sminus))));
     }
+    Lmin += 2;
 
-    // TODO: Choose iters dynamically based on total strangeness
-    int iters = 20;
-
+    bool converged = true;
     for (unsigned int i = 0; i < m_StrVals.size(); ++i) {
-      double res = 0.;
-
-      for (int m = -iters; m <= iters; ++m)
-        for (int n = -iters; n <= iters; ++n) {
-          double tmp = xMath::BesselI(abs(3 * m + 2 * n - m_StrVals[i]), xi[0]) *
-            xMath::BesselI(abs(n), xi[1]) *
-            xMath::BesselI(abs(m), xi[2]) *
-            pow(yi[0], m_StrVals[i] - 3 * m - 2 * n) *
-            pow(yi[1], n) *
-            pow(yi[2], m);
-          if (tmp != tmp) continue;
-          res += tmp;
+      int s = m_StrVals[i];
+      double res = 0., shell = 0.;
+      int smallshells = 0, L = 0;
+
+      // Summation over the square shells max(|m|,|n|) = L of the (m,n) lattice,
+      // all the terms are non-negative
+      for (L = 0; L <= ZsumsMaxShells; ++L) {
+        shell = 0.;
+        if (L == 0)
+          shell = terms[0](s) * terms[1](0) * terms[2](0);
+        else {
+          for (int sgn = -1; sgn <= 1; sgn += 2) {
+            int mL = sgn * L;
+            double tm = terms[2](mL);
+            if (tm != 0.)
+              for (int n = -L; n <= L; ++n)
+                shell += terms[0](s - 3 * mL - 2 * n) * terms[1](n) * tm;
+
+            int nL = sgn * L;
+            double tn = terms[1](nL);
+            if (tn != 0.)
+              for (int m = -L + 1; m <= L - 1; ++m)
+                shell += terms[0](s - 3 * m - 2 * nL) * tn * terms[2](m);
+          }
         }
+        res += shell;
+
+        if (L >= Lmin && shell <= ZsumsTolerance * res) {
+          if (++smallshells == 2)
+            break;
+        }
+        else
+          smallshells = 0;
+      }
+
+      if (L > ZsumsMaxShells)
+        converged = false;
+
       m_Zsum[i] = res;
+      if (res > 0.)
+        m_ZsumsError = max(m_ZsumsError, shell / res);
     }
+
+    if (!converged)
+      printf("**WARNING** ThermalModelCanonicalStrangeness::CalculateZsums(): The Bessel series did not converge within %d shells, relative error estimate %E\n", ZsumsMaxShells, m_ZsumsError);
   }
 
   void ThermalModelCanonicalStrangeness::CalculatePrimordialDensities() {
@@ -11,16 +11,41 @@
 #include <omp.h>
 #endif
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <cstring>
 
 
 using namespace std;
 
 namespace thermalfist {
 
+  namespace {
+    /// Number of entries in ThermalModelIdeal::SpeciesSignature()
+    const int SpeciesSignatureSize = 9;
+
+    /// FNV-1a type hash of the mass integration table of a species, truncated to 53 bits to be exactly representable as double
+    double WidthTableHash(const ThermalParticle& part)
+    {
+      unsigned long long ret = 14695981039346656037ULL;
+      const vector<double>* tables[2] = { &part.WidthIntegrationMasses(), &part.WidthIntegrationWeights() };
+      for (int k = 0; k < 2; ++k) {
+        for (size_t i = 0; i < tables[k]->size(); ++i) {
+          unsigned long long bits = 0;
+          memcpy(&bits, &(*tables[k])[i], sizeof(double));
+          ret ^= bits;
+          ret *= 1099511628211ULL;
+        }
+        ret ^= tables[k]->size();
+        ret *= 1099511628211ULL;
+      }
+      return static_cast<double>(ret >> 11);
+    }
+  }
+
   ThermalModelIdeal::ThermalModelIdeal(ThermalParticleSystem *TPS_, const ThermalModelParameters& params) :
-    ThermalModelBase(TPS_, params)
+    ThermalModelBase(TPS_, params), m_ReferenceT(-1.), m_ReferenceUseWidth(false)
   {
     m_TAG = "ThermalModelIdeal";
 
@@ -32,17 +57,143 @@ namespace thermalfist {
   {
   }
 
+  ThermalModelIdeal* ThermalModelIdeal::Clone(ThermalParticleSystem* TPS) const
+  {
+    ThermalModelIdeal *ret = new ThermalModelIdeal(*this);
+    FinalizeClone(ret, TPS);
+    return ret;
+  }
+
   void ThermalModelIdeal::CalculatePrimordialDensities() {
     m_FluctuationsCalculated = false;
 
-    for (int i = 0; i < m_TPS->ComponentsNumber(); ++i) {
-      m_densities[i] = m_TPS->Particles()[i].Density(m_Parameters, IdealGasFunctions::ParticleDensity, m_UseWidth, m_Chem[i]);
+    int NN = m_TPS->ComponentsNumber();
+    if (m_Parameters.T != m_ReferenceT || m_UseWidth != m_ReferenceUseWidth
+      || static_cast<int>(m_ReferenceDensities.size()) != NN) {
+      m_ReferenceT = m_Parameters.T;
+      m_ReferenceUseWidth = m_UseWidth;
+      m_ReferenceMu.assign(NN, 0.);
+      m_ReferenceDensities.assign(NN, 0.);
+      m_ReferenceSignatures.assign(NN * SpeciesSignatureSize, 0.);
+    }
+
+    double signature[SpeciesSignatureSize];
+    for (int i = 0; i < NN; ++i) {
+      const ThermalParticle &part = m_TPS->Particles()[i];
+      double mu = EffectiveChemicalPotential(i);
+
+      // Thermal branching ratios of the eBW scheme depend on the chemical potential
+      bool rescalable = (part.Statistics() == 0
+        && part.GetResonanceWidthIntegrationType() != ThermalParticle::eBW
+        && part.GetResonanceWidthIntegrationType() != ThermalParticle::eBWconstBR);
+
+      SpeciesSignature(i, signature);
+      double *refsignature = &m_ReferenceSignatures[i * SpeciesSignatureSize];
+
+      if (rescalable && m_ReferenceDensities[i] > 0.
+        && equal(signature, signature + SpeciesSignatureSize, refsignature)) {
+        m_densities[i] = m_ReferenceDensities[i] * exp((mu - m_ReferenceMu[i]) / m_Parameters.T);
+        continue;
+      }
+
+      m_densities[i] = part.Density(m_Parameters, IdealGasFunctions::ParticleDensity, m_UseWidth, m_Chem[i]);
+
+      if (rescalable && isnormal(m_densities[i])) {
+        m_ReferenceMu[i] = mu;
+        m_ReferenceDensities[i] = m_densities[i];
+        copy(signature, signature + SpeciesSignatureSize, refsignature);
+      }
+      else
+        m_ReferenceDensities[i] = 0.;
     }
 
     m_Calculated = true;
     ValidateCalculation();
   }
 
+  double ThermalModelIdeal::EffectiveChemicalPotential(int i) const
+  {
+    return EffectiveChemicalPotential(m_TPS->Particles()[i], m_Parameters, m_Chem[i]);
+  }
+
+  double ThermalModelIdeal::EffectiveChemicalPotential(const ThermalParticle& part, const ThermalModelParameters& params, double mu)
+  {
+    // Same as in ThermalParticle::Density()
+    if (!(params.gammaq == 1.))
+      mu += log(params.gammaq) * part.AbsoluteQuark() * params.T;
+    if (!(params.gammaS == 1. || part.AbsoluteStrangeness() == 0.))
+      mu += log(params.gammaS) * part.AbsoluteStrangeness() * params.T;
+    if (!(params.gammaC == 1. || part.AbsoluteCharm() == 0.))
+      mu += log(params.gammaC) * part.AbsoluteCharm() * params.T;
+    return mu;
+  }
+
+  void ThermalModelIdeal::SpeciesSignature(int i, double *signature) const
+  {
+    const ThermalParticle &part = m_TPS->Particles()[i];
+    signature[0] = part.Statistics();
+    signature[1] = part.Mass();
+    signature[2] = part.Degeneracy();
+    signature[3] = part.ResonanceWidth();
+    signature[4] = part.DecayThresholdMass();
+    signature[5] = part.GetResonanceWidthIntegrationType();
+    signature[6] = part.GetResonanceWidthShape();
+    // The mass distribution including the decay thresholds and the branching ratio weights
+    signature[7] = part.DecayThresholdMassDynamical();
+    signature[8] = WidthTableHash(part);
+  }
+
+  void ThermalModelIdeal::CalculateDensitiesBatch(const std::vector<ThermalModelParameters>& params,
+    std::vector< std::vector<double> >& primordial,
+    std::vector< std::vector<double> >& totals,
+    bool constrainChemicalPotentials)
+  {
+    if (constrainChemicalPotentials || (m_UseWidth && m_TPS->ResonanceWidthIntegrationType() == ThermalParticle::eBW)) {
+      ThermalModelBase::CalculateDensitiesBatch(params, primordial, totals, constrainChemicalPotentials);
+      return;
+    }
+
+    int KK = params.size();
+    int NN = m_TPS->ComponentsNumber();
+    primordial.assign(KK, vector<double>(NN, 0.));
+    totals.resize(KK);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < NN; ++i) {
+      const ThermalParticle &part = m_TPS->Particles()[i];
+      bool rescalable = (part.Statistics() == 0 && part.GetResonanceWidthIntegrationType() != ThermalParticle::eBWconstBR);
+
+      double refT = -1., refDensity = 0.;
+      for (int k = 0; k < KK; ++k) {
+        const ThermalModelParameters &point = params[k];
+        double mu = part.BaryonCharge() * point.muB + part.Strangeness() * point.muS + part.ElectricCharge() * point.muQ + part.Charm() * point.muC;
+
+        if (rescalable) {
+          if (point.T != refT) {
+            ThermalModelParameters refpoint = point;
+            refpoint.gammaq = refpoint.gammaS = refpoint.gammaC = 1.;
+            refT = point.T;
+            refDensity = part.Density(refpoint, IdealGasFunctions::ParticleDensity, m_UseWidth, 0.);
+          }
+          if (isnormal(refDensity)) {
+            primordial[k][i] = refDensity * exp(EffectiveChemicalPotential(part, point, mu) / point.T);
+            continue;
+          }
+        }
+
+        primordial[k][i] = part.Density(point, IdealGasFunctions::ParticleDensity, m_UseWidth, mu);
+      }
+    }
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+    for (int k = 0; k < KK; ++k)
+      ApplyFeeddown(Feeddown::StabilityFlag, primordial[k], totals[k]);
+  }
+
   void ThermalModelIdeal::CalculateTwoParticleCorrelations() {
     int NN = m_densities.size();
     vector<double> tN(NN), tW(NN);
@@ -52,7 +203,6 @@ namespace thermalfist {
 
     m_PrimCorrel.resize(NN);
     for (int i = 0; i < NN; ++i) m_PrimCorrel[i].resize(NN);
-    m_TotalCorrel = m_PrimCorrel;
 
     for (int i = 0; i < NN; ++i)
       for (int j = 0; j < NN; ++j) {
@@ -121,32 +271,61 @@ namespace thermalfist {
 
   std::vector<double> ThermalModelIdeal::CalculateChargeFluctuations(const std::vector<double>& chgs, int order)
   {
-    vector<double> ret(order + 1, 0.);
-
-    // chi1
-    for (size_t i = 0; i < m_densities.size(); ++i)
-      ret[0] += chgs[i] * m_densities[i];
+    return CalculateChargeFluctuationsBatch(vector< vector<double> >(1, chgs), order)[0];
+  }
 
-    ret[0] /= pow(m_Parameters.T * xMath::GeVtoifm(), 3);
+  std::vector< std::vector<double> > ThermalModelIdeal::CalculateChargeFluctuationsBatch(const std::vector< std::vector<double> >& chgs, int order)
+  {
+    int NN = m_densities.size();
+    int KK = chgs.size();
 
-    if (order < 2) return ret;
+    vector< vector<double> > ret(KK, vector<double>(order + 1, 0.));
 
-    for (size_t i = 0; i < m_densities.size(); ++i)
-      ret[1] += chgs[i] * chgs[i] * m_TPS->Particles()[i].chi(2, m_Parameters, m_UseWidth, m_Chem[i]);
+    // chi1
+    for (int k = 0; k < KK; ++k) {
+      for (int i = 0; i < NN; ++i)
+        ret[k][0] += chgs[k][i] * m_densities[i];
+      ret[k][0] /= pow(m_Parameters.T * xMath::GeVtoifm(), 3);
+    }
 
-    if (order < 3) return ret;
+    if (order < 2) return ret;
 
-    for (size_t i = 0; i < m_densities.size(); ++i)
-      ret[2] += chgs[i] * chgs[i] * chgs[i] * m_TPS->Particles()[i].chi(3, m_Parameters, m_UseWidth, m_Chem[i]);
+    // Only the species carrying at least one of the charges contribute
+    vector<int> species;
+    for (int i = 0; i < NN; ++i) {
+      for (int k = 0; k < KK; ++k) {
+        if (chgs[k][i] != 0.) {
+          species.push_back(i);
+          break;
+        }
+      }
+    }
 
-    if (order < 4) return ret;
+    int NS = species.size();
+    vector< vector<double> > partchis(NS);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int is = 0; is < NS; ++is) {
+      int i = species[is];
+      partchis[is] = m_TPS->Particles()[i].chis(order, m_Parameters, m_UseWidth, m_Chem[i]);
+    }
 
-    for (size_t i = 0; i < m_densities.size(); ++i)
-      ret[3] += chgs[i] * chgs[i] * chgs[i] * chgs[i] * m_TPS->Particles()[i].chi(4, m_Parameters, m_UseWidth, m_Chem[i]);
+    for (int k = 0; k < KK; ++k) {
+      for (int is = 0; is < NS; ++is) {
+        double q = chgs[k][species[is]];
+        double qn = q;
+        for (int n = 2; n <= order; ++n) {
+          qn *= q;
+          ret[k][n - 1] += qn * partchis[is][n - 1];
+        }
+      }
+    }
 
     return ret;
   }
 
+
   double ThermalModelIdeal::CalculateEnergyDensity() {
     double ret = 0.;
 
@@ -0,0 +1,400 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2014-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include "HRGBase/ThermalModelResultCache.h"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+namespace thermalfist {
+
+  namespace {
+    const char ResultCacheSignature[] = "TFRCACH2";
+
+    /// Marker at the start of each record of the disk store
+    const char ResultCacheRecordMarker[] = "TFRECORD";
+
+    /// Size of the record header: marker, two hash words, number of values
+    const size_t RecordHeaderSize = 8 + 2 * sizeof(unsigned long long) + sizeof(long long);
+
+    const unsigned long long FNVOffsetBasis = 14695981039346656037ULL;
+    const unsigned long long FNVPrime = 1099511628211ULL;
+
+    /// Upper bound on the number of values in a record, protects against corrupted files
+    const long long MaxRecordSize = 1LL << 28;
+
+    unsigned long long BitsOf(double value)
+    {
+      // Do not distinguish between +0 and -0
+      if (value == 0.)
+        value = 0.;
+      unsigned long long ret;
+      memcpy(&ret, &value, sizeof(double));
+      return ret;
+    }
+
+    /// FNV-1a type hash, processing the numbers as 64-bit words
+    unsigned long long HashFNV(const vector<double>& values)
+    {
+      unsigned long long ret = FNVOffsetBasis;
+      for (size_t i = 0; i < values.size(); ++i) {
+        ret ^= BitsOf(values[i]);
+        ret *= FNVPrime;
+      }
+      return ret;
+    }
+
+    /// FNV-1a hash of a sequence of bytes, used as the record checksum
+    unsigned long long HashBytes(const char *data, size_t size)
+    {
+      unsigned long long ret = FNVOffsetBasis;
+      for (size_t i = 0; i < size; ++i) {
+        ret ^= static_cast<unsigned char>(data[i]);
+        ret *= FNVPrime;
+      }
+      return ret;
+    }
+
+    /// Position of the next record marker in buf at or after pos.
+    /// If there is none, the position of a partial marker at the end of buf, or buf.size().
+    size_t FindRecordMarker(const vector<char>& buf, size_t pos)
+    {
+      for (; pos < buf.size(); ++pos) {
+        size_t len = buf.size() - pos;
+        if (len > 8)
+          len = 8;
+        if (memcmp(&buf[pos], ResultCacheRecordMarker, len) == 0)
+          return pos;
+      }
+      return buf.size();
+    }
+
+    /// Hash of the numbers based on the splitmix64 finalizer
+    unsigned long long HashMix(const vector<double>& values)
+    {
+      unsigned long long ret = values.size();
+      for (size_t i = 0; i < values.size(); ++i) {
+        unsigned long long z = ret ^ BitsOf(values[i]);
+        z += 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        ret = z ^ (z >> 31);
+      }
+      return ret;
+    }
+
+    void AppendVector(vector<double>& data, const vector<double>& values)
+    {
+      data.push_back(static_cast<double>(values.size()));
+      data.insert(data.end(), values.begin(), values.end());
+    }
+
+    bool ReadVector(const vector<double>& data, size_t& pos, vector<double>& values)
+    {
+      if (pos >= data.size())
+        return false;
+      size_t size = static_cast<size_t>(data[pos]);
+      ++pos;
+      if (pos + size > data.size())
+        return false;
+      values.assign(data.begin() + pos, data.begin() + pos + size);
+      pos += size;
+      return true;
+    }
+
+    /// Flattens the result into a vector of numbers
+    vector<double> SerializeResult(const ThermalModelCachedResult& result)
+    {
+      const ThermalModelParameters& params = result.Parameters;
+      vector<double> ret;
+      ret.push_back(params.T);
+      ret.push_back(params.muB);
+      ret.push_back(params.muS);
+      ret.push_back(params.muQ);
+      ret.push_back(params.muC);
+      ret.push_back(params.gammaq);
+      ret.push_back(params.gammaS);
+      ret.push_back(params.gammaC);
+      ret.push_back(params.V);
+      ret.push_back(params.SVc);
+      ret.push_back(params.B);
+      ret.push_back(params.Q);
+      ret.push_back(params.S);
+      ret.push_back(params.C);
+      ret.push_back(result.MaxDiff);
+      AppendVector(ret, result.Densities);
+      AppendVector(ret, result.TotalDensities);
+      ret.push_back(static_cast<double>(result.DensitiesByFeeddown.size()));
+      for (size_t i = 0; i < result.DensitiesByFeeddown.size(); ++i)
+        AppendVector(ret, result.DensitiesByFeeddown[i]);
+      AppendVector(ret, result.State);
+      return ret;
+    }
+
+    bool DeserializeResult(const vector<double>& data, ThermalModelCachedResult& result)
+    {
+      if (data.size() < 16)
+        return false;
+      ThermalModelParameters& params = result.Parameters;
+      params.T = data[0];
+      params.muB = data[1];
+      params.muS = data[2];
+      params.muQ = data[3];
+      params.muC = data[4];
+      params.gammaq = data[5];
+      params.gammaS = data[6];
+      params.gammaC = data[7];
+      params.V = data[8];
+      params.SVc = data[9];
+      params.B = static_cast<int>(data[10]);
+      params.Q = static_cast<int>(data[11]);
+      params.S = static_cast<int>(data[12]);
+      params.C = static_cast<int>(data[13]);
+      result.MaxDiff = data[14];
+      size_t pos = 15;
+      if (!ReadVector(data, pos, result.Densities) || !ReadVector(data, pos, result.TotalDensities) || pos >= data.size())
+        return false;
+      result.DensitiesByFeeddown.resize(static_cast<size_t>(data[pos]));
+      ++pos;
+      for (size_t i = 0; i < result.DensitiesByFeeddown.size(); ++i)
+        if (!ReadVector(data, pos, result.DensitiesByFeeddown[i]))
+          return false;
+      return ReadVector(data, pos, result.State);
+    }
+  }
+
+  ThermalModelResultCache::ThermalModelResultCache(int capacity) :
+    m_Capacity(capacity), m_DiskStore(""), m_DiskScanned(0), m_Hits(0), m_Misses(0)
+  {
+  }
+
+  void ThermalModelResultCache::SetCapacity(int capacity)
+  {
+    m_Capacity = capacity;
+    while (static_cast<int>(m_Entries.size()) > m_Capacity && !m_Entries.empty()) {
+      m_Index.erase(m_Entries.back().first);
+      m_Entries.pop_back();
+    }
+  }
+
+  void ThermalModelResultCache::Clear()
+  {
+    m_Entries.clear();
+    m_Index.clear();
+  }
+
+  bool ThermalModelResultCache::SetDiskStore(const std::string& filename)
+  {
+    CloseDiskStore();
+
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (f == NULL) {
+      f = fopen(filename.c_str(), "wb");
+      if (f == NULL) {
+        printf("**WARNING** ThermalModelResultCache::SetDiskStore(): Cannot create file %s\n", filename.c_str());
+        return false;
+      }
+      bool ok = (fwrite(ResultCacheSignature, sizeof(char), 8, f) == 8);
+      fclose(f);
+      if (!ok) {
+        printf("**WARNING** ThermalModelResultCache::SetDiskStore(): Cannot write to file %s\n", filename.c_str());
+        return false;
+      }
+    }
+    else {
+      char signature[8];
+      bool ok = (fread(signature, sizeof(char), 8, f) == 8 && strncmp(signature, ResultCacheSignature, 8) == 0);
+      fclose(f);
+      if (!ok) {
+        printf("**WARNING** ThermalModelResultCache::SetDiskStore(): File %s is not a result cache file\n", filename.c_str());
+        return false;
+      }
+    }
+
+    m_DiskStore = filename;
+    m_DiskScanned = 8;
+    ScanDiskStore();
+    return true;
+  }
+
+  void ThermalModelResultCache::CloseDiskStore()
+  {
+    m_DiskStore = "";
+    m_DiskIndex.clear();
+    m_DiskScanned = 0;
+  }
+
+  bool ThermalModelResultCache::Lookup(const std::vector<double>& key, ThermalModelCachedResult& result)
+  {
+    KeyHash hash = Hash(key);
+
+    map<KeyHash, EntriesList::iterator>::iterator it = m_Index.find(hash);
+    if (it != m_Index.end()) {
+      m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+      result = it->second->second;
+      ++m_Hits;
+      return true;
+    }
+
+    if (m_DiskStore != "") {
+      if (m_DiskIndex.count(hash) == 0)
+        ScanDiskStore();
+      map< KeyHash, pair<long long, long long> >::const_iterator itd = m_DiskIndex.find(hash);
+      if (itd != m_DiskIndex.end() && ReadDiskRecord(itd->second.first, itd->second.second, result)) {
+        InsertInMemory(hash, result);
+        ++m_Hits;
+        return true;
+      }
+    }
+
+    ++m_Misses;
+    return false;
+  }
+
+  void ThermalModelResultCache::Insert(const std::vector<double>& key, const ThermalModelCachedResult& result)
+  {
+    KeyHash hash = Hash(key);
+    InsertInMemory(hash, result);
+    if (m_DiskStore != "" && m_DiskIndex.count(hash) == 0)
+      AppendDiskRecord(hash, result);
+  }
+
+  ThermalModelResultCache::KeyHash ThermalModelResultCache::Hash(const std::vector<double>& key)
+  {
+    return KeyHash(HashFNV(key), HashMix(key));
+  }
+
+  void ThermalModelResultCache::InsertInMemory(const KeyHash& hash, const ThermalModelCachedResult& result)
+  {
+    if (m_Capacity <= 0)
+      return;
+
+    map<KeyHash, EntriesList::iterator>::iterator it = m_Index.find(hash);
+    if (it != m_Index.end()) {
+      it->second->second = result;
+      m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+      return;
+    }
+
+    m_Entries.push_front(make_pair(hash, result));
+    m_Index[hash] = m_Entries.begin();
+
+    if (static_cast<int>(m_Entries.size()) > m_Capacity) {
+      m_Index.erase(m_Entries.back().first);
+      m_Entries.pop_back();
+    }
+  }
+
+  void ThermalModelResultCache::ScanDiskStore()
+  {
+    if (m_DiskStore == "")
+      return;
+
+    FILE *f = fopen(m_DiskStore.c_str(), "rb");
+    if (f == NULL)
+      return;
+
+    // Read everything appended since the last scan
+    vector<char> buf;
+    bool ok = (fseek(f, 0, SEEK_END) == 0);
+    long fileend = ok ? ftell(f) : -1;
+    if (fileend > m_DiskScanned && fseek(f, static_cast<long>(m_DiskScanned), SEEK_SET) == 0) {
+      buf.resize(static_cast<size_t>(fileend - m_DiskScanned));
+      buf.resize(fread(&buf[0], sizeof(char), buf.size(), f));
+    }
+    fclose(f);
+
+    // Record: marker, two hash words, number of values, values, checksum of all the preceding fields.
+    // After a corrupted record the scan resumes at the next marker.
+    size_t pos = 0;
+    while (pos + RecordHeaderSize <= buf.size()) {
+      if (memcmp(&buf[pos], ResultCacheRecordMarker, 8) != 0) {
+        pos = FindRecordMarker(buf, pos + 1);
+        continue;
+      }
+
+      unsigned long long header[2];
+      long long size = 0;
+      memcpy(header, &buf[pos + 8], 2 * sizeof(unsigned long long));
+      memcpy(&size, &buf[pos + 8 + 2 * sizeof(unsigned long long)], sizeof(long long));
+      if (size < 0 || size > MaxRecordSize) {
+        pos = FindRecordMarker(buf, pos + 1);
+        continue;
+      }
+
+      size_t recordsize = RecordHeaderSize + static_cast<size_t>(size) * sizeof(double) + sizeof(unsigned long long);
+      if (pos + recordsize > buf.size()) {
+        // Either the record is still being written, then it is picked up by the next scan,
+        // or it is truncated and followed by other records
+        size_t next = FindRecordMarker(buf, pos + 1);
+        if (next + 8 > buf.size())
+          break;
+        pos = next;
+        continue;
+      }
+
+      unsigned long long checksum = 0;
+      memcpy(&checksum, &buf[pos + recordsize - sizeof(unsigned long long)], sizeof(unsigned long long));
+      if (checksum != HashBytes(&buf[pos], recordsize - sizeof(unsigned long long))) {
+        pos = FindRecordMarker(buf, pos + 1);
+        continue;
+      }
+
+      m_DiskIndex[KeyHash(header[0], header[1])] = make_pair(m_DiskScanned + static_cast<long long>(pos + RecordHeaderSize), size);
+      pos += recordsize;
+    }
+
+    // An incomplete record at the end of the file is left for the next scan
+    m_DiskScanned += pos;
+  }
+
+  bool ThermalModelResultCache::ReadDiskRecord(long long offset, long long size, ThermalModelCachedResult& result) const
+  {
+    FILE *f = fopen(m_DiskStore.c_str(), "rb");
+    if (f == NULL)
+      return false;
+
+    vector<double> data(static_cast<size_t>(size));
+    bool ok = (fseek(f, static_cast<long>(offset), SEEK_SET) == 0);
+    ok = ok && (size == 0 || fread(&data[0], sizeof(double), data.size(), f) == data.size());
+    fclose(f);
+
+    return ok && DeserializeResult(data, result);
+  }
+
+  void ThermalModelResultCache::AppendDiskRecord(const KeyHash& hash, const ThermalModelCachedResult& result)
+  {
+    vector<double> data = SerializeResult(result);
+    long long size = data.size();
+
+    // The record is written with a single call, so that records appended
+    // concurrently by different processes do not interleave
+    vector<char> buffer(RecordHeaderSize + size * sizeof(double) + sizeof(unsigned long long));
+    char *ptr = &buffer[0];
+    memcpy(ptr, ResultCacheRecordMarker, 8); ptr += 8;
+    memcpy(ptr, &hash.first, sizeof(unsigned long long)); ptr += sizeof(unsigned long long);
+    memcpy(ptr, &hash.second, sizeof(unsigned long long)); ptr += sizeof(unsigned long long);
+    memcpy(ptr, &size, sizeof(long long)); ptr += sizeof(long long);
+    if (size > 0)
+      memcpy(ptr, &data[0], size * sizeof(double));
+    ptr += size * sizeof(double);
+    unsigned long long checksum = HashBytes(&buffer[0], ptr - &buffer[0]);
+    memcpy(ptr, &checksum, sizeof(unsigned long long));
+
+    FILE *f = fopen(m_DiskStore.c_str(), "ab");
+    if (f == NULL) {
+      printf("**WARNING** ThermalModelResultCache::AppendDiskRecord(): Cannot write to file %s\n", m_DiskStore.c_str());
+      return;
+    }
+    if (fwrite(&buffer[0], sizeof(char), buffer.size(), f) != buffer.size())
+      printf("**WARNING** ThermalModelResultCache::AppendDiskRecord(): Cannot write to file %s\n", m_DiskStore.c_str());
+    fclose(f);
+  }
+
+} // namespace thermalfist
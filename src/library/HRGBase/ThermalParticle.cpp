@@ -43,6 +43,7 @@ namespace thermalfist {
 
     m_DecayType = ParticleDecayType::Default;
 
+    m_wwidthsum = 0.;
     FillCoefficients();
 
     SetAbsoluteQuark(GetAbsQ());
@@ -64,10 +65,9 @@ namespace thermalfist {
   void ThermalParticle::SetResonanceWidth(double width)
   {
     m_Width = width;
-    if (m_Width != 0.0) {
+    if (m_Width != 0.0)
       FillCoefficients();
-      FillCoefficientsDynamical();
-    }
+    FillCoefficientsDynamical();
   }
 
   void ThermalParticle::SetDecayThresholdMass(double threshold)
@@ -101,6 +101,7 @@ namespace thermalfist {
     if (shape != m_ResonanceWidthShape) {
       m_ResonanceWidthShape = shape;
       FillCoefficientsDynamical();
+      FillWidthIntegrationTable();
     }
   }
 
@@ -172,10 +173,12 @@ namespace thermalfist {
         m_Decays[j].mBratioAverage = 0.;
       }
 
+      IdealGasFunctions::IdealGasQuantityKernel kernel = IdealGasFunctions::GetIdealGasQuantityKernel(IdealGasFunctions::ParticleDensity, m_QuantumStatisticsCalculationType, m_Statistics);
+
       double ret1 = 0., ret2 = 0., tmp = 0.;
       for (size_t i = 0; i < m_xalldyn.size(); i++) {
         tmp = m_walldyn[i];
-        double dens = IdealGasFunctions::IdealGasQuantity(IdealGasFunctions::ParticleDensity, m_QuantumStatisticsCalculationType, m_Statistics, params.T, mu, m_xalldyn[i], m_Degeneracy, m_ClusterExpansionOrder);
+        double dens = kernel(params.T, mu, m_xalldyn[i], m_Degeneracy, m_ClusterExpansionOrder);
         ret1 += tmp * dens;
         ret2 += tmp;
 
@@ -337,11 +340,21 @@ namespace thermalfist {
     // New version
     NumericalIntegration::GetCoefsIntegrateLegendre32(0., 1., &m_xleg32, &m_wleg32);
     NumericalIntegration::GetCoefsIntegrateLaguerre32(&m_xlag32, &m_wlag32);
+
+    FillWidthIntegrationTable();
   }
 
   // Mass-dependent widths
   void ThermalParticle::FillCoefficientsDynamical() {
-    if (m_Width == 0.0) return;
+    if (m_Width == 0.0) {
+      // Nothing to integrate over, discard the tables of a previous non-zero width
+      m_xlegdyn.clear(); m_wlegdyn.clear(); m_vallegdyn.clear();
+      m_xlegpdyn.clear(); m_wlegpdyn.clear(); m_vallegpdyn.clear();
+      m_xlagdyn.clear(); m_wlagdyn.clear(); m_vallagdyn.clear();
+      m_xalldyn.clear(); m_walldyn.clear(); m_densalldyn.clear();
+      FillWidthIntegrationTable();
+      return;
+    }
 
     double a, b;
 
@@ -505,6 +518,54 @@ namespace thermalfist {
     //   fclose(f);
     // }
 
+    FillWidthIntegrationTable();
+  }
+
+  void ThermalParticle::FillWidthIntegrationTable()
+  {
+    m_xwidth.resize(0);
+    m_wwidth.resize(0);
+
+    if (m_ResonanceWidthIntegrationType == eBW || m_ResonanceWidthIntegrationType == eBWconstBR) {
+      m_xwidth = m_xalldyn;
+      m_wwidth = m_walldyn;
+    }
+    else {
+      // Integration from m0 or M-2*Gamma to M+2*Gamma
+      for (size_t i = 0; i < m_xleg.size(); i++) {
+        double tmp = m_wleg[i] * MassDistribution(m_xleg[i]);
+        if (m_ResonanceWidthIntegrationType == FullIntervalWeighted)
+          tmp *= m_brweight[i];
+        m_xwidth.push_back(m_xleg[i]);
+        m_wwidth.push_back(tmp);
+      }
+
+      // Integration from M+2*Gamma to infinity
+      if (m_ResonanceWidthIntegrationType == FullInterval || m_ResonanceWidthIntegrationType == FullIntervalWeighted) {
+        for (size_t i = 0; i < m_xlag32.size(); ++i) {
+          double tmass = m_Mass + 2.*m_Width + m_xlag32[i] * m_Width;
+          m_xwidth.push_back(tmass);
+          m_wwidth.push_back(m_wlag32[i] * m_Width * MassDistribution(tmass));
+        }
+      }
+    }
+
+    m_wwidthsum = 0.;
+    for (size_t i = 0; i < m_wwidth.size(); ++i)
+      m_wwidthsum += m_wwidth[i];
+  }
+
+  double ThermalParticle::IntegrateOverWidth(IdealGasFunctions::IdealGasQuantityKernel kernel, double T, double mu, int order) const
+  {
+    if (kernel == NULL) {
+      printf("**WARNING** ThermalParticle::IntegrateOverWidth: Unknown quantity or statistics\n");
+      return 0.;
+    }
+
+    double ret = 0.;
+    for (size_t i = 0; i < m_xwidth.size(); i++)
+      ret += m_wwidth[i] * kernel(T, mu, m_xwidth[i], m_Degeneracy, order);
+    return ret / m_wwidthsum;
   }
 
   double ThermalParticle::TotalWidtheBW(double M) const
@@ -601,49 +662,8 @@ namespace thermalfist {
       return IdealGasFunctions::IdealGasQuantity(type, m_QuantumStatisticsCalculationType, m_Statistics, params.T, mu, m_Mass, m_Degeneracy, m_ClusterExpansionOrder);
     }
 
-    int ind = m_xleg.size();
-    const vector<double> &x = m_xleg, &w = m_wleg;
-    double ret1 = 0., ret2 = 0., tmp = 0.;
-
-    // Integration from m0 or M-2*Gamma to M+2*Gamma
-    if (m_ResonanceWidthIntegrationType != eBW && m_ResonanceWidthIntegrationType != eBWconstBR) {
-      for (int i = 0; i < ind; i++) {
-
-        tmp = w[i] * MassDistribution(x[i]);
-
-        if (m_ResonanceWidthIntegrationType == FullIntervalWeighted)
-          tmp *= m_brweight[i];
-
-        double dens = IdealGasFunctions::IdealGasQuantity(type, m_QuantumStatisticsCalculationType, m_Statistics, params.T, mu, x[i], m_Degeneracy, m_ClusterExpansionOrder);
-
-        ret1 += tmp * dens;
-        ret2 += tmp;
-      }
-    }
-
-    // Integration from M+2*Gamma to infinity
-    if (m_ResonanceWidthIntegrationType == FullInterval || m_ResonanceWidthIntegrationType == FullIntervalWeighted) {
-      int ind2 = m_xlag32.size();
-      for (int i = 0; i < ind2; ++i) {
-        double tmass = m_Mass + 2.*m_Width + m_xlag32[i] * m_Width;
-        tmp = m_wlag32[i] * m_Width * MassDistribution(tmass);
-        double dens = IdealGasFunctions::IdealGasQuantity(type, m_QuantumStatisticsCalculationType, m_Statistics, params.T, mu, tmass, m_Degeneracy, m_ClusterExpansionOrder);
-
-        ret1 += tmp * dens;
-        ret2 += tmp;
-      }
-    }
-
-    if (m_ResonanceWidthIntegrationType == eBW || m_ResonanceWidthIntegrationType == eBWconstBR) {
-      for (size_t i = 0; i < m_xalldyn.size(); i++) {
-        tmp = m_walldyn[i];
-        double dens = IdealGasFunctions::IdealGasQuantity(type, m_QuantumStatisticsCalculationType, m_Statistics, params.T, mu, m_xalldyn[i], m_Degeneracy, m_ClusterExpansionOrder);
-        ret1 += tmp * dens;
-        ret2 += tmp;
-      }
-    }
 
-    return ret1 / ret2;
+    return IntegrateOverWidth(IdealGasFunctions::GetIdealGasQuantityKernel(type, m_QuantumStatisticsCalculationType, m_Statistics), params.T, mu, m_ClusterExpansionOrder);
   }
 
   double ThermalParticle::DensityCluster(int n, const ThermalModelParameters & params, IdealGasFunctions::Quantity type, bool useWidth, double mu) const
@@ -661,48 +681,30 @@ namespace thermalfist {
       return mn * IdealGasFunctions::IdealGasQuantity(type, m_QuantumStatisticsCalculationType, 0, params.T / static_cast<double>(n), mu, m_Mass, m_Degeneracy);
     }
 
-    int ind = m_xleg.size();
-    const vector<double> &x = m_xleg, &w = m_wleg;
-    double ret1 = 0., ret2 = 0., tmp = 0.;
-
-    // Integration from m0 or M-2*Gamma to M+2*Gamma
-    if (m_ResonanceWidthIntegrationType != eBW && m_ResonanceWidthIntegrationType != eBWconstBR) {
-      for (int i = 0; i < ind; i++) {
-        tmp = w[i] * MassDistribution(x[i]);
-
-        if (m_ResonanceWidthIntegrationType == FullIntervalWeighted)
-          tmp *= m_brweight[i];
-
-        double dens = IdealGasFunctions::IdealGasQuantity(type, m_QuantumStatisticsCalculationType, 0, params.T / static_cast<double>(n), mu, x[i], m_Degeneracy);
+    return mn * IntegrateOverWidth(IdealGasFunctions::GetIdealGasQuantityKernel(type, m_QuantumStatisticsCalculationType, 0), params.T / static_cast<double>(n), mu, 1);
+  }
 
-        ret1 += tmp * dens;
-        ret2 += tmp;
-      }
-    }
+  void ThermalParticle::ClusterExpansionTerms(const ThermalModelParameters & params, std::vector<IdealGasFunctions::IdealGasQuantities>& terms, bool useWidth, double mu) const
+  {
+    // Same sign convention as in DensityCluster()
+    int statistics = (abs(BaryonCharge()) & 1) ? 1 : -1;
 
-    // Integration from M+2*Gamma to infinity
-    if (m_ResonanceWidthIntegrationType == FullInterval || m_ResonanceWidthIntegrationType == FullIntervalWeighted) {
-      int ind2 = m_xlag32.size();
-      for (int i = 0; i < ind2; ++i) {
-        double tmass = m_Mass + 2.*m_Width + m_xlag32[i] * m_Width;
-        tmp = m_wlag32[i] * m_Width * MassDistribution(tmass);
-        double dens = IdealGasFunctions::IdealGasQuantity(type, m_QuantumStatisticsCalculationType, 0, params.T / static_cast<double>(n), mu, tmass, m_Degeneracy);
+    if (!(params.gammaq == 1.))                  mu += log(params.gammaq) * m_AbsQuark /*GetAbsQ()*/  * params.T;
+    if (!(params.gammaS == 1. || m_AbsS == 0.))  mu += log(params.gammaS) * m_AbsS     * params.T;
+    if (!(params.gammaC == 1. || m_AbsC == 0.))  mu += log(params.gammaC) * m_AbsC     * params.T;
 
-        ret1 += tmp * dens;
-        ret2 += tmp;
-      }
+    if (!useWidth || ZeroWidthEnforced() || m_ResonanceWidthIntegrationType == ZeroWidth) {
+      IdealGasFunctions::QuantumClusterExpansionQuantities(statistics, params.T, mu, m_Mass, m_Degeneracy, m_ClusterExpansionOrder, &terms);
+      return;
     }
 
-    if (m_ResonanceWidthIntegrationType == eBW || m_ResonanceWidthIntegrationType == eBWconstBR) {
-      for (size_t i = 0; i < m_xalldyn.size(); i++) {
-        tmp = m_walldyn[i];
-        double dens = IdealGasFunctions::IdealGasQuantity(type, m_QuantumStatisticsCalculationType, 0, params.T / static_cast<double>(n), mu, m_xalldyn[i], m_Degeneracy);
-        ret1 += tmp * dens;
-        ret2 += tmp;
-      }
+    terms.assign(m_ClusterExpansionOrder > 0 ? m_ClusterExpansionOrder : 0, IdealGasFunctions::IdealGasQuantities());
+    vector<IdealGasFunctions::IdealGasQuantities> termsM;
+    for (size_t i = 0; i < m_xwidth.size(); i++) {
+      IdealGasFunctions::QuantumClusterExpansionQuantities(statistics, params.T, mu, m_xwidth[i], m_Degeneracy, m_ClusterExpansionOrder, &termsM);
+      for (size_t n = 0; n < terms.size(); ++n)
+        terms[n].Add(termsM[n], m_wwidth[i] / m_wwidthsum);
     }
-
-    return mn * ret1 / ret2;
   }
 
 
@@ -770,7 +772,35 @@ namespace thermalfist {
     if (index == 2) return Density(params, IdealGasFunctions::chi2, useWidth, mu);
     if (index == 3) return Density(params, IdealGasFunctions::chi3, useWidth, mu);
     if (index == 4) return Density(params, IdealGasFunctions::chi4, useWidth, mu);
+    if (index > 4) return chis(index, params, useWidth, mu)[index - 1];
     return 1.;
   }
 
+  std::vector<double> ThermalParticle::chis(int N, const ThermalModelParameters & params, bool useWidth, double mu) const
+  {
+    if (!(params.gammaq == 1.))                  mu += log(params.gammaq) * m_AbsQuark * params.T;
+    if (!(params.gammaS == 1. || m_AbsS == 0.))  mu += log(params.gammaS) * m_AbsS     * params.T;
+    if (!(params.gammaC == 1. || m_AbsC == 0.))  mu += log(params.gammaC) * m_AbsC     * params.T;
+
+    vector<double> ret;
+    if (!useWidth || m_Mass == 0.0 || ZeroWidthEnforced() || m_ResonanceWidthIntegrationType == ZeroWidth) {
+      IdealGasFunctions::IdealGasSusceptibilities(N, m_QuantumStatisticsCalculationType, m_Statistics, params.T, mu, m_Mass, m_Degeneracy, ret, m_ClusterExpansionOrder);
+      return ret;
+    }
+
+    // Mass points and weights as in Density()
+    ret.assign(N > 0 ? N : 0, 0.);
+    vector<double> tchis;
+    for (size_t i = 0; i < m_xwidth.size(); ++i) {
+      IdealGasFunctions::IdealGasSusceptibilities(N, m_QuantumStatisticsCalculationType, m_Statistics, params.T, mu, m_xwidth[i], m_Degeneracy, tchis, m_ClusterExpansionOrder);
+      for (int n = 0; n < N; ++n)
+        ret[n] += m_wwidth[i] * tchis[n];
+    }
+
+    for (int n = 0; n < N; ++n)
+      ret[n] /= m_wwidthsum;
+
+    return ret;
+  }
+
 } // namespace thermalfist
\ No newline at end of file
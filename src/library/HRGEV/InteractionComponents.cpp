@@ -0,0 +1,187 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2016-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include "HRGEV/InteractionComponents.h"
+
+#include <map>
+
+#include <Eigen/Dense>
+
+using namespace Eigen;
+
+using namespace std;
+
+namespace thermalfist {
+
+  InteractionComponents::InteractionComponents(const vector< vector<double> >& b, const vector< vector<double> >& a)
+  {
+    int NN = b.size();
+    bool attr = (static_cast<int>(a.size()) == NN);
+
+    m_ComponentOf.resize(NN);
+    m_Members.clear();
+
+    map< vector<double>, int > components;
+    vector<double> key(attr ? 2 * NN : NN);
+    for (int i = 0; i < NN; ++i) {
+      for (int j = 0; j < NN; ++j) {
+        key[j] = b[i][j];
+        if (attr)
+          key[NN + j] = a[i][j] + a[j][i];
+      }
+
+      map< vector<double>, int >::const_iterator it = components.find(key);
+      if (it == components.end()) {
+        int k = m_Members.size();
+        components[key] = k;
+        m_ComponentOf[i] = k;
+        m_Members.push_back(vector<int>(1, i));
+      }
+      else {
+        m_ComponentOf[i] = it->second;
+        m_Members[it->second].push_back(i);
+      }
+    }
+  }
+
+  std::vector<int> InteractionComponents::Representatives() const
+  {
+    vector<int> ret(m_Members.size());
+    for (size_t k = 0; k < m_Members.size(); ++k)
+      ret[k] = m_Members[k][0];
+    return ret;
+  }
+
+  struct InteractionResponseSolver::Decomposition {
+    typedef Matrix<double, Dynamic, Dynamic, RowMajor> RowMatrix;
+    PartialPivLU<MatrixXd> lu;
+    RowMatrix Bk;   // Representative rows of b, K x N
+    RowMatrix Ak;   // Representative rows of a + a^T, K x N
+  };
+
+  InteractionResponseSolver::InteractionResponseSolver(const InteractionComponents& components,
+    const vector< vector<double> >& b,
+    const vector< vector<double> >& a,
+    const vector<double>& nid,
+    const vector<double>& c) :
+    m_Components(components), m_nid(nid), m_c(c), m_Decomposition(new Decomposition)
+  {
+    int NN = nid.size();
+    bool attr = (static_cast<int>(a.size()) == NN);
+    m_Reduced = components.IsReducible();
+
+    if (!m_Reduced) {
+      MatrixXd densMatrix(2 * NN, 2 * NN);
+      for (int i = 0; i < NN; ++i)
+        for (int j = 0; j < NN; ++j) {
+          densMatrix(i, j) = b[j][i] * nid[i] + static_cast<double>(i == j);
+          densMatrix(i, NN + j) = (i == j) ? c[i] : 0.;
+          densMatrix(NN + i, j) = attr ? -(a[i][j] + a[j][i]) : 0.;
+          densMatrix(NN + i, NN + j) = b[i][j] * nid[j] + static_cast<double>(i == j);
+        }
+      m_Decomposition->lu = PartialPivLU<MatrixXd>(densMatrix);
+      return;
+    }
+
+    // Woodbury reduction: the unknowns are the component sums of dn
+    // and the component shifts of dmu, see Solve()
+    int KK = components.ComponentsNumber();
+    Decomposition::RowMatrix &Bk = m_Decomposition->Bk, &Ak = m_Decomposition->Ak;
+    Bk.resize(KK, NN);
+    Ak = Decomposition::RowMatrix::Zero(KK, NN);
+    for (int k = 0; k < KK; ++k) {
+      int r = components.Representative(k);
+      for (int j = 0; j < NN; ++j) {
+        Bk(k, j) = b[r][j];
+        if (attr)
+          Ak(k, j) = a[r][j] + a[j][r];
+      }
+    }
+
+    MatrixXd redMatrix = MatrixXd::Zero(2 * KK, 2 * KK);
+    for (int k = 0; k < KK; ++k) {
+      redMatrix(k, k) += 1.;
+      redMatrix(KK + k, KK + k) += 1.;
+    }
+    for (int i = 0; i < NN; ++i) {
+      int ki = components.Component(i);
+      for (int l = 0; l < KK; ++l) {
+        redMatrix(ki, l) += nid[i] * Bk(l, i);
+        redMatrix(KK + l, KK + ki) += Ak(l, i) * c[i] + Bk(l, i) * nid[i];
+      }
+      redMatrix(ki, KK + ki) += c[i];
+    }
+    if (attr) {
+      for (int k = 0; k < KK; ++k)
+        for (int l = 0; l < KK; ++l) {
+          double tmp = 0.;
+          for (int i = 0; i < NN; ++i)
+            tmp += Ak(k, i) * nid[i] * Bk(l, i);
+          redMatrix(KK + k, l) = tmp;
+        }
+    }
+
+    m_Decomposition->lu = PartialPivLU<MatrixXd>(redMatrix);
+  }
+
+  InteractionResponseSolver::~InteractionResponseSolver()
+  {
+    delete m_Decomposition;
+  }
+
+  void InteractionResponseSolver::Solve(const vector<double>& x, const vector<double>& y,
+    vector<double>& dn, vector<double>& dmu) const
+  {
+    int NN = m_nid.size();
+    dn.resize(NN);
+    dmu.resize(NN);
+
+    if (!m_Reduced) {
+      VectorXd xVector(2 * NN);
+      for (int i = 0; i < NN; ++i) {
+        xVector[i] = x[i];
+        xVector[NN + i] = y[i];
+      }
+      VectorXd solVector = m_Decomposition->lu.solve(xVector);
+      for (int i = 0; i < NN; ++i) {
+        dn[i] = solVector[i];
+        dmu[i] = solVector[NN + i];
+      }
+      return;
+    }
+
+    // With u = x - c y the solution reads
+    // dmu_i = y_i + delta_{k(i)},
+    // dn_i  = u_i - c_i delta_{k(i)} - nid_i sum_k b_{k i} alpha_k,
+    // where alpha_k is the sum of dn_i over the k-th component
+    const Decomposition::RowMatrix &Bk = m_Decomposition->Bk, &Ak = m_Decomposition->Ak;
+    int KK = Bk.rows();
+    VectorXd xVector = VectorXd::Zero(2 * KK);
+    vector<double> u(NN);
+    for (int i = 0; i < NN; ++i) {
+      u[i] = x[i] - m_c[i] * y[i];
+      xVector[m_Components.Component(i)] += u[i];
+    }
+    for (int k = 0; k < KK; ++k) {
+      double tmp = 0.;
+      for (int i = 0; i < NN; ++i)
+        tmp += Ak(k, i) * u[i] - Bk(k, i) * m_nid[i] * y[i];
+      xVector[KK + k] = tmp;
+    }
+
+    VectorXd solVector = m_Decomposition->lu.solve(xVector);
+
+    for (int i = 0; i < NN; ++i) {
+      dmu[i] = y[i] + solVector[KK + m_Components.Component(i)];
+      double tmp = 0.;
+      for (int k = 0; k < KK; ++k)
+        tmp += Bk(k, i) * solVector[k];
+      dn[i] = x[i] - m_c[i] * dmu[i] - m_nid[i] * tmp;
+    }
+  }
+
+} // namespace thermalfist
@@ -0,0 +1,285 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2020 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include "HRGEV/InteractionParametersIO.h"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+#include "HRGBase/ThermalParticleSystem.h"
+
+using namespace std;
+
+namespace thermalfist {
+
+  namespace InteractionParametersIO {
+
+    namespace {
+
+      const char Magic[8] = { 'T', 'F', 'I', 'S', 'T', 'I', 'P', '\0' };
+      const unsigned int ByteOrderMark = 0x01020304u;
+      const unsigned int FormatVersion = 1;
+
+      enum Layout { SparseLayout = 0, BlockLayout = 1 };
+
+      /// Fixed-size header of the binary file
+      struct FileHeader {
+        char magic[8];
+        unsigned int byteorder;
+        unsigned int version;
+        unsigned int layout;
+        unsigned int nmatrices;     // 1 -- b only, 2 -- b and a
+        long long n1;               // sparse: number of pairs, block: number of species
+        long long n2;               // block: number of classes
+      };
+
+      bool IsAllZero(const vector< vector<double> > *mat)
+      {
+        if (mat == NULL)
+          return true;
+        for (size_t i = 0; i < mat->size(); ++i)
+          for (size_t j = 0; j < (*mat)[i].size(); ++j)
+            if ((*mat)[i][j] != 0.)
+              return false;
+        return true;
+      }
+
+      template<typename T>
+      void Append(vector<char> &buf, const T &val)
+      {
+        const char *p = reinterpret_cast<const char*>(&val);
+        buf.insert(buf.end(), p, p + sizeof(T));
+      }
+
+      template<typename T>
+      T Extract(const char *&p)
+      {
+        T ret;
+        memcpy(&ret, p, sizeof(T));
+        p += sizeof(T);
+        return ret;
+      }
+    }
+
+    bool IsBinaryFile(const std::string &filename)
+    {
+      FILE *f = fopen(filename.c_str(), "rb");
+      if (f == NULL)
+        return false;
+      char magic[sizeof(Magic)];
+      bool ret = (fread(magic, 1, sizeof(magic), f) == sizeof(magic) && memcmp(magic, Magic, sizeof(Magic)) == 0);
+      fclose(f);
+      return ret;
+    }
+
+    bool ReadBinary(const std::string &filename, ThermalParticleSystem *TPS,
+      std::vector< std::vector<double> > &b,
+      std::vector< std::vector<double> > *a)
+    {
+      int N = TPS->ComponentsNumber();
+      b = vector< vector<double> >(N, vector<double>(N, 0.));
+      if (a != NULL)
+        *a = vector< vector<double> >(N, vector<double>(N, 0.));
+
+      FILE *f = fopen(filename.c_str(), "rb");
+      if (f == NULL) {
+        printf("**WARNING** InteractionParametersIO::ReadBinary: Cannot open file %s\n", filename.c_str());
+        return false;
+      }
+      fseek(f, 0, SEEK_END);
+      long size = ftell(f);
+      fseek(f, 0, SEEK_SET);
+      vector<char> buf(size > 0 ? size : 0);
+      bool readok = (size >= static_cast<long>(sizeof(FileHeader)) && fread(&buf[0], 1, buf.size(), f) == buf.size());
+      fclose(f);
+
+      FileHeader header;
+      if (readok)
+        memcpy(&header, &buf[0], sizeof(FileHeader));
+      if (!readok || memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+        printf("**WARNING** InteractionParametersIO::ReadBinary: %s is not a binary interaction parameters file\n", filename.c_str());
+        return false;
+      }
+      if (header.byteorder != ByteOrderMark || header.version != FormatVersion
+        || (header.layout != SparseLayout && header.layout != BlockLayout)
+        || header.nmatrices < 1 || header.nmatrices > 2 || header.n1 < 0 || header.n2 < 0) {
+        printf("**WARNING** InteractionParametersIO::ReadBinary: Unsupported version or byte order of file %s\n", filename.c_str());
+        return false;
+      }
+
+      long long nm = header.nmatrices;
+      long long expected = sizeof(FileHeader);
+      if (header.layout == SparseLayout)
+        expected += header.n1 * (2 * sizeof(long long) + nm * sizeof(double));
+      else
+        expected += header.n1 * 2 * sizeof(long long) + nm * header.n2 * header.n2 * sizeof(double);
+      if (expected != static_cast<long long>(buf.size())) {
+        printf("**WARNING** InteractionParametersIO::ReadBinary: File %s is truncated or corrupt\n", filename.c_str());
+        return false;
+      }
+
+      const char *p = &buf[0] + sizeof(FileHeader);
+      if (header.layout == SparseLayout) {
+        for (long long k = 0; k < header.n1; ++k) {
+          int ind1 = TPS->PdgToId(Extract<long long>(p));
+          int ind2 = TPS->PdgToId(Extract<long long>(p));
+          double tb = Extract<double>(p);
+          double ta = (nm > 1) ? Extract<double>(p) : 0.;
+          if (ind1 != -1 && ind2 != -1) {
+            b[ind1][ind2] = tb;
+            if (a != NULL)
+              (*a)[ind1][ind2] = ta;
+          }
+        }
+      }
+      else {
+        long long K = header.n2;
+        vector<int> ids(header.n1);
+        vector<long long> classes(header.n1);
+        for (long long k = 0; k < header.n1; ++k) {
+          ids[k] = TPS->PdgToId(Extract<long long>(p));
+          classes[k] = Extract<long long>(p);
+          if (classes[k] < 0 || classes[k] >= K) {
+            printf("**WARNING** InteractionParametersIO::ReadBinary: File %s is truncated or corrupt\n", filename.c_str());
+            return false;
+          }
+        }
+        vector<double> blocks(nm * K * K);
+        if (!blocks.empty())
+          memcpy(&blocks[0], p, blocks.size() * sizeof(double));
+        const double *bK = blocks.empty() ? NULL : &blocks[0];
+        const double *aK = blocks.empty() ? NULL : bK + K * K;
+        for (long long k1 = 0; k1 < header.n1; ++k1) {
+          if (ids[k1] == -1)
+            continue;
+          for (long long k2 = 0; k2 < header.n1; ++k2) {
+            if (ids[k2] == -1)
+              continue;
+            long long ind = classes[k1] * K + classes[k2];
+            b[ids[k1]][ids[k2]] = bK[ind];
+            if (a != NULL && nm > 1)
+              (*a)[ids[k1]][ids[k2]] = aK[ind];
+          }
+        }
+      }
+
+      return true;
+    }
+
+    bool WriteBinary(const std::string &filename, ThermalParticleSystem *TPS,
+      const std::vector< std::vector<double> > &b,
+      const std::vector< std::vector<double> > *a)
+    {
+      int N = TPS->ComponentsNumber();
+      if (static_cast<int>(b.size()) != N || (a != NULL && static_cast<int>(a->size()) != N)) {
+        printf("**WARNING** InteractionParametersIO::WriteBinary: Size of the parameter matrices does not match the particle list\n");
+        return false;
+      }
+
+      bool attr = !IsAllZero(a);
+      long long nm = attr ? 2 : 1;
+
+      // Non-zero pairs for the sparse layout
+      vector< pair<int, int> > pairs;
+      for (int i = 0; i < N; ++i)
+        for (int j = 0; j < N; ++j)
+          if (b[i][j] != 0. || (attr && (*a)[i][j] != 0.))
+            pairs.push_back(make_pair(i, j));
+
+      // Classes of the interacting species with identical rows and columns for the block layout
+      vector<int> species, classes, representatives;
+      map< vector<double>, int > classmap;
+      vector<double> key((attr ? 4 : 2) * N);
+      for (int i = 0; i < N; ++i) {
+        bool interacting = false;
+        for (int j = 0; j < N; ++j) {
+          key[j] = b[i][j];
+          key[N + j] = b[j][i];
+          if (attr) {
+            key[2 * N + j] = (*a)[i][j];
+            key[3 * N + j] = (*a)[j][i];
+          }
+        }
+        for (size_t k = 0; k < key.size(); ++k)
+          interacting |= (key[k] != 0.);
+        if (!interacting)
+          continue;
+
+        map< vector<double>, int >::const_iterator it = classmap.find(key);
+        int cl = 0;
+        if (it == classmap.end()) {
+          cl = representatives.size();
+          classmap[key] = cl;
+          representatives.push_back(i);
+        }
+        else {
+          cl = it->second;
+        }
+        species.push_back(i);
+        classes.push_back(cl);
+      }
+      long long K = representatives.size();
+
+      long long sparsesize = static_cast<long long>(pairs.size()) * (2 * sizeof(long long) + nm * sizeof(double));
+      long long blocksize = static_cast<long long>(species.size()) * 2 * sizeof(long long) + nm * K * K * sizeof(double);
+
+      FileHeader header;
+      memcpy(header.magic, Magic, sizeof(Magic));
+      header.byteorder = ByteOrderMark;
+      header.version = FormatVersion;
+      header.nmatrices = nm;
+
+      vector<char> buf;
+      if (sparsesize <= blocksize) {
+        header.layout = SparseLayout;
+        header.n1 = pairs.size();
+        header.n2 = 0;
+        buf.reserve(sizeof(FileHeader) + sparsesize);
+        Append(buf, header);
+        for (size_t k = 0; k < pairs.size(); ++k) {
+          int i = pairs[k].first, j = pairs[k].second;
+          Append(buf, TPS->Particle(i).PdgId());
+          Append(buf, TPS->Particle(j).PdgId());
+          Append(buf, b[i][j]);
+          if (attr)
+            Append(buf, (*a)[i][j]);
+        }
+      }
+      else {
+        header.layout = BlockLayout;
+        header.n1 = species.size();
+        header.n2 = K;
+        buf.reserve(sizeof(FileHeader) + blocksize);
+        Append(buf, header);
+        for (size_t k = 0; k < species.size(); ++k) {
+          Append(buf, TPS->Particle(species[k]).PdgId());
+          Append(buf, static_cast<long long>(classes[k]));
+        }
+        for (long long k1 = 0; k1 < K; ++k1)
+          for (long long k2 = 0; k2 < K; ++k2)
+            Append(buf, b[representatives[k1]][representatives[k2]]);
+        if (attr) {
+          for (long long k1 = 0; k1 < K; ++k1)
+            for (long long k2 = 0; k2 < K; ++k2)
+              Append(buf, (*a)[representatives[k1]][representatives[k2]]);
+        }
+      }
+
+      FILE *f = fopen(filename.c_str(), "wb");
+      if (f == NULL) {
+        printf("**WARNING** InteractionParametersIO::WriteBinary: Cannot open file %s for writing\n", filename.c_str());
+        return false;
+      }
+      bool ret = (fwrite(&buf[0], 1, buf.size(), f) == buf.size());
+      fclose(f);
+      return ret;
+    }
+
+  } // namespace InteractionParametersIO
+
+} // namespace thermalfist
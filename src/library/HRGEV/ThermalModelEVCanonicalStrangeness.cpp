@@ -35,6 +35,16 @@ namespace thermalfist {
     ClearModelEV();
   }
 
+  ThermalModelEVCanonicalStrangeness* ThermalModelEVCanonicalStrangeness::Clone(ThermalParticleSystem* TPS) const
+  {
+    ThermalModelEVCanonicalStrangeness *ret = new ThermalModelEVCanonicalStrangeness(*this);
+    // The auxiliary model owned by the original is recreated when needed
+    ret->m_modelEV = NULL;
+
+    FinalizeClone(ret, TPS);
+    return ret;
+  }
+
   void ThermalModelEVCanonicalStrangeness::CalculateDensitiesGCE() {
     if (m_modelEV == NULL)
       PrepareModelEV();
@@ -236,7 +246,7 @@ namespace thermalfist {
       if (elems.size() < 1)
         continue;
       istringstream iss(elems[0]);
-      int pdgid;
+      long long pdgid;
       double b;
       if (iss >> pdgid >> b) {
         int ind = m_TPS->PdgToId(pdgid);
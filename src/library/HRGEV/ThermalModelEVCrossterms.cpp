@@ -21,6 +21,8 @@
 
 #include "HRGBase/xMath.h"
 #include "HRGEV/ExcludedVolumeHelper.h"
+#include "HRGEV/InteractionComponents.h"
+#include "HRGEV/InteractionParametersIO.h"
 
 #include <Eigen/Dense>
 
@@ -30,6 +32,50 @@ using namespace std;
 
 namespace thermalfist {
 
+  namespace {
+    /**
+     * Returns the K x N matrix H = E^{-1} b^K, where b^K are the representative rows
+     * of the excluded volume matrix and E_kl = delta_kl + sum_{i in l} b_ki tN_i.
+     * By the Woodbury identity, b (1 + diag(tN) b)^{-1} = P H, with P the N x K indicator
+     * matrix of the components, thus the solution of the linear systems for the
+     * densities and their derivatives only requires the factorization of E.
+     */
+    MatrixXd PartialPressureResponse(const InteractionComponents& components,
+      const vector< vector<double> >& b,
+      const vector<double>& tN)
+    {
+      int NN = tN.size(), KK = components.ComponentsNumber();
+      MatrixXd Bk(KK, NN);
+      for (int k = 0; k < KK; ++k)
+        for (int j = 0; j < NN; ++j)
+          Bk(k, j) = b[components.Representative(k)][j];
+
+      MatrixXd E = MatrixXd::Identity(KK, KK);
+      for (int k = 0; k < KK; ++k)
+        for (int i = 0; i < NN; ++i)
+          E(k, components.Component(i)) += Bk(k, i) * tN[i];
+
+      return E.partialPivLu().solve(Bk);
+    }
+
+    /// Returns w = (1 + b^T diag(tN))^{-1} 1, i.e. w_i = 1 - sum_k H_ki sum_{j in k} tN_j
+    vector<double> PartialPressureWeights(const InteractionComponents& components,
+      const MatrixXd& response,
+      const vector<double>& tN)
+    {
+      int NN = tN.size(), KK = components.ComponentsNumber();
+      vector<double> sums(KK, 0.);
+      for (int i = 0; i < NN; ++i)
+        sums[components.Component(i)] += tN[i];
+
+      vector<double> ret(NN, 1.);
+      for (int i = 0; i < NN; ++i)
+        for (int k = 0; k < KK; ++k)
+          ret[i] -= sums[k] * response(k, i);
+      return ret;
+    }
+  }
+
   ThermalModelEVCrossterms::ThermalModelEVCrossterms(ThermalParticleSystem *TPS, const ThermalModelParameters& params) :
     ThermalModelBase(TPS, params)
   {
@@ -47,11 +93,19 @@ namespace thermalfist {
   {
   }
 
+  ThermalModelEVCrossterms* ThermalModelEVCrossterms::Clone(ThermalParticleSystem* TPS) const
+  {
+    ThermalModelEVCrossterms *ret = new ThermalModelEVCrossterms(*this);
+    FinalizeClone(ret, TPS);
+    return ret;
+  }
+
   void ThermalModelEVCrossterms::FillVirial(const std::vector<double> & ri) {
     if (ri.size() != m_TPS->Particles().size()) {
       printf("**WARNING** %s::FillVirial(const std::vector<double> & ri): size %d of ri does not match number of hadrons %d in the list", m_TAG.c_str(), static_cast<int>(ri.size()), static_cast<int>(m_TPS->Particles().size()));
       return;
     }
+    m_Components = InteractionComponents();
     m_Virial.resize(m_TPS->Particles().size());
     for (int i = 0; i < m_TPS->ComponentsNumber(); ++i) {
       m_Virial[i].resize(m_TPS->Particles().size());
@@ -70,6 +124,13 @@ namespace thermalfist {
 
   void ThermalModelEVCrossterms::ReadInteractionParameters(const std::string & filename)
   {
+    m_Components = InteractionComponents();
+
+    if (InteractionParametersIO::IsBinaryFile(filename)) {
+      InteractionParametersIO::ReadBinary(filename, m_TPS, m_Virial);
+      return;
+    }
+
     m_Virial = std::vector< std::vector<double> >(m_TPS->Particles().size(), std::vector<double>(m_TPS->Particles().size(), 0.));
 
     ifstream fin(filename.c_str());
@@ -81,7 +142,7 @@ namespace thermalfist {
       if (elems.size() < 1)
         continue;
       istringstream iss(elems[0]);
-      int pdgid1, pdgid2;
+      long long pdgid1, pdgid2;
       double b;
       if (iss >> pdgid1 >> pdgid2 >> b) {
         int ind1 = m_TPS->PdgToId(pdgid1);
@@ -135,11 +196,20 @@ namespace thermalfist {
   }
 
   void ThermalModelEVCrossterms::SetVirial(int i, int j, double b) {
-    if (i >= 0 && i < static_cast<int>(m_Virial.size()) && j >= 0 && j < static_cast<int>(m_Virial.size())) 
+    if (i >= 0 && i < static_cast<int>(m_Virial.size()) && j >= 0 && j < static_cast<int>(m_Virial.size())) {
       m_Virial[i][j] = b;
+      m_Components = InteractionComponents();
+    }
     else printf("**WARNING** Index overflow in ThermalModelEVCrossterms::SetVirial\n");
   }
 
+  const InteractionComponents& ThermalModelEVCrossterms::Components()
+  {
+    if (m_Components.SpeciesNumber() != static_cast<int>(m_Virial.size()))
+      m_Components = InteractionComponents(m_Virial);
+    return m_Components;
+  }
+
   void ThermalModelEVCrossterms::ChangeTPS(ThermalParticleSystem *TPS) {
     ThermalModelBase::ChangeTPS(TPS);
     m_densitiesid.resize(m_TPS->Particles().size());
@@ -250,49 +320,20 @@ namespace thermalfist {
 
     int NN = m_densities.size();
 
-    MatrixXd densMatrix(NN, NN);
-    VectorXd solVector(NN), xVector(NN);
+    // The densities are n_i = tN_i w_i with w = (1 + b^T diag(tN))^{-1} 1, and the
+    // entropy density is w^T s^id, see PartialPressureResponse()
+    const InteractionComponents& components = Components();
+    MatrixXd response = PartialPressureResponse(components, m_Virial, tN);
+    vector<double> weights = PartialPressureWeights(components, response, tN);
 
     for (int i = 0; i < NN; ++i)
-      for (int j = 0; j < NN; ++j) {
-        densMatrix(i, j) = m_Virial[i][j] * tN[i];
-        if (i == j) densMatrix(i, j) += 1.;
-      }
-
-    PartialPivLU<MatrixXd> decomp(densMatrix);
-
-    for (int i = 0; i < NN; ++i) xVector[i] = 0.;
-    for (int i = 0; i < NN; ++i) {
-      xVector[i] = tN[i];
-      solVector = decomp.solve(xVector);
-      if (1) {
-        m_densities[i] = 0.;
-        for (int j = 0; j < NN; ++j)
-          m_densities[i] += solVector[j];
-      }
-      else {
-        cout << "Could not recover m_densities from partial pressures!\n";
-      }
-      xVector[i] = 0.;
-    }
+      m_densities[i] = tN[i] * weights[i];
 
-    std::vector<double> fEntropyP(m_densities.size());
+    m_TotalEntropyDensity = 0.;
     for (int i = 0; i < NN; ++i) {
       double dMu = 0.;
       for (int j = 0; j < m_TPS->ComponentsNumber(); ++j) dMu += -m_Virial[i][j] * m_Ps[j];
-      xVector[i] = m_TPS->Particles()[i].Density(m_Parameters, IdealGasFunctions::EntropyDensity, m_UseWidth, m_Chem[i] + dMu);
-    }
-
-    solVector = decomp.solve(xVector);
-
-    if (1) {
-      m_TotalEntropyDensity = 0.;
-      for (int i = 0; i < NN; ++i)
-        m_TotalEntropyDensity += solVector[i];
-    }
-    else {
-      cout << "**ERROR** Could not recover m_densities from partial pressures!\n";
-      return;
+      m_TotalEntropyDensity += weights[i] * m_TPS->Particles()[i].Density(m_Parameters, IdealGasFunctions::EntropyDensity, m_UseWidth, m_Chem[i] + dMu);
     }
 
     m_Calculated = true;
@@ -310,55 +351,20 @@ namespace thermalfist {
 
     int NN = m_densities.size();
 
-    MatrixXd densMatrix(NN, NN);
-    VectorXd solVector(NN), xVector(NN);
+    // The densities are n_i = tN_i w_i with w = (1 + b^T diag(tN))^{-1} 1, and the
+    // entropy density is w^T s^id, see PartialPressureResponse()
+    const InteractionComponents& components = Components();
+    MatrixXd response = PartialPressureResponse(components, m_Virial, tN);
+    vector<double> weights = PartialPressureWeights(components, response, tN);
 
     for (int i = 0; i < NN; ++i)
-      for (int j = 0; j < NN; ++j) {
-        densMatrix(i, j) = m_Virial[i][j] * tN[i];
-        if (i == j) densMatrix(i, j) += 1.;
-      }
-
-    PartialPivLU<MatrixXd> decomp(densMatrix);
+      m_densities[i] = tN[i] * weights[i];
 
-    for (int i = 0; i < NN; ++i) xVector[i] = 0.;
-    for (int i = 0; i < NN; ++i) {
-      xVector[i] = tN[i];//m_Ps[i] / m_Parameters.T;
-      //solVector = lu.Solve(xVector, ok);
-      solVector = decomp.solve(xVector);
-      //if (ok) {
-      if (1) {
-        //if (decomp.info()==Eigen::Success) {
-        m_densities[i] = 0.;
-        for (int j = 0; j < NN; ++j)
-          m_densities[i] += solVector[j];
-      }
-      else {
-        cout << "**ERROR** Could not recover m_densities from partial pressures!\n";
-        return;
-      }
-      xVector[i] = 0.;
-    }
-
-    std::vector<double> fEntropyP(m_densities.size());
+    m_TotalEntropyDensity = 0.;
     for (int i = 0; i < NN; ++i) {
       double dMu = 0.;
       for (int j = 0; j < m_TPS->ComponentsNumber(); ++j) dMu += -m_Virial[i][j] * m_Ps[j];
-      xVector[i] = m_TPS->Particles()[i].Density(m_Parameters, IdealGasFunctions::EntropyDensity, m_UseWidth, m_Chem[i] + dMu);
-    }
-
-    solVector = decomp.solve(xVector);
-
-    //if (ok) {
-    if (1) {
-      //if (decomp.info()==Eigen::Success) {
-      m_TotalEntropyDensity = 0.;
-      for (int i = 0; i < NN; ++i)
-        m_TotalEntropyDensity += solVector[i];
-    }
-    else {
-      cout << "**ERROR** Could not recover m_densities from partial pressures!\n";
-      return;
+      m_TotalEntropyDensity += weights[i] * m_TPS->Particles()[i].Density(m_Parameters, IdealGasFunctions::EntropyDensity, m_UseWidth, m_Chem[i] + dMu);
     }
 
     // Decays
@@ -461,72 +467,37 @@ namespace thermalfist {
     vector<double> tN(NN), tW(NN);
     for (int i = 0; i < NN; ++i) tN[i] = DensityId(i);
     for (int i = 0; i < NN; ++i) tW[i] = ScaledVarianceId(i);
-    MatrixXd densMatrix(NN, NN);
-    VectorXd solVector(NN), xVector(NN), xVector2(NN);
 
+    // The correlations read sum_l D_l coefs_li coefs_lj, with D_l = w_l tN_l tW_l / T
+    // and coefs_li = delta_li - sum_k b_lk dPk/dPi = delta_li - G_{k(l) i},
+    // where G = H diag(tN) is stored in ders, see PartialPressureResponse()
+    const InteractionComponents& components = Components();
+    int KK = components.ComponentsNumber();
+    MatrixXd ders = PartialPressureResponse(components, m_Virial, tN);
+    vector<double> weights = PartialPressureWeights(components, ders, tN);
     for (int i = 0; i < NN; ++i)
-      for (int j = 0; j < NN; ++j) {
-        densMatrix(i, j) = m_Virial[i][j] * tN[i];
-        if (i == j) densMatrix(i, j) += 1.;
-      }
-
-    PartialPivLU<MatrixXd> decomp(densMatrix);
-
-    vector< vector<double> > ders, coefs;
-
-    ders.resize(NN);
-    coefs.resize(NN);
-
-    for (int i = 0; i < NN; ++i) {
-      ders[i].resize(NN);
-      coefs[i].resize(NN);
-    }
+      ders.col(i) *= tN[i];
 
-    for (int i = 0; i < NN; ++i) xVector[i] = 0.;
-    for (int i = 0; i < NN; ++i) {
-      xVector[i] = tN[i];
-      solVector = decomp.solve(xVector);
-      if (1) {
-        //if (decomp.info()==Eigen::Success) {
-        for (int j = 0; j < NN; ++j) {
-          ders[j][i] = solVector[j];
-        }
-
-        for (int l = 0; l < NN; ++l) {
-          coefs[l][i] = 0.;
-          for (int k = 0; k < NN; ++k) {
-            coefs[l][i] += -m_Virial[l][k] * ders[k][i];
-          }
-          if (l == i) coefs[l][i] += 1.;
-        }
-      }
-      else {
-        cout << "**WARNING** Could not recover fluctuations!\n";
-      }
-      xVector[i] = 0.;
+    vector<double> Ds(NN);
+    VectorXd DKs = VectorXd::Zero(KK);
+    for (int l = 0; l < NN; ++l) {
+      Ds[l] = weights[l] * tN[l] / m_Parameters.T * tW[l];
+      DKs[components.Component(l)] += Ds[l];
     }
 
+    MatrixXd dersProd = ders.transpose() * DKs.asDiagonal() * ders;
 
     m_PrimCorrel.resize(NN);
     for (int i = 0; i < NN; ++i) m_PrimCorrel[i].resize(NN);
-    m_TotalCorrel = m_PrimCorrel;
 
     for (int i = 0; i < NN; ++i)
       for (int j = i; j < NN; ++j) {
-        for (int l = 0; l < NN; ++l)
-          xVector[l] = tN[l] / m_Parameters.T * tW[l] * coefs[l][i] * coefs[l][j];
-        solVector = decomp.solve(xVector);
-        if (1) {
-          //if (decomp.info()==Eigen::Success) {
-          m_PrimCorrel[i][j] = 0.;
-          for (int k = 0; k < NN; ++k) {
-            m_PrimCorrel[i][j] += solVector[k];
-          }
-          m_PrimCorrel[j][i] = m_PrimCorrel[i][j];
-        }
-        else {
-          cout << "**WARNING** Could not recover fluctuations!\n";
-        }
+        m_PrimCorrel[i][j] = dersProd(i, j)
+          - Ds[i] * ders(components.Component(i), j)
+          - Ds[j] * ders(components.Component(j), i);
+        if (i == j)
+          m_PrimCorrel[i][j] += Ds[i];
+        m_PrimCorrel[j][i] = m_PrimCorrel[i][j];
       }
 
     //cout << "Primaries solved!\n";
@@ -577,8 +548,7 @@ namespace thermalfist {
       MuStar[i] = m_Chem[i] + MuShift(i);
     }
 
-    MatrixXd densMatrix(2 * NN, 2 * NN);
-    VectorXd solVector(2 * NN), xVector(2 * NN);
+    vector<double> xVector(NN), yVector(NN);
 
     vector<double> DensitiesId(m_densities.size()), chi2id(m_densities.size());
     for (int i = 0; i < NN; ++i) {
@@ -586,47 +556,24 @@ namespace thermalfist {
       chi2id[i] = m_TPS->Particles()[i].chi(2, m_Parameters, m_UseWidth, MuStar[i]);
     }
 
-    for (int i = 0; i < NN; ++i)
-      for (int j = 0; j < NN; ++j) {
-        densMatrix(i, j) = m_Virial[j][i] * DensitiesId[i];
-        if (i == j) densMatrix(i, j) += 1.;
-      }
-
-    for (int i = 0; i < NN; ++i)
-      for (int j = 0; j < NN; ++j)
-        densMatrix(i, NN + j) = 0.;
-
+    vector<double> cs(NN, 0.);
     for (int i = 0; i < NN; ++i) {
-      densMatrix(i, NN + i) = 0.;
-      for (int k = 0; k < NN; ++k) {
-        densMatrix(i, NN + i) += m_Virial[k][i] * m_densities[k];
-      }
-      densMatrix(i, NN + i) = (densMatrix(i, NN + i) - 1.) * chi2id[i] * pow(xMath::GeVtoifm(), 3) * m_Parameters.T * m_Parameters.T;
+      for (int k = 0; k < NN; ++k)
+        cs[i] += m_Virial[k][i] * m_densities[k];
+      cs[i] = (cs[i] - 1.) * chi2id[i] * pow(xMath::GeVtoifm(), 3) * m_Parameters.T * m_Parameters.T;
     }
 
-    for (int i = 0; i < NN; ++i)
-      for (int j = 0; j < NN; ++j) {
-        densMatrix(NN + i, NN + j) = m_Virial[i][j] * DensitiesId[j];
-        if (i == j) densMatrix(NN + i, NN + j) += 1.;
-      }
-
-
-    PartialPivLU<MatrixXd> decomp(densMatrix);
+    InteractionResponseSolver decomp(Components(), m_Virial, vector< vector<double> >(), DensitiesId, cs);
 
     // chi2
     vector<double> dni(NN, 0.), dmus(NN, 0.);
 
     for (int i = 0; i < NN; ++i) {
       xVector[i] = 0.;
-      xVector[NN + i] = chgs[i];
+      yVector[i] = chgs[i];
     }
 
-    solVector = decomp.solve(xVector);
-
-    for (int i = 0; i < NN; ++i) {
-      dni[i] = solVector[i];
-      dmus[i] = solVector[NN + i];
-    }
+    decomp.Solve(xVector, yVector, dni, dmus);
 
     for (int i = 0; i < NN; ++i)
       ret[1] += chgs[i] * dni[i];
@@ -655,20 +602,15 @@ namespace thermalfist {
       xVector[i] += tmp;
     }
     for (int i = 0; i < NN; ++i) {
-      xVector[NN + i] = 0.;
+      yVector[i] = 0.;
 
       double tmp = 0.;
       for (int j = 0; j < NN; ++j) tmp += -m_Virial[i][j] * dmus[j] * chi2id[j] * pow(xMath::GeVtoifm(), 3) * m_Parameters.T * m_Parameters.T * dmus[j];
 
-      xVector[NN + i] = tmp;
+      yVector[i] = tmp;
     }
 
-    solVector = decomp.solve(xVector);
-
-    for (int i = 0; i < NN; ++i) {
-      d2ni[i] = solVector[i];
-      d2mus[i] = solVector[NN + i];
-    }
+    decomp.Solve(xVector, yVector, d2ni, d2mus);
 
     for (int i = 0; i < NN; ++i)
       ret[2] += chgs[i] * d2ni[i];
@@ -719,23 +661,18 @@ namespace thermalfist {
       xVector[i] += tmp;
     }
     for (int i = 0; i < NN; ++i) {
-      xVector[NN + i] = 0.;
+      yVector[i] = 0.;
 
       double tmp = 0.;
       for (int j = 0; j < NN; ++j) tmp += -2. * m_Virial[i][j] * d2mus[j] * dnis[j];
-      xVector[NN + i] += tmp;
+      yVector[i] += tmp;
 
       tmp = 0.;
       for (int j = 0; j < NN; ++j) tmp += -m_Virial[i][j] * dmus[j] * d2nis[j];
-      xVector[NN + i] += tmp;
+      yVector[i] += tmp;
     }
 
-    solVector = decomp.solve(xVector);
-
-    for (int i = 0; i < NN; ++i) {
-      d3ni[i] = solVector[i];
-      d3mus[i] = solVector[NN + i];
-    }
+    decomp.Solve(xVector, yVector, d3ni, d3mus);
 
     for (int i = 0; i < NN; ++i)
       ret[3] += chgs[i] * d3ni[i];
@@ -777,12 +714,42 @@ namespace thermalfist {
       return 0.0;
   }
 
+  void ThermalModelEVCrossterms::AppendResultCacheKey(std::vector<double>& key) const
+  {
+    key.reserve(key.size() + m_Virial.size() * m_Virial.size());
+    for (size_t i = 0; i < m_Virial.size(); ++i)
+      key.insert(key.end(), m_Virial[i].begin(), m_Virial[i].end());
+  }
+
+  void ThermalModelEVCrossterms::StoreResultCacheState(std::vector<double>& state) const
+  {
+    state.clear();
+    state.push_back(m_Pressure);
+    state.push_back(m_TotalEntropyDensity);
+    state.insert(state.end(), m_Ps.begin(), m_Ps.end());
+  }
+
+  void ThermalModelEVCrossterms::RestoreResultCacheState(const std::vector<double>& state)
+  {
+    if (state.size() != 2 + m_densities.size())
+      return;
+    m_Pressure = state[0];
+    m_TotalEntropyDensity = state[1];
+    m_Ps.assign(state.begin() + 2, state.end());
+  }
+
   std::vector<double> ThermalModelEVCrossterms::BroydenEquationsCRS::Equations(const std::vector<double>& x)
   {
-    std::vector<double> ret(m_N);
+    std::vector<double> ret;
+    EvaluateEquations(x, ret);
+    return ret;
+  }
+
+  void ThermalModelEVCrossterms::BroydenEquationsCRS::EvaluateEquations(const std::vector<double>& x, std::vector<double>& ret)
+  {
+    ret.resize(m_N);
     for (size_t i = 0; i < x.size(); ++i)
       ret[i] = x[i] - m_THM->Pressure(i, x);
-    return ret;
   }
 
   std::vector<double> ThermalModelEVCrossterms::BroydenJacobianCRS::Jacobian(const std::vector<double>& x)
@@ -817,8 +784,14 @@ namespace thermalfist {
 
   std::vector<double> ThermalModelEVCrossterms::BroydenEquationsCRSDEV::Equations(const std::vector<double>& x)
   {
-    std::vector<double> ret(1);
-    ret[0] = x[0] - m_THM->PressureDiagonalTotal(x[0]);
+    std::vector<double> ret;
+    EvaluateEquations(x, ret);
     return ret;
   }
+
+  void ThermalModelEVCrossterms::BroydenEquationsCRSDEV::EvaluateEquations(const std::vector<double>& x, std::vector<double>& ret)
+  {
+    ret.resize(1);
+    ret[0] = x[0] - m_THM->PressureDiagonalTotal(x[0]);
+  }
 } // namespace thermalfist
\ No newline at end of file
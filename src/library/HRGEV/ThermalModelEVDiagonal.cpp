@@ -46,6 +46,13 @@ namespace thermalfist {
   {
   }
 
+  ThermalModelEVDiagonal* ThermalModelEVDiagonal::Clone(ThermalParticleSystem* TPS) const
+  {
+    ThermalModelEVDiagonal *ret = new ThermalModelEVDiagonal(*this);
+    FinalizeClone(ret, TPS);
+    return ret;
+  }
+
 
   void ThermalModelEVDiagonal::SetRadius(double rad) {
     if (m_v.size() != m_TPS->Particles().size())
@@ -88,7 +95,7 @@ namespace thermalfist {
       if (elems.size() < 1)
         continue;
       istringstream iss(elems[0]);
-      int pdgid;
+      long long pdgid;
       double b;
       if (iss >> pdgid >> b) {
         int ind = m_TPS->PdgToId(pdgid);
@@ -212,7 +219,9 @@ namespace thermalfist {
 
     m_densitiesidnoshift = m_densitiesid;
 
-#pragma omp parallel for reduction(+:densityid) reduction(+:suppression) if(useOpenMP)
+#ifdef USE_OPENMP
+#pragma omp parallel for reduction(+:densityid) reduction(+:suppression) if(m_useOpenMP)
+#endif
     for (int i = 0; i < m_TPS->ComponentsNumber(); ++i) {
       double dMu = -m_v[i] * m_Pressure;
       m_densitiesid[i] = m_TPS->Particles()[i].Density(m_Parameters, IdealGasFunctions::ParticleDensity, m_UseWidth, m_Chem[i] + dMu);
@@ -247,7 +256,6 @@ namespace thermalfist {
 
     m_PrimCorrel.resize(NN);
     for (int i = 0; i < NN; ++i) m_PrimCorrel[i].resize(NN);
-    m_TotalCorrel = m_PrimCorrel;
 
     for (int i = 0; i < NN; ++i)
       for (int j = 0; j < NN; ++j) {
@@ -534,6 +542,37 @@ namespace thermalfist {
       return 0.0;
   }
 
+  void ThermalModelEVDiagonal::AppendResultCacheKey(std::vector<double>& key) const
+  {
+    key.insert(key.end(), m_v.begin(), m_v.end());
+  }
+
+  void ThermalModelEVDiagonal::StoreResultCacheState(std::vector<double>& state) const
+  {
+    state.clear();
+    state.push_back(m_Pressure);
+    state.push_back(m_Suppression);
+    state.push_back(m_Densityid);
+    state.push_back(m_TotalDensity);
+    state.push_back(m_wnSum);
+    state.insert(state.end(), m_densitiesid.begin(), m_densitiesid.end());
+    state.insert(state.end(), m_densitiesidnoshift.begin(), m_densitiesidnoshift.end());
+  }
+
+  void ThermalModelEVDiagonal::RestoreResultCacheState(const std::vector<double>& state)
+  {
+    int NN = m_densities.size();
+    if (static_cast<int>(state.size()) != 5 + 2 * NN)
+      return;
+    m_Pressure = state[0];
+    m_Suppression = state[1];
+    m_Densityid = state[2];
+    m_TotalDensity = state[3];
+    m_wnSum = state[4];
+    m_densitiesid.assign(state.begin() + 5, state.begin() + 5 + NN);
+    m_densitiesidnoshift.assign(state.begin() + 5 + NN, state.end());
+  }
+
   double ThermalModelEVDiagonal::CalculateEigenvolumeFraction() {
     double tEV = 0.;
     for (int i = 0; i < m_TPS->ComponentsNumber(); ++i) {
@@ -561,12 +600,17 @@ namespace thermalfist {
 
   std::vector<double> ThermalModelEVDiagonal::BroydenEquationsDEV::Equations(const std::vector<double>& x)
   {
-    std::vector<double> ret(1);
+    std::vector<double> ret;
+    EvaluateEquations(x, ret);
+    return ret;
+  }
+
+  void ThermalModelEVDiagonal::BroydenEquationsDEV::EvaluateEquations(const std::vector<double>& x, std::vector<double>& ret)
+  {
+    ret.resize(1);
     double pressure = m_mnc * exp(x[0]);
 
     ret[0] = pressure - m_THM->Pressure(pressure);
-
-    return ret;
   }
 
   std::vector<double> ThermalModelEVDiagonal::BroydenJacobianDEV::Jacobian(const std::vector<double>& x)
@@ -584,11 +628,17 @@ namespace thermalfist {
 
   std::vector<double> ThermalModelEVDiagonal::BroydenEquationsDEVOrig::Equations(const std::vector<double>& x)
   {
-    std::vector<double> ret(1);
-    ret[0] = x[0] - m_THM->Pressure(x[0]);
+    std::vector<double> ret;
+    EvaluateEquations(x, ret);
     return ret;
   }
 
+  void ThermalModelEVDiagonal::BroydenEquationsDEVOrig::EvaluateEquations(const std::vector<double>& x, std::vector<double>& ret)
+  {
+    ret.resize(1);
+    ret[0] = x[0] - m_THM->Pressure(x[0]);
+  }
+
   std::vector<double> ThermalModelEVDiagonal::BroydenJacobianDEVOrig::Jacobian(const std::vector<double>& x)
   {
     const double &pressure = x[0];
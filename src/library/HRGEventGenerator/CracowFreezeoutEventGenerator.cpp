@@ -7,6 +7,10 @@
  */
 #include "HRGEventGenerator/CracowFreezeoutEventGenerator.h"
 
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
 #include <algorithm>
 
 #include "HRGBase/xMath.h"
@@ -40,22 +44,15 @@ namespace thermalfist {
 
   void CracowFreezeoutEventGenerator::SetMomentumGenerators()
   {
-    ClearMomentumGenerators();
-    m_BWGens.resize(0);
-    if (m_THM != NULL) {
-      for (size_t i = 0; i < m_THM->TPS()->Particles().size(); ++i) {
-        const ThermalParticle& part = m_THM->TPS()->Particles()[i];
-        //m_MomentumGens.push_back(new RandomGenerators::CracowFreezeoutMomentumGenerator(m_T, m_RoverTauH, m_EtaMax, part.Mass(), part.Statistics(), m_THM->FullIdealChemicalPotential(i)));
-        m_MomentumGens.push_back(new RandomGenerators::BoostInvariantMomentumGenerator(new CracowFreezeoutParametrization(m_RoverTauH), GetTkin(), GetEtaMax(), part.Mass(), part.Statistics(), m_THM->FullIdealChemicalPotential(i)));
-
-        double T = m_THM->Parameters().T;
-        double Mu = m_THM->FullIdealChemicalPotential(i);
-        if (m_THM->TPS()->ResonanceWidthIntegrationType() == ThermalParticle::eBW || m_THM->TPS()->ResonanceWidthIntegrationType() == ThermalParticle::eBWconstBR)
-          m_BWGens.push_back(new RandomGenerators::ThermalEnergyBreitWignerGenerator(&m_THM->TPS()->Particle(i), T, Mu));
-        else
-          m_BWGens.push_back(new RandomGenerators::ThermalBreitWignerGenerator(&m_THM->TPS()->Particle(i), T, Mu));
-      }
-    }
+    // The generators are constructed on first use,
+    // PrepareMomentumGenerators() builds them in advance if desired
+    ResetMomentumGenerators();
+  }
+
+  RandomGenerators::ParticleMomentumGenerator* CracowFreezeoutEventGenerator::CreateMomentumGenerator(int i) const
+  {
+    const ThermalParticle& part = m_THM->TPS()->Particles()[i];
+    return new RandomGenerators::BoostInvariantMomentumGenerator(new CracowFreezeoutParametrization(m_RoverTauH), m_T, m_EtaMax, part.Mass(), part.Statistics(), GeneratorChemicalPotential(i));
   }
 
 } // namespace thermalfist
\ No newline at end of file
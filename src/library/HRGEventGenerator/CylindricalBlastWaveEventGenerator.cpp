@@ -7,6 +7,10 @@
  */
 #include "HRGEventGenerator/CylindricalBlastWaveEventGenerator.h"
 
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
 #include <algorithm>
 
 #include "HRGBase/xMath.h"
@@ -87,21 +91,15 @@ namespace thermalfist {
 
   void CylindricalBlastWaveEventGenerator::SetMomentumGenerators()
   {
-    ClearMomentumGenerators();
-    m_BWGens.resize(0);
-    if (m_THM != NULL) {
-      for (size_t i = 0; i < m_THM->TPS()->Particles().size(); ++i) {
-        const ThermalParticle& part = m_THM->TPS()->Particles()[i];
-        m_MomentumGens.push_back(new RandomGenerators::BoostInvariantMomentumGenerator(new CylindricalBlastWaveParametrization(GetBetaSurface(), GetNPow()), GetTkin(), GetEtaMax(), part.Mass(), part.Statistics(), m_THM->FullIdealChemicalPotential(i)));
-
-        double T = m_THM->Parameters().T;
-        double Mu = m_THM->FullIdealChemicalPotential(i);
-        if (m_THM->TPS()->ResonanceWidthIntegrationType() == ThermalParticle::eBW || m_THM->TPS()->ResonanceWidthIntegrationType() == ThermalParticle::eBWconstBR)
-          m_BWGens.push_back(new RandomGenerators::ThermalEnergyBreitWignerGenerator(&m_THM->TPS()->Particle(i), T, Mu));
-        else
-          m_BWGens.push_back(new RandomGenerators::ThermalBreitWignerGenerator(&m_THM->TPS()->Particle(i), T, Mu));
-      }
-    }
+    // The generators are constructed on first use,
+    // PrepareMomentumGenerators() builds them in advance if desired
+    ResetMomentumGenerators();
+  }
+
+  RandomGenerators::ParticleMomentumGenerator* CylindricalBlastWaveEventGenerator::CreateMomentumGenerator(int i) const
+  {
+    const ThermalParticle& part = m_THM->TPS()->Particles()[i];
+    return new RandomGenerators::BoostInvariantMomentumGenerator(new CylindricalBlastWaveParametrization(m_BetaS, m_n), m_T, m_EtaMax, part.Mass(), part.Statistics(), GeneratorChemicalPotential(i));
   }
 
 } // namespace thermalfist
\ No newline at end of file
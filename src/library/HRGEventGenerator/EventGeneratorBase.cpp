@@ -7,11 +7,16 @@
  */
 #include "HRGEventGenerator/EventGeneratorBase.h"
 
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
 #include <functional>
 #include <algorithm>
 
 
 #include "HRGBase/xMath.h"
+#include "HRGBase/Profiler.h"
 #include "HRGBase/ThermalModelBase.h"
 #include "HRGBase/ThermalModelIdeal.h"
 #include "HRGBase/ThermalModelCanonicalStrangeness.h"
@@ -34,17 +39,192 @@ namespace thermalfist {
 
   void EventGeneratorBase::ClearMomentumGenerators()
   {
-    for (size_t i = 0; i < m_MomentumGens.size(); ++i) {
-      if (m_MomentumGens[i] != NULL)
-        delete m_MomentumGens[i];
+    std::lock_guard<std::mutex> lock(m_GeneratorsMutex);
+
+    for (size_t i = 0; i < m_OwnedMomentumGens.size(); ++i)
+      delete m_OwnedMomentumGens[i];
+    m_OwnedMomentumGens.clear();
+    m_SharedMomentumGens.clear();
+    std::vector< std::atomic<RandomGenerators::ParticleMomentumGenerator*> >().swap(m_MomentumGens);
+
+    for (size_t i = 0; i < m_OwnedBWGens.size(); ++i)
+      delete m_OwnedBWGens[i];
+    m_OwnedBWGens.clear();
+    m_SharedBWGens.clear();
+    std::vector< std::atomic<RandomGenerators::ThermalBreitWignerGenerator*> >().swap(m_BWGens);
+  }
+
+  void EventGeneratorBase::ResetMomentumGenerators()
+  {
+    ClearMomentumGenerators();
+    if (m_THM != NULL) {
+      size_t Nspecies = m_THM->TPS()->Particles().size();
+      std::vector< std::atomic<RandomGenerators::ParticleMomentumGenerator*> >(Nspecies).swap(m_MomentumGens);
+      std::vector< std::atomic<RandomGenerators::ThermalBreitWignerGenerator*> >(Nspecies).swap(m_BWGens);
+      for (size_t i = 0; i < Nspecies; ++i) {
+        m_MomentumGens[i].store(NULL);
+        m_BWGens[i].store(NULL);
+      }
+
+      m_GeneratorsT = m_THM->Parameters().T;
+      m_GeneratorsMu.resize(Nspecies);
+      for (size_t i = 0; i < Nspecies; ++i)
+        m_GeneratorsMu[i] = m_THM->FullIdealChemicalPotential(i);
     }
-    m_MomentumGens.resize(0);
+  }
+
+  namespace {
+    /// Returns the generator stored in the slot, constructs it if necessary.
+    /// The construction itself is done outside the lock, so that different
+    /// generators can be built concurrently.
+    template<class Generator>
+    Generator* GetOrCreateGenerator(
+      std::atomic<Generator*>& slot,
+      const std::vector<double>& key,
+      std::function<Generator*()> create,
+      std::vector<Generator*>& owned,
+      std::map< std::vector<double>, Generator* >& shared,
+      std::mutex& mtx)
+    {
+      Generator* ret = slot.load(std::memory_order_acquire);
+      if (ret != NULL)
+        return ret;
+
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        ret = slot.load(std::memory_order_relaxed);
+        if (ret == NULL && !key.empty()) {
+          typename std::map< std::vector<double>, Generator* >::iterator it = shared.find(key);
+          if (it != shared.end()) {
+            ret = it->second;
+            slot.store(ret, std::memory_order_release);
+          }
+        }
+        if (ret != NULL)
+          return ret;
+      }
 
-    for (size_t i = 0; i < m_BWGens.size(); ++i) {
-      if (m_BWGens[i] != NULL)
-        delete m_BWGens[i];
+      Generator* gen = create();
+
+      std::lock_guard<std::mutex> lock(mtx);
+      ret = slot.load(std::memory_order_relaxed);
+      if (ret == NULL && !key.empty()) {
+        typename std::map< std::vector<double>, Generator* >::iterator it = shared.find(key);
+        if (it != shared.end())
+          ret = it->second;
+      }
+
+      // Another thread has been faster
+      if (ret != NULL) {
+        delete gen;
+        slot.store(ret, std::memory_order_release);
+        return ret;
+      }
+
+      owned.push_back(gen);
+      if (!key.empty())
+        shared[key] = gen;
+      slot.store(gen, std::memory_order_release);
+      return gen;
     }
-    m_BWGens.resize(0);
+  }
+
+  RandomGenerators::ParticleMomentumGenerator* EventGeneratorBase::GetMomentumGenerator(int i) const
+  {
+    RandomGenerators::ParticleMomentumGenerator* ret = m_MomentumGens[i].load(std::memory_order_acquire);
+    if (ret != NULL)
+      return ret;
+
+    ret = GetOrCreateGenerator<RandomGenerators::ParticleMomentumGenerator>(
+      m_MomentumGens[i],
+      MomentumGeneratorKey(i),
+      std::bind(&EventGeneratorBase::CreateMomentumGenerator, this, i),
+      m_OwnedMomentumGens,
+      m_SharedMomentumGens,
+      m_GeneratorsMutex);
+
+    if (ret == NULL) {
+      printf("**ERROR** EventGeneratorBase::GetMomentumGenerator: Momentum generator for particle %lld is not available!\n", m_THM->TPS()->Particles()[i].PdgId());
+      exit(1);
+    }
+
+    return ret;
+  }
+
+  RandomGenerators::ThermalBreitWignerGenerator* EventGeneratorBase::GetBWGenerator(int i) const
+  {
+    RandomGenerators::ThermalBreitWignerGenerator* ret = m_BWGens[i].load(std::memory_order_acquire);
+    if (ret != NULL)
+      return ret;
+
+    return GetOrCreateGenerator<RandomGenerators::ThermalBreitWignerGenerator>(
+      m_BWGens[i],
+      BWGeneratorKey(i),
+      std::bind(&EventGeneratorBase::CreateBWGenerator, this, i),
+      m_OwnedBWGens,
+      m_SharedBWGens,
+      m_GeneratorsMutex);
+  }
+
+  void EventGeneratorBase::PrepareMomentumGenerators() const
+  {
+    int Nspecies = static_cast<int>(m_MomentumGens.size());
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < Nspecies; ++i) {
+      GetMomentumGenerator(i);
+      GetBWGenerator(i);
+    }
+  }
+
+  std::vector<double> EventGeneratorBase::MomentumGeneratorKey(int i) const
+  {
+    const ThermalParticle& part = m_THM->TPS()->Particles()[i];
+    std::vector<double> ret;
+    ret.push_back(part.Mass());
+    ret.push_back(part.Statistics());
+    ret.push_back(GeneratorChemicalPotential(i));
+    return ret;
+  }
+
+  RandomGenerators::ThermalBreitWignerGenerator* EventGeneratorBase::CreateBWGenerator(int i) const
+  {
+    double T = GeneratorTemperature();
+    double Mu = GeneratorChemicalPotential(i);
+    if (m_THM->TPS()->ResonanceWidthIntegrationType() == ThermalParticle::eBW || m_THM->TPS()->ResonanceWidthIntegrationType() == ThermalParticle::eBWconstBR)
+      return new RandomGenerators::ThermalEnergyBreitWignerGenerator(&m_THM->TPS()->Particle(i), T, Mu);
+    else
+      return new RandomGenerators::ThermalBreitWignerGenerator(&m_THM->TPS()->Particle(i), T, Mu);
+  }
+
+  std::vector<double> EventGeneratorBase::BWGeneratorKey(int i) const
+  {
+    const ThermalParticle& part = m_THM->TPS()->Particles()[i];
+    bool eBW = (m_THM->TPS()->ResonanceWidthIntegrationType() == ThermalParticle::eBW || m_THM->TPS()->ResonanceWidthIntegrationType() == ThermalParticle::eBWconstBR);
+
+    std::vector<double> ret;
+    ret.push_back(eBW ? 1. : 0.);
+    ret.push_back(GeneratorTemperature());
+    ret.push_back(GeneratorChemicalPotential(i));
+    ret.push_back(part.Mass());
+    ret.push_back(part.ResonanceWidth());
+    ret.push_back(part.DecayThresholdMass());
+    ret.push_back(part.Statistics());
+    ret.push_back(static_cast<double>(part.CalculationType()));
+    ret.push_back(part.ClusterExpansionOrder());
+    ret.push_back(static_cast<double>(part.GetResonanceWidthShape()));
+
+    // The energy-dependent width is determined by the decay channels
+    if (eBW) {
+      ret.push_back(part.DecayThresholdMassDynamical());
+      for (size_t j = 0; j < part.Decays().size(); ++j) {
+        ret.push_back(part.Decays()[j].mBratio);
+        ret.push_back(part.Decays()[j].mM0);
+        ret.push_back(part.Decays()[j].mL);
+      }
+    }
+    return ret;
   }
 
   //void EventGeneratorBase::SetConfiguration(const ThermalModelParameters& params, EventGeneratorConfiguration::Ensemble ensemble, EventGeneratorConfiguration::ModelType modeltype, ThermalParticleSystem *TPS, ThermalModelBase *THMEVVDW)
@@ -355,6 +535,8 @@ namespace thermalfist {
   }
 
   std::vector<int> EventGeneratorBase::GenerateTotals() const {
+    THERMALFIST_PROFILE_SCOPE("EventGeneratorBase::GenerateTotals");
+
     if (!m_THM->IsGCECalculated())
       m_THM->CalculateDensitiesGCE();
 
@@ -1164,6 +1346,8 @@ namespace thermalfist {
 
   SimpleEvent EventGeneratorBase::SampleMomenta(const std::vector<int>& yields) const
   {
+    THERMALFIST_PROFILE_SCOPE("EventGeneratorBase::SampleMomenta");
+
     SimpleEvent ret;
 
     std::vector< std::vector<SimpleParticle> > primParticles(m_THM->TPS()->Particles().size());
@@ -1172,19 +1356,39 @@ namespace thermalfist {
       const ThermalParticle& species = m_THM->TPS()->Particles()[i];
       primParticles[i].resize(0);
       int total = yields[i];
+
+      // Accepted-particle fast path: binomial thinning of the multiplicity
+      bool fastpath = (i < m_AcceptanceFast.size() && m_AcceptanceFast[i] != NULL);
+      if (fastpath)
+        total = RandomGenerators::RandomBinomial(total, m_AcceptanceProbabilities[i]);
+
+      const RandomGenerators::InverseCDFTable2D* table = NULL;
+      if (fastpath && i < m_AcceptedMomentumTables.size())
+        table = m_AcceptedMomentumTables[i].get();
+
       for (int part = 0; part < total; ++part) {
-        double tmass = species.Mass();
-        if (m_THM->UseWidth() && !species.ZeroWidthEnforced() && !(species.GetResonanceWidthIntegrationType() == ThermalParticle::ZeroWidth))
-          tmass = m_BWGens[i]->GetRandom();
-
-        // Check for Bose-Einstein condensation
-        // Force m = mu if the sampled mass is too small
-        double tmu = m_THM->FullIdealChemicalPotential(i);
-        if (species.Statistics() == -1 && tmu > tmass) {
-          tmass = tmu;
+        double tmass = 0.;
+        std::vector<double> momentum;
+        // Momenta of accepted particles are sampled from the acceptance-weighted distribution,
+        // directly from the tabulated distribution if available, by rejection otherwise
+        if (table != NULL) {
+          tmass = species.Mass();
+          double y = 0., x = 1.;
+          table->GetRandom(y, x);
+          double pt = -log(x);
+          double mt = sqrt(pt * pt + tmass * tmass);
+          double phi = 2. * xMath::Pi() * RandomGenerators::randgenMT.rand();
+          momentum.resize(3);
+          momentum[0] = pt * cos(phi);
+          momentum[1] = pt * sin(phi);
+          momentum[2] = mt * sinh(y);
+        }
+        else {
+          do {
+            tmass = SampleParticleMass(i);
+            momentum = GetMomentumGenerator(i)->GetMomentum(tmass);
+          } while (fastpath && !AcceptParticle(i, momentum, tmass));
         }
-
-        std::vector<double> momentum = m_MomentumGens[i]->GetMomentum(tmass);
         //std::vector<double> momentum = m_MomentumGens[i]->GetMomentum(0.99999 * m_THM->TPS()->Particles()[i].Mass());
 
         primParticles[i].push_back(SimpleParticle(momentum[0], momentum[1], momentum[2], tmass, species.PdgId()));
@@ -1207,8 +1411,166 @@ namespace thermalfist {
     return ret;
   }
 
+  double EventGeneratorBase::SampleParticleMass(int i) const
+  {
+    const ThermalParticle& species = m_THM->TPS()->Particles()[i];
+    double tmass = species.Mass();
+    if (m_THM->UseWidth() && !species.ZeroWidthEnforced() && !(species.GetResonanceWidthIntegrationType() == ThermalParticle::ZeroWidth))
+      tmass = GetBWGenerator(i)->GetRandom();
+
+    // Check for Bose-Einstein condensation
+    // Force m = mu if the sampled mass is too small
+    double tmu = m_THM->FullIdealChemicalPotential(i);
+    if (species.Statistics() == -1 && tmu > tmass) {
+      tmass = tmu;
+    }
+
+    return tmass;
+  }
+
+  bool EventGeneratorBase::AcceptParticle(int i, const std::vector<double>& momentum, double mass) const
+  {
+    SimpleParticle part(momentum[0], momentum[1], momentum[2], mass);
+    double prob = m_AcceptanceFast[i]->getAcceptance(part.GetY() + m_AcceptanceYcm, part.GetPt());
+    return (RandomGenerators::randgenMT.rand() < prob);
+  }
+
+  namespace {
+    /// Tabulates the momentum distribution of the accepted particles in the variables y and exp(-pT),
+    /// returns NULL if the y-pT density is not available from the momentum generator
+    std::shared_ptr<const RandomGenerators::InverseCDFTable2D> AcceptedMomentumTable(
+      const RandomGenerators::ParticleMomentumGenerator* gen,
+      const Acceptance::AcceptanceFunction* acc, double ycm, double mass)
+    {
+      const int npt = 240;
+      const double dy = 0.05;
+
+      // pT = -log(x), x = 0 corresponds to infinite pT and is excluded
+      std::vector<double> xs(npt + 1), pts(npt);
+      for (int ix = 0; ix <= npt; ++ix)
+        xs[ix] = static_cast<double>(ix) / npt;
+      for (int ix = 1; ix <= npt; ++ix)
+        pts[ix - 1] = -log(xs[ix]);
+
+      // The rapidity range is extended until the density at its edges is negligible
+      double ymax = 6.;
+      std::vector<double> ys;
+      std::vector< std::vector<double> > density;
+      for (int iter = 0; iter < 4; ++iter) {
+        int ny = static_cast<int>(2. * ymax / dy + 0.5);
+        ys.resize(ny + 1);
+        for (int iy = 0; iy <= ny; ++iy)
+          ys[iy] = -ymax + 2. * ymax * iy / ny;
+
+        if (!gen->YPtDensity(ys, pts, density, mass))
+          return std::shared_ptr<const RandomGenerators::InverseCDFTable2D>();
+
+        double maxall = 0., maxedge = 0.;
+        for (int iy = 0; iy <= ny; ++iy) {
+          for (int ipt = 0; ipt < npt; ++ipt) {
+            maxall = std::max(maxall, density[iy][ipt]);
+            if (iy == 0 || iy == ny)
+              maxedge = std::max(maxedge, density[iy][ipt]);
+          }
+        }
+        if (!(maxedge > 1.e-12 * maxall))
+          break;
+        ymax *= 2.;
+      }
+
+      // Density in x is rho(y,pT) / x
+      std::vector< std::vector<double> > f(ys.size(), std::vector<double>(npt + 1, 0.));
+      for (size_t iy = 0; iy < ys.size(); ++iy)
+        for (int ix = 1; ix <= npt; ++ix)
+          f[iy][ix] = density[iy][ix - 1] / xs[ix] * acc->getAcceptance(ys[iy] + ycm, pts[ix - 1]);
+
+      std::shared_ptr<const RandomGenerators::InverseCDFTable2D> ret =
+        std::make_shared<const RandomGenerators::InverseCDFTable2D>(f, ys.front(), ys.back(), 0., 1.);
+      if (!ret->IsValid())
+        return std::shared_ptr<const RandomGenerators::InverseCDFTable2D>();
+      return ret;
+    }
+  }
+
+  void EventGeneratorBase::SetAcceptedParticlesFastPath(const std::vector<Acceptance::AcceptanceFunction*>& acceptance, double ycm, int samples)
+  {
+    if (m_THM == NULL || m_MomentumGens.size() != m_THM->TPS()->Particles().size()) {
+      printf("**WARNING** EventGeneratorBase::SetAcceptedParticlesFastPath: Event generator is not initialized!\n");
+      return;
+    }
+
+    if (acceptance.size() != m_THM->TPS()->Particles().size()) {
+      printf("**WARNING** EventGeneratorBase::SetAcceptedParticlesFastPath: Size of the acceptance vector does not match the number of species!\n");
+      return;
+    }
+
+    if (!m_THM->IsGCECalculated())
+      m_THM->CalculateDensitiesGCE();
+
+    m_AcceptanceYcm = ycm;
+    m_AcceptanceFast = std::vector<const Acceptance::AcceptanceFunction*>(acceptance.size(), NULL);
+    m_AcceptanceProbabilities = std::vector<double>(acceptance.size(), 1.);
+    m_AcceptedMomentumTables = std::vector< std::shared_ptr<const RandomGenerators::InverseCDFTable2D> >(acceptance.size());
+
+    for (size_t i = 0; i < acceptance.size(); ++i) {
+      if (acceptance[i] == NULL || !acceptance[i]->init)
+        continue;
+
+      const ThermalParticle& species = m_THM->TPS()->Particles()[i];
+      if (!species.IsStable()) {
+        printf("**WARNING** EventGeneratorBase::SetAcceptedParticlesFastPath: Particle %lld is unstable, acceptance fast path not applied!\n", species.PdgId());
+        continue;
+      }
+
+      m_AcceptanceFast[i] = acceptance[i];
+
+      // Quadrature over the momentum distribution if the generator provides it and the mass is fixed
+      bool fixedmass = !(m_THM->UseWidth() && !species.ZeroWidthEnforced() && !(species.GetResonanceWidthIntegrationType() == ThermalParticle::ZeroWidth));
+      if (species.Statistics() == -1 && m_THM->FullIdealChemicalPotential(i) > species.Mass())
+        fixedmass = false;
+      if (fixedmass) {
+        const Acceptance::AcceptanceFunction* acc = m_AcceptanceFast[i];
+        double ycm = m_AcceptanceYcm;
+        double prob = GetMomentumGenerator(i)->AcceptedFraction(
+          [acc, ycm](double y, double pt) { return acc->getAcceptance(y + ycm, pt); },
+          species.Mass());
+        m_AcceptedMomentumTables[i] = AcceptedMomentumTable(GetMomentumGenerator(i), acc, ycm, species.Mass());
+        if (prob >= 0.) {
+          m_AcceptanceProbabilities[i] = std::min(prob, 1.);
+          continue;
+        }
+      }
+
+      // Monte Carlo estimate otherwise
+      double probsum = 0.;
+      for (int isample = 0; isample < samples; ++isample) {
+        double tmass = SampleParticleMass(i);
+        std::vector<double> momentum = GetMomentumGenerator(i)->GetMomentum(tmass);
+        SimpleParticle part(momentum[0], momentum[1], momentum[2], tmass);
+        probsum += m_AcceptanceFast[i]->getAcceptance(part.GetY() + m_AcceptanceYcm, part.GetPt());
+      }
+      m_AcceptanceProbabilities[i] = probsum / samples;
+    }
+  }
+
+  void EventGeneratorBase::ClearAcceptedParticlesFastPath()
+  {
+    m_AcceptanceFast.clear();
+    m_AcceptanceProbabilities.clear();
+    m_AcceptedMomentumTables.clear();
+  }
+
+  double EventGeneratorBase::AcceptanceProbability(int i) const
+  {
+    if (i < 0 || i >= static_cast<int>(m_AcceptanceProbabilities.size()) || m_AcceptanceFast[i] == NULL)
+      return 1.;
+    return m_AcceptanceProbabilities[i];
+  }
+
   SimpleEvent EventGeneratorBase::GetEvent(bool DoDecays) const
   {
+    THERMALFIST_PROFILE_SCOPE("EventGeneratorBase::GetEvent");
+
     if (!m_THM->IsGCECalculated()) m_THM->CalculateDensitiesGCE();
 
     std::vector<int> totals = GenerateTotals();
@@ -1358,6 +1720,8 @@ namespace thermalfist {
 
   SimpleEvent EventGeneratorBase::PerformDecays(const SimpleEvent& evtin, ThermalParticleSystem* TPS)
   {
+    THERMALFIST_PROFILE_SCOPE("EventGeneratorBase::PerformDecays");
+
     SimpleEvent ret;
     ret.weight = evtin.weight;
     ret.logweight = evtin.logweight;
@@ -1431,6 +1795,7 @@ namespace thermalfist {
                   pdgids.push_back(dpdg);
                 }
                 std::vector<SimpleParticle> decres = ParticleDecaysMC::ManyBodyDecay(primParticles[i][j], masses, pdgids);
+                THERMALFIST_PROFILE_COUNT("EventGeneratorBase::PerformDecays: decays", 1);
                 for (size_t ind = 0; ind < decres.size(); ind++) {
                   decres[ind].processed = false;
                   if (TPS->PdgToId(decres[ind].PDGID) != -1) {
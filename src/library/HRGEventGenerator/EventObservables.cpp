@@ -0,0 +1,521 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2014-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include "HRGEventGenerator/EventObservables.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+using namespace std;
+
+namespace thermalfist {
+
+  namespace {
+    /// Binomial coefficient C(n, k)
+    double Binomial(int n, int k) {
+      double ret = 1.;
+      for (int i = 1; i <= k; ++i)
+        ret = ret * (n - k + i) / i;
+      return ret;
+    }
+  }
+
+  void MomentsAccumulator::Reset()
+  {
+    for (int k = 0; k <= MaxMoment; ++k)
+      m_Sums[k] = 0.;
+    m_Mean = 0.;
+    m_W2Sum = 0.;
+    m_Events = 0;
+  }
+
+  void MomentsAccumulator::Add(double x, double w)
+  {
+    double sums[MaxMoment + 1];
+    sums[0] = w;
+    for (int k = 1; k <= MaxMoment; ++k)
+      sums[k] = 0.;
+    Combine(w, x, sums);
+    m_W2Sum += w * w;
+    m_Events++;
+  }
+
+  void MomentsAccumulator::Merge(const MomentsAccumulator & other)
+  {
+    Combine(other.m_Sums[0], other.m_Mean, other.m_Sums);
+    m_W2Sum += other.m_W2Sum;
+    m_Events += other.m_Events;
+  }
+
+  void MomentsAccumulator::Combine(double W, double mean, const double * sums)
+  {
+    if (W == 0.)
+      return;
+    double WA = m_Sums[0];
+    double Wtot = WA + W;
+    if (Wtot == 0.) {
+      for (int k = 0; k <= MaxMoment; ++k)
+        m_Sums[k] = 0.;
+      m_Mean = 0.;
+      return;
+    }
+
+    // Shifts of the two means relative to the combined one
+    double delta = mean - m_Mean;
+    double dA = -W / Wtot * delta, dB = WA / Wtot * delta;
+
+    double powA[MaxMoment + 1], powB[MaxMoment + 1];
+    powA[0] = powB[0] = 1.;
+    for (int k = 1; k <= MaxMoment; ++k) {
+      powA[k] = powA[k - 1] * dA;
+      powB[k] = powB[k - 1] * dB;
+    }
+
+    // sum_A w (x - mu)^p = sum_k C(p,k) M_{p-k,A} dA^k, with M_0 = W_A and M_1 = 0, and similarly for B
+    double newsums[MaxMoment + 1];
+    for (int p = 2; p <= MaxMoment; ++p) {
+      newsums[p] = 0.;
+      double binom = 1.;
+      for (int k = 0; k <= p; ++k) {
+        if (p - k != 1)
+          newsums[p] += binom * (m_Sums[p - k] * powA[k] + sums[p - k] * powB[k]);
+        binom = binom * (p - k) / (k + 1);
+      }
+    }
+    for (int p = 2; p <= MaxMoment; ++p)
+      m_Sums[p] = newsums[p];
+    m_Sums[0] = Wtot;
+    m_Mean += W / Wtot * delta;
+  }
+
+  double MomentsAccumulator::EffectiveEvents() const
+  {
+    if (m_W2Sum == 0.)
+      return 0.;
+    return m_Sums[0] * m_Sums[0] / m_W2Sum;
+  }
+
+  double MomentsAccumulator::RawMoment(int k) const
+  {
+    if (k < 0 || k > MaxMoment) {
+      printf("**ERROR** MomentsAccumulator::RawMoment(int k): k = %d is out of bounds!\n", k);
+      exit(1);
+    }
+    // <x^k> = sum_i C(k,i) m_i mean^(k-i)
+    double ret = 0., tmpn = 1.;
+    for (int i = k; i >= 0; --i) {
+      ret += Binomial(k, i) * CentralMoment(i) * tmpn;
+      tmpn *= m_Mean;
+    }
+    return ret;
+  }
+
+  double MomentsAccumulator::CentralMoment(int k) const
+  {
+    if (k < 0 || k > MaxMoment) {
+      printf("**ERROR** MomentsAccumulator::CentralMoment(int k): k = %d is out of bounds!\n", k);
+      exit(1);
+    }
+    if (k == 0)
+      return 1.;
+    if (k == 1)
+      return 0.;
+    return m_Sums[k] / m_Sums[0];
+  }
+
+  double MomentsAccumulator::Cumulant(int k) const
+  {
+    if (k == 1)
+      return Mean();
+    if (k == 2)
+      return CentralMoment(2);
+    if (k == 3)
+      return CentralMoment(3);
+    if (k == 4)
+      return CentralMoment(4) - 3. * CentralMoment(2) * CentralMoment(2);
+    if (k == 5)
+      return CentralMoment(5) - 10. * CentralMoment(3) * CentralMoment(2);
+    if (k == 6) {
+      double m2 = CentralMoment(2), m3 = CentralMoment(3);
+      return CentralMoment(6) - 15. * CentralMoment(4) * m2 - 10. * m3 * m3 + 30. * m2 * m2 * m2;
+    }
+    printf("**ERROR** MomentsAccumulator::Cumulant(int k): only cumulants of order 1 to 6 are supported!\n");
+    exit(1);
+    return 0.;
+  }
+
+  double MomentsAccumulator::MeanError() const
+  {
+    return sqrt(Variance() / (EffectiveEvents() - 1.));
+  }
+
+  double MomentsAccumulator::VarianceError() const
+  {
+    double m2 = CentralMoment(2);
+    return sqrt(CentralMoment(4) - m2 * m2) / sqrt(EffectiveEvents());
+  }
+
+  std::vector<double> MomentsAccumulator::NormalizedCentralMoments() const
+  {
+    std::vector<double> mn(MaxMoment + 1, 0.);
+    double sig = sqrt(Variance());
+    double sigk = 1.;
+    mn[0] = 1.;
+    for (int k = 1; k <= MaxMoment; ++k) {
+      sigk *= sig;
+      mn[k] = CentralMoment(k) / sigk;
+    }
+    return mn;
+  }
+
+  double MomentsAccumulator::C3C2() const
+  {
+    return Cumulant(3) / Cumulant(2);
+  }
+
+  double MomentsAccumulator::C3C2Error() const
+  {
+    std::vector<double> mn = NormalizedCentralMoments();
+    double sig2 = Variance();
+    return sqrt((9. - 6. * mn[4] + mn[3] * mn[3] * (6. + mn[4]) - 2. * mn[3] * mn[5] + mn[6]) * sig2) / sqrt(EffectiveEvents());
+  }
+
+  double MomentsAccumulator::C4C2() const
+  {
+    return Cumulant(4) / Cumulant(2);
+  }
+
+  double MomentsAccumulator::C4C2Error() const
+  {
+    std::vector<double> mn = NormalizedCentralMoments();
+    double sig2 = Variance();
+    return sqrt((-9. + 6. * mn[4] * mn[4] + mn[4] * mn[4] * mn[4] + 8. * mn[3] * mn[3] * (5. + mn[4])
+      - 8. * mn[3] * mn[5] + mn[4] * (9. - 2. * mn[6]) - 6. * mn[6] + mn[8]) * sig2 * sig2) / sqrt(EffectiveEvents());
+  }
+
+  double MomentsAccumulator::C5C2() const
+  {
+    return Cumulant(5) / Cumulant(2);
+  }
+
+  double MomentsAccumulator::C5C2Error() const
+  {
+    std::vector<double> mn = NormalizedCentralMoments();
+    double sig2 = Variance();
+    return sqrt((mn[10] - 100. * mn[3] * mn[3] + 10. * mn[3] * (-6. + mn[4]) * mn[5]
+      + mn[4] * (125. * mn[4] + mn[5] * mn[5] - 10. * (90. - mn[6])) - 2. * mn[5] * mn[7]
+      + 20. * (45. + mn[5] * mn[5] + 8. * mn[6] - mn[8])) * sig2 * sig2 * sig2) / sqrt(EffectiveEvents());
+  }
+
+  double MomentsAccumulator::C6C2() const
+  {
+    return Cumulant(6) / Cumulant(2);
+  }
+
+  double MomentsAccumulator::C6C2Error() const
+  {
+    std::vector<double> mn = NormalizedCentralMoments();
+    double sig2 = Variance();
+    double m3sq = mn[3] * mn[3];
+    return sqrt((10575. - 30. * mn[10] + mn[12] + 18300. * m3sq
+      + 2600. * m3sq * m3sq - 225. * (-3. + mn[4]) * (-3. + mn[4]) - 7440. * mn[3] * mn[5]
+      - 520. * m3sq * mn[3] * mn[5] + 216. * mn[5] * mn[5] - 2160. * mn[6] - 200. * m3sq * mn[6] + 52. * mn[3] * mn[5] * mn[6] + 33. * mn[6] * mn[6]
+      + (-3. + mn[4]) * (10. * (405. - 390. * m3sq + 10. * m3sq * m3sq + 24. * mn[3] * mn[5]) - 20. * (6. + m3sq) * mn[6] + mn[6] * mn[6])
+      + 840. * mn[3] * mn[7] - 12. * mn[5] * mn[7] + 345. * mn[8] + 20. * m3sq * mn[8] - 2. * mn[6] * mn[8] - 40. * mn[3] * mn[9])
+      * sig2 * sig2 * sig2 * sig2) / sqrt(EffectiveEvents());
+  }
+
+
+  Histogram1D::Histogram1D(double xmin, double xmax, int nbins) :
+    m_Xmin(xmin), m_Xmax(xmax), m_Bins(nbins)
+  {
+    if (m_Bins < 1)
+      m_Bins = 1;
+    m_dx = (m_Xmax - m_Xmin) / m_Bins;
+    Reset();
+  }
+
+  void Histogram1D::Fill(double x, double w)
+  {
+    // NaN cannot be assigned to any bin
+    if (x != x)
+      return;
+    if (x < m_Xmin) {
+      m_Underflow += w;
+      return;
+    }
+    // Also catches +inf before the conversion to int
+    if (x >= m_Xmax) {
+      m_Overflow += w;
+      return;
+    }
+    int bin = static_cast<int>((x - m_Xmin) / m_dx);
+    if (bin >= m_Bins) {
+      m_Overflow += w;
+      return;
+    }
+    m_Content[bin] += w;
+    m_Content2[bin] += w * w;
+  }
+
+  void Histogram1D::Reset()
+  {
+    m_Content = std::vector<double>(m_Bins, 0.);
+    m_Content2 = std::vector<double>(m_Bins, 0.);
+    m_Underflow = m_Overflow = 0.;
+  }
+
+  void Histogram1D::Merge(const Histogram1D & other)
+  {
+    if (other.m_Bins != m_Bins || other.m_Xmin != m_Xmin || other.m_Xmax != m_Xmax) {
+      printf("**ERROR** Histogram1D::Merge: Binning of the histograms does not match!\n");
+      exit(1);
+    }
+    for (int i = 0; i < m_Bins; ++i) {
+      m_Content[i] += other.m_Content[i];
+      m_Content2[i] += other.m_Content2[i];
+    }
+    m_Underflow += other.m_Underflow;
+    m_Overflow += other.m_Overflow;
+  }
+
+  double Histogram1D::BinError(int bin) const
+  {
+    return sqrt(m_Content2[bin]);
+  }
+
+
+  EventObservablesAccumulator::EventObservablesAccumulator(ThermalParticleSystem * TPS, const Config & config) :
+    m_Config(config)
+  {
+    m_TrackedNumber = static_cast<int>(m_Config.pdgs.size());
+
+    if (TPS == NULL)
+      m_Config.computeNetCharges = false;
+
+    if (m_Config.computeNetCharges) {
+      for (int i = 0; i < TPS->ComponentsNumber(); ++i) {
+        const ThermalParticle &part = TPS->Particle(i);
+        SpeciesInfo info;
+        info.index = -1;
+        for (int chg = 0; chg < 4; ++chg)
+          info.charges[chg] = part.ConservedCharge(static_cast<ConservedCharge::Name>(chg));
+        m_Species[part.PdgId()] = info;
+      }
+    }
+
+    for (int i = 0; i < m_TrackedNumber; ++i) {
+      long long pdg = m_Config.pdgs[i];
+      if (m_Species.count(pdg) == 0) {
+        SpeciesInfo info;
+        for (int chg = 0; chg < 4; ++chg)
+          info.charges[chg] = 0;
+        m_Species[pdg] = info;
+      }
+      m_Species[pdg].index = i;
+    }
+
+    int nobs = m_TrackedNumber + (m_Config.computeNetCharges ? 4 : 0);
+    m_Moments.resize(nobs);
+    m_Values.resize(nobs);
+    if (m_Config.computeCorrelations)
+      m_CrossSums.resize(nobs * (nobs - 1) / 2);
+
+    if (m_Config.computeSpectra) {
+      m_PtHist = std::vector<Histogram1D>(m_TrackedNumber, Histogram1D(0., m_Config.ptMax, m_Config.ptBins));
+      m_YHist = std::vector<Histogram1D>(m_TrackedNumber, Histogram1D(m_Config.yMin, m_Config.yMax, m_Config.yBins));
+      m_MtHist = std::vector<Histogram1D>(m_TrackedNumber, Histogram1D(0., m_Config.mtMax, m_Config.mtBins));
+    }
+
+    Reset();
+  }
+
+  void EventObservablesAccumulator::AddEvent(const SimpleEvent & evt)
+  {
+    double w = evt.weight;
+    int nobs = ObservablesNumber();
+
+    for (int i = 0; i < nobs; ++i)
+      m_Values[i] = 0.;
+
+    for (size_t ip = 0; ip < evt.Particles.size(); ++ip) {
+      const SimpleParticle &part = evt.Particles[ip];
+      std::map<long long, SpeciesInfo>::const_iterator it = m_Species.find(part.PDGID);
+      if (it == m_Species.end())
+        continue;
+
+      const SpeciesInfo &info = it->second;
+      if (m_Config.computeNetCharges) {
+        for (int chg = 0; chg < 4; ++chg)
+          m_Values[m_TrackedNumber + chg] += info.charges[chg];
+      }
+
+      if (info.index >= 0) {
+        m_Values[info.index] += 1.;
+        if (m_Config.computeSpectra) {
+          m_PtHist[info.index].Fill(part.GetPt(), w);
+          m_YHist[info.index].Fill(part.GetY(), w);
+          m_MtHist[info.index].Fill(part.GetMt() - part.m, w);
+        }
+      }
+    }
+
+    // Centred co-moments, updated with the means before this event
+    if (m_Config.computeCorrelations && m_WeightSum + w != 0.) {
+      double factor = w * m_WeightSum / (m_WeightSum + w);
+      int ind = 0;
+      for (int i = 0; i < nobs; ++i) {
+        double dxi = m_Values[i] - m_Moments[i].Mean();
+        for (int j = i + 1; j < nobs; ++j, ++ind)
+          m_CrossSums[ind] += factor * dxi * (m_Values[j] - m_Moments[j].Mean());
+      }
+    }
+
+    for (int i = 0; i < nobs; ++i)
+      m_Moments[i].Add(m_Values[i], w);
+
+    m_Events++;
+    m_WeightSum += w;
+  }
+
+  void EventObservablesAccumulator::Reset()
+  {
+    m_Events = 0;
+    m_WeightSum = 0.;
+    for (size_t i = 0; i < m_Moments.size(); ++i)
+      m_Moments[i].Reset();
+    for (size_t i = 0; i < m_CrossSums.size(); ++i)
+      m_CrossSums[i] = 0.;
+    for (size_t i = 0; i < m_PtHist.size(); ++i) {
+      m_PtHist[i].Reset();
+      m_YHist[i].Reset();
+      m_MtHist[i].Reset();
+    }
+  }
+
+  void EventObservablesAccumulator::Merge(const EventObservablesAccumulator & other)
+  {
+    if (other.m_Moments.size() != m_Moments.size() || other.m_CrossSums.size() != m_CrossSums.size()
+      || other.m_PtHist.size() != m_PtHist.size()) {
+      printf("**ERROR** EventObservablesAccumulator::Merge: Configurations of the accumulators do not match!\n");
+      exit(1);
+    }
+    double Wtot = m_WeightSum + other.m_WeightSum;
+    if (m_CrossSums.size() > 0 && Wtot != 0.) {
+      double factor = m_WeightSum * other.m_WeightSum / Wtot;
+      int nobs = ObservablesNumber();
+      int ind = 0;
+      for (int i = 0; i < nobs; ++i) {
+        double di = other.m_Moments[i].Mean() - m_Moments[i].Mean();
+        for (int j = i + 1; j < nobs; ++j, ++ind)
+          m_CrossSums[ind] += other.m_CrossSums[ind] + factor * di * (other.m_Moments[j].Mean() - m_Moments[j].Mean());
+      }
+    }
+    for (size_t i = 0; i < m_Moments.size(); ++i)
+      m_Moments[i].Merge(other.m_Moments[i]);
+    for (size_t i = 0; i < m_PtHist.size(); ++i) {
+      m_PtHist[i].Merge(other.m_PtHist[i]);
+      m_YHist[i].Merge(other.m_YHist[i]);
+      m_MtHist[i].Merge(other.m_MtHist[i]);
+    }
+    m_Events += other.m_Events;
+    m_WeightSum += other.m_WeightSum;
+  }
+
+  EventObservablesAccumulator EventObservablesAccumulator::Reduce(const std::vector<EventObservablesAccumulator>& parts)
+  {
+    if (parts.size() == 0)
+      return EventObservablesAccumulator();
+
+    std::vector<EventObservablesAccumulator> work = parts;
+    int N = static_cast<int>(work.size());
+    for (int stride = 1; stride < N; stride *= 2) {
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int i = 0; i < N - stride; i += 2 * stride) {
+        work[i].Merge(work[i + stride]);
+      }
+    }
+    return work[0];
+  }
+
+  int EventObservablesAccumulator::SpeciesIndex(long long pdg) const
+  {
+    std::map<long long, SpeciesInfo>::const_iterator it = m_Species.find(pdg);
+    if (it == m_Species.end())
+      return -1;
+    return it->second.index;
+  }
+
+  int EventObservablesAccumulator::NetChargeIndex(ConservedCharge::Name chg) const
+  {
+    if (!m_Config.computeNetCharges)
+      return -1;
+    return m_TrackedNumber + static_cast<int>(chg);
+  }
+
+  const MomentsAccumulator & EventObservablesAccumulator::MomentsByPdg(long long pdg) const
+  {
+    int ind = SpeciesIndex(pdg);
+    if (ind == -1) {
+      printf("**ERROR** EventObservablesAccumulator::MomentsByPdg: Particle %lld is not among the selected species!\n", pdg);
+      exit(1);
+    }
+    return m_Moments[ind];
+  }
+
+  const MomentsAccumulator & EventObservablesAccumulator::NetChargeMoments(ConservedCharge::Name chg) const
+  {
+    int ind = NetChargeIndex(chg);
+    if (ind == -1) {
+      printf("**ERROR** EventObservablesAccumulator::NetChargeMoments: Net-charge moments were not computed!\n");
+      exit(1);
+    }
+    return m_Moments[ind];
+  }
+
+  double EventObservablesAccumulator::Covariance(int i, int j) const
+  {
+    if (i == j)
+      return m_Moments[i].Variance();
+    if (!m_Config.computeCorrelations) {
+      printf("**WARNING** EventObservablesAccumulator::Covariance: Correlations were not computed!\n");
+      return 0.;
+    }
+    if (i > j) {
+      int tmp = i;
+      i = j;
+      j = tmp;
+    }
+    int nobs = ObservablesNumber();
+    // Position of the (i,j) element in the packed upper triangle
+    int ind = i * (2 * nobs - i - 1) / 2 + (j - i - 1);
+    return m_CrossSums[ind] / m_WeightSum;
+  }
+
+  double EventObservablesAccumulator::PearsonCorrelation(int i, int j) const
+  {
+    return Covariance(i, j) / sqrt(m_Moments[i].Variance() * m_Moments[j].Variance());
+  }
+
+  double EventObservablesAccumulator::PerEventYield(const Histogram1D & hist, int bin) const
+  {
+    return hist.BinContent(bin) / m_WeightSum / hist.BinWidth();
+  }
+
+  double EventObservablesAccumulator::PerEventYieldError(const Histogram1D & hist, int bin) const
+  {
+    return hist.BinError(bin) / m_WeightSum / hist.BinWidth();
+  }
+
+} // namespace thermalfist
@@ -97,6 +97,15 @@ namespace thermalfist {
     return m_R * zeta * m_tau * coshetaperp(zeta) * m_R;
   }
 
+  std::vector<double> CylindricalBlastWaveParametrization::ZetaDistributionKey() const
+  {
+    // The shape of the zeta distribution does not depend on tau and R
+    std::vector<double> ret(2);
+    ret[0] = m_BetaS;
+    ret[1] = m_n;
+    return ret;
+  }
+
   CracowFreezeoutParametrization::CracowFreezeoutParametrization(double RoverTauH, double tauH) :
     BoostInvariantFreezeoutParametrization(),
     m_RoverTauH(RoverTauH),
@@ -0,0 +1,625 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2014-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include "HRGEventGenerator/HypersurfaceEventGenerator.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <algorithm>
+
+#include "HRGBase/xMath.h"
+#include "HRGBase/NumericalIntegration.h"
+#include "HRGBase/Profiler.h"
+#include "HRGBase/ThermalModelBase.h"
+
+namespace thermalfist {
+
+  namespace {
+    const char HypersurfaceSignature[] = "TFHYPSRF";
+    const int  HypersurfaceElementFields = 16;
+
+    /// \f$ u^\mu d\sigma_\mu \f$
+    double FlowTimesNormal(const ParticlizationHypersurfaceElement& el)
+    {
+      return el.u[0] * el.dsigma[0] + el.u[1] * el.dsigma[1] + el.u[2] * el.dsigma[2] + el.u[3] * el.dsigma[3];
+    }
+
+    /// Majorant of \f$ p^\mu d\sigma_\mu / E^* \f$, \f$ u^\mu d\sigma_\mu + |d\sigma^*| \f$
+    double MajorantVolume(const ParticlizationHypersurfaceElement& el)
+    {
+      double udsigma = FlowTimesNormal(el);
+      double dsigma2 = el.dsigma[0] * el.dsigma[0] - el.dsigma[1] * el.dsigma[1] - el.dsigma[2] * el.dsigma[2] - el.dsigma[3] * el.dsigma[3];
+      double dsigmaspatial2 = udsigma * udsigma - dsigma2;
+      if (dsigmaspatial2 < 0.)
+        dsigmaspatial2 = 0.;
+      return udsigma + sqrt(dsigmaspatial2);
+    }
+
+    /// Number of bins in u.dsigma / |dsigma*| for the cells where p.dsigma changes sign
+    const int SpacelikeRatioBins = 200;
+
+    /// Angular average of max(0, E r - p cos(theta)) / E at the velocity v = p / E
+    double SpacelikeAngularFactor(double r, double v)
+    {
+      if (v <= r)
+        return r;
+      if (v <= -r)
+        return 0.;
+      return (r + v) * (r + v) / (4. * v);
+    }
+
+    /**
+     * Thermal average of max(0, p.dsigma) / (E |dsigma*|) in the local rest frame
+     * for a cell with u.dsigma = r |dsigma*|.
+     * The momentum integral is split at the velocity v = |r| where the angular factor has a kink.
+     */
+    double SpacelikeYieldFactor(double r, double mass, int statistics, double T, double mu)
+    {
+      std::vector<double> xleg, wleg, xlag, wlag;
+      double pk = (mass > 0. && std::abs(r) < 1.) ? mass * std::abs(r) / sqrt(1. - r * r) : 0.;
+      NumericalIntegration::GetCoefsIntegrateLegendre32(0., pk, &xleg, &wleg);
+      NumericalIntegration::GetCoefsIntegrateLaguerre32(&xlag, &wlag);
+
+      double num = 0., den = 0.;
+      for (int ipart = 0; ipart < 2; ++ipart) {
+        const std::vector<double>& xs = (ipart == 0) ? xleg : xlag;
+        const std::vector<double>& ws = (ipart == 0) ? wleg : wlag;
+        if (ipart == 0 && !(pk > 0.))
+          continue;
+        for (size_t ip = 0; ip < xs.size(); ++ip) {
+          double p = (ipart == 0) ? xs[ip] : pk + T * xs[ip];
+          double w = (ipart == 0) ? ws[ip] : T * ws[ip];
+          double E = sqrt(p * p + mass * mass);
+          double f = p * p / (exp((E - mu) / T) + statistics);
+          if (!(f > 0.) || f != f || f > 1.e300)
+            continue;
+          num += w * f * SpacelikeAngularFactor(r, (E > 0.) ? p / E : 1.);
+          den += w * f;
+        }
+      }
+
+      if (!(den > 0.))
+        return 0.;
+      return num / den;
+    }
+  }
+
+  bool ReadParticlizationHypersurfaceBinary(const std::string& filename, ParticlizationHypersurface& surface)
+  {
+    FILE *fin = fopen(filename.c_str(), "rb");
+    if (fin == NULL) {
+      printf("**WARNING** ReadParticlizationHypersurfaceBinary: Cannot open file %s!\n", filename.c_str());
+      return false;
+    }
+
+    char signature[8];
+    long long elements = 0;
+    if (fread(signature, sizeof(char), 8, fin) != 8
+      || strncmp(signature, HypersurfaceSignature, 8) != 0
+      || fread(&elements, sizeof(long long), 1, fin) != 1
+      || elements < 0) {
+      printf("**WARNING** ReadParticlizationHypersurfaceBinary: %s is not a valid hypersurface file!\n", filename.c_str());
+      fclose(fin);
+      return false;
+    }
+
+    // Check the number of elements against the file size before allocating the memory
+    long datastart = ftell(fin);
+    if (datastart >= 0 && fseek(fin, 0, SEEK_END) == 0) {
+      long fileend = ftell(fin);
+      if (fileend >= 0 && static_cast<double>(elements) * HypersurfaceElementFields * sizeof(double) > static_cast<double>(fileend - datastart)) {
+        printf("**WARNING** ReadParticlizationHypersurfaceBinary: %s is truncated, expected %lld elements!\n", filename.c_str(), elements);
+        fclose(fin);
+        return false;
+      }
+      fseek(fin, datastart, SEEK_SET);
+    }
+
+    surface.resize(elements);
+    std::vector<double> buffer(HypersurfaceElementFields);
+    for (long long i = 0; i < elements; ++i) {
+      if (fread(&buffer[0], sizeof(double), HypersurfaceElementFields, fin) != static_cast<size_t>(HypersurfaceElementFields)) {
+        printf("**WARNING** ReadParticlizationHypersurfaceBinary: Unexpected end of file %s!\n", filename.c_str());
+        surface.resize(i);
+        fclose(fin);
+        return false;
+      }
+      ParticlizationHypersurfaceElement& el = surface[i];
+      el.tau = buffer[0];
+      el.x   = buffer[1];
+      el.y   = buffer[2];
+      el.eta = buffer[3];
+      for (int mu = 0; mu < 4; ++mu) {
+        el.dsigma[mu] = buffer[4 + mu];
+        el.u[mu]      = buffer[8 + mu];
+      }
+      el.T   = buffer[12];
+      el.muB = buffer[13];
+      el.muQ = buffer[14];
+      el.muS = buffer[15];
+    }
+
+    fclose(fin);
+    return true;
+  }
+
+  bool WriteParticlizationHypersurfaceBinary(const std::string& filename, const ParticlizationHypersurface& surface)
+  {
+    FILE *fout = fopen(filename.c_str(), "wb");
+    if (fout == NULL) {
+      printf("**WARNING** WriteParticlizationHypersurfaceBinary: Cannot open file %s!\n", filename.c_str());
+      return false;
+    }
+
+    long long elements = surface.size();
+    bool ok = (fwrite(HypersurfaceSignature, sizeof(char), 8, fout) == 8);
+    ok = ok && (fwrite(&elements, sizeof(long long), 1, fout) == 1);
+
+    std::vector<double> buffer(HypersurfaceElementFields);
+    for (size_t i = 0; i < surface.size() && ok; ++i) {
+      const ParticlizationHypersurfaceElement& el = surface[i];
+      buffer[0] = el.tau;
+      buffer[1] = el.x;
+      buffer[2] = el.y;
+      buffer[3] = el.eta;
+      for (int mu = 0; mu < 4; ++mu) {
+        buffer[4 + mu] = el.dsigma[mu];
+        buffer[8 + mu] = el.u[mu];
+      }
+      buffer[12] = el.T;
+      buffer[13] = el.muB;
+      buffer[14] = el.muQ;
+      buffer[15] = el.muS;
+      ok = (fwrite(&buffer[0], sizeof(double), HypersurfaceElementFields, fout) == static_cast<size_t>(HypersurfaceElementFields));
+    }
+
+    fclose(fout);
+
+    if (!ok)
+      printf("**WARNING** WriteParticlizationHypersurfaceBinary: Error writing file %s!\n", filename.c_str());
+
+    return ok;
+  }
+
+  ParticlizationHypersurface CylindricalBlastWaveHypersurface(double T, double betas, double etamax, double npow,
+    double R, double tau, int nr, int nphi, int neta,
+    double muB, double muQ, double muS)
+  {
+    ParticlizationHypersurface ret(nr * nphi * neta);
+
+    double dr = R / nr;
+    double dphi = 2. * xMath::Pi() / nphi;
+    double deta = 2. * etamax / neta;
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+    for (int ir = 0; ir < nr; ++ir) {
+      double r = (ir + 0.5) * dr;
+      double beta = betas * pow(r / R, npow);
+      double gamma = 1. / sqrt(1. - beta * beta);
+      for (int iphi = 0; iphi < nphi; ++iphi) {
+        double phi = (iphi + 0.5) * dphi;
+        for (int ieta = 0; ieta < neta; ++ieta) {
+          ParticlizationHypersurfaceElement& el = ret[(ir * nphi + iphi) * neta + ieta];
+          el.tau = tau;
+          el.x = r * cos(phi);
+          el.y = r * sin(phi);
+          el.eta = -etamax + (ieta + 0.5) * deta;
+          el.dsigma[0] = tau * r * dr * dphi * deta;
+          el.dsigma[1] = el.dsigma[2] = el.dsigma[3] = 0.;
+          el.u[0] = gamma;
+          el.u[1] = gamma * beta * cos(phi);
+          el.u[2] = gamma * beta * sin(phi);
+          el.u[3] = 0.;
+          el.T = T;
+          el.muB = muB;
+          el.muQ = muQ;
+          el.muS = muS;
+        }
+      }
+    }
+
+    return ret;
+  }
+
+  namespace RandomGenerators {
+
+    HypersurfaceMomentumGenerator::HypersurfaceMomentumGenerator(const ParticlizationHypersurface* surface,
+      const HypersurfaceCellClasses* classes,
+      double mass, int statistics,
+      const std::vector<double>& densities,
+      const std::vector<double>& mus) :
+      m_Surface(surface), m_Classes(classes), m_Mass(mass)
+    {
+      int nclasses = static_cast<int>(m_Classes->Parameters.size());
+      std::vector<double> weights(nclasses, 0.);
+      m_Generators.resize(nclasses);
+      for (int k = 0; k < nclasses; ++k) {
+        weights[k] = densities[k] * m_Classes->MajorantVolumes[k];
+        if (weights[k] > 0.)
+          m_Generators[k] = ThermalMomentumGenerator(m_Mass, statistics, m_Classes->Parameters[k].T, mus[k]);
+      }
+      m_ClassSampler = AliasTable(weights);
+    }
+
+    std::vector<double> HypersurfaceMomentumGenerator::GetMomentum(double mass) const
+    {
+      if (mass < 0.)
+        mass = m_Mass;
+
+      std::vector<double> ret(3, 0.);
+      if (!m_ClassSampler.IsValid())
+        return ret;
+
+      while (true) {
+        int k = m_ClassSampler.GetRandom();
+        const AliasTable& cellsampler = m_Classes->CellSamplers[k];
+        const ParticlizationHypersurfaceElement& el = (*m_Surface)[m_Classes->Cells[k][cellsampler.GetRandom()]];
+
+        // Local rest frame
+        double p = m_Generators[k].GetP(mass);
+        double costh = 2. * randgenMT.rand() - 1.;
+        double sinth = sqrt(1. - costh * costh);
+        double phi = 2. * xMath::Pi() * randgenMT.rand();
+        double pst[3] = { p * sinth * cos(phi), p * sinth * sin(phi), p * costh };
+        double Est = sqrt(p * p + mass * mass);
+
+        // Boost with the flow velocity
+        const double *u = el.u;
+        double updst = u[1] * pst[0] + u[2] * pst[1] + u[3] * pst[2];
+        double E = u[0] * Est + updst;
+        double coef = updst / (u[0] + 1.) + Est;
+        double px = pst[0] + coef * u[1];
+        double py = pst[1] + coef * u[2];
+        double pz = pst[2] + coef * u[3];
+
+        double pdsigma = E * el.dsigma[0] + px * el.dsigma[1] + py * el.dsigma[2] + pz * el.dsigma[3];
+        double wmax = Est * MajorantVolume(el);
+        if (pdsigma <= 0. || randgenMT.rand() * wmax > pdsigma)
+          continue;
+
+        // Longitudinal boost from the local Bjorken frame
+        double cheta = cosh(el.eta), sheta = sinh(el.eta);
+        ret[0] = px;
+        ret[1] = py;
+        ret[2] = E * sheta + pz * cheta;
+        return ret;
+      }
+
+      return ret;
+    }
+
+  }
+
+  HypersurfaceEventGenerator::HypersurfaceEventGenerator(ThermalParticleSystem *TPS, const EventGeneratorConfiguration& config, const ParticlizationHypersurface* surface, double tolerance) :
+    m_Surface(surface), m_ClassTolerance(tolerance)
+  {
+    if (TPS == NULL || m_Surface == NULL)
+      return;
+
+    ProcessHypersurface();
+
+    EventGeneratorConfiguration configmod = config;
+    int nclasses = ThermodynamicClassesNumber();
+    double Vtot = EffectiveVolume();
+    if (nclasses == 0 || !(Vtot > 0.)) {
+      printf("**WARNING** HypersurfaceEventGenerator: The hypersurface has no emitting cells!\n");
+      Vtot = 0.;
+    }
+
+    // Volume-averaged thermal parameters
+    ThermalModelParameters& params = configmod.CFOParameters;
+    params.T = params.muB = params.muQ = params.muS = 0.;
+    for (int k = 0; k < nclasses; ++k) {
+      double wk = (Vtot > 0.) ? m_Classes.Volumes[k] / Vtot : 1. / nclasses;
+      params.T   += wk * m_Classes.Parameters[k].T;
+      params.muB += wk * m_Classes.Parameters[k].muB;
+      params.muQ += wk * m_Classes.Parameters[k].muQ;
+      params.muS += wk * m_Classes.Parameters[k].muS;
+    }
+    params.V = params.SVc = Vtot;
+
+    if (nclasses > 1 && configmod.fEnsemble != EventGeneratorConfiguration::GCE) {
+      printf("**WARNING** HypersurfaceEventGenerator: Thermal parameters vary over the hypersurface. Using the grand-canonical ensemble!\n");
+      configmod.fEnsemble = EventGeneratorConfiguration::GCE;
+    }
+
+    if (HasSpacelikeCells() && configmod.fEnsemble != EventGeneratorConfiguration::GCE) {
+      printf("**WARNING** HypersurfaceEventGenerator: Negative Cooper-Frye contributions of the hypersurface are discarded. Using the grand-canonical ensemble!\n");
+      configmod.fEnsemble = EventGeneratorConfiguration::GCE;
+    }
+
+    SetConfiguration(TPS, configmod);
+
+    CalculateClassDensities();
+
+    SetMomentumGenerators();
+  }
+
+  double HypersurfaceEventGenerator::EffectiveVolume() const
+  {
+    double ret = 0.;
+    for (size_t k = 0; k < m_Classes.Volumes.size(); ++k)
+      ret += m_Classes.Volumes[k];
+    return ret;
+  }
+
+  bool HypersurfaceEventGenerator::HasSpacelikeCells() const
+  {
+    for (size_t k = 0; k < m_Classes.SpacelikeWeights.size(); ++k)
+      for (size_t j = 0; j < m_Classes.SpacelikeWeights[k].size(); ++j)
+        if (m_Classes.SpacelikeWeights[k][j] > 0.)
+          return true;
+    return false;
+  }
+
+  double HypersurfaceEventGenerator::CooperFryeVolume(int i, int k) const
+  {
+    double ret = m_Classes.TimelikeVolumes[k];
+    const std::vector<double>& weights = m_Classes.SpacelikeWeights[k];
+    const ThermalParticle& part = m_THM->TPS()->Particles()[i];
+    for (size_t j = 0; j < weights.size(); ++j) {
+      if (weights[j] > 0.)
+        ret += weights[j] * SpacelikeYieldFactor(-1. + 2. * j / SpacelikeRatioBins,
+          part.Mass(), part.Statistics(), m_Classes.Parameters[k].T, m_ClassChemicalPotentials[k][i]);
+    }
+    return ret;
+  }
+
+  void HypersurfaceEventGenerator::ProcessHypersurface()
+  {
+    int ncells = static_cast<int>(m_Surface->size());
+    std::vector<double> volumes(ncells), majorants(ncells);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+    for (int i = 0; i < ncells; ++i) {
+      volumes[i] = std::max(0., FlowTimesNormal((*m_Surface)[i]));
+      majorants[i] = std::max(0., MajorantVolume((*m_Surface)[i]));
+    }
+
+    // Cells are grouped by the bins of (T, muB, muQ, muS) of width m_ClassTolerance,
+    // or by the exact values if the tolerance is zero
+    m_Classes = HypersurfaceCellClasses();
+    std::map< std::vector<double>, int > classindex;
+    std::vector<double> key(4), values(4);
+    std::vector< std::vector<double> > sums;
+    for (int i = 0; i < ncells; ++i) {
+      if (!(majorants[i] > 0.))
+        continue;
+      const ParticlizationHypersurfaceElement& el = (*m_Surface)[i];
+      values[0] = el.T;
+      values[1] = el.muB;
+      values[2] = el.muQ;
+      values[3] = el.muS;
+      for (int j = 0; j < 4; ++j)
+        key[j] = (m_ClassTolerance > 0.) ? floor(values[j] / m_ClassTolerance + 0.5) : values[j];
+      std::map< std::vector<double>, int >::iterator it = classindex.find(key);
+      int k = 0;
+      if (it == classindex.end()) {
+        k = static_cast<int>(m_Classes.Cells.size());
+        classindex[key] = k;
+        m_Classes.Cells.push_back(std::vector<int>());
+        sums.push_back(std::vector<double>(5, 0.));
+      }
+      else {
+        k = it->second;
+      }
+      m_Classes.Cells[k].push_back(i);
+      for (int j = 0; j < 4; ++j)
+        sums[k][j] += majorants[i] * values[j];
+      sums[k][4] += majorants[i];
+    }
+
+    // The parameters of each class are averaged over its cells
+    int nclasses = static_cast<int>(m_Classes.Cells.size());
+    m_Classes.Parameters.resize(nclasses);
+    for (int k = 0; k < nclasses; ++k) {
+      ThermalModelParameters& params = m_Classes.Parameters[k];
+      params.T   = sums[k][0] / sums[k][4];
+      params.muB = sums[k][1] / sums[k][4];
+      params.muQ = sums[k][2] / sums[k][4];
+      params.muS = sums[k][3] / sums[k][4];
+    }
+
+    m_Classes.CellSamplers.resize(nclasses);
+    m_Classes.Volumes.resize(nclasses);
+    m_Classes.MajorantVolumes.resize(nclasses);
+    m_Classes.TimelikeVolumes.resize(nclasses);
+    m_Classes.SpacelikeWeights.resize(nclasses);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+    for (int k = 0; k < nclasses; ++k) {
+      const std::vector<int>& cells = m_Classes.Cells[k];
+      std::vector<double> weights(cells.size());
+      double Vk = 0.;
+      for (size_t j = 0; j < cells.size(); ++j) {
+        weights[j] = majorants[cells[j]];
+        Vk += volumes[cells[j]];
+      }
+      m_Classes.CellSamplers[k] = RandomGenerators::AliasTable(weights);
+      m_Classes.Volumes[k] = Vk;
+      m_Classes.MajorantVolumes[k] = m_Classes.CellSamplers[k].Normalization();
+
+      // Cells where p.dsigma changes sign, binned in r = u.dsigma / |dsigma*| with linear weights
+      double Vtimelike = 0.;
+      std::vector<double> spacelike(SpacelikeRatioBins + 1, 0.);
+      bool anyspacelike = false;
+      for (size_t j = 0; j < cells.size(); ++j) {
+        double udsigma = FlowTimesNormal((*m_Surface)[cells[j]]);
+        double dsigmast = majorants[cells[j]] - udsigma;
+        if (udsigma >= dsigmast) {
+          Vtimelike += udsigma;
+          continue;
+        }
+        if (udsigma <= -dsigmast)
+          continue;
+        double tx = (udsigma / dsigmast + 1.) / 2. * SpacelikeRatioBins;
+        int ix = std::min(static_cast<int>(tx), SpacelikeRatioBins - 1);
+        spacelike[ix] += (ix + 1 - tx) * dsigmast;
+        spacelike[ix + 1] += (tx - ix) * dsigmast;
+        anyspacelike = true;
+      }
+      m_Classes.TimelikeVolumes[k] = Vtimelike;
+      if (anyspacelike)
+        m_Classes.SpacelikeWeights[k].swap(spacelike);
+    }
+  }
+
+  void HypersurfaceEventGenerator::CalculateClassDensities()
+  {
+    int nclasses = ThermodynamicClassesNumber();
+    int Nspecies = m_THM->TPS()->ComponentsNumber();
+
+    m_ClassDensities.assign(nclasses, std::vector<double>(Nspecies, 0.));
+    m_ClassChemicalPotentials.assign(nclasses, std::vector<double>(Nspecies, 0.));
+
+    if (nclasses == 1) {
+      // The model is already set up with the thermal parameters of the only class
+      if (!m_THM->IsGCECalculated())
+        m_THM->CalculateDensitiesGCE();
+      m_ClassDensities[0] = m_THM->Densities();
+      for (int i = 0; i < Nspecies; ++i)
+        m_ClassChemicalPotentials[0][i] = m_THM->FullIdealChemicalPotential(i);
+    }
+    else if (nclasses > 1) {
+#ifdef USE_OPENMP
+      // Each thread works with its own copy of the model and of the particle list
+#pragma omp parallel
+      {
+        ThermalParticleSystem TPS(*m_THM->TPS());
+        ThermalModelBase *model = m_THM->Clone(&TPS);
+#pragma omp for schedule(dynamic)
+        for (int k = 0; k < nclasses; ++k) {
+          if (model != NULL)
+            CalculateClassDensities(model, k);
+          else {
+#pragma omp critical
+            CalculateClassDensities(m_THM, k);
+          }
+        }
+        if (model != NULL)
+          delete model;
+      }
+#else
+      for (int k = 0; k < nclasses; ++k)
+        CalculateClassDensities(m_THM, k);
+#endif
+
+      // Restore the volume-averaged parameters, used for sampling the resonance masses
+      m_THM->SetParameters(m_Config.CFOParameters);
+      if (!m_Config.fUsePCE)
+        m_THM->FillChemicalPotentials();
+      else
+        m_THM->SetChemicalPotentials(m_Config.fPCEChems);
+      m_THM->CalculateDensitiesGCE();
+      m_DensitiesIdeal = m_THM->GetIdealGasDensities();
+    }
+
+    // Cooper-Frye yields, the negative contributions are discarded as in the momentum sampling
+    m_MeanYields.assign(Nspecies, 0.);
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < Nspecies; ++i)
+      for (int k = 0; k < nclasses; ++k)
+        if (m_ClassDensities[k][i] != 0.)
+          m_MeanYields[i] += m_ClassDensities[k][i] * CooperFryeVolume(i, k);
+  }
+
+  void HypersurfaceEventGenerator::CalculateClassDensities(ThermalModelBase *model, int k)
+  {
+    ThermalModelParameters params = m_Config.CFOParameters;
+    params.T = m_Classes.Parameters[k].T;
+    params.muB = m_Classes.Parameters[k].muB;
+    params.muQ = m_Classes.Parameters[k].muQ;
+    params.muS = m_Classes.Parameters[k].muS;
+    params.V = params.SVc = m_Classes.Volumes[k];
+    model->SetParameters(params);
+    if (!m_Config.fUsePCE)
+      model->FillChemicalPotentials();
+    else
+      model->SetChemicalPotentials(m_Config.fPCEChems);
+    model->CalculatePrimordialDensities();
+    m_ClassDensities[k] = model->Densities();
+    for (int i = 0; i < model->TPS()->ComponentsNumber(); ++i)
+      m_ClassChemicalPotentials[k][i] = model->FullIdealChemicalPotential(i);
+  }
+
+  void HypersurfaceEventGenerator::SetMomentumGenerators()
+  {
+    // The generators are constructed on first use
+    ResetMomentumGenerators();
+  }
+
+  RandomGenerators::ParticleMomentumGenerator* HypersurfaceEventGenerator::CreateMomentumGenerator(int i) const
+  {
+    int nclasses = ThermodynamicClassesNumber();
+    std::vector<double> densities(nclasses), mus(nclasses);
+    for (int k = 0; k < nclasses; ++k) {
+      densities[k] = m_ClassDensities[k][i];
+      mus[k] = m_ClassChemicalPotentials[k][i];
+    }
+    const ThermalParticle& part = m_THM->TPS()->Particles()[i];
+    return new RandomGenerators::HypersurfaceMomentumGenerator(m_Surface, &m_Classes, part.Mass(), part.Statistics(), densities, mus);
+  }
+
+  std::vector<double> HypersurfaceEventGenerator::MomentumGeneratorKey(int i) const
+  {
+    const ThermalParticle& part = m_THM->TPS()->Particles()[i];
+    int nclasses = ThermodynamicClassesNumber();
+    std::vector<double> ret;
+    ret.push_back(part.Mass());
+    ret.push_back(part.Statistics());
+    // Only the relative densities in the different classes matter
+    double norm = 0.;
+    for (int k = 0; k < nclasses; ++k)
+      norm += m_ClassDensities[k][i];
+    for (int k = 0; k < nclasses; ++k) {
+      ret.push_back(m_ClassChemicalPotentials[k][i]);
+      ret.push_back((norm > 0.) ? m_ClassDensities[k][i] / norm : 0.);
+    }
+    return ret;
+  }
+
+  SimpleEvent HypersurfaceEventGenerator::GetEvent(bool DoDecays) const
+  {
+    if (ThermodynamicClassesNumber() <= 1 && !HasSpacelikeCells())
+      return EventGeneratorBase::GetEvent(DoDecays);
+
+    THERMALFIST_PROFILE_SCOPE("EventGeneratorBase::GetEvent");
+
+    // Grand-canonical sampling of the multiplicities for an inhomogeneous hypersurface
+    // or a hypersurface with negative Cooper-Frye contributions
+    std::vector<int> totals(m_MeanYields.size(), 0);
+    {
+      THERMALFIST_PROFILE_SCOPE("EventGeneratorBase::GenerateTotals");
+      for (size_t i = 0; i < m_MeanYields.size(); ++i)
+        totals[i] = RandomGenerators::RandomPoisson(m_MeanYields[i]);
+    }
+
+    SimpleEvent ret = SampleMomenta(totals);
+    ret.weight = 1.;
+    ret.logweight = 0.;
+
+    if (DoDecays)
+      return PerformDecays(ret, m_THM->TPS());
+    else
+      return ret;
+  }
+
+} // namespace thermalfist
@@ -7,7 +7,14 @@
  */
 #include "HRGEventGenerator/RandomGenerators.h"
 
+#include <map>
+#include <mutex>
+#include <algorithm>
+#include <typeinfo>
+#include <limits>
+
 #include "HRGBase/xMath.h"
+#include "HRGBase/NumericalIntegration.h"
 #include "HRGEventGenerator/SimpleParticle.h"
 #include "HRGEventGenerator/ParticleDecaysMC.h"
 
@@ -17,6 +24,36 @@ namespace thermalfist {
 
     MTRand randgenMT;
 
+    namespace {
+      /// Nodes and weights of the composite 32-point Gauss-Legendre quadrature on [a,b]
+      void CompositeLegendre32(double a, double b, int segments, std::vector<double> *x, std::vector<double> *w)
+      {
+        x->clear();
+        w->clear();
+        std::vector<double> xs, ws;
+        double h = (b - a) / segments;
+        for (int iseg = 0; iseg < segments; ++iseg) {
+          NumericalIntegration::GetCoefsIntegrateLegendre32(a + iseg * h, a + (iseg + 1) * h, &xs, &ws);
+          x->insert(x->end(), xs.begin(), xs.end());
+          w->insert(w->end(), ws.begin(), ws.end());
+        }
+      }
+
+      /// Nodes and weights of the composite 10-point Gauss-Legendre quadrature on [a,b]
+      void CompositeLegendre10(double a, double b, int segments, std::vector<double> *x, std::vector<double> *w)
+      {
+        x->clear();
+        w->clear();
+        std::vector<double> xs, ws;
+        double h = (b - a) / segments;
+        for (int iseg = 0; iseg < segments; ++iseg) {
+          NumericalIntegration::GetCoefsIntegrateLegendre10(a + iseg * h, a + (iseg + 1) * h, &xs, &ws);
+          x->insert(x->end(), xs.begin(), xs.end());
+          w->insert(w->end(), ws.begin(), ws.end());
+        }
+      }
+    }
+
     void SetSeed(const unsigned int seed) {
       randgenMT.seed(seed);
     }
@@ -110,6 +147,279 @@ namespace thermalfist {
       //}
     }
 
+    int RandomBinomial(int n, double p) {
+      return RandomBinomial(n, p, randgenMT);
+    }
+
+    int RandomBinomial(int n, double p, MTRand &rangen) {
+      if (n <= 0 || p <= 0.) return 0;
+      if (p >= 1.) return n;
+      if (p > 0.5) return n - RandomBinomial(n, 1. - p, rangen);
+      // Waiting time method: skip over failures using geometrically distributed gaps,
+      // the expected cost is O(n*p) random numbers
+      double logq = log(1. - p);
+      int ret = 0;
+      double pos = 0.;
+      while (true) {
+        pos += floor(log(rangen.randDblExc()) / logq) + 1.;
+        if (pos > n) break;
+        ret++;
+      }
+      return ret;
+    }
+
+    InverseCDFTable::InverseCDFTable(const std::function<double(double)>& f, double xmin, double xmax, double tolerance, int maxpoints) :
+      m_Xmin(xmin), m_Xmax(xmax), m_Total(0.), m_Accuracy(1.)
+    {
+      int n = 64;
+      if (maxpoints < n + 1)
+        maxpoints = n + 1;
+
+      m_f.resize(n + 1);
+      for (int i = 0; i <= n; ++i) {
+        double tf = f(m_Xmin + (m_Xmax - m_Xmin) * i / n);
+        m_f[i] = (tf > 0. && tf == tf && tf < 1.e300) ? tf : 0.;
+      }
+
+      // Piecewise linear density -> trapezoidal CDF
+      m_CDF.resize(n + 1);
+      m_dx = (m_Xmax - m_Xmin) / n;
+      m_CDF[0] = 0.;
+      for (int i = 0; i < n; ++i)
+        m_CDF[i + 1] = m_CDF[i] + 0.5 * m_dx * (m_f[i] + m_f[i + 1]);
+
+      while (2 * n + 1 <= maxpoints) {
+        int n2 = 2 * n;
+        double dx2 = (m_Xmax - m_Xmin) / n2;
+        std::vector<double> f2(n2 + 1), cdf2(n2 + 1);
+        for (int i = 0; i <= n2; ++i) {
+          if (i % 2 == 0)
+            f2[i] = m_f[i / 2];
+          else {
+            double tf = f(m_Xmin + dx2 * i);
+            f2[i] = (tf > 0. && tf == tf && tf < 1.e300) ? tf : 0.;
+          }
+        }
+        cdf2[0] = 0.;
+        for (int i = 0; i < n2; ++i)
+          cdf2[i + 1] = cdf2[i] + 0.5 * dx2 * (f2[i] + f2[i + 1]);
+
+        double err = 0.;
+        if (m_CDF[n] > 0. && cdf2[n2] > 0.) {
+          for (int i = 0; i <= n; ++i)
+            err = std::max(err, fabs(m_CDF[i] / m_CDF[n] - cdf2[2 * i] / cdf2[n2]));
+        }
+        else if (m_CDF[n] != cdf2[n2]) {
+          err = 1.;
+        }
+
+        m_f.swap(f2);
+        m_CDF.swap(cdf2);
+        m_dx = dx2;
+        n = n2;
+        m_Accuracy = err;
+
+        if (err < tolerance)
+          break;
+      }
+
+      m_Total = m_CDF[n];
+    }
+
+    double InverseCDFTable::Sample(double xi) const
+    {
+      double r = xi * m_Total;
+      int k = static_cast<int>(std::upper_bound(m_CDF.begin(), m_CDF.end(), r) - m_CDF.begin()) - 1;
+      if (k < 0)
+        k = 0;
+      if (k > static_cast<int>(m_CDF.size()) - 2)
+        k = static_cast<int>(m_CDF.size()) - 2;
+      r -= m_CDF[k];
+
+      // Invert f0 * t + s * t^2 / 2 = r within the bin
+      double f0 = m_f[k];
+      double s = (m_f[k + 1] - m_f[k]) / m_dx;
+      double disc = f0 * f0 + 2. * s * r;
+      if (disc < 0.)
+        disc = 0.;
+      double denom = f0 + sqrt(disc);
+      double t = (denom > 0.) ? 2. * r / denom : 0.5 * m_dx;
+      if (t < 0.)
+        t = 0.;
+      if (t > m_dx)
+        t = m_dx;
+      return m_Xmin + k * m_dx + t;
+    }
+
+    namespace {
+      typedef std::pair< std::string, std::vector<double> > InverseCDFTableKey;
+      std::map< InverseCDFTableKey, std::shared_ptr<const InverseCDFTable> > InverseCDFTableCache;
+      std::mutex InverseCDFTableCacheMutex;
+      // Protection against unbounded growth, e.g. during fits
+      const size_t InverseCDFTableCacheMaxSize = 10000;
+    }
+
+    std::shared_ptr<const InverseCDFTable> GetCachedInverseCDFTable(const std::string& tag, const std::vector<double>& key,
+      const std::function<double(double)>& f, double xmin, double xmax, double tolerance, int maxpoints)
+    {
+      std::vector<double> fullkey = key;
+      fullkey.push_back(xmin);
+      fullkey.push_back(xmax);
+      fullkey.push_back(tolerance);
+      fullkey.push_back(maxpoints);
+      InverseCDFTableKey tkey(tag, fullkey);
+
+      {
+        std::lock_guard<std::mutex> lock(InverseCDFTableCacheMutex);
+        std::map< InverseCDFTableKey, std::shared_ptr<const InverseCDFTable> >::const_iterator it = InverseCDFTableCache.find(tkey);
+        if (it != InverseCDFTableCache.end())
+          return it->second;
+      }
+
+      // The table is built outside of the lock such that different tables can be built in parallel
+      std::shared_ptr<const InverseCDFTable> ret = std::make_shared<const InverseCDFTable>(f, xmin, xmax, tolerance, maxpoints);
+
+      {
+        std::lock_guard<std::mutex> lock(InverseCDFTableCacheMutex);
+        if (InverseCDFTableCache.size() >= InverseCDFTableCacheMaxSize)
+          InverseCDFTableCache.clear();
+        std::map< InverseCDFTableKey, std::shared_ptr<const InverseCDFTable> >::const_iterator it = InverseCDFTableCache.find(tkey);
+        if (it != InverseCDFTableCache.end())
+          return it->second;
+        InverseCDFTableCache[tkey] = ret;
+      }
+
+      return ret;
+    }
+
+    void ClearInverseCDFTableCache()
+    {
+      std::lock_guard<std::mutex> lock(InverseCDFTableCacheMutex);
+      InverseCDFTableCache.clear();
+    }
+
+    AliasTable::AliasTable(const std::vector<double>& weights) : m_Total(0.)
+    {
+      int n = static_cast<int>(weights.size());
+      m_Probabilities.resize(n);
+      m_Aliases.resize(n);
+
+      std::vector<double> w(n, 0.);
+      for (int i = 0; i < n; ++i) {
+        if (weights[i] > 0. && weights[i] == weights[i] && weights[i] < std::numeric_limits<double>::infinity())
+          w[i] = weights[i];
+        m_Total += w[i];
+      }
+
+      if (!(m_Total > 0.)) {
+        m_Total = 0.;
+        return;
+      }
+
+      std::vector<int> small, large;
+      for (int i = 0; i < n; ++i) {
+        w[i] *= n / m_Total;
+        m_Aliases[i] = i;
+        if (w[i] < 1.)
+          small.push_back(i);
+        else
+          large.push_back(i);
+      }
+
+      while (!small.empty() && !large.empty()) {
+        int l = small.back();
+        small.pop_back();
+        int g = large.back();
+        m_Probabilities[l] = w[l];
+        m_Aliases[l] = g;
+        w[g] = (w[g] + w[l]) - 1.;
+        if (w[g] < 1.) {
+          large.pop_back();
+          small.push_back(g);
+        }
+      }
+
+      // Remaining entries are unity up to round-off errors
+      for (size_t i = 0; i < large.size(); ++i)
+        m_Probabilities[large[i]] = 1.;
+      for (size_t i = 0; i < small.size(); ++i)
+        m_Probabilities[small[i]] = 1.;
+    }
+
+    int AliasTable::Sample(double xi) const
+    {
+      int n = static_cast<int>(m_Probabilities.size());
+      double x = xi * n;
+      int i = static_cast<int>(x);
+      if (i >= n)
+        i = n - 1;
+      if (i < 0)
+        i = 0;
+      return (x - i < m_Probabilities[i]) ? i : m_Aliases[i];
+    }
+
+    namespace {
+      // Inverts the CDF of the linear density f0 (1 - t) + f1 t on [0,1]
+      double InverseLinearCDF(double f0, double f1, double xi)
+      {
+        double r = xi * 0.5 * (f0 + f1);
+        double s = f1 - f0;
+        double disc = f0 * f0 + 2. * s * r;
+        if (disc < 0.)
+          disc = 0.;
+        double denom = f0 + sqrt(disc);
+        double t = (denom > 0.) ? 2. * r / denom : xi;
+        if (t < 0.)
+          t = 0.;
+        if (t > 1.)
+          t = 1.;
+        return t;
+      }
+    }
+
+    InverseCDFTable2D::InverseCDFTable2D(const std::vector< std::vector<double> >& f, double xmin, double xmax, double ymin, double ymax) :
+      m_Xmin(xmin), m_Ymin(ymin), m_dx(1.), m_dy(1.), m_Nx(0), m_Ny(0)
+    {
+      if (f.size() < 2 || f[0].size() < 2)
+        return;
+
+      m_Nx = static_cast<int>(f.size()) - 1;
+      m_Ny = static_cast<int>(f[0].size()) - 1;
+      m_dx = (xmax - xmin) / m_Nx;
+      m_dy = (ymax - ymin) / m_Ny;
+
+      m_f.resize((m_Nx + 1) * (m_Ny + 1));
+      for (int ix = 0; ix <= m_Nx; ++ix) {
+        for (int iy = 0; iy <= m_Ny; ++iy) {
+          double tf = (iy < static_cast<int>(f[ix].size())) ? f[ix][iy] : 0.;
+          m_f[ix * (m_Ny + 1) + iy] = (tf > 0. && tf == tf && tf < 1.e300) ? tf : 0.;
+        }
+      }
+
+      // The integral of the bilinear interpolant over a cell is the average of the corner values
+      std::vector<double> weights(m_Nx * m_Ny);
+      for (int ix = 0; ix < m_Nx; ++ix)
+        for (int iy = 0; iy < m_Ny; ++iy)
+          weights[ix * m_Ny + iy] = 0.25 * (Value(ix, iy) + Value(ix + 1, iy) + Value(ix, iy + 1) + Value(ix + 1, iy + 1));
+      m_Cells = AliasTable(weights);
+    }
+
+    void InverseCDFTable2D::Sample(double xi1, double xi2, double xi3, double& x, double& y) const
+    {
+      int cell = m_Cells.Sample(xi1);
+      int ix = cell / m_Ny;
+      int iy = cell % m_Ny;
+
+      double f00 = Value(ix, iy), f10 = Value(ix + 1, iy), f01 = Value(ix, iy + 1), f11 = Value(ix + 1, iy + 1);
+
+      // Marginal distribution in x is linear, conditional distribution in y at fixed x is linear
+      double u = InverseLinearCDF(f00 + f01, f10 + f11, xi2);
+      double v = InverseLinearCDF((1. - u) * f00 + u * f10, (1. - u) * f01 + u * f11, xi3);
+
+      x = m_Xmin + (ix + u) * m_dx;
+      y = m_Ymin + (iy + v) * m_dy;
+    }
+
     double SkellamProbability(int k, double mu1, double mu2)
     {
       return exp(-(mu1 + mu2)) * pow(sqrt(mu1 / mu2), k) * xMath::BesselI(k, 2. * sqrt(mu1 * mu2));
@@ -246,10 +556,37 @@ namespace thermalfist {
       return g((m1 + m2) / 2., mass);
     }
 
+    void ThermalMomentumGenerator::FixTable()
+    {
+      m_Table.reset();
+      // Bose-Einstein condensation, leave to the rejection sampling
+      if (m_Statistics == -1 && m_Mu >= m_Mass)
+        return;
+
+      std::vector<double> key(4);
+      key[0] = m_Mass;
+      key[1] = m_T;
+      key[2] = m_Mu;
+      key[3] = m_Statistics;
+      const ThermalMomentumGenerator *gen = this;
+      double mass = m_Mass;
+      std::shared_ptr<const InverseCDFTable> table = GetCachedInverseCDFTable("ThermalMomentum", key,
+        [gen, mass](double x) { return gen->g(x, mass); },
+        0., 1.);
+      if (table->IsValid())
+        m_Table = table;
+    }
+
     double ThermalMomentumGenerator::GetP(double mass) const
     {
       if (mass < 0.)
         mass = m_Mass;
+      if (mass == m_Mass && m_Table) {
+        double x0 = m_Table->GetRandom();
+        while (x0 <= 0.)
+          x0 = m_Table->GetRandom();
+        return -log(x0);
+      }
       while (1) {
         double x0 = randgenMT.randDblExc();
 
@@ -280,6 +617,17 @@ namespace thermalfist {
       if (m_FreezeoutModel == NULL) {
         //m_FreezeoutModel = new BoostInvariantFreezeoutParametrization();
       }
+      else if (!m_FreezeoutModel->InverseZetaDistributionIsExplicit()) {
+        const BoostInvariantFreezeoutParametrization *model = m_FreezeoutModel;
+        std::function<double(double)> zetaprob = [model](double zeta) { return model->ZetaProbability(zeta); };
+        std::vector<double> key = m_FreezeoutModel->ZetaDistributionKey();
+        if (key.size() > 0)
+          m_ZetaTable = GetCachedInverseCDFTable(std::string("Zeta") + typeid(*m_FreezeoutModel).name(), key, zetaprob, 0., 1.);
+        else
+          m_ZetaTable = std::make_shared<const InverseCDFTable>(zetaprob, 0., 1.);
+        if (!m_ZetaTable->IsValid())
+          m_ZetaTable.reset();
+      }
     }
 
     BoostInvariantMomentumGenerator::~BoostInvariantMomentumGenerator()
@@ -350,10 +698,165 @@ namespace thermalfist {
       return ret;
     }
 
+    double BoostInvariantMomentumGenerator::AcceptedFraction(const std::function<double(double, double)>& acceptance, double mass) const
+    {
+      if (m_FreezeoutModel == NULL)
+        return -1.;
+
+      if (mass < 0.)
+        mass = Mass();
+
+      // The accepted particles are distributed as
+      // rho(y,pT) ~ pT \int dzeta w(zeta) \int deta \int dpsi f(u.p) max(0, p.dsigma)
+      // with w(zeta) = ZetaProbability(zeta) / [cosh(rho) R' - sinh(rho) tau'], see GetMomentum().
+      // The integrand depends on y and eta only through y - eta, thus
+      // g(pT, y - eta) is tabulated first and the acceptance is then folded over eta.
+      std::vector<double> xpt, wpt, xdy, wdy, xzeta, wzeta, xpsi, wpsi, xeta, weta;
+      CompositeLegendre32(0., 1., 8, &xpt, &wpt);
+      CompositeLegendre32(-6., 6., 4, &xdy, &wdy);
+      CompositeLegendre10(0., 1., 2, &xzeta, &wzeta);
+      CompositeLegendre10(0., xMath::Pi(), 1, &xpsi, &wpsi);
+      if (EtaMax() > 0.)
+        CompositeLegendre10(-EtaMax(), EtaMax(), static_cast<int>(ceil(8. * EtaMax())), &xeta, &weta);
+      else {
+        xeta.assign(1, 0.);
+        weta.assign(1, 1.);
+      }
+      double etanorm = 0.;
+      for (size_t ieta = 0; ieta < weta.size(); ++ieta)
+        etanorm += weta[ieta];
+
+      std::vector<double> wz(xzeta.size()), chr(xzeta.size()), shr(xzeta.size()), dR(xzeta.size()), dtau(xzeta.size());
+      for (size_t iz = 0; iz < xzeta.size(); ++iz) {
+        double zeta = xzeta[iz];
+        chr[iz] = m_FreezeoutModel->coshetaperp(zeta);
+        shr[iz] = m_FreezeoutModel->sinhetaperp(zeta);
+        dR[iz] = m_FreezeoutModel->dRdZeta(zeta);
+        dtau[iz] = m_FreezeoutModel->dtaudZeta(zeta);
+        wz[iz] = wzeta[iz] * m_FreezeoutModel->ZetaProbability(zeta) / (chr[iz] * dR[iz] - shr[iz] * dtau[iz]);
+      }
+
+      double total = 0., accepted = 0.;
+      for (size_t ipt = 0; ipt < xpt.size(); ++ipt) {
+        if (xpt[ipt] <= 0.)
+          continue;
+        double pt = -log(xpt[ipt]);
+        double mt = sqrt(pt * pt + mass * mass);
+        for (size_t idy = 0; idy < xdy.size(); ++idy) {
+          double mtch = mt * cosh(xdy[idy]);
+          double g = 0.;
+          for (size_t iz = 0; iz < xzeta.size(); ++iz) {
+            for (size_t ipsi = 0; ipsi < xpsi.size(); ++ipsi) {
+              double ptcos = pt * cos(xpsi[ipsi]);
+              double pdsigma = dR[iz] * mtch - dtau[iz] * ptcos;
+              if (pdsigma <= 0.)
+                continue;
+              g += wz[iz] * wpsi[ipsi] * m_Generator.Occupation(chr[iz] * mtch - shr[iz] * ptcos) * pdsigma;
+            }
+          }
+          g *= wpt[ipt] * wdy[idy] * pt / xpt[ipt];
+          if (g == 0.)
+            continue;
+
+          double acc = 0.;
+          for (size_t ieta = 0; ieta < xeta.size(); ++ieta)
+            acc += weta[ieta] * acceptance(xdy[idy] + xeta[ieta], pt);
+
+          total += g;
+          accepted += g * acc / etanorm;
+        }
+      }
+
+      if (!(total > 0.))
+        return -1.;
+      return accepted / total;
+    }
+
+    namespace {
+      // Linear interpolation of values tabulated at x = xmin + i * dx, x is assumed to be within the table
+      double LinearInterpolation(const std::vector<double>& f, double xmin, double dx, double x)
+      {
+        double tx = (x - xmin) / dx;
+        int i = std::min(std::max(static_cast<int>(tx), 0), static_cast<int>(f.size()) - 2);
+        return f[i] + (tx - i) * (f[i + 1] - f[i]);
+      }
+    }
+
+    bool BoostInvariantMomentumGenerator::YPtDensity(const std::vector<double>& ys, const std::vector<double>& pts, std::vector< std::vector<double> >& density, double mass) const
+    {
+      if (m_FreezeoutModel == NULL)
+        return false;
+
+      if (mass < 0.)
+        mass = Mass();
+
+      // rho(y,pT) = \int_{-etamax}^{etamax} deta g(pT, y - eta), see AcceptedFraction().
+      // g is tabulated in y - eta for each pT, the eta integral is then
+      // the difference of its cumulative integral G.
+      const int nd = 480;
+      const double dmax = 6.;
+      double dd = 2. * dmax / nd;
+
+      std::vector<double> xzeta, wzeta, xpsi, wpsi;
+      CompositeLegendre10(0., 1., 2, &xzeta, &wzeta);
+      CompositeLegendre10(0., xMath::Pi(), 1, &xpsi, &wpsi);
+
+      std::vector<double> wz(xzeta.size()), chr(xzeta.size()), shr(xzeta.size()), dR(xzeta.size()), dtau(xzeta.size());
+      for (size_t iz = 0; iz < xzeta.size(); ++iz) {
+        double zeta = xzeta[iz];
+        chr[iz] = m_FreezeoutModel->coshetaperp(zeta);
+        shr[iz] = m_FreezeoutModel->sinhetaperp(zeta);
+        dR[iz] = m_FreezeoutModel->dRdZeta(zeta);
+        dtau[iz] = m_FreezeoutModel->dtaudZeta(zeta);
+        wz[iz] = wzeta[iz] * m_FreezeoutModel->ZetaProbability(zeta) / (chr[iz] * dR[iz] - shr[iz] * dtau[iz]);
+      }
+
+      density.assign(ys.size(), std::vector<double>(pts.size(), 0.));
+      std::vector<double> g(nd + 1), G(nd + 1);
+      for (size_t ipt = 0; ipt < pts.size(); ++ipt) {
+        double pt = pts[ipt];
+        double mt = sqrt(pt * pt + mass * mass);
+        for (int id = 0; id <= nd; ++id) {
+          double mtch = mt * cosh(-dmax + id * dd);
+          double tg = 0.;
+          for (size_t iz = 0; iz < xzeta.size(); ++iz) {
+            for (size_t ipsi = 0; ipsi < xpsi.size(); ++ipsi) {
+              double ptcos = pt * cos(xpsi[ipsi]);
+              double pdsigma = dR[iz] * mtch - dtau[iz] * ptcos;
+              if (pdsigma <= 0.)
+                continue;
+              tg += wz[iz] * wpsi[ipsi] * m_Generator.Occupation(chr[iz] * mtch - shr[iz] * ptcos) * pdsigma;
+            }
+          }
+          g[id] = pt * tg;
+        }
+
+        G[0] = 0.;
+        for (int id = 0; id < nd; ++id)
+          G[id + 1] = G[id] + 0.5 * dd * (g[id] + g[id + 1]);
+
+        for (size_t iy = 0; iy < ys.size(); ++iy) {
+          if (EtaMax() > 0.) {
+            double dhi = std::min(std::max(ys[iy] + EtaMax(), -dmax), dmax);
+            double dlo = std::min(std::max(ys[iy] - EtaMax(), -dmax), dmax);
+            density[iy][ipt] = LinearInterpolation(G, -dmax, dd, dhi) - LinearInterpolation(G, -dmax, dd, dlo);
+          }
+          else if (ys[iy] >= -dmax && ys[iy] <= dmax) {
+            density[iy][ipt] = LinearInterpolation(g, -dmax, dd, ys[iy]);
+          }
+        }
+      }
+
+      return true;
+    }
+
     double BoostInvariantMomentumGenerator::GetRandomZeta(MTRand& rangen) const
     {
       if (m_FreezeoutModel->InverseZetaDistributionIsExplicit())
         return m_FreezeoutModel->InverseZetaDistribution(rangen.rand());
+
+      if (m_ZetaTable)
+        return m_ZetaTable->GetRandom(rangen);
       
       while (1) {
         double zetacand = rangen.rand();
@@ -772,6 +1275,82 @@ namespace thermalfist {
         return RandomBesselNormal(a, nu, rangen);
     }
 
+    double SiemensRasmussenMomentumGeneratorGeneralized::AcceptedFraction(const std::function<double(double, double)>& acceptance, double mass) const
+    {
+      if (mass < 0.)
+        mass = GetMass();
+
+      // The lab frame distribution is isotropic, with
+      // dN/dp ~ p^2 / E \int dcos(alpha) E* f(E*),  E* = gamma (E - beta p cos(alpha)),
+      // where alpha is the angle between the particle momentum and the flow velocity
+      double beta = GetBeta();
+      double gamma = 1. / sqrt(1. - beta * beta);
+      std::vector<double> xp, wp, xcos, wcos;
+      CompositeLegendre32(0., 1., 8, &xp, &wp);
+      CompositeLegendre32(-1., 1., 4, &xcos, &wcos);
+
+      double total = 0., accepted = 0.;
+      for (size_t ip = 0; ip < xp.size(); ++ip) {
+        if (xp[ip] <= 0.)
+          continue;
+        double p = -log(xp[ip]);
+        double en = sqrt(p * p + mass * mass);
+
+        double dndp = 0.;
+        for (size_t ia = 0; ia < xcos.size(); ++ia) {
+          double enst = gamma * (en - beta * p * xcos[ia]);
+          dndp += wcos[ia] * enst * m_Generator.Occupation(enst);
+        }
+        dndp *= wp[ip] * p * p / en / xp[ip];
+
+        double acc = 0.;
+        for (size_t ith = 0; ith < xcos.size(); ++ith) {
+          double pz = p * xcos[ith];
+          double pt = p * sqrt(1. - xcos[ith] * xcos[ith]);
+          double y = 0.5 * log((en + pz) / (en - pz));
+          acc += 0.5 * wcos[ith] * acceptance(y, pt);
+        }
+
+        total += dndp;
+        accepted += dndp * acc;
+      }
+
+      if (!(total > 0.))
+        return -1.;
+      return accepted / total;
+    }
+
+    bool SiemensRasmussenMomentumGeneratorGeneralized::YPtDensity(const std::vector<double>& ys, const std::vector<double>& pts, std::vector< std::vector<double> >& density, double mass) const
+    {
+      if (mass < 0.)
+        mass = GetMass();
+
+      // dN/dy dpT ~ pT \int dcos(alpha) E* f(E*), see AcceptedFraction()
+      double beta = GetBeta();
+      double gamma = 1. / sqrt(1. - beta * beta);
+      std::vector<double> xcos, wcos;
+      CompositeLegendre32(-1., 1., 4, &xcos, &wcos);
+
+      density.assign(ys.size(), std::vector<double>(pts.size(), 0.));
+      for (size_t iy = 0; iy < ys.size(); ++iy) {
+        for (size_t ipt = 0; ipt < pts.size(); ++ipt) {
+          double pt = pts[ipt];
+          double mt = sqrt(pt * pt + mass * mass);
+          double en = mt * cosh(ys[iy]);
+          double pz = mt * sinh(ys[iy]);
+          double p = sqrt(pt * pt + pz * pz);
+          double dens = 0.;
+          for (size_t ia = 0; ia < xcos.size(); ++ia) {
+            double enst = gamma * (en - beta * p * xcos[ia]);
+            dens += wcos[ia] * enst * m_Generator.Occupation(enst);
+          }
+          density[iy][ipt] = pt * dens;
+        }
+      }
+
+      return true;
+    }
+
     std::vector<double> SiemensRasmussenMomentumGeneratorGeneralized::GetMomentum(double mass) const
     {
       if (mass < 0.)
@@ -819,252 +1398,45 @@ namespace thermalfist {
 
   namespace RandomGenerators {
 
-    void SSHMomentumGenerator::FixParameters() {
-      {
-        double eps = 1e-8;
-        double l = 0., r = 1.;
-        double m1 = l + (r - l) / 3.;
-        double m2 = r - (r - l) / 3.;
-        int MAXITERS = 200;
-        int iter = 0;
-        while (fabs(m2 - m1) > eps && iter < MAXITERS) {
-          if (g(m1) < g(m2)) {
-            l = m1;
-          }
-          else {
-            r = m2;
-          }
-          m1 = l + (r - l) / 3.;
-          m2 = r - (r - l) / 3.;
-          iter++;
-        }
-        m_MaxPt = g((m1 + m2) / 2.);
-
-        m_dndpt.clear();
-        double dx = m_dPt;
-        for (double x = 0.5 * dx; x <= 1.; x += dx) {
-          m_dndpt.add_val(x, g(x));
-        }
-      }
-
-      {
-        m_dndy.resize(0);
-        m_MaxYs.resize(0);
-        double dx = m_dPt;
-        for (double x = 0.5 * dx; x <= 1.; x += dx) {
-
-          double pt = -log(x);
-
-          double eps = 1e-8;
-          double l = -4. - m_EtaMax, r = 4. + m_EtaMax;
-          double m1 = l + (r - l) / 3.;
-          double m2 = r - (r - l) / 3.;
-          int MAXITERS = 200;
-          int iter = 0;
-          while (fabs(m2 - m1) > eps && iter < MAXITERS) {
-            if (m_distr.dndy(m1, pt) < m_distr.dndy(m2, pt)) {
-              l = m1;
-            }
-            else {
-              r = m2;
-            }
-            m1 = l + (r - l) / 3.;
-            m2 = r - (r - l) / 3.;
-            iter++;
-          }
-          m_MaxYs.push_back(m_distr.dndy((m1 + m2) / 2., pt));
-
-          m_dndy.push_back(SplineFunction());
-          double dy = m_dy;
-          for (double ty = -4. - m_EtaMax + 0.5 * dy; ty <= 4. + m_EtaMax; ty += dy) {
-            m_dndy[m_dndy.size() - 1].add_val(ty, m_distr.dndy(ty, pt));
-          }
-        }
-      }
-    }
-
     void SSHMomentumGenerator::FixParameters2() {
-      {
-        double eps = 1e-8;
-        double l = 0., r = 1.;
-        double m1 = l + (r - l) / 3.;
-        double m2 = r - (r - l) / 3.;
-        int MAXITERS = 200;
-        int iter = 0;
-        while (fabs(m2 - m1) > eps && iter < MAXITERS) {
-          if (g(m1) < g(m2)) {
-            l = m1;
-          }
-          else {
-            r = m2;
-          }
-          m1 = l + (r - l) / 3.;
-          m2 = r - (r - l) / 3.;
-          iter++;
-        }
-        m_MaxPt = g((m1 + m2) / 2.);
-
-        m_dndpt.clear();
-        double dx = m_dPt;
-        for (double x = 0.5 * dx; x <= 1.; x += dx) {
-          m_dndpt.add_val(x, g(x));
-        }
-      }
-
-      {
-        m_dndy.resize(0);
-        m_MaxYs.resize(0);
-        double dx = m_dPt;
-        for (double x = 0.5 * dx; x <= 1.; x += dx) {
-
-          double pt = -log(x);
-
-          double eps = 1e-8;
-          double l = -4. - m_EtaMax, r = 4. + m_EtaMax;
-          double m1 = l + (r - l) / 3.;
-          double m2 = r - (r - l) / 3.;
-          int MAXITERS = 200;
-          int iter = 0;
-          while (fabs(m2 - m1) > eps && iter < MAXITERS) {
-            if (m_distr.dndysingle(m1, pt) < m_distr.dndysingle(m2, pt)) {
-              l = m1;
-            }
-            else {
-              r = m2;
-            }
-            m1 = l + (r - l) / 3.;
-            m2 = r - (r - l) / 3.;
-            iter++;
-          }
-          m_MaxYs.push_back(m_distr.dndysingle((m1 + m2) / 2., pt));
-
-          m_dndy.push_back(SplineFunction());
-          double dy = m_dy;
-          for (double ty = -4. + 0.5 * dy; ty <= 4.; ty += dy) {
-            m_dndy[m_dndy.size() - 1].add_val(ty, m_distr.dndysingle(ty, pt));
-          }
-        }
-      }
-
-    }
-
-    void SSHMomentumGenerator::FindMaximumPt() {
-
-      double eps = 1e-8;
-      double l = 0., r = 1.;
-      double m1 = l + (r - l) / 3.;
-      double m2 = r - (r - l) / 3.;
-      int MAXITERS = 200;
-      int iter = 0;
-      while (fabs(m2 - m1) > eps && iter < MAXITERS) {
-        if (g(m1) < g(m2)) {
-          l = m1;
-        }
-        else {
-          r = m2;
-        }
-        m1 = l + (r - l) / 3.;
-        m2 = r - (r - l) / 3.;
-        iter++;
-      }
-      m_MaxPt = g((m1 + m2) / 2.);
-
-      m_dndpt.clearall();
-      double dx = 0.05;
+      std::vector<double> key(5);
+      key[0] = m_Mass;
+      key[1] = m_T;
+      key[2] = m_BetaS;
+      key[3] = m_n;
+      key[4] = m_EtaMax;
+
+      const SSHMomentumGenerator *gen = this;
+      m_PtTable = GetCachedInverseCDFTable("SSHPt", key,
+        [gen](double x) { return gen->g(x); },
+        0., 1., 1.e-5, 4096);
+
+      // Rapidity distributions at fixed pT at the nodes of x = exp(-pT)
+      const SSHDistribution *distr = &m_distr;
+      m_YTables.resize(0);
+      double dx = m_dPt;
       for (double x = 0.5 * dx; x <= 1.; x += dx) {
-        m_dndpt.add_val(x, g(x));
+        double pt = -log(x);
+        std::vector<double> keyy = key;
+        keyy.push_back(pt);
+        m_YTables.push_back(GetCachedInverseCDFTable("SSHY", keyy,
+          [distr, pt](double ty) { return distr->dndysingle(ty, pt); },
+          -4., 4., 1.e-5, 4096));
       }
     }
 
-    void SSHMomentumGenerator::FindMaximumY(double pt) {
-      double eps = 1e-8;
-      double l = -4. - m_EtaMax, r = 4. + m_EtaMax;
-      double m1 = l + (r - l) / 3.;
-      double m2 = r - (r - l) / 3.;
-      int MAXITERS = 200;
-      int iter = 0;
-      while (fabs(m2 - m1) > eps && iter < MAXITERS) {
-        if (m_distr.dndy(m1, pt) < m_distr.dndy(m2, pt)) {
-          l = m1;
-        }
-        else {
-          r = m2;
-        }
-        m1 = l + (r - l) / 3.;
-        m2 = r - (r - l) / 3.;
-        iter++;
-      }
-      m_MaxY = m_distr.dndy((m1 + m2) / 2., pt);
-    }
-
-    void SSHMomentumGenerator::FindMaximumY2(double pt) {
-      double eps = 1e-8;
-      double l = -4. - m_EtaMax, r = 4. + m_EtaMax;
-      double m1 = l + (r - l) / 3.;
-      double m2 = r - (r - l) / 3.;
-      int MAXITERS = 200;
-      int iter = 0;
-      while (fabs(m2 - m1) > eps && iter < MAXITERS) {
-        if (m_distr.dndysingle(m1, pt) < m_distr.dndysingle(m2, pt)) {
-          l = m1;
-        }
-        else {
-          r = m2;
-        }
-        m1 = l + (r - l) / 3.;
-        m2 = r - (r - l) / 3.;
-        iter++;
-      }
-      m_MaxY = m_distr.dndysingle((m1 + m2) / 2., pt);
-    }
+    std::pair<double, double> SSHMomentumGenerator::GetRandom2(double /*mass*/) const {
+      double x0 = m_PtTable->GetRandom();
+      while (x0 <= 0.)
+        x0 = m_PtTable->GetRandom();
+      double tpt = -log(x0);
 
-    std::pair<double, double> SSHMomentumGenerator::GetRandom(double mass) {
-      double tpt = 0., ty = 0.;
-      while (1) {
-        double x0 = randgenMT.randDblExc();
-        double y0 = m_MaxPt * randgenMT.randDblExc();
-        if (y0 < g2(x0)) {
-          tpt = -log(x0);
-          break;
-        }
-      }
-      while (1) {
-        int ind = (int)(exp(-tpt) / m_dPt);
-        if (ind < 0) ind = 0;
-        if (ind >= static_cast<int>(m_dndy.size())) ind = m_dndy.size() - 1;
-        double x0 = -4. - m_EtaMax + (8. + 2. * m_EtaMax) * randgenMT.randDblExc();
-        double y0 = m_MaxYs[ind] * randgenMT.randDblExc();
-        if (y0 < m_dndy[ind].f(x0)) {
-          ty = x0;
-          break;
-        }
-      }
-      return std::make_pair(tpt, ty);
-    }
+      int ind = (int)(x0 / m_dPt);
+      if (ind < 0) ind = 0;
+      if (ind >= static_cast<int>(m_YTables.size())) ind = m_YTables.size() - 1;
+      double ty = m_YTables[ind]->GetRandom();
+      double teta = -m_EtaMax + 2. * m_EtaMax * randgenMT.randDblExc();
 
-    std::pair<double, double> SSHMomentumGenerator::GetRandom2(double mass) const {
-      double tpt = 0., ty = 0., teta = 0.;
-      while (1) {
-        double x0 = randgenMT.randDblExc();
-        double y0 = m_MaxPt * randgenMT.randDblExc();
-        if (y0 < g2(x0)) {
-          tpt = -log(x0);
-          break;
-        }
-      }
-      while (1) {
-        int ind = (int)(exp(-tpt) / m_dPt);
-        if (ind < 0) ind = 0;
-        if (ind >= static_cast<int>(m_dndy.size())) ind = m_dndy.size() - 1;
-        double x0 = -4. + (8.) * randgenMT.randDblExc();
-        double y0 = m_MaxYs[ind] * randgenMT.randDblExc();
-
-        if (y0 < m_dndy[ind].f(x0)) {
-          ty = x0;
-          teta = -m_EtaMax + 2. * m_EtaMax * randgenMT.randDblExc();
-          break;
-        }
-      }
       return std::make_pair(tpt, ty - teta);
     }
 
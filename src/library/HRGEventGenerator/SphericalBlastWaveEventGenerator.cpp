@@ -78,22 +78,14 @@ namespace thermalfist {
 
   void SphericalBlastWaveEventGenerator::SetMomentumGenerators()
   {
-    ClearMomentumGenerators();
-    m_BWGens.resize(0);
-    if (m_THM != NULL) {
-      for (size_t i = 0; i < m_THM->TPS()->Particles().size(); ++i) {
-        const ThermalParticle& part = m_THM->TPS()->Particles()[i];
-        //m_MomentumGens.push_back(new RandomGenerators::SiemensRasmussenMomentumGeneratorGeneralized(m_T, m_Beta, m_THM->TPS()->Particles()[i].Mass()));
-        m_MomentumGens.push_back(new RandomGenerators::SiemensRasmussenMomentumGeneratorGeneralized(m_T, m_Beta, part.Mass(), part.Statistics(), m_THM->FullIdealChemicalPotential(i)));
-
-        double T = m_THM->Parameters().T;
-        double Mu = m_THM->FullIdealChemicalPotential(i);
-        if (m_THM->TPS()->ResonanceWidthIntegrationType() == ThermalParticle::eBW || m_THM->TPS()->ResonanceWidthIntegrationType() == ThermalParticle::eBWconstBR)
-          m_BWGens.push_back(new RandomGenerators::ThermalEnergyBreitWignerGenerator(&m_THM->TPS()->Particle(i), T, Mu));
-        else
-          m_BWGens.push_back(new RandomGenerators::ThermalBreitWignerGenerator(&m_THM->TPS()->Particle(i), T, Mu));
-      }
-    }
+    // The generators are constructed on first use
+    ResetMomentumGenerators();
+  }
+
+  RandomGenerators::ParticleMomentumGenerator* SphericalBlastWaveEventGenerator::CreateMomentumGenerator(int i) const
+  {
+    const ThermalParticle& part = m_THM->TPS()->Particles()[i];
+    return new RandomGenerators::SiemensRasmussenMomentumGeneratorGeneralized(m_T, m_Beta, part.Mass(), part.Statistics(), GeneratorChemicalPotential(i));
   }
 
 } // namespace thermalfist
\ No newline at end of file
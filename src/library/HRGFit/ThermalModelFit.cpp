@@ -48,156 +48,7 @@ namespace thermalfist {
       ~FitFCN() {}
 
       double operator()(const std::vector<double>& par) const {
-        m_THMFit->Increment();
-        double chi2 = 0.;
-        if (par[2]<0.) return 1e12;
-        if (par[3]<0.) return 1e12;
-
-        m_THMFit->SetParameterValue("T", par[0]);
-        m_THMFit->SetParameterValue("muB", par[1]);
-        m_THMFit->SetParameterValue("gammaS", par[2]);
-        m_THMFit->SetParameterValue("R", par[3]);
-        m_THMFit->SetParameterValue("Rc", par[4]);
-        m_THMFit->SetParameterValue("gammaq", par[5]);
-        m_THMFit->SetParameterValue("muQ", par[6]);
-        m_THMFit->SetParameterValue("muS", par[7]);
-        m_THMFit->SetParameterValue("muC", par[8]);
-        m_THMFit->SetParameterValue("gammac", par[9]);
-        m_THMFit->SetParameterValue("Tkin", par[10]);
-
-        m_THMFit->model()->SetTemperature(par[0]);
-
-        if (!m_THMFit->model()->ConstrainMuB())
-          m_THMFit->model()->SetBaryonChemicalPotential(par[1]);
-
-        m_THMFit->model()->SetGammaS(par[2]);
-
-        m_THMFit->model()->SetVolumeRadius(par[3]);
-
-        if (m_THMFit->FixVcOverV())
-          m_THMFit->model()->SetCanonicalVolume(m_THMFit->model()->Volume() * m_THMFit->VcOverV());
-        else
-          m_THMFit->model()->SetCanonicalVolumeRadius(par[4]);
-
-
-        m_THMFit->model()->SetGammaq(par[5]);
-
-        m_THMFit->model()->SetGammaC(par[9]);
-
-        if (m_THMFit->model()->ConstrainMuQ())
-          m_THMFit->model()->SetElectricChemicalPotential(-par[1] / 50.);
-        else
-          m_THMFit->model()->SetElectricChemicalPotential(par[6]);
-
-        if (m_THMFit->model()->ConstrainMuS())
-          m_THMFit->model()->SetStrangenessChemicalPotential(par[1] / 5.);
-        else
-          m_THMFit->model()->SetStrangenessChemicalPotential(par[7]);
-
-        if (m_THMFit->model()->ConstrainMuC())
-          m_THMFit->model()->SetCharmChemicalPotential(par[1] / 5.);
-        else
-          m_THMFit->model()->SetCharmChemicalPotential(par[8]);
-
-        m_THMFit->model()->SetParameters(m_THMFit->model()->Parameters());
-
-        //m_THMFit->model()->SetQoverB(m_THMFit->QoverB());
-
-        IdealGasFunctions::calculationHadBECIssue = false;
-
-        m_THMFit->model()->ConstrainChemicalPotentials();
-
-        if (m_THMFit->UseTkin()) {
-          m_THMFit->modelpce()->SetChemicalFreezeout(m_THMFit->model()->Parameters(), m_THMFit->model()->ChemicalPotentials());
-          m_THMFit->modelpce()->CalculatePCE(par[10]);
-        }
-        else {
-          m_THMFit->model()->CalculateDensities();
-        }
-
-        // If current chemical potentials lead to
-        // Bose-Einstein function divergence (\mu > m),
-        // then effectively discard parameter of the current iteration by setting chi^2 to 10^12
-        if (IdealGasFunctions::calculationHadBECIssue) {
-          printf("%15d ", m_THMFit->Iters());
-          printf("Issue with Bose-Einstein condensation, discarding this iteration...\n");
-          return m_THMFit->Chi2() = chi2 = 1.e12;
-        }
-        
-        // Ratios first
-        for (size_t i = 0; i < m_THMFit->FittedQuantities().size(); ++i) {
-          if (m_THMFit->FittedQuantities()[i].type == FittedQuantity::Ratio) {
-            const ExperimentRatio &ratio = m_THMFit->FittedQuantities()[i].ratio;
-            double dens1 = m_THMFit->model()->GetDensity(ratio.fPDGID1, ratio.fFeedDown1);
-            double dens2 = m_THMFit->model()->GetDensity(ratio.fPDGID2, ratio.fFeedDown2);
-            double ModelRatio = dens1 / dens2;
-            m_THMFit->ModelData(i) = ModelRatio;
-            if (m_THMFit->FittedQuantities()[i].toFit)
-              chi2 += (ModelRatio - ratio.fValue) * (ModelRatio - ratio.fValue) / ratio.fError / ratio.fError;
-          }
-        }
-
-        // Yields second
-        for (size_t i = 0; i < m_THMFit->FittedQuantities().size(); ++i) {
-          if (m_THMFit->FittedQuantities()[i].type == FittedQuantity::Multiplicity) {
-            const ExperimentMultiplicity &multiplicity = m_THMFit->FittedQuantities()[i].mult;
-            double dens = m_THMFit->model()->GetDensity(multiplicity.fPDGID, multiplicity.fFeedDown);
-            double ModelMult = dens * m_THMFit->model()->Parameters().V;
-            m_THMFit->ModelData(i) = ModelMult;
-            if (m_THMFit->FittedQuantities()[i].toFit)
-              chi2 += (ModelMult - multiplicity.fValue) * (ModelMult - multiplicity.fValue) / multiplicity.fError / multiplicity.fError;
-          }
-        }
-
-        if (m_verbose) {
-          printf("%15d ", m_THMFit->Iters());
-          printf("%15lf ", chi2);
-          if (m_THMFit->Parameters().T.toFit)
-            printf("%15lf ", par[0]);
-          if (m_THMFit->Parameters().muB.toFit)
-            printf("%15lf ", m_THMFit->model()->Parameters().muB);
-          if (m_THMFit->Parameters().muQ.toFit)
-            printf("%15lf ", m_THMFit->model()->Parameters().muQ);
-          if (m_THMFit->Parameters().muS.toFit)
-            printf("%15lf ", m_THMFit->model()->Parameters().muS);
-          if (m_THMFit->Parameters().muC.toFit)
-            printf("%15lf ", m_THMFit->model()->Parameters().muC);
-          if (m_THMFit->Parameters().R.toFit)
-            printf("%15lf ", par[3]);
-          if (m_THMFit->Parameters().Rc.toFit)
-            printf("%15lf ", par[4]);
-          if (m_THMFit->Parameters().gammaq.toFit)
-            printf("%15lf ", m_THMFit->model()->Parameters().gammaq);
-          if (m_THMFit->Parameters().gammaS.toFit)
-            printf("%15lf ", m_THMFit->model()->Parameters().gammaS);
-          if (m_THMFit->Parameters().gammaC.toFit)
-            printf("%15lf ", m_THMFit->model()->Parameters().gammaC);
-          if (m_THMFit->Parameters().Tkin.toFit)
-            printf("%15lf ", par[10]);
-          printf("\n");
-
-          if (m_THMFit->model()->Ensemble() == ThermalModelBase::CE)
-            printf("B = %10.5lf\tQ = %10.5lf\tS = %10.5lf\tC = %10.5lf\n", 
-              m_THMFit->model()->CalculateBaryonDensity() * m_THMFit->model()->Parameters().V,
-              m_THMFit->model()->CalculateChargeDensity() * m_THMFit->model()->Parameters().V, 
-              m_THMFit->model()->CalculateStrangenessDensity() * m_THMFit->model()->Parameters().V,
-              m_THMFit->model()->CalculateCharmDensity() * m_THMFit->model()->Parameters().V);
-        }
-
-        m_THMFit->Chi2() = chi2;
-        if (m_THMFit->model()->Ensemble() == ThermalModelBase::CE) {
-          m_THMFit->BT()   = m_THMFit->model()->CalculateBaryonDensity()      * m_THMFit->model()->Parameters().V;
-          m_THMFit->QT()   = m_THMFit->model()->CalculateChargeDensity()      * m_THMFit->model()->Parameters().V;
-          m_THMFit->ST()   = m_THMFit->model()->CalculateStrangenessDensity() * m_THMFit->model()->Parameters().V;
-          m_THMFit->CT()   = m_THMFit->model()->CalculateCharmDensity()       * m_THMFit->model()->Parameters().V;
-        }
-
-        if (chi2!=chi2) {
-          chi2 = 1.e12;
-          printf("**WARNING** chi2 evaluated to NaN\n");
-        }
-
-        return chi2;
+        return m_THMFit->EvaluateChi2(par, m_verbose);
       }
 
       double Up() const {return 1.;}
@@ -222,8 +73,8 @@ namespace thermalfist {
   {
   }
 
-  ThermalModelFitParameters ThermalModelFit::PerformFit(bool verbose, bool AsymmErrors) {
-  #ifdef USE_MINUIT
+  void ThermalModelFit::PrepareFit()
+  {
     m_ModelData.resize(m_Quantities.size(), 0.);
 
     m_Parameters.B = m_model->Parameters().B;
@@ -239,34 +90,6 @@ namespace thermalfist {
     }
 
     m_Iters = 0;
-    FitFCN mfunc(this, verbose);
-    std::vector<double> params(11, 0.);
-    params[0] = m_Parameters.T.value;
-    params[1] = m_Parameters.muB.value;
-    params[2] = m_Parameters.gammaS.value;
-    params[3] = m_Parameters.R.value;
-    params[4] = m_Parameters.Rc.value;
-    params[5] = m_Parameters.gammaq.value;
-    params[6] = m_Parameters.muQ.value;
-    params[7] = m_Parameters.muS.value;
-    params[8] = m_Parameters.muC.value;
-    params[9] = m_Parameters.gammaC.value;
-    params[10] = m_Parameters.Tkin.value;
-
-    MnUserParameters upar;
-    upar.Add("T", m_Parameters.T.value, m_Parameters.T.error, m_Parameters.T.xmin, m_Parameters.T.xmax);
-    upar.Add("muB", m_Parameters.muB.value, m_Parameters.muB.error, m_Parameters.muB.xmin, m_Parameters.muB.xmax);
-    upar.Add("gammaS", m_Parameters.gammaS.value, m_Parameters.gammaS.error, m_Parameters.gammaS.xmin, m_Parameters.gammaS.xmax);
-    upar.Add("R", m_Parameters.R.value, m_Parameters.R.error, m_Parameters.R.xmin, m_Parameters.R.xmax);
-    upar.Add("Rc", m_Parameters.Rc.value, m_Parameters.Rc.error, m_Parameters.Rc.xmin, m_Parameters.Rc.xmax);
-    upar.Add("gammaq", m_Parameters.gammaq.value, m_Parameters.gammaq.error, m_Parameters.gammaq.xmin, m_Parameters.gammaq.xmax);
-    upar.Add("muQ", m_Parameters.muQ.value, m_Parameters.muQ.error, m_Parameters.muQ.xmin, m_Parameters.muQ.xmax);
-    upar.Add("muS", m_Parameters.muS.value, m_Parameters.muS.error, m_Parameters.muS.xmin, m_Parameters.muS.xmax);
-    upar.Add("muC", m_Parameters.muC.value, m_Parameters.muC.error, m_Parameters.muC.xmin, m_Parameters.muC.xmax);
-    upar.Add("gammaC", m_Parameters.gammaC.value, m_Parameters.gammaC.error, m_Parameters.gammaC.xmin, m_Parameters.gammaC.xmax);
-    upar.Add("Tkin", m_Parameters.Tkin.value, m_Parameters.Tkin.error, m_Parameters.Tkin.xmin, m_Parameters.Tkin.xmax);
-
-    int nparams = 11;
 
     // If only ratios fitted then volume drops out
     //if (m_Multiplicities.size() == 0 && m_model->Ensemble() == ThermalModelBase::GCE)
@@ -313,6 +136,196 @@ namespace thermalfist {
     if (!UseTkin())
       m_Parameters.SetParameterFitFlag("Tkin", false);
 
+    m_Ndf = GetNdf();
+  }
+
+  double ThermalModelFit::EvaluateChi2(const std::vector<double>& par, bool verbose)
+  {
+    Increment();
+    double chi2 = 0.;
+    if (par[2]<0.) return 1e12;
+    if (par[3]<0.) return 1e12;
+
+    SetParameterValue("T", par[0]);
+    SetParameterValue("muB", par[1]);
+    SetParameterValue("gammaS", par[2]);
+    SetParameterValue("R", par[3]);
+    SetParameterValue("Rc", par[4]);
+    SetParameterValue("gammaq", par[5]);
+    SetParameterValue("muQ", par[6]);
+    SetParameterValue("muS", par[7]);
+    SetParameterValue("muC", par[8]);
+    SetParameterValue("gammac", par[9]);
+    SetParameterValue("Tkin", par[10]);
+
+    model()->SetTemperature(par[0]);
+
+    if (!model()->ConstrainMuB())
+      model()->SetBaryonChemicalPotential(par[1]);
+
+    model()->SetGammaS(par[2]);
+
+    model()->SetVolumeRadius(par[3]);
+
+    if (FixVcOverV())
+      model()->SetCanonicalVolume(model()->Volume() * VcOverV());
+    else
+      model()->SetCanonicalVolumeRadius(par[4]);
+
+
+    model()->SetGammaq(par[5]);
+
+    model()->SetGammaC(par[9]);
+
+    if (model()->ConstrainMuQ())
+      model()->SetElectricChemicalPotential(-par[1] / 50.);
+    else
+      model()->SetElectricChemicalPotential(par[6]);
+
+    if (model()->ConstrainMuS())
+      model()->SetStrangenessChemicalPotential(par[1] / 5.);
+    else
+      model()->SetStrangenessChemicalPotential(par[7]);
+
+    if (model()->ConstrainMuC())
+      model()->SetCharmChemicalPotential(par[1] / 5.);
+    else
+      model()->SetCharmChemicalPotential(par[8]);
+
+    model()->SetParameters(model()->Parameters());
+
+    //model()->SetQoverB(QoverB());
+
+    IdealGasFunctions::calculationHadBECIssue = false;
+
+    model()->ConstrainChemicalPotentials();
+
+    if (UseTkin()) {
+      modelpce()->SetChemicalFreezeout(model()->Parameters(), model()->ChemicalPotentials());
+      modelpce()->CalculatePCE(par[10]);
+    }
+    else {
+      model()->CalculateDensities();
+    }
+
+    // If current chemical potentials lead to
+    // Bose-Einstein function divergence (\mu > m),
+    // then effectively discard parameter of the current iteration by setting chi^2 to 10^12
+    if (IdealGasFunctions::calculationHadBECIssue) {
+      printf("%15d ", Iters());
+      printf("Issue with Bose-Einstein condensation, discarding this iteration...\n");
+      return Chi2() = chi2 = 1.e12;
+    }
+    
+    // Ratios first
+    for (size_t i = 0; i < FittedQuantities().size(); ++i) {
+      if (FittedQuantities()[i].type == FittedQuantity::Ratio) {
+        const ExperimentRatio &ratio = FittedQuantities()[i].ratio;
+        double dens1 = model()->GetDensity(ratio.fPDGID1, ratio.fFeedDown1);
+        double dens2 = model()->GetDensity(ratio.fPDGID2, ratio.fFeedDown2);
+        double ModelRatio = dens1 / dens2;
+        ModelData(i) = ModelRatio;
+        if (FittedQuantities()[i].toFit)
+          chi2 += (ModelRatio - ratio.fValue) * (ModelRatio - ratio.fValue) / ratio.fError / ratio.fError;
+      }
+    }
+
+    // Yields second
+    for (size_t i = 0; i < FittedQuantities().size(); ++i) {
+      if (FittedQuantities()[i].type == FittedQuantity::Multiplicity) {
+        const ExperimentMultiplicity &multiplicity = FittedQuantities()[i].mult;
+        double dens = model()->GetDensity(multiplicity.fPDGID, multiplicity.fFeedDown);
+        double ModelMult = dens * model()->Parameters().V;
+        ModelData(i) = ModelMult;
+        if (FittedQuantities()[i].toFit)
+          chi2 += (ModelMult - multiplicity.fValue) * (ModelMult - multiplicity.fValue) / multiplicity.fError / multiplicity.fError;
+      }
+    }
+
+    if (verbose) {
+      printf("%15d ", Iters());
+      printf("%15lf ", chi2);
+      if (Parameters().T.toFit)
+        printf("%15lf ", par[0]);
+      if (Parameters().muB.toFit)
+        printf("%15lf ", model()->Parameters().muB);
+      if (Parameters().muQ.toFit)
+        printf("%15lf ", model()->Parameters().muQ);
+      if (Parameters().muS.toFit)
+        printf("%15lf ", model()->Parameters().muS);
+      if (Parameters().muC.toFit)
+        printf("%15lf ", model()->Parameters().muC);
+      if (Parameters().R.toFit)
+        printf("%15lf ", par[3]);
+      if (Parameters().Rc.toFit)
+        printf("%15lf ", par[4]);
+      if (Parameters().gammaq.toFit)
+        printf("%15lf ", model()->Parameters().gammaq);
+      if (Parameters().gammaS.toFit)
+        printf("%15lf ", model()->Parameters().gammaS);
+      if (Parameters().gammaC.toFit)
+        printf("%15lf ", model()->Parameters().gammaC);
+      if (Parameters().Tkin.toFit)
+        printf("%15lf ", par[10]);
+      printf("\n");
+
+      if (model()->Ensemble() == ThermalModelBase::CE)
+        printf("B = %10.5lf\tQ = %10.5lf\tS = %10.5lf\tC = %10.5lf\n", 
+          model()->CalculateBaryonDensity() * model()->Parameters().V,
+          model()->CalculateChargeDensity() * model()->Parameters().V, 
+          model()->CalculateStrangenessDensity() * model()->Parameters().V,
+          model()->CalculateCharmDensity() * model()->Parameters().V);
+    }
+
+    Chi2() = chi2;
+    if (model()->Ensemble() == ThermalModelBase::CE) {
+      BT()   = model()->CalculateBaryonDensity()      * model()->Parameters().V;
+      QT()   = model()->CalculateChargeDensity()      * model()->Parameters().V;
+      ST()   = model()->CalculateStrangenessDensity() * model()->Parameters().V;
+      CT()   = model()->CalculateCharmDensity()       * model()->Parameters().V;
+    }
+
+    if (chi2!=chi2) {
+      chi2 = 1.e12;
+      printf("**WARNING** chi2 evaluated to NaN\n");
+    }
+
+    return chi2;
+  }
+
+  ThermalModelFitParameters ThermalModelFit::PerformFit(bool verbose, bool AsymmErrors) {
+  #ifdef USE_MINUIT
+    PrepareFit();
+
+    FitFCN mfunc(this, verbose);
+    std::vector<double> params(11, 0.);
+    params[0] = m_Parameters.T.value;
+    params[1] = m_Parameters.muB.value;
+    params[2] = m_Parameters.gammaS.value;
+    params[3] = m_Parameters.R.value;
+    params[4] = m_Parameters.Rc.value;
+    params[5] = m_Parameters.gammaq.value;
+    params[6] = m_Parameters.muQ.value;
+    params[7] = m_Parameters.muS.value;
+    params[8] = m_Parameters.muC.value;
+    params[9] = m_Parameters.gammaC.value;
+    params[10] = m_Parameters.Tkin.value;
+
+    MnUserParameters upar;
+    upar.Add("T", m_Parameters.T.value, m_Parameters.T.error, m_Parameters.T.xmin, m_Parameters.T.xmax);
+    upar.Add("muB", m_Parameters.muB.value, m_Parameters.muB.error, m_Parameters.muB.xmin, m_Parameters.muB.xmax);
+    upar.Add("gammaS", m_Parameters.gammaS.value, m_Parameters.gammaS.error, m_Parameters.gammaS.xmin, m_Parameters.gammaS.xmax);
+    upar.Add("R", m_Parameters.R.value, m_Parameters.R.error, m_Parameters.R.xmin, m_Parameters.R.xmax);
+    upar.Add("Rc", m_Parameters.Rc.value, m_Parameters.Rc.error, m_Parameters.Rc.xmin, m_Parameters.Rc.xmax);
+    upar.Add("gammaq", m_Parameters.gammaq.value, m_Parameters.gammaq.error, m_Parameters.gammaq.xmin, m_Parameters.gammaq.xmax);
+    upar.Add("muQ", m_Parameters.muQ.value, m_Parameters.muQ.error, m_Parameters.muQ.xmin, m_Parameters.muQ.xmax);
+    upar.Add("muS", m_Parameters.muS.value, m_Parameters.muS.error, m_Parameters.muS.xmin, m_Parameters.muS.xmax);
+    upar.Add("muC", m_Parameters.muC.value, m_Parameters.muC.error, m_Parameters.muC.xmin, m_Parameters.muC.xmax);
+    upar.Add("gammaC", m_Parameters.gammaC.value, m_Parameters.gammaC.error, m_Parameters.gammaC.xmin, m_Parameters.gammaC.xmax);
+    upar.Add("Tkin", m_Parameters.Tkin.value, m_Parameters.Tkin.error, m_Parameters.Tkin.xmin, m_Parameters.Tkin.xmax);
+
+    int nparams = 11;
+
     if (!m_Parameters.T.toFit) { upar.Fix("T"); nparams--; }
     if (!m_Parameters.R.toFit) { upar.Fix("R"); nparams--; }
     if (!m_Parameters.Rc.toFit) { upar.Fix("Rc"); nparams--; }
@@ -326,8 +339,6 @@ namespace thermalfist {
     if (!m_Parameters.Tkin.toFit) { upar.Fix("Tkin"); nparams--; }
 
 
-    m_Ndf = GetNdf();
-
     bool repeat = 0;
 
     ThermalModelFitParameters ret;
@@ -0,0 +1,480 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2014-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include "HRGFit/ThermalModelFitMCMC.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+namespace thermalfist {
+
+  namespace {
+    const char ChainFileSignature[] = "TFMCMC01";
+
+    /// Names of the parameters in the order of the argument of ThermalModelFit::EvaluateChi2()
+    const char* const Chi2ParameterNames[] = { "T", "muB", "gammaS", "R", "Rc", "gammaq", "muQ", "muS", "muC", "gammaC", "Tkin" };
+    const int Chi2ParametersNumber = 11;
+
+    /// Quantile of a sorted sample, with linear interpolation
+    double SortedQuantile(const vector<double>& sorted, double q)
+    {
+      if (sorted.size() == 0)
+        return 0.;
+      double pos = q * (sorted.size() - 1);
+      size_t ind = static_cast<size_t>(pos);
+      if (ind + 1 >= sorted.size())
+        return sorted.back();
+      return sorted[ind] + (pos - ind) * (sorted[ind + 1] - sorted[ind]);
+    }
+  }
+
+  ThermalModelFitMCMC::ThermalModelFitMCMC(ThermalModelFit *fit, int walkers, unsigned int seed) :
+    m_Fits(1, fit), m_RandomGenerator(seed)
+  {
+    Init(walkers);
+  }
+
+  ThermalModelFitMCMC::ThermalModelFitMCMC(const std::vector<ThermalModelFit*>& fits, int walkers, unsigned int seed) :
+    m_Fits(fits), m_RandomGenerator(seed)
+  {
+    if (m_Fits.size() == 0) {
+      printf("**ERROR** ThermalModelFitMCMC: No ThermalModelFit objects provided!\n");
+      exit(1);
+    }
+    Init(walkers);
+  }
+
+  ThermalModelFitMCMC::~ThermalModelFitMCMC()
+  {
+  }
+
+  void ThermalModelFitMCMC::Init(int walkers)
+  {
+    m_Walkers = walkers;
+    m_StretchParameter = 2.;
+    m_Steps = 0;
+    m_Proposed = m_Accepted = 0;
+    m_OutputFile = "";
+  }
+
+  void ThermalModelFitMCMC::PrepareParameters()
+  {
+    for (size_t i = 0; i < m_Fits.size(); ++i)
+      m_Fits[i]->PrepareFit();
+
+    const ThermalModelFitParameters &params = m_Fits[0]->Parameters();
+
+    m_Indices.clear();
+    m_Chi2Indices.clear();
+    m_Lower.clear();
+    m_Upper.clear();
+    m_BaseParameters.resize(Chi2ParametersNumber);
+    for (int k = 0; k < Chi2ParametersNumber; ++k) {
+      const FitParameter &par = params.GetParameter(Chi2ParameterNames[k]);
+      m_BaseParameters[k] = par.value;
+      if (par.toFit) {
+        m_Indices.push_back(params.IndexByName(Chi2ParameterNames[k]));
+        m_Chi2Indices.push_back(k);
+        m_Lower.push_back(par.xmin);
+        m_Upper.push_back(par.xmax);
+      }
+    }
+
+    int dim = Dimension();
+    if (m_Walkers < 2 * dim) {
+      printf("**WARNING** ThermalModelFitMCMC::Initialize(): The number of walkers %d is too small for %d parameters, using %d walkers\n",
+        m_Walkers, dim, 2 * dim);
+      m_Walkers = 2 * dim;
+    }
+    if (m_Walkers % 2 != 0)
+      m_Walkers++;
+  }
+
+  void ThermalModelFitMCMC::Initialize(double spread)
+  {
+    PrepareParameters();
+
+    const ThermalModelFitParameters &params = m_Fits[0]->Parameters();
+
+    int dim = Dimension();
+    vector<double> mean(dim), sigma(dim);
+    for (int d = 0; d < dim; ++d) {
+      const FitParameter &par = params.GetParameter(m_Indices[d]);
+      mean[d] = par.value;
+      sigma[d] = (par.error > 0. ? par.error : 1.e-3 * (par.xmax - par.xmin));
+    }
+
+    m_Positions.assign(m_Walkers, vector<double>(dim));
+    for (int w = 0; w < m_Walkers; ++w) {
+      for (int d = 0; d < dim; ++d) {
+        double val = mean[d] + spread * sigma[d] * m_RandomGenerator.randNorm(0., 1.);
+        int iters = 0;
+        while ((val < m_Lower[d] || val > m_Upper[d]) && iters < 100) {
+          val = mean[d] + spread * sigma[d] * m_RandomGenerator.randNorm(0., 1.);
+          iters++;
+        }
+        m_Positions[w][d] = min(max(val, m_Lower[d]), m_Upper[d]);
+      }
+    }
+
+    EvaluateChi2(m_Positions, m_PositionsChi2);
+
+    m_Steps = 0;
+    m_Chain.clear();
+    m_Chi2.clear();
+    m_Proposed = m_Accepted = 0;
+    RecordStep();
+  }
+
+  bool ThermalModelFitMCMC::SetOutputFile(const std::string & filename, bool resume)
+  {
+    m_OutputFile = "";
+
+    if (resume) {
+      // The walkers are placed from the file, their chi2 is not re-evaluated
+      if (m_Positions.size() == 0)
+        PrepareParameters();
+
+      int dim = Dimension();
+      vector<int> indices;
+      int walkers = 0;
+      vector<double> chain, chi2;
+      if (ReadChainFile(filename, indices, walkers, chain, chi2) && indices == m_Indices && walkers == m_Walkers && chi2.size() > 0) {
+        m_Chain = chain;
+        m_Chi2 = chi2;
+        m_Steps = chi2.size() / m_Walkers;
+        m_Positions.assign(m_Walkers, vector<double>(dim));
+        m_PositionsChi2.resize(m_Walkers);
+        for (int w = 0; w < m_Walkers; ++w) {
+          for (int d = 0; d < dim; ++d)
+            m_Positions[w][d] = Value(m_Steps - 1, w, d);
+          m_PositionsChi2[w] = Chi2(m_Steps - 1, w);
+        }
+        m_Proposed = m_Accepted = 0;
+
+        // Drop an incomplete last step, if any
+        long long size = 8 + sizeof(int) * (2 + dim) + static_cast<long long>(m_Chi2.size()) * (dim + 1) * sizeof(double);
+        FILE *f = fopen(filename.c_str(), "rb");
+        vector<char> buffer(static_cast<size_t>(size));
+        bool ok = (f != NULL && fread(&buffer[0], sizeof(char), buffer.size(), f) == buffer.size());
+        if (f != NULL)
+          fclose(f);
+        f = ok ? fopen(filename.c_str(), "wb") : NULL;
+        ok = (f != NULL && fwrite(&buffer[0], sizeof(char), buffer.size(), f) == buffer.size());
+        if (f != NULL)
+          fclose(f);
+        if (!ok) {
+          printf("**WARNING** ThermalModelFitMCMC::SetOutputFile(): Cannot write to file %s\n", filename.c_str());
+          return false;
+        }
+
+        m_OutputFile = filename;
+        return true;
+      }
+      printf("**WARNING** ThermalModelFitMCMC::SetOutputFile(): Cannot resume the chain from file %s, starting a new one\n", filename.c_str());
+    }
+
+    if (m_Positions.size() == 0)
+      Initialize();
+
+    int dim = Dimension();
+
+    FILE *f = fopen(filename.c_str(), "wb");
+    if (f == NULL) {
+      printf("**WARNING** ThermalModelFitMCMC::SetOutputFile(): Cannot create file %s\n", filename.c_str());
+      return false;
+    }
+    int header[2] = { dim, m_Walkers };
+    bool ok = (fwrite(ChainFileSignature, sizeof(char), 8, f) == 8);
+    ok = ok && (fwrite(header, sizeof(int), 2, f) == 2);
+    ok = ok && (dim == 0 || fwrite(&m_Indices[0], sizeof(int), dim, f) == static_cast<size_t>(dim));
+    for (size_t i = 0; ok && i < m_Chi2.size(); ++i) {
+      ok = ok && (dim == 0 || fwrite(&m_Chain[i * dim], sizeof(double), dim, f) == static_cast<size_t>(dim));
+      ok = ok && (fwrite(&m_Chi2[i], sizeof(double), 1, f) == 1);
+    }
+    fclose(f);
+    if (!ok) {
+      printf("**WARNING** ThermalModelFitMCMC::SetOutputFile(): Cannot write to file %s\n", filename.c_str());
+      return false;
+    }
+
+    m_OutputFile = filename;
+    return true;
+  }
+
+  void ThermalModelFitMCMC::Run(int steps, bool verbose)
+  {
+    if (m_Positions.size() == 0)
+      Initialize();
+
+    int dim = Dimension();
+    int half = m_Walkers / 2;
+    double a = m_StretchParameter;
+
+    vector< vector<double> > proposals(half, vector<double>(dim));
+    vector<double> zs(half), accepts(half), proposalsChi2;
+
+    for (int step = 0; step < steps; ++step) {
+      for (int h = 0; h < 2; ++h) {
+        int first = h * half;
+        int other = (1 - h) * half;
+
+        // The random numbers are generated serially
+        for (int k = 0; k < half; ++k) {
+          double u = m_RandomGenerator.rand();
+          zs[k] = (1. + (a - 1.) * u) * (1. + (a - 1.) * u) / a;
+          int j = other + static_cast<int>(m_RandomGenerator.randInt(half - 1));
+          for (int d = 0; d < dim; ++d)
+            proposals[k][d] = m_Positions[j][d] + zs[k] * (m_Positions[first + k][d] - m_Positions[j][d]);
+          accepts[k] = m_RandomGenerator.randDblExc();
+        }
+
+        EvaluateChi2(proposals, proposalsChi2);
+
+        for (int k = 0; k < half; ++k) {
+          m_Proposed++;
+          if (!IsInBounds(proposals[k]))
+            continue;
+          double lnratio = (dim - 1) * log(zs[k]) - 0.5 * (proposalsChi2[k] - m_PositionsChi2[first + k]);
+          if (log(accepts[k]) < lnratio) {
+            m_Positions[first + k] = proposals[k];
+            m_PositionsChi2[first + k] = proposalsChi2[k];
+            m_Accepted++;
+          }
+        }
+      }
+
+      RecordStep();
+
+      if (verbose && ((step + 1) % 100 == 0 || step + 1 == steps)) {
+        printf("Step %8d, acceptance fraction %6.3lf, best chi2 %12.5lf\n", m_Steps - 1, AcceptanceFraction(),
+          *min_element(m_PositionsChi2.begin(), m_PositionsChi2.end()));
+        fflush(stdout);
+      }
+    }
+  }
+
+  std::vector<std::string> ThermalModelFitMCMC::ParameterNames() const
+  {
+    vector<string> ret;
+    for (size_t d = 0; d < m_Chi2Indices.size(); ++d)
+      ret.push_back(Chi2ParameterNames[m_Chi2Indices[d]]);
+    return ret;
+  }
+
+  std::vector<double> ThermalModelFitMCMC::Samples(int parameter, int burnin, int thin) const
+  {
+    vector<double> ret;
+    if (thin < 1)
+      thin = 1;
+    for (int step = burnin; step < m_Steps; step += thin)
+      for (int w = 0; w < m_Walkers; ++w)
+        ret.push_back(Value(step, w, parameter));
+    return ret;
+  }
+
+  double ThermalModelFitMCMC::AcceptanceFraction() const
+  {
+    if (m_Proposed == 0)
+      return 0.;
+    return static_cast<double>(m_Accepted) / m_Proposed;
+  }
+
+  std::vector<double> ThermalModelFitMCMC::AutocorrelationTimes(int burnin) const
+  {
+    int dim = Dimension();
+    int n = m_Steps - burnin;
+    vector<double> ret(dim, 0.);
+    if (n < 2)
+      return ret;
+
+    const double window = 5.;
+
+    vector<double> x(static_cast<size_t>(m_Walkers) * n);
+    for (int d = 0; d < dim; ++d) {
+      for (int w = 0; w < m_Walkers; ++w) {
+        double *xw = &x[static_cast<size_t>(w) * n];
+        double mean = 0.;
+        for (int s = 0; s < n; ++s) {
+          xw[s] = Value(burnin + s, w, d);
+          mean += xw[s];
+        }
+        mean /= n;
+        for (int s = 0; s < n; ++s)
+          xw[s] -= mean;
+      }
+
+      // Autocovariance function averaged over the walkers, computed up to the window
+      double acf0 = 0., tau = 1.;
+      for (int t = 0; t < n; ++t) {
+        double acf = 0.;
+        for (int w = 0; w < m_Walkers; ++w) {
+          const double *xw = &x[static_cast<size_t>(w) * n];
+          for (int s = 0; s + t < n; ++s)
+            acf += xw[s] * xw[s + t];
+        }
+        if (t == 0) {
+          acf0 = acf;
+          if (!(acf0 > 0.))
+            break;
+          continue;
+        }
+        tau += 2. * acf / acf0;
+        if (t >= window * tau)
+          break;
+      }
+      ret[d] = tau;
+    }
+    return ret;
+  }
+
+  ThermalModelFitParameters ThermalModelFitMCMC::PosteriorParameters(int burnin, int thin) const
+  {
+    ThermalModelFitParameters ret = m_Fits[0]->Parameters();
+
+    for (int d = 0; d < Dimension(); ++d) {
+      vector<double> samples = Samples(d, burnin, thin);
+      if (samples.size() == 0)
+        continue;
+
+      double mean = 0., mean2 = 0.;
+      for (size_t i = 0; i < samples.size(); ++i) {
+        mean += samples[i];
+        mean2 += samples[i] * samples[i];
+      }
+      mean /= samples.size();
+      mean2 /= samples.size();
+
+      sort(samples.begin(), samples.end());
+      FitParameter &par = ret.GetParameter(m_Indices[d]);
+      par.value = SortedQuantile(samples, 0.5);
+      par.error = sqrt(max(0., mean2 - mean * mean));
+      par.errm = par.value - SortedQuantile(samples, 0.15865);
+      par.errp = SortedQuantile(samples, 0.84135) - par.value;
+    }
+
+    if (m_Chi2.size() > 0) {
+      ret.chi2 = *min_element(m_Chi2.begin(), m_Chi2.end());
+      ret.ndf = m_Fits[0]->GetNdf();
+      ret.chi2ndf = ret.chi2 / ret.ndf;
+    }
+
+    return ret;
+  }
+
+  bool ThermalModelFitMCMC::ReadChainFile(const std::string & filename, std::vector<int>& indices, int & walkers,
+    std::vector<double>& chain, std::vector<double>& chi2)
+  {
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (f == NULL)
+      return false;
+
+    char signature[8];
+    int header[2];
+    bool ok = (fread(signature, sizeof(char), 8, f) == 8 && strncmp(signature, ChainFileSignature, 8) == 0);
+    ok = ok && (fread(header, sizeof(int), 2, f) == 2) && header[0] >= 0 && header[0] <= 11 && header[1] > 0;
+    if (!ok) {
+      fclose(f);
+      return false;
+    }
+
+    int dim = header[0];
+    walkers = header[1];
+    indices.resize(dim);
+    if (dim > 0 && fread(&indices[0], sizeof(int), dim, f) != static_cast<size_t>(dim)) {
+      fclose(f);
+      return false;
+    }
+
+    chain.clear();
+    chi2.clear();
+    vector<double> record(static_cast<size_t>(walkers) * (dim + 1));
+    while (fread(&record[0], sizeof(double), record.size(), f) == record.size()) {
+      for (int w = 0; w < walkers; ++w) {
+        chain.insert(chain.end(), record.begin() + w * (dim + 1), record.begin() + w * (dim + 1) + dim);
+        chi2.push_back(record[w * (dim + 1) + dim]);
+      }
+    }
+
+    fclose(f);
+    return true;
+  }
+
+  void ThermalModelFitMCMC::EvaluateChi2(const std::vector< std::vector<double> >& points, std::vector<double>& chi2)
+  {
+    int NN = points.size();
+    chi2.resize(NN);
+
+    int threads = m_Fits.size();
+    if (threads > NN)
+      threads = NN;
+
+#ifdef USE_OPENMP
+#pragma omp parallel for num_threads(threads) schedule(dynamic)
+#endif
+    for (int k = 0; k < NN; ++k) {
+      // Proposals outside the bounds are rejected without evaluation
+      if (!IsInBounds(points[k])) {
+        chi2[k] = 1.e12;
+        continue;
+      }
+
+      int thread = 0;
+#ifdef USE_OPENMP
+      thread = omp_get_thread_num();
+#endif
+
+      vector<double> par = m_BaseParameters;
+      for (size_t d = 0; d < m_Chi2Indices.size(); ++d)
+        par[m_Chi2Indices[d]] = points[k][d];
+
+      chi2[k] = m_Fits[thread]->EvaluateChi2(par);
+    }
+  }
+
+  bool ThermalModelFitMCMC::IsInBounds(const std::vector<double>& point) const
+  {
+    for (size_t d = 0; d < point.size(); ++d)
+      if (point[d] < m_Lower[d] || point[d] > m_Upper[d])
+        return false;
+    return true;
+  }
+
+  void ThermalModelFitMCMC::RecordStep()
+  {
+    int dim = Dimension();
+    for (int w = 0; w < m_Walkers; ++w) {
+      m_Chain.insert(m_Chain.end(), m_Positions[w].begin(), m_Positions[w].end());
+      m_Chi2.push_back(m_PositionsChi2[w]);
+    }
+    m_Steps++;
+
+    if (m_OutputFile != "") {
+      vector<double> record;
+      record.reserve(static_cast<size_t>(m_Walkers) * (dim + 1));
+      for (int w = 0; w < m_Walkers; ++w) {
+        record.insert(record.end(), m_Positions[w].begin(), m_Positions[w].end());
+        record.push_back(m_PositionsChi2[w]);
+      }
+      FILE *f = fopen(m_OutputFile.c_str(), "ab");
+      if (f == NULL || fwrite(&record[0], sizeof(double), record.size(), f) != record.size())
+        printf("**WARNING** ThermalModelFitMCMC::RecordStep(): Cannot write to file %s\n", m_OutputFile.c_str());
+      if (f != NULL)
+        fclose(f);
+    }
+  }
+
+} // namespace thermalfist
@@ -19,7 +19,8 @@ namespace thermalfist {
     m_ResoWidthCut(LonglivedResoWidthCut),
     m_ChemicalFreezeoutSet(false), 
     m_StabilityFlagsSet(false),
-    m_IsCalculated(false)
+    m_IsCalculated(false),
+    m_UseAnalyticJacobian(true)
   {
     m_model->UsePartialChemicalEquilibrium(true);
   }
@@ -140,9 +141,6 @@ namespace thermalfist {
     
     
 
-    BroydenEquationsPCE eqs(this, mode);
-    Broyden broydn(&eqs);
-
     std::vector<double> PCEParams(m_StableComponentsNumber, 0.);
     int stab_index = 0;
     for (int i = 0; i < m_StabilityFlags.size(); ++i) {
@@ -166,19 +164,203 @@ namespace thermalfist {
     else
       PCEParams.push_back(m_ParametersCurrent.T);
 
-    PCEParams = broydn.Solve(PCEParams);
+    SolvePCE(PCEParams, mode);
+  }
+
+  std::vector<ThermalModelPCE::PCETrajectoryPoint> ThermalModelPCE::CalculatePCETrajectory(const std::vector<double>& params, PCEMode mode)
+  {
+    std::vector<PCETrajectoryPoint> ret(params.size());
 
-    m_ChemCurrent = m_model->ChemicalPotentials();
+    for (size_t k = 0; k < params.size(); ++k) {
+      if (k == 0 || !m_IsCalculated || !m_UseAnalyticJacobian || !IsAnalyticJacobianAvailable()) {
+        CalculatePCE(params[k], mode);
+      }
+      else {
+        // Predictor: the solution is continued along the trajectory, dx/dp = -J^{-1} dF/dp, 
+        // using the derivatives at the previous point
+        // The model corresponds to the previous solution at this point
+        std::vector<double> x = PCEVariables(mode);
+
+        std::vector<double> jacobian, dFdparam;
+        CalculateJacobian(mode, jacobian, dFdparam);
+
+        int N = x.size();
+        MatrixXd Jac = Eigen::Map< Matrix<double, Dynamic, Dynamic, RowMajor> >(&jacobian[0], N, N);
+        VectorXd dFdp = VectorXd::Map(&dFdparam[0], N);
+        VectorXd dxdp = Jac.fullPivLu().solve(dFdp);
+
+        double dparam = 0.;
+        if (mode == 0) {
+          dparam = params[k] - m_ParametersCurrent.T;
+          m_ParametersCurrent.T = params[k];
+        }
+        else {
+          dparam = params[k] - m_ParametersCurrent.V;
+          m_ParametersCurrent.V = params[k];
+        }
+
+        bool predictorValid = true;
+        for (int i = 0; i < N; ++i) {
+          if (dxdp[i] != dxdp[i])
+            predictorValid = false;
+        }
+
+        if (predictorValid) {
+          for (int i = 0; i < N; ++i)
+            x[i] -= dxdp[i] * dparam;
+        }
+        else {
+          jacobian.clear();
+        }
+
+        // Corrector
+        SolvePCE(x, mode, jacobian);
+      }
+
+      PCETrajectoryPoint &point = ret[k];
+      point.Parameters = m_ParametersCurrent;
+      point.ChemicalPotentials = m_ChemCurrent;
+      point.PrimordialYields = m_model->Densities();
+      point.TotalYields = m_model->TotalDensities();
+      for (size_t i = 0; i < point.PrimordialYields.size(); ++i) {
+        point.PrimordialYields[i] *= m_ParametersCurrent.V;
+        point.TotalYields[i] *= m_ParametersCurrent.V;
+      }
+    }
+
+    return ret;
+  }
+
+  void ThermalModelPCE::SolvePCE(const std::vector<double>& x0, PCEMode mode, const std::vector<double>& jacobian)
+  {
+    BroydenEquationsPCE eqs(this, mode);
+    BroydenJacobianPCE jaco(this, mode);
+    bool analytic = m_UseAnalyticJacobian && IsAnalyticJacobianAvailable();
+    if (analytic && static_cast<int>(jacobian.size()) == eqs.Dimension() * eqs.Dimension())
+      jaco.SetInitialJacobian(jacobian);
+    Broyden broydn(&eqs, analytic ? &jaco : NULL);
+
+    std::vector<double> PCEParams = broydn.Solve(x0);
     if (mode == 0)
       m_ParametersCurrent.V = PCEParams[PCEParams.size() - 1];
     else
       m_ParametersCurrent.T = PCEParams[PCEParams.size() - 1];
 
+    m_ChemCurrent = m_model->ChemicalPotentials();
+
     m_model->CalculateFeeddown();
     
     m_IsCalculated = true;
   }
 
+  void ThermalModelPCE::SetPCEVariables(const std::vector<double>& x, int mode)
+  {
+    std::vector<double> Chem(m_model->Densities().size(), 0.);
+    for (size_t i = 0; i < m_EffectiveCharges.size(); ++i) {
+      for (size_t is = 0; is < m_EffectiveCharges[i].size(); ++is) {
+        Chem[i] += m_EffectiveCharges[i][is] * x[is];
+      }
+    }
+
+    m_model->SetChemicalPotentials(Chem);
+    if (mode == 0) {
+      m_ParametersCurrent.V = x[x.size() - 1];
+    }
+    else {
+      m_ParametersCurrent.T = x[x.size() - 1];
+    }
+    m_model->SetParameters(m_ParametersCurrent);
+    //m_model->CalculateDensities();
+    m_model->CalculatePrimordialDensities();
+  }
+
+  std::vector<double> ThermalModelPCE::PCEVariables(int mode) const
+  {
+    std::vector<double> ret(m_StableComponentsNumber + 1, 0.);
+    for (int is = 0; is < m_StableComponentsNumber; ++is)
+      ret[is] = m_ChemCurrent[m_StableMapTo[is]];
+    if (mode == 0)
+      ret[m_StableComponentsNumber] = m_ParametersCurrent.V;
+    else
+      ret[m_StableComponentsNumber] = m_ParametersCurrent.T;
+    return ret;
+  }
+
+  bool ThermalModelPCE::IsAnalyticJacobianAvailable() const
+  {
+    return m_model->InteractionModel() == ThermalModelBase::Ideal && m_model->Ensemble() == ThermalModelBase::GCE;
+  }
+
+  void ThermalModelPCE::CalculateEquationsDerivatives(std::vector< std::vector<double> >& dFdmu, std::vector<double>& dFdT, std::vector<double>& dFdV) const
+  {
+    const ThermalModelParameters &params = m_model->Parameters();
+    const std::vector<double> &dens = m_model->Densities();
+    const std::vector<double> &chem = m_model->ChemicalPotentials();
+    int NN = dens.size();
+    int NS = m_StableComponentsNumber;
+    double T = params.T;
+    double V = params.V;
+
+    // Particle number susceptibilities dn_i/dmu_i of the ideal gas,
+    // the temperature derivatives at fixed mu_i are evaluated numerically
+    std::vector<double> dndmu(NN), dndT(NN), dsdT(NN);
+    double dT = 1.e-5 * T;
+    ThermalModelParameters paramsPlus = params, paramsMinus = params;
+    paramsPlus.T = T + dT;
+    paramsMinus.T = T - dT;
+    for (int i = 0; i < NN; ++i) {
+      const ThermalParticle &part = m_model->TPS()->Particles()[i];
+      dndmu[i] = dens[i] * m_model->ParticleScaledVariance(i) / T;
+      dndT[i] = (part.Density(paramsPlus, IdealGasFunctions::ParticleDensity, m_model->UseWidth(), chem[i])
+        - part.Density(paramsMinus, IdealGasFunctions::ParticleDensity, m_model->UseWidth(), chem[i])) / (2. * dT);
+      dsdT[i] = (part.Density(paramsPlus, IdealGasFunctions::EntropyDensity, m_model->UseWidth(), chem[i])
+        - part.Density(paramsMinus, IdealGasFunctions::EntropyDensity, m_model->UseWidth(), chem[i])) / (2. * dT);
+    }
+
+    double N0S = m_EntropyDensityInit * m_ParametersInit.V;
+
+    dFdmu = std::vector< std::vector<double> >(NS + 1, std::vector<double>(NS, 0.));
+    dFdT = std::vector<double>(NS + 1, 0.);
+    dFdV = std::vector<double>(NS + 1, 0.);
+
+    for (int i = 0; i < NN; ++i) {
+      const std::vector<double> &charges = m_EffectiveCharges[i];
+      for (int is = 0; is < NS; ++is) {
+        if (charges[is] == 0.)
+          continue;
+        double N0 = m_StableDensitiesInit[is] * m_ParametersInit.V;
+        for (int it = 0; it < NS; ++it) {
+          if (charges[it] != 0.)
+            dFdmu[is][it] += V * charges[is] * charges[it] * dndmu[i] / N0;
+        }
+        dFdT[is] += V * charges[is] * dndT[i] / N0;
+        dFdV[is] += charges[is] * dens[i] / N0;
+
+        // Entropy: ds/dmu_i = dn_i/dT
+        dFdmu[NS][is] += V * charges[is] * dndT[i] / N0S;
+      }
+      dFdT[NS] += V * dsdT[i] / N0S;
+    }
+
+    dFdV[NS] = m_model->CalculateEntropyDensity() / N0S;
+  }
+
+  void ThermalModelPCE::CalculateJacobian(int mode, std::vector<double>& jacobian, std::vector<double>& dFdparam) const
+  {
+    std::vector< std::vector<double> > dFdmu;
+    std::vector<double> dFdT, dFdV;
+    CalculateEquationsDerivatives(dFdmu, dFdT, dFdV);
+
+    int N = m_StableComponentsNumber + 1;
+    jacobian.resize(N * N);
+    for (int i = 0; i < N; ++i) {
+      for (int j = 0; j < N - 1; ++j)
+        jacobian[i * N + j] = dFdmu[i][j];
+      jacobian[i * N + N - 1] = (mode == 0) ? dFdV[i] : dFdT[i];
+    }
+    dFdparam = (mode == 0) ? dFdT : dFdV;
+  }
+
   void ThermalModelPCE::PrepareNucleiForPCE(ThermalParticleSystem * TPS)
   {
     ThermalParticleSystem &parts = *TPS;
@@ -356,30 +538,19 @@ namespace thermalfist {
 
   std::vector<double> ThermalModelPCE::BroydenEquationsPCE::Equations(const std::vector<double>& x)
   {
-    std::vector<double> ret(x.size(), 0.);
+    std::vector<double> ret;
+    EvaluateEquations(x, ret);
+    return ret;
+  }
 
-    std::vector<double> Chem(m_THM->ThermalModel()->Densities().size(), 0.);
-    for (int i = 0; i < m_THM->m_EffectiveCharges.size(); ++i) {
-      for (int is = 0; is < m_THM->m_EffectiveCharges[i].size(); ++is) {
-        Chem[i] += m_THM->m_EffectiveCharges[i][is] * x[is];
-      }
-    }
+  void ThermalModelPCE::BroydenEquationsPCE::EvaluateEquations(const std::vector<double>& x, std::vector<double>& ret)
+  {
+    ret.assign(x.size(), 0.);
 
     ThermalModelBase *model = m_THM->ThermalModel();
 
-    model->SetChemicalPotentials(Chem);
-    if (m_Mode == 0) {
-      const double& Vtmp = x[x.size() - 1];
-      m_THM->m_ParametersCurrent.V = Vtmp;
-    }
-    else {
-      const double& Ttmp = x[x.size() - 1];
-      m_THM->m_ParametersCurrent.T = Ttmp;
-    }
+    m_THM->SetPCEVariables(x, m_Mode);
     double V = m_THM->m_ParametersCurrent.V;
-    model->SetParameters(m_THM->m_ParametersCurrent);
-    //model->CalculateDensities();
-    model->CalculatePrimordialDensities();
 
     for (int is = 0; is < m_THM->m_StableComponentsNumber; ++is) {
       double totdens = 0.;
@@ -392,7 +563,48 @@ namespace thermalfist {
     }
 
     ret[ret.size() - 1] = (model->CalculateEntropyDensity() * V) / (m_THM->m_EntropyDensityInit * m_THM->m_ParametersInit.V) - 1.;
+  }
+
+  ThermalModelPCE::BroydenEquationsPCE::~BroydenEquationsPCE()
+  {
+    if (m_Copy != NULL) {
+      delete m_Copy->m_model;
+      delete m_Copy;
+    }
+  }
+
+  BroydenEquations* ThermalModelPCE::BroydenEquationsPCE::Clone() const
+  {
+    // The eBW scheme modifies the particle list during the calculations
+    const ThermalParticleSystem *TPS = m_THM->m_model->TPS();
+    if (TPS->ResonanceWidthIntegrationType() == ThermalParticle::eBW
+      || TPS->ResonanceWidthIntegrationType() == ThermalParticle::eBWconstBR)
+      return NULL;
+
+    ThermalModelBase *model = m_THM->m_model->Clone();
+    if (model == NULL)
+      return NULL;
+
+    ThermalModelPCE *copy = new ThermalModelPCE(*m_THM);
+    copy->m_model = model;
+
+    BroydenEquationsPCE *ret = new BroydenEquationsPCE(copy, m_Mode);
+    ret->m_Copy = copy;
+    return ret;
+  }
+
+  std::vector<double> ThermalModelPCE::BroydenJacobianPCE::Jacobian(const std::vector<double>& x)
+  {
+    if (!m_InitialJacobian.empty()) {
+      std::vector<double> ret;
+      ret.swap(m_InitialJacobian);
+      return ret;
+    }
+
+    m_THM->SetPCEVariables(x, m_Mode);
 
+    std::vector<double> ret, dFdparam;
+    m_THM->CalculateJacobian(m_Mode, ret, dFdparam);
     return ret;
   }
 
@@ -17,6 +17,7 @@
 
 #include "HRGBase/xMath.h"
 #include "HRGEV/ExcludedVolumeHelper.h"
+#include "HRGEV/InteractionParametersIO.h"
 
 #ifdef USE_OPENMP
 #include <omp.h>
@@ -32,7 +33,7 @@ using namespace std;
 namespace thermalfist {
 
   ThermalModelVDW::ThermalModelVDW(ThermalParticleSystem *TPS_, const ThermalModelParameters& params):
-      ThermalModelBase(TPS_, params), m_SearchMultipleSolutions(false), m_TemperatureDependentAB(false)
+      ThermalModelBase(TPS_, params), m_SearchMultipleSolutions(false), m_TemperatureDependentAB(false), m_SolutionsTracking(false)
   {
     m_chi.resize(6);
     for(int i=0;i<6;++i) m_chi[i].resize(3);
@@ -55,6 +56,13 @@ namespace thermalfist {
   {
   }
 
+  ThermalModelVDW* ThermalModelVDW::Clone(ThermalParticleSystem* TPS) const
+  {
+    ThermalModelVDW *ret = new ThermalModelVDW(*this);
+    FinalizeClone(ret, TPS);
+    return ret;
+  }
+
   void ThermalModelVDW::FillChemicalPotentials() {
     ThermalModelBase::FillChemicalPotentials();
     for(size_t i = 0; i < m_MuStar.size(); ++i) 
@@ -73,6 +81,7 @@ namespace thermalfist {
       printf("**WARNING** %s::FillVirial(const vector<double> & ri): size of ri does not match number of hadrons in the list", m_TAG.c_str());
       return;
     }
+    ClearSolutionsCache();
     m_Virial.resize(m_TPS->Particles().size());
     for (int i = 0; i < m_TPS->ComponentsNumber(); ++i) {
       m_Virial[i].resize(m_TPS->Particles().size());
@@ -99,6 +108,7 @@ namespace thermalfist {
       return;
     }
     m_Virial = bij;
+    ClearSolutionsCache();
   }
 
   void ThermalModelVDW::FillAttraction(const vector<vector<double> >& aij)
@@ -108,10 +118,18 @@ namespace thermalfist {
       return;
     }
     m_Attr = aij;
+    ClearSolutionsCache();
   }
 
   void ThermalModelVDW::ReadInteractionParameters(const string & filename)
   {
+    ClearSolutionsCache();
+
+    if (InteractionParametersIO::IsBinaryFile(filename)) {
+      InteractionParametersIO::ReadBinary(filename, m_TPS, m_Virial, &m_Attr);
+      return;
+    }
+
     m_Virial = vector< vector<double> >(m_TPS->Particles().size(), vector<double>(m_TPS->Particles().size(), 0.));
     m_Attr   = vector< vector<double> >(m_TPS->Particles().size(), vector<double>(m_TPS->Particles().size(), 0.));
 
@@ -124,7 +142,7 @@ namespace thermalfist {
       if (elems.size() < 1)
         continue;
       istringstream iss(elems[0]);
-      int pdgid1, pdgid2;
+      long long pdgid1, pdgid2;
       double b, a;
       if (iss >> pdgid1 >> pdgid2 >> b) {
         if (!(iss >> a))
@@ -182,6 +200,7 @@ namespace thermalfist {
       m_Attr = vector< vector<double> >(m_TPS->Particles().size(), vector<double>(m_TPS->Particles().size(), 0.));
       m_VirialdT = vector< vector<double> >(m_TPS->Particles().size(), vector<double>(m_TPS->Particles().size(), 0.));
       m_AttrdT = vector< vector<double> >(m_TPS->Particles().size(), vector<double>(m_TPS->Particles().size(), 0.));
+      ClearSolutionsCache();
   }
 
   std::vector<double> ThermalModelVDW::ComputeNp(const std::vector<double>& dmustar)
@@ -250,90 +269,216 @@ namespace thermalfist {
     for (int i = 0; i < NNdmu; ++i)
       dmuscur[i] = muStarInit[m_MapFromdMuStar[i]] - m_Chem[m_MapFromdMuStar[i]];
 
+    m_LastBroydenSuccessFlag = SolveFromInitialGuess(dmuscur, dmuscur, m_MaxDiff);
+
+    vector<double> ret(NN);
+    for (int i = 0; i < NN; ++i)
+      ret[i] = m_Chem[i] + dmuscur[m_MapTodMuStar[i]];
+
+    return ret;
+  }
+
+  bool ThermalModelVDW::SolveFromInitialGuess(const vector<double>& dmuInit, vector<double>& dmuSol, double& maxdiff)
+  {
     BroydenEquationsVDW eqs(this);
     BroydenJacobianVDW  jac(this);
     Broyden broydn(&eqs, &jac);
     BroydenSolutionCriteriumVDW crit(this);
 
-    dmuscur = broydn.Solve(dmuscur, &crit);
+    dmuSol = broydn.Solve(dmuInit, &crit);
+    maxdiff = broydn.MaxDifference();
 
-    if (broydn.Iterations() == broydn.MaxIterations())
-      m_LastBroydenSuccessFlag = false;
-    else m_LastBroydenSuccessFlag = true;
+    return (broydn.Iterations() != broydn.MaxIterations());
+  }
 
+  double ThermalModelVDW::PressureForShifts(const vector<double>& dmustar)
+  {
+    int NN = m_densities.size();
 
+    double ret = 0.;
+    vector<double> ns(NN, 0.);
+    for (int i = 0; i < NN; ++i) {
+      double mu = m_Chem[i] + dmustar[m_MapTodMuStar[i]];
+      ret += m_TPS->Particles()[i].Density(m_Parameters, IdealGasFunctions::Pressure, m_UseWidth, mu);
+      ns[i] = m_TPS->Particles()[i].Density(m_Parameters, IdealGasFunctions::ParticleDensity, m_UseWidth, mu);
+    }
 
-    m_MaxDiff = broydn.MaxDifference();
+    vector<double> np = ComputeNp(dmustar, ns);
 
-    vector<double> ret(NN);
-    for (int i = 0; i < NN; ++i)
-      ret[i] = m_Chem[i] + dmuscur[m_MapTodMuStar[i]];
+    // sum_ij a_ij n_i n_j = 1/2 sum_i n_i sum_j (a_ij + a_ji) n_j,
+    // where the inner sum only depends on the component of i
+    for (size_t k = 0; k < m_MapFromdMuStar.size(); ++k) {
+      int r = m_MapFromdMuStar[k];
+      double tmp = 0.;
+      for (int j = 0; j < NN; ++j)
+        tmp += (m_Attr[r][j] + m_Attr[j][r]) * np[j];
+      for (size_t m = 0; m < m_dMuStarIndices[k].size(); ++m)
+        ret += -0.5 * tmp * np[m_dMuStarIndices[k][m]];
+    }
 
     return ret;
   }
 
+  namespace {
+    /// Neighbourhood of the thermal parameters (GeV) where the cached solutions are tracked
+    const double SolutionsTrackingTemperatureRange = 0.010;
+    const double SolutionsTrackingChemicalPotentialRange = 0.050;
+
+    /// Two solutions coincide if all the shifts of the chemical potentials agree within this value (GeV)
+    const double SolutionsTolerance = 1.e-6;
+
+    /// Splits the indices 0..iters-1 into levels: the two ends, followed by successive midpoints
+    vector< vector<int> > BisectionLevels(int iters)
+    {
+      vector< vector<int> > ret;
+      if (iters < 1)
+        return ret;
+
+      ret.push_back(vector<int>(1, 0));
+      if (iters > 1)
+        ret[0].push_back(iters - 1);
+
+      vector< pair<int, int> > intervals(1, make_pair(0, iters - 1));
+      while (!intervals.empty()) {
+        vector<int> level;
+        vector< pair<int, int> > next;
+        for (size_t i = 0; i < intervals.size(); ++i) {
+          int a = intervals[i].first, b = intervals[i].second;
+          if (b - a > 1) {
+            int mid = (a + b) / 2;
+            level.push_back(mid);
+            next.push_back(make_pair(a, mid));
+            next.push_back(make_pair(mid, b));
+          }
+        }
+        if (!level.empty())
+          ret.push_back(level);
+        intervals = next;
+      }
+      return ret;
+    }
+  }
+
+  vector<int> ThermalModelVDW::SolveForInitialGuesses(const vector< vector<double> >& guesses, vector<VDWSolution>& solutions)
+  {
+    int nguesses = guesses.size();
+    vector<VDWSolution> sols(nguesses);
+    vector<int> fl(nguesses, 0);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int ig = 0; ig < nguesses; ++ig) {
+      fl[ig] = SolveFromInitialGuess(guesses[ig], sols[ig].dMuStar, sols[ig].MaxDiff);
+      for (size_t i = 0; i < sols[ig].dMuStar.size(); ++i)
+        if (sols[ig].dMuStar[i] != sols[ig].dMuStar[i])
+          fl[ig] = 0;
+      if (fl[ig])
+        sols[ig].Pressure = PressureForShifts(sols[ig].dMuStar);
+    }
+
+    vector<int> ret(nguesses, -1);
+    for (int ig = 0; ig < nguesses; ++ig) {
+      if (!fl[ig])
+        continue;
+      for (size_t isol = 0; isol < solutions.size() && ret[ig] == -1; ++isol) {
+        bool same = true;
+        for (size_t i = 0; i < sols[ig].dMuStar.size() && same; ++i)
+          same = (fabs(sols[ig].dMuStar[i] - solutions[isol].dMuStar[i]) < SolutionsTolerance);
+        if (same)
+          ret[ig] = isol;
+      }
+      if (ret[ig] == -1) {
+        ret[ig] = solutions.size();
+        solutions.push_back(sols[ig]);
+      }
+    }
+    return ret;
+  }
+
   vector<double> ThermalModelVDW::SearchMultipleSolutions(int iters) {
-    vector<double> csol(m_densities.size(), 0.);
-    double Psol = 0.;
-    bool solved = false;
+    int NN = m_densities.size();
+    int NNdmu = m_MapFromdMuStar.size();
+
+    // Initial guesses which scan the baryon chemical potential
+    vector< vector<double> > starts(iters, vector<double>(NNdmu, 0.));
     double muBmin = m_Parameters.muB - 0.5 * xMath::mnucleon();
     double muBmax = m_Parameters.muB + 0.5 * xMath::mnucleon();
     double dmu = (muBmax - muBmin) / iters;
-    vector<double> curmust(m_densities.size(), 0.);
-    double maxdif = 0.;
     for(int isol = 0; isol < iters; ++isol) {
       double tmu = muBmin + (0.5 + isol) * dmu;
-      for(size_t j = 0; j < curmust.size(); ++j) {
-        curmust[j] = m_Chem[j] + (tmu - m_Parameters.muB) * m_Chem[j] / m_Parameters.muB;
-        if (m_TPS->Particles()[j].Statistics()==-1 && curmust[j] > m_TPS->Particles()[j].Mass()) 
-          curmust[j] = 0.98 * m_TPS->Particles()[j].Mass();
+      for(int k = 0; k < NNdmu; ++k) {
+        int j = m_MapFromdMuStar[k];
+        double curmust = m_Chem[j] + (tmu - m_Parameters.muB) * m_Chem[j] / m_Parameters.muB;
+        if (m_TPS->Particles()[j].Statistics()==-1 && curmust > m_TPS->Particles()[j].Mass()) 
+          curmust = 0.98 * m_TPS->Particles()[j].Mass();
+        starts[isol][k] = curmust - m_Chem[j];
       }
+    }
 
-      vector<double> sol = SearchSingleSolution(curmust);
-      bool fl = true;
-      for(size_t i = 0; i < sol.size(); ++i)
-        if (sol[i] != sol[i]) fl = false;
-      fl &= m_LastBroydenSuccessFlag;
-      if (!fl) continue;
+    double params[] = { m_Parameters.T, m_Parameters.muB, m_Parameters.muQ, m_Parameters.muS, m_Parameters.muC };
+    vector<double> curparams(params, params + 5);
 
-      for(int i = 0; i < m_TPS->ComponentsNumber(); ++i) 
-        m_DensitiesId[i] = m_TPS->Particles()[i].Density(m_Parameters, IdealGasFunctions::ParticleDensity, m_UseWidth, sol[i]);
+    vector<VDWSolution> solutions;
 
-      int NN = m_densities.size();
+    // Track the branches found at the previous, neighbouring, point,
+    // the two extreme initial guesses check whether new branches appeared
+    bool tracked = false;
+    if (m_SolutionsTracking && !m_CachedSolutions.empty() && iters > 0
+      && m_CachedSolutionsComponents == m_MapTodMuStar) {
+      bool close = (fabs(curparams[0] - m_CachedSolutionsParameters[0]) < SolutionsTrackingTemperatureRange);
+      for (int i = 1; i < 5; ++i)
+        close &= (fabs(curparams[i] - m_CachedSolutionsParameters[i]) < SolutionsTrackingChemicalPotentialRange);
 
-      MatrixXd densMatrix(NN, NN);
-      VectorXd solVector(NN), xVector(NN);
+      if (close) {
+        vector< vector<double> > guesses = m_CachedSolutions;
+        guesses.push_back(starts[0]);
+        guesses.push_back(starts[iters - 1]);
+        vector<int> inds = SolveForInitialGuesses(guesses, solutions);
 
-      for(int i=0;i<NN;++i)
-        for(int j=0;j<NN;++j) {
-          densMatrix(i,j) = m_Virial[j][i] * m_DensitiesId[i];
-          if (i==j) densMatrix(i,j) += 1.;
-        }
+        tracked = (solutions.size() == m_CachedSolutions.size());
+        for (size_t i = 0; i < m_CachedSolutions.size(); ++i)
+          tracked &= (inds[i] != -1);
 
-      PartialPivLU<MatrixXd> decomp(densMatrix);
+        if (!tracked)
+          solutions.clear();
+      }
+    }
 
-      for(int i=0;i<NN;++i) 
-        xVector[i] = m_DensitiesId[i];
-      solVector = decomp.solve(xVector);
-      for(int i=0;i<NN;++i) 
-        m_densities[i] = solVector[i];
-
-      double tP = 0.;
-      for(size_t i=0;i<m_densities.size();++i) 
-        tP += m_TPS->Particles()[i].Density(m_Parameters, IdealGasFunctions::Pressure, m_UseWidth, sol[i]);
-      for(size_t i=0;i<m_densities.size();++i)
-        for(size_t j=0;j<m_densities.size();++j)
-          tP += -m_Attr[i][j] * m_densities[i] * m_densities[j];
-
-      if (!solved || tP > Psol) {
-        solved = true;
-        Psol = tP;
-        csol = sol;
-        maxdif = m_MaxDiff;
+    if (!tracked) {
+      vector< vector<int> > levels = BisectionLevels(iters);
+      for (size_t ilev = 0; ilev < levels.size(); ++ilev) {
+        vector< vector<double> > guesses;
+        for (size_t i = 0; i < levels[ilev].size(); ++i)
+          guesses.push_back(starts[levels[ilev][i]]);
+
+        size_t found = solutions.size();
+        SolveForInitialGuesses(guesses, solutions);
+
+        if (levels[ilev].size() >= 4 && solutions.size() == found)
+          break;
       }
     }
-    m_LastBroydenSuccessFlag = solved;
-    m_MaxDiff = maxdif;
+
+    m_CachedSolutions.clear();
+    for (size_t isol = 0; isol < solutions.size(); ++isol)
+      m_CachedSolutions.push_back(solutions[isol].dMuStar);
+    m_CachedSolutionsParameters = curparams;
+    m_CachedSolutionsComponents = m_MapTodMuStar;
+
+    vector<double> csol(NN, 0.);
+    int best = -1;
+    for (size_t isol = 0; isol < solutions.size(); ++isol)
+      if (best == -1 || solutions[isol].Pressure > solutions[best].Pressure)
+        best = isol;
+
+    m_LastBroydenSuccessFlag = (best != -1);
+    m_MaxDiff = 0.;
+    if (best != -1) {
+      m_MaxDiff = solutions[best].MaxDiff;
+      for (int i = 0; i < NN; ++i)
+        csol[i] = m_Chem[i] + solutions[best].dMuStar[m_MapTodMuStar[i]];
+    }
     return csol;
   }
 
@@ -355,6 +500,15 @@ namespace thermalfist {
     }
   }
 
+  void ThermalModelVDW::FillInteractionComponents() {
+    m_Components = InteractionComponents(m_Virial, m_Attr);
+    m_MapTodMuStar = m_Components.ComponentMap();
+    m_MapFromdMuStar = m_Components.Representatives();
+    m_dMuStarIndices.resize(m_Components.ComponentsNumber());
+    for (int k = 0; k < m_Components.ComponentsNumber(); ++k)
+      m_dMuStarIndices[k] = m_Components.Members(k);
+  }
+
   void ThermalModelVDW::CalculatePrimordialDensities() {
     CalculatePrimordialDensitiesNew();
     ValidateCalculation();
@@ -363,41 +517,11 @@ namespace thermalfist {
   void ThermalModelVDW::CalculatePrimordialDensitiesOld() {
     m_FluctuationsCalculated = false;
 
-    map< vector<double> , int> m_MapVDW;
-
     int NN = m_densities.size();
 
-    {
-      m_MapTodMuStar.resize(NN);
-      m_MapFromdMuStar.clear();
-      m_MapVDW.clear();
-      m_dMuStarIndices.clear();
-
-      int tind = 0;
-      for (int i = 0; i < NN; ++i) {
-        vector<double> VDWParam(0);
-        for (int j = 0; j < NN; ++j) {
-          VDWParam.push_back(m_Virial[i][j]);
-        }
-        for (int j = 0; j < NN; ++j) {
-          VDWParam.push_back(m_Attr[i][j] + m_Attr[j][i]);
-        }
-
-        if (m_MapVDW.count(VDWParam) == 0) {
-          m_MapVDW[VDWParam] = tind;
-          m_MapTodMuStar[i]  = tind;
-          m_MapFromdMuStar.push_back(i);
-          m_dMuStarIndices.push_back(vector<int>(1, i));
-          tind++;
-        }
-        else {
-          m_MapTodMuStar[i] = m_MapVDW[VDWParam];
-          m_dMuStarIndices[m_MapVDW[VDWParam]].push_back(i);
-        }
-      }
+    FillInteractionComponents();
 
-      printf("Optimization: %d --> %d\n", NN, static_cast<int>(m_MapFromdMuStar.size()));
-    }
+    printf("Optimization: %d --> %d\n", NN, static_cast<int>(m_MapFromdMuStar.size()));
 
     clock_t tbeg = clock();
 
@@ -452,39 +576,9 @@ namespace thermalfist {
   void ThermalModelVDW::CalculatePrimordialDensitiesNew() {
     m_FluctuationsCalculated = false;
 
-    map< vector<double>, int> m_MapVDW;
-
     int NN = m_densities.size();
 
-    {
-      m_MapTodMuStar.resize(NN);
-      m_MapFromdMuStar.clear();
-      m_MapVDW.clear();
-      m_dMuStarIndices.clear();
-
-      int tind = 0;
-      for (int i = 0; i < NN; ++i) {
-        vector<double> VDWParam(0);
-        for (int j = 0; j < NN; ++j) {
-          VDWParam.push_back(m_Virial[i][j]);
-        }
-        for (int j = 0; j < NN; ++j) {
-          VDWParam.push_back(m_Attr[i][j] + m_Attr[j][i]);
-        }
-
-        if (m_MapVDW.count(VDWParam) == 0) {
-          m_MapVDW[VDWParam] = tind;
-          m_MapTodMuStar[i] = tind;
-          m_MapFromdMuStar.push_back(i);
-          m_dMuStarIndices.push_back(vector<int>(1, i));
-          tind++;
-        }
-        else {
-          m_MapTodMuStar[i] = m_MapVDW[VDWParam];
-          m_dMuStarIndices[m_MapVDW[VDWParam]].push_back(i);
-        }
-      }
-    }
+    FillInteractionComponents();
 
     clock_t tbeg = clock();
 
@@ -555,59 +649,33 @@ namespace thermalfist {
     if (order<2) return ret;
     // Preparing matrix for system of linear equations
     int NN = m_densities.size();
-    MatrixXd densMatrix(2*NN, 2*NN);
-    VectorXd solVector(2*NN), xVector(2*NN);
+    vector<double> xVector(NN), yVector(NN);
 
     vector<double> chi2id(m_densities.size());
     for(int i=0;i<NN;++i) 
       chi2id[i] = m_TPS->Particles()[i].chi(2, m_Parameters, m_UseWidth, m_MuStar[i]);
 
-    for(int i=0;i<NN;++i)
-      for(int j=0;j<NN;++j) {
-        densMatrix(i,j) = m_Virial[j][i] * m_DensitiesId[i];
-        if (i==j) densMatrix(i,j) += 1.;
-      }
-
-    for(int i=0;i<NN;++i)
-      for(int j=0;j<NN;++j) 
-        densMatrix(i,NN+j) = 0.;
-
-    for(int i=0;i<NN;++i) {
-      densMatrix(i,NN+i) = 0.;
-      for(int k=0;k<NN;++k) {
-        densMatrix(i,NN+i) += m_Virial[k][i] * m_densities[k];
-      }
-      densMatrix(i,NN+i) = (densMatrix(i,NN+i) - 1.) * chi2id[i] * pow(xMath::GeVtoifm(), 3) * m_Parameters.T * m_Parameters.T;
+    vector<double> cs(NN, 0.);
+    for (int i = 0; i < NN; ++i) {
+      for (int k = 0; k < NN; ++k)
+        cs[i] += m_Virial[k][i] * m_densities[k];
+      cs[i] = (cs[i] - 1.) * chi2id[i] * pow(xMath::GeVtoifm(), 3) * m_Parameters.T * m_Parameters.T;
     }
 
-    for(int i=0;i<NN;++i)
-      for(int j=0;j<NN;++j) {
-        densMatrix(NN+i,j) = -(m_Attr[i][j] + m_Attr[j][i]);
-      }
-  
-    for(int i=0;i<NN;++i)
-      for(int j=0;j<NN;++j) {
-        densMatrix(NN+i,NN+j) = m_Virial[i][j] * m_DensitiesId[j];
-        if (i==j) densMatrix(NN+i,NN+j) += 1.;
-      }
-
+    if (m_Components.SpeciesNumber() != NN)
+      FillInteractionComponents();
 
-    PartialPivLU<MatrixXd> decomp(densMatrix);
+    InteractionResponseSolver decomp(m_Components, m_Virial, m_Attr, m_DensitiesId, cs);
 
     // chi2
     vector<double> dni(NN, 0.), dmus(NN, 0.);
 
     for(int i=0;i<NN;++i) {
       xVector[i]    = 0.;
-      xVector[NN+i] = chgs[i];
+      yVector[i] = chgs[i];
     }
 
-    solVector = decomp.solve(xVector);
-
-    for(int i=0;i<NN;++i) {
-      dni[i]  = solVector[i];
-      dmus[i] = solVector[NN+i];
-    }
+    decomp.Solve(xVector, yVector, dni, dmus);
 
     for(int i=0;i<NN;++i)
       ret[1] += chgs[i] * dni[i];
@@ -637,20 +705,15 @@ namespace thermalfist {
       xVector[i] += tmp;
     }
     for(int i=0;i<NN;++i) {
-      xVector[NN+i]    = 0.;
+      yVector[i]    = 0.;
 
       double tmp = 0.;
       for(int j=0;j<NN;++j) tmp += -m_Virial[i][j] * dmus[j] * chi2id[j] * pow(xMath::GeVtoifm(), 3) * m_Parameters.T * m_Parameters.T * dmus[j];
     
-      xVector[NN+i] = tmp;
+      yVector[i] = tmp;
     }
 
-    solVector = decomp.solve(xVector);
-
-    for(int i=0;i<NN;++i) {
-      d2ni[i]  = solVector[i];
-      d2mus[i] = solVector[NN+i];
-    }
+    decomp.Solve(xVector, yVector, d2ni, d2mus);
 
     for(int i=0;i<NN;++i)
       ret[2] += chgs[i] * d2ni[i];
@@ -701,23 +764,18 @@ namespace thermalfist {
       xVector[i] += tmp;
     }
     for(int i=0;i<NN;++i) {
-      xVector[NN+i]    = 0.;
+      yVector[i]    = 0.;
 
       double tmp = 0.;
       for(int j=0;j<NN;++j) tmp += -2. * m_Virial[i][j] * d2mus[j] * dnis[j];
-      xVector[NN+i] += tmp;
+      yVector[i] += tmp;
 
       tmp = 0.;
       for(int j=0;j<NN;++j) tmp += -m_Virial[i][j] * dmus[j] * d2nis[j];
-      xVector[NN+i] += tmp;
+      yVector[i] += tmp;
     }
 
-    solVector = decomp.solve(xVector);
-
-    for(int i=0;i<NN;++i) {
-      d3ni[i]  = solVector[i];
-      d3mus[i] = solVector[NN+i];
-    }
+    decomp.Solve(xVector, yVector, d3ni, d3mus);
 
     for(int i=0;i<NN;++i)
       ret[3] += chgs[i] * d3ni[i];
@@ -768,60 +826,32 @@ namespace thermalfist {
     m_PrimCorrel.resize(NN);
     for (int i = 0; i < NN; ++i)
       m_PrimCorrel[i].resize(NN);
-    m_TotalCorrel = m_PrimCorrel;
-
-    MatrixXd densMatrix(2 * NN, 2 * NN);
-    VectorXd solVector(2 * NN), xVector(2 * NN);
 
     vector<double> chi2id(m_densities.size());
     for (int i = 0; i<NN; ++i)
       chi2id[i] = m_TPS->Particles()[i].chi(2, m_Parameters, m_UseWidth, m_MuStar[i]);
 
-    for (int i = 0; i<NN; ++i)
-      for (int j = 0; j<NN; ++j) {
-        densMatrix(i, j) = m_Virial[j][i] * m_DensitiesId[i];
-        if (i == j) densMatrix(i, j) += 1.;
-      }
-
-    for (int i = 0; i<NN; ++i)
-      for (int j = 0; j<NN; ++j)
-        densMatrix(i, NN + j) = 0.;
-
-    for (int i = 0; i<NN; ++i) {
-      densMatrix(i, NN + i) = 0.;
-      for (int k = 0; k<NN; ++k) {
-        densMatrix(i, NN + i) += m_Virial[k][i] * m_densities[k];
-      }
-      densMatrix(i, NN + i) = (densMatrix(i, NN + i) - 1.) * chi2id[i] * pow(xMath::GeVtoifm(), 3) * m_Parameters.T * m_Parameters.T;
+    vector<double> cs(NN, 0.);
+    for (int i = 0; i < NN; ++i) {
+      for (int k = 0; k < NN; ++k)
+        cs[i] += m_Virial[k][i] * m_densities[k];
+      cs[i] = (cs[i] - 1.) * chi2id[i] * pow(xMath::GeVtoifm(), 3) * m_Parameters.T * m_Parameters.T;
     }
 
-    for (int i = 0; i<NN; ++i)
-      for (int j = 0; j<NN; ++j) {
-        densMatrix(NN + i, j) = -(m_Attr[i][j] + m_Attr[j][i]);
-      }
+    if (m_Components.SpeciesNumber() != NN)
+      FillInteractionComponents();
 
-    for (int i = 0; i<NN; ++i)
-      for (int j = 0; j<NN; ++j) {
-        densMatrix(NN + i, NN + j) = m_Virial[i][j] * m_DensitiesId[j];
-        if (i == j) densMatrix(NN + i, NN + j) += 1.;
-      }
-
-    PartialPivLU<MatrixXd> decomp(densMatrix);
+    InteractionResponseSolver decomp(m_Components, m_Virial, m_Attr, m_DensitiesId, cs);
 
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
     for (int k = 0; k < NN; ++k) {
       vector<double> dni(NN, 0.), dmus(NN, 0.);
+      vector<double> xVector(NN, 0.), yVector(NN, 0.);
+      yVector[k] = 1.;
 
-      for (int i = 0; i < NN; ++i) {
-        xVector[i] = 0.;
-        xVector[NN + i] = static_cast<int>(i == k);
-      }
-
-      solVector = decomp.solve(xVector);
-
-      for (int i = 0; i < NN; ++i) {
-        dni[i]  = solVector[i];
-        dmus[i] = solVector[NN + i];
-      }
+      decomp.Solve(xVector, yVector, dni, dmus);
 
       for (int j = 0; j < NN; ++j) {
         m_PrimCorrel[j][k] = dni[j];
@@ -924,6 +954,45 @@ namespace thermalfist {
       return 0.0;
   }
 
+  void ThermalModelVDW::AppendResultCacheKey(std::vector<double>& key) const
+  {
+    key.push_back(m_SearchMultipleSolutions);
+    key.push_back(m_SolutionsTracking);
+    key.push_back(m_TemperatureDependentAB);
+    key.reserve(key.size() + (m_TemperatureDependentAB ? 4 : 2) * m_Virial.size() * m_Virial.size());
+    for (size_t i = 0; i < m_Virial.size(); ++i) {
+      key.insert(key.end(), m_Virial[i].begin(), m_Virial[i].end());
+      key.insert(key.end(), m_Attr[i].begin(), m_Attr[i].end());
+      if (m_TemperatureDependentAB) {
+        key.insert(key.end(), m_VirialdT[i].begin(), m_VirialdT[i].end());
+        key.insert(key.end(), m_AttrdT[i].begin(), m_AttrdT[i].end());
+      }
+    }
+  }
+
+  void ThermalModelVDW::StoreResultCacheState(std::vector<double>& state) const
+  {
+    state.clear();
+    state.push_back(m_LastBroydenSuccessFlag);
+    state.insert(state.end(), m_MuStar.begin(), m_MuStar.end());
+    state.insert(state.end(), m_DensitiesId.begin(), m_DensitiesId.end());
+    state.insert(state.end(), m_scaldens.begin(), m_scaldens.end());
+  }
+
+  void ThermalModelVDW::RestoreResultCacheState(const std::vector<double>& state)
+  {
+    int NN = m_densities.size();
+    if (static_cast<int>(state.size()) != 1 + 3 * NN)
+      return;
+    m_LastBroydenSuccessFlag = (state[0] != 0.);
+    m_MuStar.assign(state.begin() + 1, state.begin() + 1 + NN);
+    m_DensitiesId.assign(state.begin() + 1 + NN, state.begin() + 1 + 2 * NN);
+    m_scaldens.assign(state.begin() + 1 + 2 * NN, state.end());
+
+    // The interaction components are refilled on demand
+    m_Components = InteractionComponents();
+  }
+
   double ThermalModelVDW::VirialCoefficient(int i, int j) const
   {
     if (i<0 || i >= static_cast<int>(m_Virial.size()) || j < 0 || j >= static_cast<int>(m_Virial.size()))
@@ -953,9 +1022,17 @@ namespace thermalfist {
   }
 
   std::vector<double> ThermalModelVDW::BroydenEquationsVDW::Equations(const std::vector<double>& x)
+  {
+    std::vector<double> ret;
+    EvaluateEquations(x, ret);
+    return ret;
+  }
+
+  void ThermalModelVDW::BroydenEquationsVDW::EvaluateEquations(const std::vector<double>& x, std::vector<double>& ret)
   {
     int NN = m_THM->Densities().size();
-    vector<double> Ps(NN, 0.);
+    vector<double> &Ps = m_Ps, &ns = m_ns;
+    Ps.resize(NN);
     for (int i = 0; i < NN; ++i) {
       Ps[i] = m_THM->TPS()->Particles()[i].Density(m_THM->Parameters(),
         IdealGasFunctions::Pressure,
@@ -964,7 +1041,7 @@ namespace thermalfist {
       );
     }
 
-    vector<double> ns(NN, 0.);
+    ns.resize(NN);
     for (int i = 0; i < NN; ++i) {
       ns[i] = m_THM->TPS()->Particles()[i].Density(m_THM->Parameters(),
         IdealGasFunctions::ParticleDensity,
@@ -976,7 +1053,7 @@ namespace thermalfist {
     vector<double> np = m_THM->ComputeNp(x, ns);
 
 
-    vector<double> ret(m_N, 0.);
+    ret.resize(m_N);
     for (size_t i = 0; i < ret.size(); ++i) {
       ret[i] = x[i];
       for (int j = 0; j < NN; ++j)
@@ -984,7 +1061,6 @@ namespace thermalfist {
         - (m_THM->AttractionCoefficient(m_THM->m_MapFromdMuStar[i], j)
           + m_THM->AttractionCoefficient(j, m_THM->m_MapFromdMuStar[i])) * np[j];
     }
-    return ret;
   }
 
   std::vector<double> ThermalModelVDW::BroydenJacobianVDW::Jacobian(const std::vector<double>& x)
@@ -14,6 +14,7 @@
 
 #include "HRGBase/xMath.h"
 #include "HRGEV/ExcludedVolumeHelper.h"
+#include "HRGEV/InteractionParametersIO.h"
 
 using namespace std;
 
@@ -37,6 +38,16 @@ namespace thermalfist {
     ClearModelVDW();
   }
 
+  ThermalModelVDWCanonicalStrangeness* ThermalModelVDWCanonicalStrangeness::Clone(ThermalParticleSystem* TPS) const
+  {
+    ThermalModelVDWCanonicalStrangeness *ret = new ThermalModelVDWCanonicalStrangeness(*this);
+    // The auxiliary model owned by the original is recreated when needed
+    ret->m_modelVDW = NULL;
+
+    FinalizeClone(ret, TPS);
+    return ret;
+  }
+
   void ThermalModelVDWCanonicalStrangeness::CalculateDensitiesGCE() {
     if (m_modelVDW == NULL)
       PrepareModelVDW();
@@ -74,10 +85,7 @@ namespace thermalfist {
     if (!m_GCECalculated)
       CalculateDensitiesGCE();
 
-    m_Zsum.resize(m_StrVals.size());
-
     m_partialS.resize(m_StrVals.size());
-    vector<double> xi(3, 0.), yi(3, 0.);
 
     for (size_t i = 0; i < m_StrVals.size(); ++i) {
       m_partialS[i] = 0.;
@@ -86,30 +94,7 @@ namespace thermalfist {
           m_partialS[i] += m_densitiesGCE[j] * Vcs[j];
     }
 
-    for (int i = 0; i < 3; ++i) {
-      xi[i] = 2. * sqrt(m_partialS[m_StrMap[i + 1]] * m_partialS[m_StrMap[-(i + 1)]]);
-      yi[i] = sqrt(m_partialS[m_StrMap[i + 1]] / m_partialS[m_StrMap[-(i + 1)]]);
-    }
-
-    // TODO: Choose iters dynamically based on total strangeness
-    int iters = 20;
-
-    for (unsigned int i = 0; i < m_StrVals.size(); ++i) {
-      double res = 0.;
-
-      for (int m = -iters; m <= iters; ++m)
-        for (int n = -iters; n <= iters; ++n) {
-          double tmp = xMath::BesselI(abs(3 * m + 2 * n - m_StrVals[i]), xi[0]) *
-            xMath::BesselI(abs(n), xi[1]) *
-            xMath::BesselI(abs(m), xi[2]) *
-            pow(yi[0], m_StrVals[i] - 3 * m - 2 * n) *
-            pow(yi[1], n) *
-            pow(yi[2], m);
-          if (tmp != tmp) continue;
-          res += tmp;
-        }
-      m_Zsum[i] = res;
-    }
+    CalculateZsums();
   }
 
 
@@ -306,6 +291,11 @@ namespace thermalfist {
 
   void ThermalModelVDWCanonicalStrangeness::ReadInteractionParameters(const std::string & filename)
   {
+    if (InteractionParametersIO::IsBinaryFile(filename)) {
+      InteractionParametersIO::ReadBinary(filename, m_TPS, m_Virial, &m_Attr);
+      return;
+    }
+
     m_Virial = std::vector< std::vector<double> >(m_TPS->Particles().size(), std::vector<double>(m_TPS->Particles().size(), 0.));
     m_Attr = std::vector< std::vector<double> >(m_TPS->Particles().size(), std::vector<double>(m_TPS->Particles().size(), 0.));
 
@@ -318,7 +308,7 @@ namespace thermalfist {
       if (elems.size() < 1)
         continue;
       istringstream iss(elems[0]);
-      int pdgid1, pdgid2;
+      long long pdgid1, pdgid2;
       double b, a;
       if (iss >> pdgid1 >> pdgid2 >> b) {
         if (!(iss >> a))
@@ -11,12 +11,20 @@
 #include <iomanip>
 #include <ctime>
 #include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
 
 #include "HRGBase.h"
 #include "HRGEV.h"
 #include "HRGFit.h"
 #include "HRGVDW/ThermalModelVDW.h"
 #include "HRGEV/ExcludedVolumeHelper.h"
+#include "HRGEV/InteractionParametersIO.h"
 
 #include "ThermalFISTConfig.h"
 
@@ -37,10 +45,10 @@ using namespace thermalfist;
 // 6 - 4b
 // 7 - s-inv
 
-void Diagonal(std::string filename, ThermalParticleSystem *TPS, int mode = 0, double r1 = 0., double r2 = 0., double r3 = 0., double r4 = 0.) {
-	ThermalModelEVDiagonal model(TPS);
+// Hadron radii for a given mode
+vector<double> EVRadii(ThermalParticleSystem *TPS, int mode = 0, double r1 = 0., double r2 = 0., double r3 = 0., double r4 = 0.) {
 	vector<double> radii(TPS->Particles().size(), 0.);
-	for (int i = 0; i < TPS->Particles().size(); ++i) {
+	for (int i = 0; i < TPS->ComponentsNumber(); ++i) {
 		ThermalParticle &tpart = TPS->Particle(i);
 		if (mode == 0) {
 			radii[i] = r1;
@@ -81,109 +89,63 @@ void Diagonal(std::string filename, ThermalParticleSystem *TPS, int mode = 0, do
 				radii[i] = r2 * pow(tpart.Mass() / TPS->ParticleByPDG(3122).Mass() , -1. / 3.);
 		}
 	}
-
-	model.FillVirial(radii);
-	model.WriteInteractionParameters(filename);
+	return radii;
 }
 
+// Sets the excluded-volume parameters of a Diagonal (crossterms = false) or Crossterms (crossterms = true) EV model
+void SetEVParameters(ThermalModelBase *model, bool crossterms, int mode = 0, double r1 = 0., double r2 = 0., double r3 = 0., double r4 = 0.) {
+	ThermalParticleSystem *TPS = model->TPS();
+	vector<double> radii = EVRadii(TPS, mode, r1, r2, r3, r4);
 
-void Crossterms(std::string filename, ThermalParticleSystem *TPS, int mode = 0, double r1 = 0., double r2 = 0., double r3 = 0., double r4 = 0.) {
-	ThermalModelEVCrossterms model(TPS);
-	vector<double> radii(TPS->Particles().size(), 0.);
-	for (int i = 0; i < TPS->Particles().size(); ++i) {
-		ThermalParticle &tpart = TPS->Particle(i);
-		if (mode == 0) {
-			radii[i] = r1;
-		}
-		if (mode >= 1 && mode <= 3) {
-			int N = TPS->Particles().size();
-			for (int j = 0; j < N; ++j) {
-				ThermalParticle &tpart2 = TPS->Particle(j);
-				double tr1 = r1, tr2 = r2;
-
-				if (tpart.BaryonCharge() == 0)
-					tr1 = r2;
-				else
-					tr1 = r1 * pow(abs(tpart.BaryonCharge()), 1. / 3.);
-
-				if (tpart2.BaryonCharge() == 0)
-					tr2 = r2;
-				else
-					tr2 = r1 * pow(abs(tpart2.BaryonCharge()), 1. / 3.);
-				double tb = CuteHRGHelper::brr(tr1, tr2);
-
-				if (mode == 2 || mode == 3) {
-					if (tpart.BaryonCharge() * tpart2.BaryonCharge() < 0)
-						tb = 0.;
-				}
+	if (!(crossterms && mode >= 1 && mode <= 3)) {
+		model->FillVirial(radii);
+		return;
+	}
 
-				if (mode == 3) {
-					if ((tpart.BaryonCharge() == 0 && tpart2.BaryonCharge() !=0) 
-						|| (tpart2.BaryonCharge() == 0 && tpart.BaryonCharge() != 0))
-						tb = 0.;
-				}
+	int N = TPS->Particles().size();
+	for (int i = 0; i < N; ++i) {
+		ThermalParticle &tpart = TPS->Particle(i);
+		for (int j = 0; j < N; ++j) {
+			ThermalParticle &tpart2 = TPS->Particle(j);
+			double tb = CuteHRGHelper::brr(radii[i], radii[j]);
 
-				model.SetVirial(i, j, tb);
+			if (mode == 2 || mode == 3) {
+				if (tpart.BaryonCharge() * tpart2.BaryonCharge() < 0)
+					tb = 0.;
 			}
-		}
-		if (mode == 4) {
-			radii[i] = r1 * pow(tpart.Mass() / xMath::mnucleon(), 1. / 3.);
-		}
-		if (mode == 5) {
-			if (tpart.BaryonCharge() == 0)
-				radii[i] = r2 * pow(tpart.Mass() / xMath::mnucleon(), 1. / 3.);
-			else
-				radii[i] = r1 * pow(tpart.Mass() / xMath::mnucleon(), 1. / 3.);
-		}
-		if (mode == 6) {
-			if (tpart.BaryonCharge() == 0) {
-				if (tpart.Strangeness() == 0)
-					radii[i] = r2 * pow(tpart.Mass() / xMath::mnucleon(), 1. / 3.);
-				else
-					radii[i] = r4 * pow(tpart.Mass() / xMath::mnucleon(), 1. / 3.);
-			}
-			else {
-				if (tpart.Strangeness() == 0)
-					radii[i] = r1 * pow(tpart.Mass() / xMath::mnucleon(), 1. / 3.);
-				else
-					radii[i] = r3 * pow(tpart.Mass() / xMath::mnucleon(), 1. / 3.);
+
+			if (mode == 3) {
+				if ((tpart.BaryonCharge() == 0 && tpart2.BaryonCharge() !=0) 
+					|| (tpart2.BaryonCharge() == 0 && tpart.BaryonCharge() != 0))
+					tb = 0.;
 			}
-		}
-		if (mode == 7) {
-			if (tpart.Strangeness() == 0)
-				radii[i] = r1 * pow(tpart.Mass() / xMath::mnucleon(), 1. / 3.);
-			else
-				radii[i] = r2 * pow(tpart.Mass() / TPS->ParticleByPDG(3122).Mass(), -1. / 3.);
+
+			model->SetVirial(i, j, tb);
 		}
 	}
-
-	if (!(mode >= 1 && mode <= 3))
-		model.FillVirial(radii);
-	model.WriteInteractionParameters(filename);
 }
 
-
-void QvdWHRG(std::string filename, ThermalParticleSystem *TPS, double a = 0.329, double b = 3.42, double StoNS = 1.) {
-	ThermalModelVDW model(TPS);
-
-	for (int i1 = 0; i1 < model.TPS()->Particles().size(); ++i1) {
-		for (int i2 = 0; i2 < model.TPS()->Particles().size(); ++i2) {
-			const ThermalParticle &part1 = model.TPS()->Particles()[i1];
-			const ThermalParticle &part2 = model.TPS()->Particles()[i2];
+// Sets the QvdW parameters for baryon-baryon and antibaryon-antibaryon pairs, as in 1609.03975 and 1707.09215
+void SetQvdWParameters(ThermalModelBase *model, double a = 0.329, double b = 3.42, double StoNS = 1.) {
+	int N = model->TPS()->ComponentsNumber();
+	for (int i1 = 0; i1 < N; ++i1) {
+		for (int i2 = 0; i2 < N; ++i2) {
+			const ThermalParticle &part1 = model->TPS()->Particles()[i1];
+			const ThermalParticle &part2 = model->TPS()->Particles()[i2];
 			int B1 = part1.BaryonCharge();
 			int B2 = part2.BaryonCharge();
 
 			// Meson-meson, meson-baryon, baryon-antibaryon non-interacting
 			if (!(B1 * B2 > 0)) {
-				model.SetVirial(i1, i2, 0.);
-				model.SetAttraction(i1, i2, 0.);
+				model->SetVirial(i1, i2, 0.);
+				model->SetAttraction(i1, i2, 0.);
 				continue;
 			}
 
 			// First excluded-volume, proportional to baryon charge if light nuclei included
 /*			if (B1 == B2) {
 				double tb = b * abs(B1);
-				model.SetVirial(i1, i2, tb);
+				model->SetVirial(i1, i2, tb);
 			}
 			else */{
 				// Following prescription in nucl-th/9906068, Eqs. (53) and (54)
@@ -198,7 +160,7 @@ void QvdWHRG(std::string filename, ThermalParticleSystem *TPS, double a = 0.329,
 				double b12sym = CuteHRGHelper::brr(r1, r2);
 				double b12 = 2. * b11 * b12sym / (b11 + b22);
 				double b21 = 2. * b22 * b12sym / (b11 + b22);
-				model.SetVirial(i1, i2, b12);
+				model->SetVirial(i1, i2, b12);
 			}
 
 			// QvdW attraction for baryon-baryon pairs only
@@ -209,23 +171,717 @@ void QvdWHRG(std::string filename, ThermalParticleSystem *TPS, double a = 0.329,
 				if (part2.Strangeness() != 0)
 					ta2 *= StoNS;
 				double ta = sqrt(ta1 * ta2);
-				model.SetAttraction(i1, i2, ta);
+				model->SetAttraction(i1, i2, ta);
 			}
 			else {
-				model.SetAttraction(i1, i2, 0.);
+				model->SetAttraction(i1, i2, 0.);
 			}
 
 		}
 	}
+}
+
+void Diagonal(std::string filename, ThermalParticleSystem *TPS, int mode = 0, double r1 = 0., double r2 = 0., double r3 = 0., double r4 = 0.) {
+	ThermalModelEVDiagonal model(TPS);
+	SetEVParameters(&model, false, mode, r1, r2, r3, r4);
+	model.WriteInteractionParameters(filename);
+}
+
+
+void Crossterms(std::string filename, ThermalParticleSystem *TPS, int mode = 0, double r1 = 0., double r2 = 0., double r3 = 0., double r4 = 0.) {
+	ThermalModelEVCrossterms model(TPS);
+	SetEVParameters(&model, true, mode, r1, r2, r3, r4);
+	model.WriteInteractionParameters(filename);
+}
+
 
+void QvdWHRG(std::string filename, ThermalParticleSystem *TPS, double a = 0.329, double b = 3.42, double StoNS = 1.) {
+	ThermalModelVDW model(TPS);
+	SetQvdWParameters(&model, a, b, StoNS);
 	model.WriteInteractionParameters(filename);
 }
 
 
+// Converts a file with the Crossterms EV or QvdW parameters, text or binary, to the binary format
+bool ConvertToBinary(std::string input, std::string output, ThermalParticleSystem *TPS) {
+	ThermalModelVDW model(TPS);
+	model.ReadInteractionParameters(input);
+
+	int N = TPS->Particles().size();
+	vector< vector<double> > b(N, vector<double>(N, 0.)), a(N, vector<double>(N, 0.));
+	for (int i = 0; i < N; ++i) {
+		for (int j = 0; j < N; ++j) {
+			b[i][j] = model.VirialCoefficient(i, j);
+			a[i][j] = model.AttractionCoefficient(i, j);
+		}
+	}
+
+	return InteractionParametersIO::WriteBinary(output, TPS, b, &a);
+}
+
+// Converts a file with the Crossterms EV or QvdW parameters, text or binary, to the text format
+bool ConvertToText(std::string input, std::string output, ThermalParticleSystem *TPS) {
+	ThermalModelVDW model(TPS);
+	model.ReadInteractionParameters(input);
+
+	int N = TPS->Particles().size();
+	bool attr = false;
+	for (int i = 0; i < N; ++i)
+		for (int j = 0; j < N; ++j)
+			attr |= (model.AttractionCoefficient(i, j) != 0.);
+
+	// Three-column Crossterms format if there are no attractive interactions
+	if (!attr) {
+		ThermalModelEVCrossterms modelEV(TPS);
+		for (int i = 0; i < N; ++i)
+			for (int j = 0; j < N; ++j)
+				modelEV.SetVirial(i, j, model.VirialCoefficient(i, j));
+		modelEV.WriteInteractionParameters(output);
+	}
+	else {
+		model.WriteInteractionParameters(output);
+	}
+
+	return true;
+}
+
+
+// Generation of the equation of state and yield tables on a grid of thermal and interaction parameters.
+// The grid is described by a configuration file with lines "key value(s)", # starts a comment:
+//
+// list        <file>              particle list (default: PDG2020/list.dat)
+// model       <type>              Ideal, DiagonalEV, CrosstermsEV, or QvdW (default: Ideal)
+// mode        <int>               EV parametrization mode 0-7 as above, for DiagonalEV and CrosstermsEV
+// statistics  <0|1>               0 - Maxwell-Boltzmann, 1 - quantum statistics (default: as in the particle list)
+// usewidth    <0|1>               finite resonance widths (default: 0)
+// yields      <none|primordial|total>  which densities of all species are stored (default: total)
+// output      <file>              consolidated binary output table
+// chunk       <int>               number of grid points per checkpoint chunk (default: 64)
+// threads     <int>               number of threads, 0 - all available (default: 0). Requires USE_OpenMP
+// keepchunks  <0|1>               keep the checkpoint files after the consolidation (default: 0)
+// tables      <prefix>            also write the interaction parameters for each interaction
+//                                 parameter set to <prefix>.<index>.bin (text .dat for DiagonalEV)
+//
+// Grid parameters, either a fixed value "name value" or a range "name min max step":
+// T, muB, muQ, muS, gammaS        thermal parameters (GeV), defaults: 0.155, 0, 0, 0, 1
+// r1, r2, r3, r4                  radii (fm) of the EV parametrization mode
+// a, b, StoNS                     QvdW parameters (GeV fm^3, fm^3) and their strange/non-strange ratio, as in QvdWHRG()
+//
+// The grid is the product of all parameter values. The points are ordered as the parameters above,
+// from r1 (slowest) to gammaS (fastest), with the interaction parameters outer so that each thread only
+// occasionally resets them. The points are split into chunks which are processed in parallel,
+// each finished chunk is saved to <output>.chunk<k>. A run with the same configuration skips the chunks
+// already saved, so an interrupted run can be resumed. Once all chunks are done they are merged into <output>:
+//
+// char[8] "TFISTTAB", uint32 byte order mark 0x01020304, uint32 version,
+// uint32 number of grid parameters P, uint32 number of quantities Q, int64 number of points
+// P x { int32 name length, name, int64 number of values, double values }
+// Q x { int32 name length, name }
+// number of points x Q doubles, the point with the grid indices (i_1, ..., i_P) at the position
+// i_P + n_P * (i_{P-1} + n_{P-1} * (...))
+//
+// The quantities are: P (GeV/fm^3), e (GeV/fm^3), s (fm^-3), nB, nQ, nS (fm^-3), converged (1 or 0),
+// followed by the primordial or total densities (fm^-3) of all species, named as in the particle list.
+
+namespace {
+	const char TableMagic[8] = { 'T', 'F', 'I', 'S', 'T', 'T', 'A', 'B' };
+	const char ChunkMagic[8] = { 'T', 'F', 'I', 'S', 'T', 'C', 'H', 'K' };
+	const unsigned int TableByteOrderMark = 0x01020304u;
+	const unsigned int TableFormatVersion = 1;
+
+	// Number of the thermal parameters at the end of TableConfig::params
+	const int NThermalParameters = 5;
+
+	struct TableParameter {
+		string name;
+		vector<double> values;
+	};
+
+	struct TableConfig {
+		string list, model, output, tables, yields;
+		int mode, statistics, usewidth, chunk, threads, keepchunks;
+		vector<TableParameter> params;
+		unsigned long long hash;
+
+		TableConfig() :
+			list(string(ThermalFIST_INPUT_FOLDER) + "/list/PDG2020/list.dat"),
+			model("Ideal"), output(""), tables(""), yields("total"),
+			mode(0), statistics(-1), usewidth(0), chunk(64), threads(0), keepchunks(0),
+			hash(0)
+		{
+			const char *names[] = { "r1", "r2", "r3", "r4", "a", "b", "StoNS", "T", "muB", "muQ", "muS", "gammaS" };
+			const double defaults[] = { 0., 0., 0., 0., 0., 0., 1., 0.155, 0., 0., 0., 1. };
+			for (int i = 0; i < 12; ++i) {
+				TableParameter par;
+				par.name = names[i];
+				par.values.push_back(defaults[i]);
+				params.push_back(par);
+			}
+		}
+
+		long long Points(int first, int last) const {
+			long long ret = 1;
+			for (int i = first; i < last; ++i)
+				ret *= params[i].values.size();
+			return ret;
+		}
+
+		long long Points() const { return Points(0, params.size()); }
+
+		// Number of the interaction parameter sets
+		long long InteractionSets() const { return Points(0, params.size() - NThermalParameters); }
+
+		// Parameter values at the grid point with the given index
+		vector<double> Values(long long index) const {
+			vector<double> ret(params.size());
+			for (int i = static_cast<int>(params.size()) - 1; i >= 0; --i) {
+				long long n = params[i].values.size();
+				ret[i] = params[i].values[index % n];
+				index /= n;
+			}
+			return ret;
+		}
+	};
+
+	// FNV-1a hash of a string, used to check that the checkpoints correspond to the same configuration
+	void HashString(unsigned long long &hash, const string &str) {
+		for (size_t i = 0; i < str.size(); ++i) {
+			hash ^= static_cast<unsigned char>(str[i]);
+			hash *= 1099511628211ULL;
+		}
+		hash ^= 0xff;
+		hash *= 1099511628211ULL;
+	}
+
+	bool ReadTableConfig(const string &filename, TableConfig &config) {
+		ifstream fin(filename.c_str());
+		if (!fin.is_open()) {
+			printf("**ERROR** Cannot open configuration file %s\n", filename.c_str());
+			return false;
+		}
+
+		config.hash = 14695981039346656037ULL;
+		string line;
+		while (getline(fin, line)) {
+			line = line.substr(0, line.find('#'));
+			istringstream iss(line);
+			string key;
+			if (!(iss >> key))
+				continue;
+
+			vector<string> args;
+			string arg;
+			while (iss >> arg)
+				args.push_back(arg);
+
+			if (args.empty()) {
+				printf("**ERROR** No value for key %s in configuration file %s\n", key.c_str(), filename.c_str());
+				return false;
+			}
+
+			// The number of threads and keeping the chunks do not affect the results
+			if (key != "threads" && key != "keepchunks") {
+				HashString(config.hash, key);
+				for (size_t i = 0; i < args.size(); ++i)
+					HashString(config.hash, args[i]);
+			}
+
+			if (key == "list") config.list = args[0];
+			else if (key == "model") config.model = args[0];
+			else if (key == "output") config.output = args[0];
+			else if (key == "tables") config.tables = args[0];
+			else if (key == "yields") config.yields = args[0];
+			else if (key == "mode") config.mode = atoi(args[0].c_str());
+			else if (key == "statistics") config.statistics = atoi(args[0].c_str());
+			else if (key == "usewidth") config.usewidth = atoi(args[0].c_str());
+			else if (key == "chunk") config.chunk = atoi(args[0].c_str());
+			else if (key == "threads") config.threads = atoi(args[0].c_str());
+			else if (key == "keepchunks") config.keepchunks = atoi(args[0].c_str());
+			else {
+				int ipar = -1;
+				for (size_t i = 0; i < config.params.size(); ++i)
+					if (config.params[i].name == key)
+						ipar = i;
+				if (ipar == -1) {
+					printf("**ERROR** Unknown key %s in configuration file %s\n", key.c_str(), filename.c_str());
+					return false;
+				}
+
+				vector<double> &values = config.params[ipar].values;
+				values.clear();
+				if (args.size() == 1) {
+					values.push_back(atof(args[0].c_str()));
+				}
+				else if (args.size() == 3) {
+					double vmin = atof(args[0].c_str()), vmax = atof(args[1].c_str()), dv = atof(args[2].c_str());
+					if (!(dv > 0.) || vmax < vmin) {
+						printf("**ERROR** Invalid range for parameter %s in configuration file %s\n", key.c_str(), filename.c_str());
+						return false;
+					}
+					int nv = static_cast<int>(floor((vmax - vmin) / dv + 1.e-9)) + 1;
+					for (int i = 0; i < nv; ++i)
+						values.push_back(vmin + i * dv);
+				}
+				else {
+					printf("**ERROR** Parameter %s in configuration file %s should be specified either as a value or as min max step\n", key.c_str(), filename.c_str());
+					return false;
+				}
+			}
+		}
+
+		if (config.output == "") {
+			printf("**ERROR** No output file specified in configuration file %s\n", filename.c_str());
+			return false;
+		}
+		if (config.model != "Ideal" && config.model != "DiagonalEV" && config.model != "CrosstermsEV" && config.model != "QvdW") {
+			printf("**ERROR** Unknown model %s in configuration file %s\n", config.model.c_str(), filename.c_str());
+			return false;
+		}
+		if (config.yields != "none" && config.yields != "primordial" && config.yields != "total") {
+			printf("**ERROR** Unknown yields option %s in configuration file %s\n", config.yields.c_str(), filename.c_str());
+			return false;
+		}
+		if (config.chunk < 1)
+			config.chunk = 1;
+
+		return true;
+	}
+
+	ThermalModelBase* CreateTableModel(const TableConfig &config, ThermalParticleSystem *TPS) {
+		ThermalModelBase *model = NULL;
+		if (config.model == "DiagonalEV")
+			model = new ThermalModelEVDiagonal(TPS);
+		else if (config.model == "CrosstermsEV")
+			model = new ThermalModelEVCrossterms(TPS);
+		else if (config.model == "QvdW")
+			model = new ThermalModelVDW(TPS);
+		else
+			model = new ThermalModelIdeal(TPS);
+
+		if (config.statistics != -1)
+			model->SetStatistics(config.statistics != 0);
+		model->SetUseWidth(config.usewidth != 0);
+		return model;
+	}
+
+	// Sets the interaction parameters of the model from the grid point parameter values
+	void SetTableInteractions(ThermalModelBase *model, const TableConfig &config, const vector<double> &values) {
+		if (config.model == "DiagonalEV" || config.model == "CrosstermsEV")
+			SetEVParameters(model, config.model == "CrosstermsEV", config.mode, values[0], values[1], values[2], values[3]);
+		else if (config.model == "QvdW")
+			SetQvdWParameters(model, values[4], values[5], values[6]);
+	}
+
+	vector<string> TableQuantities(const TableConfig &config, ThermalParticleSystem *TPS) {
+		const char *names[] = { "P", "e", "s", "nB", "nQ", "nS", "converged" };
+		vector<string> ret(names, names + 7);
+		if (config.yields != "none") {
+			for (int i = 0; i < TPS->ComponentsNumber(); ++i)
+				ret.push_back(TPS->Particle(i).Name());
+		}
+		return ret;
+	}
+
+	// Calculates the quantities at the grid points [first, first + count)
+	void CalculateTableChunk(ThermalModelBase *model, const TableConfig &config, long long first, long long count,
+		long long &lastInteractionSet, vector<double> &data) {
+		long long NThermal = config.Points(config.params.size() - NThermalParameters, config.params.size());
+		int nq = 7 + (config.yields != "none" ? model->ComponentsNumber() : 0);
+		data.resize(count * nq);
+
+		for (long long ipoint = first; ipoint < first + count; ++ipoint) {
+			vector<double> values = config.Values(ipoint);
+
+			long long iset = ipoint / NThermal;
+			if (iset != lastInteractionSet) {
+				SetTableInteractions(model, config, values);
+				lastInteractionSet = iset;
+			}
+
+			int it = config.params.size() - NThermalParameters;
+			model->SetTemperature(values[it]);
+			model->SetBaryonChemicalPotential(values[it + 1]);
+			model->SetElectricChemicalPotential(values[it + 2]);
+			model->SetStrangenessChemicalPotential(values[it + 3]);
+			model->SetGammaS(values[it + 4]);
+			model->FillChemicalPotentials();
+			model->CalculateDensities();
+
+			double *row = &data[(ipoint - first) * nq];
+			row[0] = model->CalculatePressure();
+			row[1] = model->CalculateEnergyDensity();
+			row[2] = model->CalculateEntropyDensity();
+			row[3] = model->CalculateBaryonDensity();
+			row[4] = model->CalculateChargeDensity();
+			row[5] = model->CalculateStrangenessDensity();
+			row[6] = model->IsLastSolutionOK() ? 1. : 0.;
+			if (config.yields != "none") {
+				const vector<double> &dens = (config.yields == "primordial") ? model->Densities() : model->TotalDensities();
+				for (size_t i = 0; i < dens.size(); ++i)
+					row[7 + i] = dens[i];
+			}
+		}
+	}
+
+	struct ChunkHeader {
+		char magic[8];
+		unsigned int byteorder;
+		unsigned int version;
+		unsigned long long hash;
+		long long first, count, nquantities;
+	};
+
+	string ChunkFileName(const TableConfig &config, long long ichunk) {
+		ostringstream ss;
+		ss << config.output << ".chunk" << ichunk;
+		return ss.str();
+	}
+
+	// Reads a checkpoint file, returns false if it does not exist or does not match the configuration
+	bool ReadChunk(const string &filename, const TableConfig &config, long long first, long long count, long long nq, vector<double> *data) {
+		FILE *f = fopen(filename.c_str(), "rb");
+		if (f == NULL)
+			return false;
+
+		ChunkHeader header;
+		bool ret = (fread(&header, sizeof(ChunkHeader), 1, f) == 1)
+			&& memcmp(header.magic, ChunkMagic, sizeof(ChunkMagic)) == 0
+			&& header.byteorder == TableByteOrderMark && header.version == TableFormatVersion
+			&& header.hash == config.hash && header.first == first && header.count == count && header.nquantities == nq;
+
+		vector<double> tdata;
+		if (ret) {
+			tdata.resize(count * nq);
+			ret = (fread(&tdata[0], sizeof(double), tdata.size(), f) == tdata.size());
+			char extra;
+			ret = ret && (fread(&extra, 1, 1, f) == 0);
+		}
+		fclose(f);
+
+		if (ret && data != NULL)
+			data->swap(tdata);
+		return ret;
+	}
+
+	// Writes a checkpoint file via a temporary file, so that an interrupted write does not leave a valid-looking chunk
+	bool WriteChunk(const string &filename, const TableConfig &config, long long first, long long count, long long nq, const vector<double> &data) {
+		ChunkHeader header;
+		memcpy(header.magic, ChunkMagic, sizeof(ChunkMagic));
+		header.byteorder = TableByteOrderMark;
+		header.version = TableFormatVersion;
+		header.hash = config.hash;
+		header.first = first;
+		header.count = count;
+		header.nquantities = nq;
+
+		string tmpname = filename + ".tmp";
+		FILE *f = fopen(tmpname.c_str(), "wb");
+		if (f == NULL) {
+			printf("**ERROR** Cannot open file %s for writing\n", tmpname.c_str());
+			return false;
+		}
+		bool ret = (fwrite(&header, sizeof(ChunkHeader), 1, f) == 1)
+			&& (fwrite(&data[0], sizeof(double), data.size(), f) == data.size());
+		ret = (fclose(f) == 0) && ret;
+
+		remove(filename.c_str());
+		ret = ret && (rename(tmpname.c_str(), filename.c_str()) == 0);
+		if (!ret)
+			printf("**ERROR** Cannot write file %s\n", filename.c_str());
+		return ret;
+	}
+
+	bool WriteTableString(FILE *f, const string &str) {
+		int len = str.size();
+		return fwrite(&len, sizeof(int), 1, f) == 1
+			&& fwrite(str.c_str(), 1, len, f) == static_cast<size_t>(len);
+	}
+
+	// Merges the checkpoint files into the output table
+	bool ConsolidateTable(const TableConfig &config, const vector<string> &quantities, long long nchunks) {
+		long long npoints = config.Points();
+		long long nq = quantities.size();
+
+		string tmpname = config.output + ".tmp";
+		FILE *f = fopen(tmpname.c_str(), "wb");
+		if (f == NULL) {
+			printf("**ERROR** Cannot open file %s for writing\n", tmpname.c_str());
+			return false;
+		}
+
+		bool ret = (fwrite(TableMagic, 1, sizeof(TableMagic), f) == sizeof(TableMagic));
+		unsigned int header[4] = { TableByteOrderMark, TableFormatVersion, static_cast<unsigned int>(config.params.size()), static_cast<unsigned int>(nq) };
+		ret = ret && (fwrite(header, sizeof(unsigned int), 4, f) == 4);
+		ret = ret && (fwrite(&npoints, sizeof(long long), 1, f) == 1);
+		for (size_t i = 0; i < config.params.size() && ret; ++i) {
+			long long nv = config.params[i].values.size();
+			ret = WriteTableString(f, config.params[i].name)
+				&& fwrite(&nv, sizeof(long long), 1, f) == 1
+				&& fwrite(&config.params[i].values[0], sizeof(double), nv, f) == static_cast<size_t>(nv);
+		}
+		for (size_t i = 0; i < quantities.size() && ret; ++i)
+			ret = WriteTableString(f, quantities[i]);
+
+		vector<double> data;
+		for (long long ichunk = 0; ichunk < nchunks && ret; ++ichunk) {
+			long long first = ichunk * config.chunk;
+			long long count = min(static_cast<long long>(config.chunk), npoints - first);
+			ret = ReadChunk(ChunkFileName(config, ichunk), config, first, count, nq, &data);
+			if (!ret)
+				printf("**ERROR** Checkpoint file %s is missing or corrupt\n", ChunkFileName(config, ichunk).c_str());
+			else
+				ret = (fwrite(&data[0], sizeof(double), data.size(), f) == data.size());
+		}
+		ret = (fclose(f) == 0) && ret;
+
+		if (ret) {
+			remove(config.output.c_str());
+			ret = (rename(tmpname.c_str(), config.output.c_str()) == 0);
+		}
+		if (!ret) {
+			printf("**ERROR** Cannot write file %s\n", config.output.c_str());
+			remove(tmpname.c_str());
+		}
+		return ret;
+	}
+
+	// Writes the interaction parameters of each interaction parameter set
+	void WriteInteractionTables(ThermalModelBase *model, const TableConfig &config) {
+		if (config.tables == "" || config.model == "Ideal")
+			return;
+
+		long long NThermal = config.Points(config.params.size() - NThermalParameters, config.params.size());
+		int N = model->ComponentsNumber();
+		for (long long iset = 0; iset < config.InteractionSets(); ++iset) {
+			ostringstream ss;
+			ss << config.tables << "." << iset << (config.model == "DiagonalEV" ? ".dat" : ".bin");
+			string filename = ss.str();
+
+			FILE *f = fopen(filename.c_str(), "rb");
+			if (f != NULL) {
+				fclose(f);
+				continue;
+			}
+
+			SetTableInteractions(model, config, config.Values(iset * NThermal));
+			if (config.model == "DiagonalEV") {
+				model->WriteInteractionParameters(filename);
+				continue;
+			}
+
+			vector< vector<double> > b(N, vector<double>(N, 0.)), a(N, vector<double>(N, 0.));
+			for (int i = 0; i < N; ++i) {
+				for (int j = 0; j < N; ++j) {
+					b[i][j] = model->VirialCoefficient(i, j);
+					a[i][j] = model->AttractionCoefficient(i, j);
+				}
+			}
+			InteractionParametersIO::WriteBinary(filename, model->TPS(), b, &a);
+		}
+	}
+}
+
+// Generates the tables described by a configuration file, see above
+int GenerateTables(const std::string &configfile) {
+	TableConfig config;
+	if (!ReadTableConfig(configfile, config))
+		return 1;
+
+	ThermalParticleSystem TPS(config.list);
+	HashString(config.hash, config.list);
+
+	ThermalModelBase *model = CreateTableModel(config, &TPS);
+	WriteInteractionTables(model, config);
+
+	vector<string> quantities = TableQuantities(config, &TPS);
+	long long nq = quantities.size();
+	long long npoints = config.Points();
+	long long nchunks = (npoints + config.chunk - 1) / config.chunk;
+
+	vector<int> pending;
+	for (long long ichunk = 0; ichunk < nchunks; ++ichunk) {
+		long long first = ichunk * config.chunk;
+		long long count = min(static_cast<long long>(config.chunk), npoints - first);
+		if (!ReadChunk(ChunkFileName(config, ichunk), config, first, count, nq, NULL))
+			pending.push_back(ichunk);
+	}
+
+	int nthreads = 1;
+#ifdef USE_OPENMP
+	if (config.threads > 0)
+		omp_set_num_threads(config.threads);
+	nthreads = omp_get_max_threads();
+#endif
+
+	printf("Grid points: %lld, chunks: %lld, already done: %lld, threads: %d\n",
+		npoints, nchunks, nchunks - static_cast<long long>(pending.size()), nthreads);
+
+	// Each thread works with its own copy of the model, the copies share the particle list
+	vector<ThermalModelBase*> models(nthreads, model);
+	for (int i = 1; i < nthreads; ++i)
+		models[i] = model->Clone();
+	vector<long long> lastInteractionSet(nthreads, -1);
+
+	int done = 0;
+	bool ok = true;
+	double wt1 = get_wall_time();
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int ip = 0; ip < static_cast<int>(pending.size()); ++ip) {
+		int tid = 0;
+#ifdef USE_OPENMP
+		tid = omp_get_thread_num();
+#endif
+		long long ichunk = pending[ip];
+		long long first = ichunk * config.chunk;
+		long long count = min(static_cast<long long>(config.chunk), npoints - first);
+
+		vector<double> data;
+		CalculateTableChunk(models[tid], config, first, count, lastInteractionSet[tid], data);
+		bool written = WriteChunk(ChunkFileName(config, ichunk), config, first, count, nq, data);
+
+#ifdef USE_OPENMP
+#pragma omp critical
+#endif
+		{
+			ok = ok && written;
+			done++;
+			printf("Chunk %lld done (%d/%d), elapsed time: %lf s\n", ichunk, done, static_cast<int>(pending.size()), get_wall_time() - wt1);
+			fflush(stdout);
+		}
+	}
+
+	for (int i = 1; i < nthreads; ++i)
+		delete models[i];
+	delete model;
+
+	if (!ok || !ConsolidateTable(config, quantities, nchunks))
+		return 1;
+
+	if (!config.keepchunks) {
+		for (long long ichunk = 0; ichunk < nchunks; ++ichunk)
+			remove(ChunkFileName(config, ichunk).c_str());
+	}
+
+	printf("Table written to %s\n", config.output.c_str());
+	return 0;
+}
+
+// Prints a table generated by GenerateTables() in the text format
+int DumpTable(const std::string &filename) {
+	FILE *f = fopen(filename.c_str(), "rb");
+	if (f == NULL) {
+		printf("**ERROR** Cannot open file %s\n", filename.c_str());
+		return 1;
+	}
+
+	char magic[8];
+	unsigned int header[4];
+	long long npoints = 0;
+	if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) || memcmp(magic, TableMagic, sizeof(TableMagic)) != 0
+		|| fread(header, sizeof(unsigned int), 4, f) != 4 || header[0] != TableByteOrderMark || header[1] != TableFormatVersion
+		|| fread(&npoints, sizeof(long long), 1, f) != 1) {
+		printf("**ERROR** %s is not a supported table file\n", filename.c_str());
+		fclose(f);
+		return 1;
+	}
+
+	vector< vector<double> > grid(header[2]);
+	vector<string> names(header[2] + header[3]);
+	for (size_t i = 0; i < names.size(); ++i) {
+		int len = 0;
+		bool ok = (fread(&len, sizeof(int), 1, f) == 1 && len >= 0);
+		vector<char> str(len + 1, '\0');
+		ok = ok && (fread(&str[0], 1, len, f) == static_cast<size_t>(len));
+		names[i] = &str[0];
+		if (ok && i < grid.size()) {
+			long long nv = 0;
+			ok = (fread(&nv, sizeof(long long), 1, f) == 1 && nv > 0);
+			if (ok) {
+				grid[i].resize(nv);
+				ok = (fread(&grid[i][0], sizeof(double), nv, f) == static_cast<size_t>(nv));
+			}
+		}
+		if (!ok) {
+			printf("**ERROR** %s is truncated or corrupt\n", filename.c_str());
+			fclose(f);
+			return 1;
+		}
+	}
+
+	for (size_t i = 0; i < names.size(); ++i)
+		printf("%15s ", names[i].c_str());
+	printf("\n");
+
+	vector<double> row(header[3]);
+	for (long long ipoint = 0; ipoint < npoints; ++ipoint) {
+		if (fread(&row[0], sizeof(double), row.size(), f) != row.size()) {
+			printf("**ERROR** %s is truncated or corrupt\n", filename.c_str());
+			fclose(f);
+			return 1;
+		}
+		long long index = ipoint;
+		vector<double> values(grid.size());
+		for (int i = static_cast<int>(grid.size()) - 1; i >= 0; --i) {
+			values[i] = grid[i][index % grid[i].size()];
+			index /= grid[i].size();
+		}
+		for (size_t i = 0; i < values.size(); ++i)
+			printf("%15.8E ", values[i]);
+		for (size_t i = 0; i < row.size(); ++i)
+			printf("%15.8E ", row[i]);
+		printf("\n");
+	}
+
+	fclose(f);
+	return 0;
+}
+
+
+// Usage:
+// EVTablesGenerator [particle list]
+//   generates the tables below in the text format
+// EVTablesGenerator --to-binary <input> <output> [particle list]
+// EVTablesGenerator --to-text <input> <output> [particle list]
+//   convert a table with the Crossterms EV or QvdW parameters between the text and binary formats
+// EVTablesGenerator --config <configuration file>
+//   generates the equation of state and yield tables on a grid of parameters, see GenerateTables()
+// EVTablesGenerator --dump <table>
+//   prints a table generated with --config in the text format
 int main(int argc, char *argv[])
 {
 	//string inputlist = string(ThermalFIST_INPUT_FOLDER) + "/list/PDG2014/list-withnuclei-withcharm.dat";
 	string inputlist = string(ThermalFIST_INPUT_FOLDER) + "/list/PDG2020/list-all.dat";
+
+	if (argc > 1 && (string(argv[1]) == "--config" || string(argv[1]) == "--dump")) {
+		if (argc < 3) {
+			printf("Usage: %s %s <file>\n", argv[0], argv[1]);
+			return 1;
+		}
+		if (string(argv[1]) == "--config")
+			return GenerateTables(argv[2]);
+		return DumpTable(argv[2]);
+	}
+
+	if (argc > 1 && (string(argv[1]) == "--to-binary" || string(argv[1]) == "--to-text")) {
+		if (argc < 4) {
+			printf("Usage: %s %s <input> <output> [particle list]\n", argv[0], argv[1]);
+			return 1;
+		}
+		if (argc > 4)
+			inputlist = string(argv[4]);
+
+		ThermalParticleSystem TPS(inputlist);
+		bool ok = false;
+		if (string(argv[1]) == "--to-binary")
+			ok = ConvertToBinary(argv[2], argv[3], &TPS);
+		else
+			ok = ConvertToText(argv[2], argv[3], &TPS);
+		return ok ? 0 : 1;
+	}
+
   if (argc > 1)
     inputlist = string(argv[1]);
 
@@ -0,0 +1,111 @@
+/*
+ * Thermal-FIST package
+ * 
+ * Copyright (c) 2018-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include <cmath>
+#include <vector>
+#include "HRGBase/Broyden.h"
+#include "gtest/gtest.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	// x^2 + y^2 = 4, exp(x) + y = 1, solution near (-1.8163, 0.8374)
+	class CircleExpEquations : public BroydenEquations {
+	public:
+		static int Copies, CopiesAlive;
+		CircleExpEquations(bool copy = false) : BroydenEquations(), m_IsCopy(copy) { m_N = 2; }
+		~CircleExpEquations() { if (m_IsCopy) CopiesAlive--; }
+		std::vector<double> Equations(const std::vector<double> &x) {
+			std::vector<double> ret(2);
+			ret[0] = x[0] * x[0] + x[1] * x[1] - 4.;
+			ret[1] = std::exp(x[0]) + x[1] - 1.;
+			return ret;
+		}
+		BroydenEquations* Clone() const { Copies++; CopiesAlive++; return new CircleExpEquations(true); }
+	private:
+		bool m_IsCopy;
+	};
+
+	int CircleExpEquations::Copies = 0;
+	int CircleExpEquations::CopiesAlive = 0;
+
+	// atan(x) = 0, the full Newton steps diverge for |x0| > 1.39
+	class ArctanEquations : public BroydenEquations {
+	public:
+		ArctanEquations() : BroydenEquations() { m_N = 1; }
+		std::vector<double> Equations(const std::vector<double> &x) {
+			return std::vector<double>(1, std::atan(x[0]));
+		}
+	};
+
+	TEST(BroydenTest, SolvesNonlinearSystem) {
+		EXPECT_FALSE(Broyden().UseLineSearch());
+
+		for (int newton = 0; newton < 2; ++newton) {
+			for (int linesearch = 0; linesearch < 2; ++linesearch) {
+				CircleExpEquations eqs;
+				Broyden broydn(&eqs);
+				broydn.UseNewton(newton == 1);
+				broydn.UseLineSearch(linesearch == 1);
+				std::vector<double> x0(2);
+				x0[0] = -1.;
+				x0[1] = 1.;
+				std::vector<double> x = broydn.Solve(x0);
+				EXPECT_LT(broydn.Iterations(), broydn.MaxIterations());
+				EXPECT_LT(broydn.MaxDifference(), 1.e-10);
+				std::vector<double> f = eqs.Equations(x);
+				EXPECT_NEAR(f[0], 0., 1.e-9);
+				EXPECT_NEAR(f[1], 0., 1.e-9);
+				EXPECT_NEAR(x[0], -1.8163, 1.e-4);
+				EXPECT_NEAR(x[1], 0.8374, 1.e-4);
+			}
+		}
+	}
+
+	TEST(BroydenTest, LineSearch) {
+		ArctanEquations eqs;
+		Broyden broydn(&eqs);
+		broydn.UseNewton(true);
+		broydn.UseLineSearch(true);
+		std::vector<double> x = broydn.Solve(std::vector<double>(1, 3.));
+		EXPECT_LT(broydn.Iterations(), broydn.MaxIterations());
+		EXPECT_NEAR(x[0], 0., 1.e-9);
+	}
+
+	// The copies of the equations for the finite difference Jacobian are created once per solution
+	TEST(BroydenTest, EquationsCopiesPerSolve) {
+		CircleExpEquations eqs;
+		std::vector<double> x0(2);
+		x0[0] = -1.;
+		x0[1] = 1.;
+
+		Broyden single(&eqs);
+		CircleExpEquations::Copies = 0;
+		single.Solve(x0, NULL, 1);
+		int copiesSingle = CircleExpEquations::Copies;
+		EXPECT_EQ(CircleExpEquations::CopiesAlive, 0);
+
+		Broyden newton(&eqs);
+		newton.UseNewton(true);
+		CircleExpEquations::Copies = 0;
+		newton.Solve(x0);
+		EXPECT_GT(newton.Iterations(), 2);
+		EXPECT_EQ(CircleExpEquations::Copies, copiesSingle);
+		EXPECT_EQ(CircleExpEquations::CopiesAlive, 0);
+
+		// Same with a Jacobian object provided by the caller
+		BroydenJacobian jaco(&eqs);
+		Broyden newtonjaco(&eqs, &jaco);
+		newtonjaco.UseNewton(true);
+		CircleExpEquations::Copies = 0;
+		newtonjaco.Solve(x0);
+		EXPECT_EQ(CircleExpEquations::Copies, copiesSingle);
+		EXPECT_EQ(CircleExpEquations::CopiesAlive, 0);
+	}
+
+}
@@ -0,0 +1,74 @@
+/*
+ * Thermal-FIST package
+ * 
+ * Copyright (c) 2014-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include <cmath>
+#include <string>
+#include "HRGBase.h"
+#include "HRGEV.h"
+#include "ThermalFISTConfig.h"
+#include "gtest/gtest.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	// Gives access to the stored and the lazily computed correlation matrix elements,
+	// including those of unstable species
+	class CorrelationsModel : public ThermalModelEVDiagonal {
+	public:
+		CorrelationsModel(ThermalParticleSystem *TPS) : ThermalModelEVDiagonal(TPS) { }
+		double Primordial(int i, int j) const { return m_PrimCorrel[i][j]; }
+		double Final(int i, int j) const { return !m_TotalCorrel.empty() ? m_TotalCorrel[i][j] : FinalCorrelation(i, j); }
+	};
+
+	// The final correlations computed on request and stored in the dense matrix agree.
+	// Pairs with an unstable species keep the primordial correlations.
+	TEST(CorrelationsTest, FinalCorrelationsDenseAndLazy) {
+		ThermalParticleSystem TPS(std::string(ThermalFIST_INPUT_FOLDER) + "/list/PDG2014/list.dat");
+
+		CorrelationsModel lazy(&TPS), dense(&TPS);
+		dense.SetDenseFinalCorrelations(true);
+		CorrelationsModel *models[2] = { &lazy, &dense };
+		for (int k = 0; k < 2; ++k) {
+			models[k]->SetRadius(0.3);
+			models[k]->SetTemperature(0.155);
+			models[k]->SetBaryonChemicalPotential(0.100);
+			models[k]->FillChemicalPotentials();
+			models[k]->CalculateDensities();
+			models[k]->CalculateFluctuations();
+		}
+
+		int proton = TPS.PdgToId(2212), pion = TPS.PdgToId(211), delta = TPS.PdgToId(2224);
+		ASSERT_GE(proton, 0);
+		ASSERT_GE(pion, 0);
+		ASSERT_GE(delta, 0);
+		ASSERT_TRUE(TPS.Particles()[proton].IsStable());
+		ASSERT_FALSE(TPS.Particles()[delta].IsStable());
+
+		// Resonance - stable pair
+		double prim = lazy.Primordial(delta, proton);
+		EXPECT_NE(prim, 0.);
+		EXPECT_EQ(dense.Primordial(delta, proton), prim);
+		EXPECT_EQ(lazy.Final(delta, proton), prim);
+		EXPECT_EQ(lazy.Final(proton, delta), prim);
+		EXPECT_EQ(dense.Final(delta, proton), prim);
+		EXPECT_EQ(dense.Final(proton, delta), prim);
+
+		// Stable pairs and the diagonal elements include the decay contributions
+		int ids[3] = { proton, pion, delta };
+		for (int a = 0; a < 3; ++a) {
+			for (int b = 0; b < 3; ++b) {
+				if (a != b && (ids[a] == delta || ids[b] == delta))
+					continue;
+				EXPECT_NEAR(lazy.Final(ids[a], ids[b]), dense.Final(ids[a], ids[b]), 1.e-12 * std::abs(dense.Final(ids[a], ids[b])));
+			}
+		}
+		EXPECT_DOUBLE_EQ(lazy.TwoParticleSusceptibilityFinal(proton, pion), dense.TwoParticleSusceptibilityFinal(proton, pion));
+		EXPECT_NE(lazy.Final(proton, pion), lazy.Primordial(proton, pion));
+	}
+
+}
@@ -0,0 +1,145 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2015-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include <cmath>
+#include <string>
+#include <vector>
+#include "HRGBase.h"
+#include "HRGEventGenerator/Acceptance.h"
+#include "HRGEventGenerator/SphericalBlastWaveEventGenerator.h"
+#include "HRGEventGenerator/CylindricalBlastWaveEventGenerator.h"
+#include "ThermalFISTConfig.h"
+#include "gtest/gtest.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	const std::string ListFile = std::string(ThermalFIST_INPUT_FOLDER) + "/list/PDG2014/list.dat";
+
+	// Window in y and pT with linear edges, as obtained from a binned acceptance
+	void FillAcceptance(Acceptance::AcceptanceFunction& acc) {
+		acc.dy = acc.dpt = 0.1;
+		for (int iy = 0; iy <= 40; ++iy) {
+			for (int ipt = 0; ipt <= 30; ++ipt) {
+				double y = -2. + 0.1 * iy, pt = 0.1 * ipt;
+				acc.ys.push_back(y);
+				acc.pts.push_back(pt);
+				acc.probs.push_back((std::abs(y - 0.2) < 0.6 && pt > 0.2 && pt < 1.5) ? 0.9 : 0.);
+			}
+		}
+		acc.setSpline();
+	}
+
+	// Histograms of y and pT within the acceptance window, each particle enters with a weight
+	struct Spectra {
+		static const int nybins = 12, nptbins = 13;
+		std::vector<double> ys, yerrs, pts, pterrs;
+		double total;
+		Spectra() : ys(nybins, 0.), yerrs(nybins, 0.), pts(nptbins, 0.), pterrs(nptbins, 0.), total(0.) { }
+		void Fill(double y, double pt, double w) {
+			total += w;
+			int iy = static_cast<int>(std::floor((y + 0.4) / 0.1));
+			if (iy >= 0 && iy < nybins) {
+				ys[iy] += w;
+				yerrs[iy] += w * w;
+			}
+			int ipt = static_cast<int>(std::floor((pt - 0.2) / 0.1));
+			if (ipt >= 0 && ipt < nptbins) {
+				pts[ipt] += w;
+				pterrs[ipt] += w * w;
+			}
+		}
+	};
+
+	double Chi2(const std::vector<double>& a, const std::vector<double>& aerr, const std::vector<double>& b, const std::vector<double>& berr) {
+		double ret = 0.;
+		for (size_t i = 0; i < a.size(); ++i) {
+			if (aerr[i] + berr[i] > 0.)
+				ret += (a[i] - b[i]) * (a[i] - b[i]) / (aerr[i] + berr[i]);
+		}
+		return ret;
+	}
+
+	// Exposes whether the momenta of the accepted particles are sampled from a table
+	template<class Generator>
+	class FastPathAccess : public Generator {
+	public:
+		FastPathAccess(ThermalParticleSystem *TPS) : Generator(TPS, EventGeneratorConfiguration()) { }
+		bool UsesTable(int i) const { return i < static_cast<int>(this->m_AcceptedMomentumTables.size()) && this->m_AcceptedMomentumTables[i]; }
+	};
+
+	// Accepted spectra from the fast path vs. the full generation weighted by the acceptance
+	template<class Generator>
+	void CompareFastPath(const std::vector<long long>& pdgs) {
+		ThermalParticleSystem TPS(ListFile);
+		FastPathAccess<Generator> slow(&TPS), fast(&TPS);
+		Acceptance::AcceptanceFunction acc;
+		FillAcceptance(acc);
+
+		const int N = 200000;
+		for (size_t ipdg = 0; ipdg < pdgs.size(); ++ipdg) {
+			int id = TPS.PdgToId(pdgs[ipdg]);
+			ASSERT_GE(id, 0);
+
+			std::vector<Acceptance::AcceptanceFunction*> accs(TPS.Particles().size(), NULL);
+			accs[id] = &acc;
+			fast.SetAcceptedParticlesFastPath(accs);
+			ASSERT_TRUE(fast.UsesTable(id));
+			double prob = fast.AcceptanceProbability(id);
+			ASSERT_GT(prob, 0.);
+			ASSERT_LT(prob, 1.);
+
+			std::vector<int> yields(TPS.Particles().size(), 0);
+			yields[id] = N;
+
+			RandomGenerators::SetSeed(1);
+			Spectra sslow, sfast;
+			SimpleEvent evslow = slow.SampleMomenta(yields);
+			for (size_t i = 0; i < evslow.Particles.size(); ++i) {
+				const SimpleParticle& part = evslow.Particles[i];
+				sslow.Fill(part.GetY(), part.GetPt(), acc.getAcceptance(part.GetY(), part.GetPt()));
+			}
+			SimpleEvent evfast = fast.SampleMomenta(yields);
+			int outside = 0;
+			for (size_t i = 0; i < evfast.Particles.size(); ++i) {
+				const SimpleParticle& part = evfast.Particles[i];
+				EXPECT_EQ(part.PDGID, pdgs[ipdg]);
+				if (!(acc.getAcceptance(part.GetY(), part.GetPt()) > 0.))
+					outside++;
+				sfast.Fill(part.GetY(), part.GetPt(), 1.);
+			}
+
+			// Only the interpolation of the table at the acceptance edges
+			EXPECT_LT(outside, 1.e-3 * sfast.total);
+
+			// Accepted yield and the quadrature of the acceptance probability
+			double err = std::sqrt(N * prob);
+			EXPECT_LT(std::abs(sfast.total - N * prob), 5. * err);
+			EXPECT_LT(std::abs(sslow.total - N * prob), 5. * err);
+
+			// Spectra within the statistical errors, 12 and 13 bins
+			EXPECT_LT(Chi2(sfast.ys, sfast.yerrs, sslow.ys, sslow.yerrs), 40.);
+			EXPECT_LT(Chi2(sfast.pts, sfast.pterrs, sslow.pts, sslow.pterrs), 40.);
+		}
+	}
+
+	TEST(EventGeneratorBaseTest, AcceptedSpectraSphericalBlastWave) {
+		std::vector<long long> pdgs;
+		pdgs.push_back(211);
+		pdgs.push_back(2212);
+		CompareFastPath<SphericalBlastWaveEventGenerator>(pdgs);
+	}
+
+	TEST(EventGeneratorBaseTest, AcceptedSpectraCylindricalBlastWave) {
+		std::vector<long long> pdgs;
+		pdgs.push_back(211);
+		pdgs.push_back(2212);
+		CompareFastPath<CylindricalBlastWaveEventGenerator>(pdgs);
+	}
+
+}
@@ -0,0 +1,203 @@
+/*
+ * Thermal-FIST package
+ * 
+ * Copyright (c) 2014-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "HRGEventGenerator/EventObservables.h"
+#include "gtest/gtest.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	// Events with multiplicities k weighted with the Poisson distribution,
+	// all the cumulants are equal to lambda
+	void FillPoisson(double lambda, MomentsAccumulator& acc, MomentsAccumulator *odd = NULL) {
+		int kmin = std::max(0, static_cast<int>(lambda - 40. * sqrt(lambda)));
+		int kmax = static_cast<int>(lambda + 40. * sqrt(lambda)) + 10;
+		for (int k = kmin; k <= kmax; ++k) {
+			double w = exp(k * log(lambda) - lambda - lgamma(k + 1.));
+			if (odd != NULL && (k & 1))
+				odd->Add(k, w);
+			else
+				acc.Add(k, w);
+		}
+	}
+
+	TEST(MomentsAccumulatorTest, ExactMoments) {
+		MomentsAccumulator acc;
+		for (int x = 1; x <= 4; ++x)
+			acc.Add(x);
+
+		EXPECT_EQ(acc.Events(), 4);
+		EXPECT_DOUBLE_EQ(acc.SumOfWeights(), 4.);
+		EXPECT_DOUBLE_EQ(acc.EffectiveEvents(), 4.);
+		EXPECT_DOUBLE_EQ(acc.Mean(), 2.5);
+		EXPECT_DOUBLE_EQ(acc.RawMoment(2), 7.5);
+		EXPECT_DOUBLE_EQ(acc.RawMoment(3), 25.);
+		EXPECT_DOUBLE_EQ(acc.Variance(), 1.25);
+		EXPECT_NEAR(acc.CentralMoment(3), 0., 1.e-14);
+		EXPECT_DOUBLE_EQ(acc.CentralMoment(4), 2.5625);
+		EXPECT_DOUBLE_EQ(acc.Cumulant(4), 2.5625 - 3. * 1.25 * 1.25);
+	}
+
+	TEST(MomentsAccumulatorTest, PoissonCumulants) {
+		double lambdas[2] = { 3., 1000. };
+		for (int il = 0; il < 2; ++il) {
+			double lambda = lambdas[il];
+			MomentsAccumulator acc;
+			FillPoisson(lambda, acc);
+
+			EXPECT_NEAR(acc.SumOfWeights(), 1., 1.e-9);
+			for (int k = 1; k <= 6; ++k)
+				EXPECT_NEAR(acc.Cumulant(k), lambda, 1.e-6 * lambda) << "lambda = " << lambda << ", order " << k;
+
+			EXPECT_NEAR(acc.ScaledVariance(), 1., 1.e-6);
+			EXPECT_NEAR(acc.C3C2(), 1., 1.e-6);
+			EXPECT_NEAR(acc.C4C2(), 1., 1.e-6);
+			EXPECT_NEAR(acc.C5C2(), 1., 1.e-6);
+			EXPECT_NEAR(acc.C6C2(), 1., 1.e-6);
+		}
+	}
+
+	TEST(MomentsAccumulatorTest, Merge) {
+		double lambda = 1000.;
+		MomentsAccumulator all, even, odd, empty;
+		FillPoisson(lambda, all);
+		FillPoisson(lambda, even, &odd);
+
+		MomentsAccumulator merged = empty;
+		merged.Merge(even);
+		merged.Merge(empty);
+		merged.Merge(odd);
+
+		EXPECT_EQ(merged.Events(), all.Events());
+		EXPECT_NEAR(merged.SumOfWeights(), all.SumOfWeights(), 1.e-14);
+		EXPECT_NEAR(merged.EffectiveEvents(), all.EffectiveEvents(), 1.e-12 * all.EffectiveEvents());
+		EXPECT_NEAR(merged.Mean(), all.Mean(), 1.e-12 * lambda);
+		for (int k = 2; k <= MomentsAccumulator::MaxMoment; ++k)
+			EXPECT_NEAR(merged.CentralMoment(k), all.CentralMoment(k), 1.e-9 * std::abs(all.CentralMoment(k))) << "order " << k;
+		for (int k = 1; k <= 6; ++k)
+			EXPECT_NEAR(merged.Cumulant(k), lambda, 1.e-6 * lambda) << "order " << k;
+	}
+
+	TEST(Histogram1DTest, FillAndMerge) {
+		Histogram1D hist(0., 2., 4);
+		hist.Fill(0.1);
+		hist.Fill(0.6, 2.);
+		hist.Fill(0.7, 3.);
+		hist.Fill(1.999);
+		hist.Fill(-0.1, 0.5);
+		hist.Fill(2.);
+		hist.Fill(std::numeric_limits<double>::infinity());
+		hist.Fill(-std::numeric_limits<double>::infinity());
+		hist.Fill(std::numeric_limits<double>::quiet_NaN());
+
+		EXPECT_DOUBLE_EQ(hist.BinWidth(), 0.5);
+		EXPECT_DOUBLE_EQ(hist.BinCenter(1), 0.75);
+		EXPECT_DOUBLE_EQ(hist.BinContent(0), 1.);
+		EXPECT_DOUBLE_EQ(hist.BinContent(1), 5.);
+		EXPECT_DOUBLE_EQ(hist.BinContent(2), 0.);
+		EXPECT_DOUBLE_EQ(hist.BinContent(3), 1.);
+		EXPECT_DOUBLE_EQ(hist.BinError(1), sqrt(13.));
+		EXPECT_DOUBLE_EQ(hist.Underflow(), 1.5);
+		EXPECT_DOUBLE_EQ(hist.Overflow(), 2.);
+
+		Histogram1D other(0., 2., 4);
+		other.Fill(1.2, 2.);
+		hist.Merge(other);
+		EXPECT_DOUBLE_EQ(hist.BinContent(2), 2.);
+		EXPECT_DOUBLE_EQ(hist.BinError(2), 2.);
+
+		hist.Reset();
+		EXPECT_EQ(hist.BinContent(1), 0.);
+		EXPECT_EQ(hist.Overflow(), 0.);
+	}
+
+	// Events with large multiplicities of two species, pT = 0.5 GeV and y = 0 for all particles
+	SimpleEvent TestEvent(int e, int& N1, int& N2) {
+		N1 = 1000 + e % 3;
+		N2 = 500 + (e * e) % 5 + (e % 3 == 2 ? 1 : 0);
+		SimpleEvent evt;
+		evt.weight = 1. + 0.1 * (e % 4);
+		for (int i = 0; i < N1; ++i)
+			evt.Particles.push_back(SimpleParticle(0.5, 0., 0., 0.138, 211));
+		for (int i = 0; i < N2; ++i)
+			evt.Particles.push_back(SimpleParticle(0., 0.5, 0., 0.938, 2212));
+		// Not selected
+		evt.Particles.push_back(SimpleParticle(0., 0., 0.5, 0.494, 321));
+		return evt;
+	}
+
+	TEST(EventObservablesAccumulatorTest, CovarianceAndSpectra) {
+		EventObservablesAccumulator::Config config;
+		config.pdgs.push_back(211);
+		config.pdgs.push_back(2212);
+		config.ptBins = 10;
+		config.ptMax = 1.;
+
+		EventObservablesAccumulator all(NULL, config);
+		std::vector<EventObservablesAccumulator> parts(3, EventObservablesAccumulator(NULL, config));
+		ASSERT_EQ(all.ObservablesNumber(), 2);
+		EXPECT_EQ(all.NetChargeIndex(ConservedCharge::BaryonCharge), -1);
+
+		int nevents = 30;
+		std::vector<double> w(nevents), N1(nevents), N2(nevents);
+		for (int e = 0; e < nevents; ++e) {
+			int n1, n2;
+			SimpleEvent evt = TestEvent(e, n1, n2);
+			w[e] = evt.weight;
+			N1[e] = n1;
+			N2[e] = n2;
+			all.AddEvent(evt);
+			parts[e % 3].AddEvent(evt);
+		}
+
+		// Two-pass reference
+		double W = 0., mean1 = 0., mean2 = 0.;
+		for (int e = 0; e < nevents; ++e) {
+			W += w[e];
+			mean1 += w[e] * N1[e];
+			mean2 += w[e] * N2[e];
+		}
+		mean1 /= W;
+		mean2 /= W;
+		double var1 = 0., var2 = 0., cov = 0.;
+		for (int e = 0; e < nevents; ++e) {
+			var1 += w[e] * (N1[e] - mean1) * (N1[e] - mean1) / W;
+			var2 += w[e] * (N2[e] - mean2) * (N2[e] - mean2) / W;
+			cov += w[e] * (N1[e] - mean1) * (N2[e] - mean2) / W;
+		}
+
+		EventObservablesAccumulator reduced = EventObservablesAccumulator::Reduce(parts);
+		const EventObservablesAccumulator* accs[2] = { &all, &reduced };
+		for (int ia = 0; ia < 2; ++ia) {
+			const EventObservablesAccumulator& acc = *accs[ia];
+			int i1 = acc.SpeciesIndex(211), i2 = acc.SpeciesIndex(2212);
+			ASSERT_EQ(i1, 0);
+			ASSERT_EQ(i2, 1);
+			EXPECT_EQ(acc.SpeciesIndex(321), -1);
+			EXPECT_EQ(acc.Events(), nevents);
+			EXPECT_NEAR(acc.SumOfWeights(), W, 1.e-12 * W);
+
+			EXPECT_NEAR(acc.MomentsByPdg(211).Mean(), mean1, 1.e-12 * mean1);
+			EXPECT_NEAR(acc.MomentsByPdg(2212).Variance(), var2, 1.e-9 * var2);
+			EXPECT_NEAR(acc.Covariance(i1, i1), var1, 1.e-9 * var1);
+			EXPECT_NEAR(acc.Covariance(i1, i2), cov, 1.e-9 * std::abs(cov));
+			EXPECT_NEAR(acc.Covariance(i2, i1), cov, 1.e-9 * std::abs(cov));
+			EXPECT_NEAR(acc.PearsonCorrelation(i1, i2), cov / sqrt(var1 * var2), 1.e-9);
+
+			// All the pions are in the pT bin [0.5, 0.6)
+			const Histogram1D& hist = acc.PtHistogram(i1);
+			EXPECT_NEAR(acc.PerEventYield(hist, 5), mean1 / hist.BinWidth(), 1.e-9 * mean1 / hist.BinWidth());
+			EXPECT_EQ(acc.PerEventYield(hist, 4), 0.);
+			EXPECT_NEAR(acc.RapidityHistogram(i2).BinContent(50), W * mean2, 1.e-9 * W * mean2);
+		}
+	}
+
+}
@@ -0,0 +1,192 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2014-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include <cmath>
+#include <string>
+#include <vector>
+#include "HRGBase.h"
+#include "HRGEventGenerator/HypersurfaceEventGenerator.h"
+#include "HRGEventGenerator/CylindricalBlastWaveEventGenerator.h"
+#include "ThermalFISTConfig.h"
+#include "gtest/gtest.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	const std::string ListFile = std::string(ThermalFIST_INPUT_FOLDER) + "/list/PDG2014/list.dat";
+
+	// Histograms of y and pT
+	struct Spectra {
+		static const int nybins = 20, nptbins = 20;
+		std::vector<double> ys, pts;
+		Spectra() : ys(nybins, 0.), pts(nptbins, 0.) { }
+		void Fill(const SimpleEvent& ev) {
+			for (size_t i = 0; i < ev.Particles.size(); ++i) {
+				int iy = static_cast<int>(std::floor((ev.Particles[i].GetY() + 2.) / 0.2));
+				if (iy >= 0 && iy < nybins)
+					ys[iy] += 1.;
+				int ipt = static_cast<int>(std::floor(ev.Particles[i].GetPt() / 0.1));
+				if (ipt >= 0 && ipt < nptbins)
+					pts[ipt] += 1.;
+			}
+		}
+	};
+
+	double Chi2(const std::vector<double>& a, const std::vector<double>& b) {
+		double ret = 0.;
+		for (size_t i = 0; i < a.size(); ++i) {
+			if (a[i] + b[i] > 0.)
+				ret += (a[i] - b[i]) * (a[i] - b[i]) / (a[i] + b[i]);
+		}
+		return ret;
+	}
+
+	TEST(HypersurfaceEventGeneratorTest, CylindricalBlastWave) {
+		ThermalParticleSystem TPS(ListFile);
+
+		double T = 0.120, betas = 0.6, etamax = 1., npow = 1.;
+		ParticlizationHypersurface surface = CylindricalBlastWaveHypersurface(T, betas, etamax, npow, 10., 10., 100, 16, 64);
+
+		EventGeneratorConfiguration config;
+		HypersurfaceEventGenerator hypgen(&TPS, config, &surface);
+		ASSERT_EQ(hypgen.ThermodynamicClassesNumber(), 1);
+		EXPECT_FALSE(hypgen.HasSpacelikeCells());
+
+		config.CFOParameters.T = T;
+		config.CFOParameters.V = config.CFOParameters.SVc = hypgen.EffectiveVolume();
+		CylindricalBlastWaveEventGenerator bwgen(&TPS, config, T, betas, etamax, npow);
+
+		// Yields
+		ThermalModelBase *model = bwgen.ThermalModel();
+		if (!model->IsGCECalculated())
+			model->CalculateDensitiesGCE();
+		for (size_t i = 0; i < TPS.Particles().size(); ++i) {
+			double yield = model->Densities()[i] * model->Volume();
+			EXPECT_NEAR(hypgen.MeanYield(i), yield, 1.e-9 * yield);
+		}
+
+		// Spectra
+		const int N = 100000;
+		long long pdgs[] = { 211, 2212 };
+		for (int ipdg = 0; ipdg < 2; ++ipdg) {
+			int id = TPS.PdgToId(pdgs[ipdg]);
+			ASSERT_GE(id, 0);
+			std::vector<int> yields(TPS.Particles().size(), 0);
+			yields[id] = N;
+
+			RandomGenerators::SetSeed(1);
+			Spectra shyp, sbw;
+			shyp.Fill(hypgen.SampleMomenta(yields));
+			sbw.Fill(bwgen.SampleMomenta(yields));
+			EXPECT_LT(Chi2(shyp.ys, sbw.ys), 50.);
+			EXPECT_LT(Chi2(shyp.pts, sbw.pts), 50.);
+		}
+	}
+
+	// Monte Carlo estimate of the Cooper-Frye volume <max(0, p.dsigma) / E*> of a cell
+	double SampledCooperFryeVolume(const ParticlizationHypersurfaceElement& el, double mass, int statistics, int samples) {
+		RandomGenerators::ThermalMomentumGenerator gen(mass, statistics, el.T, 0.);
+		double ret = 0.;
+		for (int i = 0; i < samples; ++i) {
+			double p = gen.GetP();
+			double costh = 2. * RandomGenerators::randgenMT.rand() - 1.;
+			double sinth = std::sqrt(1. - costh * costh);
+			double phi = 2. * xMath::Pi() * RandomGenerators::randgenMT.rand();
+			double pst[3] = { p * sinth * std::cos(phi), p * sinth * std::sin(phi), p * costh };
+			double Est = std::sqrt(p * p + mass * mass);
+			const double *u = el.u;
+			double updst = u[1] * pst[0] + u[2] * pst[1] + u[3] * pst[2];
+			double coef = updst / (u[0] + 1.) + Est;
+			double pdsigma = (u[0] * Est + updst) * el.dsigma[0]
+				+ (pst[0] + coef * u[1]) * el.dsigma[1]
+				+ (pst[1] + coef * u[2]) * el.dsigma[2]
+				+ (pst[2] + coef * u[3]) * el.dsigma[3];
+			ret += std::max(0., pdsigma) / Est;
+		}
+		return ret / samples;
+	}
+
+	TEST(HypersurfaceEventGeneratorTest, SpacelikeCells) {
+		ThermalParticleSystem TPS(ListFile);
+
+		// Cells with the same thermal parameters and different orientations of the normal vector
+		ParticlizationHypersurfaceElement el;
+		el.tau = 10.;
+		el.x = el.y = el.eta = 0.;
+		el.T = 0.140;
+		el.muB = el.muQ = el.muS = 0.;
+		ParticlizationHypersurface surface;
+		double dsigmas[][4] = {
+			{ 1., 0., 0., 0. },    // timelike
+			{ 0., 1., 0., 0. },    // spacelike, u.dsigma = 0
+			{ 0.3, 0.8, 0., 0. },  // spacelike, u.dsigma > 0
+			{ 0.2, 0., -0.9, 0.4 } // spacelike, u.dsigma < 0
+		};
+		double us[][3] = {
+			{ 0.5, 0., 0. },
+			{ 0., 0., 0. },
+			{ 0.4, 0.3, 0. },
+			{ -0.2, 0.6, 0.1 }
+		};
+		for (int icell = 0; icell < 4; ++icell) {
+			for (int mu = 0; mu < 4; ++mu)
+				el.dsigma[mu] = dsigmas[icell][mu];
+			el.u[1] = us[icell][0];
+			el.u[2] = us[icell][1];
+			el.u[3] = us[icell][2];
+			el.u[0] = std::sqrt(1. + el.u[1] * el.u[1] + el.u[2] * el.u[2] + el.u[3] * el.u[3]);
+			surface.push_back(el);
+		}
+
+		EventGeneratorConfiguration config;
+		config.fEnsemble = EventGeneratorConfiguration::CE;
+		HypersurfaceEventGenerator gen(&TPS, config, &surface);
+		ASSERT_EQ(gen.ThermodynamicClassesNumber(), 1);
+		EXPECT_TRUE(gen.HasSpacelikeCells());
+
+		// The thermal model is evaluated for the volume sum max(0, u.dsigma)
+		ThermalModelBase *model = gen.ThermalModel();
+		double Veff = 0.;
+		for (size_t icell = 0; icell < surface.size(); ++icell) {
+			const ParticlizationHypersurfaceElement& c = surface[icell];
+			Veff += std::max(0., c.u[0] * c.dsigma[0] + c.u[1] * c.dsigma[1] + c.u[2] * c.dsigma[2] + c.u[3] * c.dsigma[3]);
+		}
+		EXPECT_NEAR(gen.EffectiveVolume(), Veff, 1.e-12);
+		EXPECT_EQ(model->Ensemble(), ThermalModelBase::GCE);
+
+		// The Cooper-Frye yields with the negative contributions discarded, as in the momentum sampling
+		RandomGenerators::SetSeed(1);
+		long long pdgs[] = { 211, 2212 };
+		for (int ipdg = 0; ipdg < 2; ++ipdg) {
+			int id = TPS.PdgToId(pdgs[ipdg]);
+			ASSERT_GE(id, 0);
+			const ThermalParticle& part = TPS.Particles()[id];
+			double V = 0.;
+			for (size_t icell = 0; icell < surface.size(); ++icell)
+				V += SampledCooperFryeVolume(surface[icell], part.Mass(), part.Statistics(), 1000000);
+			double yield = model->Densities()[id] * V;
+			EXPECT_NEAR(gen.MeanYield(id), yield, 3.e-3 * yield);
+
+			// The yields differ from n_i sum max(0, u.dsigma) for the spacelike cells
+			EXPECT_GT(std::abs(gen.MeanYield(id) / (model->Densities()[id] * Veff) - 1.), 0.05);
+		}
+
+		// Sampled multiplicities
+		int id = TPS.PdgToId(211);
+		const int events = 2000;
+		double mean = 0.;
+		for (int iev = 0; iev < events; ++iev) {
+			SimpleEvent ev = gen.GetEvent(false);
+			for (size_t i = 0; i < ev.Particles.size(); ++i)
+				if (ev.Particles[i].PDGID == 211)
+					mean += 1. / events;
+		}
+		EXPECT_NEAR(mean, gen.MeanYield(id), 5. * std::sqrt(gen.MeanYield(id) / events));
+	}
+
+}
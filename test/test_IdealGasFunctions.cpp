@@ -6,6 +6,8 @@
  * GNU General Public License (GPLv3 or later)
  */
 #include <limits.h>
+#include <cmath>
+#include <vector>
 #include "HRGBase/xMath.h"
 #include "HRGBase/IdealGasFunctions.h"
 #include "gtest/gtest.h"
@@ -171,4 +173,69 @@ namespace {
 		EXPECT_LT(abs(IdealGasFunctions::QuantumNumericalIntegrationDensity(-1, 1.000, 0.137, 0.138, 1) / xMath::GeVtoifm3() - MathematicaRef) / MathematicaRef, accuracy);
 	}
 
-}
\ No newline at end of file
+	// The single-pass evaluation of all the thermodynamic functions and all the terms of the cluster expansion
+	TEST(QSClusterExpansionTest, QuantitiesSinglePass) {
+		double accuracy = 1.e-12;
+
+		int stats[2] = { 1, -1 };
+		double Ts[3] = { 0.050, 0.155, 0.300 };
+		double mus[3] = { -0.100, 0.000, 0.120 };
+		double masses[2] = { 0.138, 0.938 };
+		for (int is = 0; is < 2; ++is) {
+			for (int iT = 0; iT < 3; ++iT) {
+				for (int imu = 0; imu < 3; ++imu) {
+					for (int im = 0; im < 2; ++im) {
+						int statistics = stats[is];
+						double T = Ts[iT], mu = mus[imu], m = masses[im], deg = 2.;
+						int order = 8;
+
+						std::vector<IdealGasFunctions::IdealGasQuantities> terms;
+						IdealGasFunctions::IdealGasQuantities ret = IdealGasFunctions::QuantumClusterExpansionQuantities(statistics, T, mu, m, deg, order, &terms);
+						ASSERT_EQ(terms.size(), static_cast<size_t>(order));
+
+						// The i-th term is the Boltzmann term at temperature T/i
+						IdealGasFunctions::IdealGasQuantities sum;
+						double sign = 1.;
+						for (int i = 1; i <= order; ++i) {
+							const IdealGasFunctions::IdealGasQuantities &term = terms[i - 1];
+							double Ti = T / i;
+							EXPECT_NEAR(term.n, sign * IdealGasFunctions::BoltzmannDensity(Ti, mu, m, deg), accuracy * std::abs(term.n));
+							EXPECT_NEAR(term.P, sign * IdealGasFunctions::BoltzmannPressure(Ti, mu, m, deg), accuracy * std::abs(term.P));
+							EXPECT_NEAR(term.e, sign * IdealGasFunctions::BoltzmannEnergyDensity(Ti, mu, m, deg), accuracy * std::abs(term.e));
+							EXPECT_NEAR(term.ns, sign * IdealGasFunctions::BoltzmannScalarDensity(Ti, mu, m, deg), accuracy * std::abs(term.ns));
+							sum.Add(term);
+							if (statistics == 1)
+								sign = -sign;
+						}
+
+						EXPECT_NEAR(ret.n, sum.n, accuracy * std::abs(ret.n));
+						EXPECT_NEAR(ret.e, sum.e, accuracy * std::abs(ret.e));
+						EXPECT_NEAR(ret.chi4, sum.chi4, accuracy * std::abs(ret.chi4));
+
+						EXPECT_NEAR(ret.n, IdealGasFunctions::QuantumClusterExpansionDensity(statistics, T, mu, m, deg, order), accuracy * ret.n);
+						EXPECT_NEAR(ret.P, IdealGasFunctions::QuantumClusterExpansionPressure(statistics, T, mu, m, deg, order), accuracy * ret.P);
+						EXPECT_NEAR(ret.ns, IdealGasFunctions::QuantumClusterExpansionScalarDensity(statistics, T, mu, m, deg, order), accuracy * ret.ns);
+						EXPECT_NEAR(ret.chi2, IdealGasFunctions::QuantumClusterExpansionChiN(2, statistics, T, mu, m, deg, order), accuracy * ret.chi2);
+						EXPECT_NEAR(ret.chi3, IdealGasFunctions::QuantumClusterExpansionChiN(3, statistics, T, mu, m, deg, order), accuracy * std::abs(ret.chi3));
+						EXPECT_NEAR(ret.chi4, IdealGasFunctions::QuantumClusterExpansionChiN(4, statistics, T, mu, m, deg, order), accuracy * std::abs(ret.chi4));
+						EXPECT_EQ(ret.e, IdealGasFunctions::QuantumClusterExpansionEnergyDensity(statistics, T, mu, m, deg, order));
+						EXPECT_EQ(ret.s, IdealGasFunctions::QuantumClusterExpansionEntropyDensity(statistics, T, mu, m, deg, order));
+
+						// Entropy density from the temperature derivative of the pressure
+						double h = 1.e-5 * T;
+						double sFD = (IdealGasFunctions::QuantumClusterExpansionPressure(statistics, T + h, mu, m, deg, order)
+							- IdealGasFunctions::QuantumClusterExpansionPressure(statistics, T - h, mu, m, deg, order)) / (2. * h);
+						EXPECT_NEAR(ret.s, sFD, 1.e-6 * ret.s);
+					}
+				}
+			}
+		}
+
+		// Maxwell-Boltzmann statistics
+		IdealGasFunctions::IdealGasQuantities ret = IdealGasFunctions::QuantumClusterExpansionQuantities(0, 0.155, 0.100, 0.938, 2., 5);
+		EXPECT_NEAR(ret.n, IdealGasFunctions::BoltzmannDensity(0.155, 0.100, 0.938, 2.), accuracy * ret.n);
+		EXPECT_NEAR(ret.e, IdealGasFunctions::BoltzmannEnergyDensity(0.155, 0.100, 0.938, 2.), accuracy * ret.e);
+		EXPECT_NEAR(ret.s, IdealGasFunctions::BoltzmannEntropyDensity(0.155, 0.100, 0.938, 2.), accuracy * ret.s);
+	}
+
+}
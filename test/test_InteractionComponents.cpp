@@ -0,0 +1,155 @@
+/*
+ * Thermal-FIST package
+ * 
+ * Copyright (c) 2014-2018 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include <cmath>
+#include <vector>
+#include "HRGBase.h"
+#include "HRGEV.h"
+#include "HRGEV/InteractionComponents.h"
+#include "ThermalFISTConfig.h"
+#include "gtest/gtest.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	// Solves A x = r by the Gaussian elimination with partial pivoting
+	std::vector<double> DenseSolve(std::vector< std::vector<double> > A, std::vector<double> r) {
+		int n = r.size();
+		for (int k = 0; k < n; ++k) {
+			int piv = k;
+			for (int i = k + 1; i < n; ++i)
+				if (std::abs(A[i][k]) > std::abs(A[piv][k]))
+					piv = i;
+			std::swap(A[k], A[piv]);
+			std::swap(r[k], r[piv]);
+			for (int i = k + 1; i < n; ++i) {
+				double f = A[i][k] / A[k][k];
+				for (int j = k; j < n; ++j)
+					A[i][j] -= f * A[k][j];
+				r[i] -= f * r[k];
+			}
+		}
+		std::vector<double> x(n);
+		for (int i = n - 1; i >= 0; --i) {
+			x[i] = r[i];
+			for (int j = i + 1; j < n; ++j)
+				x[i] -= A[i][j] * x[j];
+			x[i] /= A[i][i];
+		}
+		return x;
+	}
+
+	TEST(InteractionComponentsTest, WoodburyMatchesDense) {
+		// 12 species in 3 components, with and without attraction
+		int NN = 12;
+		std::vector<int> comp(NN);
+		for (int i = 0; i < NN; ++i)
+			comp[i] = i % 3;
+		double bK[3][3] = { { 1.0, 0.5, 0.2 }, { 0.4, 2.0, 0.3 }, { 0.1, 0.6, 1.5 } };
+		double aK[3][3] = { { 0.3, 0.1, 0.0 }, { 0.2, 0.5, 0.1 }, { 0.0, 0.2, 0.4 } };
+
+		for (int withattr = 0; withattr <= 1; ++withattr) {
+			std::vector< std::vector<double> > b(NN, std::vector<double>(NN)), a;
+			if (withattr)
+				a.assign(NN, std::vector<double>(NN));
+			std::vector<double> nid(NN), c(NN), x(NN), y(NN);
+			for (int i = 0; i < NN; ++i) {
+				for (int j = 0; j < NN; ++j) {
+					b[i][j] = 0.1 * bK[comp[i]][comp[j]];
+					if (withattr)
+						a[i][j] = 0.1 * aK[comp[i]][comp[j]];
+				}
+				nid[i] = 0.05 + 0.01 * i;
+				c[i] = 0.3 - 0.01 * i;
+				x[i] = sin(1. + i);
+				y[i] = cos(2. * i);
+			}
+
+			InteractionComponents components(b, a);
+			EXPECT_EQ(components.ComponentsNumber(), 3);
+			InteractionResponseSolver solver(components, b, a, nid, c);
+			EXPECT_TRUE(solver.IsReduced());
+			std::vector<double> dn, dmu;
+			solver.Solve(x, y, dn, dmu);
+
+			// The full 2N x 2N system, see InteractionResponseSolver
+			std::vector< std::vector<double> > A(2 * NN, std::vector<double>(2 * NN, 0.));
+			std::vector<double> r(2 * NN);
+			for (int i = 0; i < NN; ++i) {
+				for (int j = 0; j < NN; ++j) {
+					A[i][j] = nid[i] * b[j][i] + (i == j ? 1. : 0.);
+					A[NN + i][j] = withattr ? -(a[i][j] + a[j][i]) : 0.;
+					A[NN + i][NN + j] = b[i][j] * nid[j] + (i == j ? 1. : 0.);
+				}
+				A[i][NN + i] = c[i];
+				r[i] = x[i];
+				r[NN + i] = y[i];
+			}
+			std::vector<double> sol = DenseSolve(A, r);
+
+			for (int i = 0; i < NN; ++i) {
+				EXPECT_NEAR(dn[i], sol[i], 1.e-12);
+				EXPECT_NEAR(dmu[i], sol[NN + i], 1.e-12);
+			}
+		}
+	}
+
+	TEST(InteractionComponentsTest, CrosstermsMatchDiagonal) {
+		// With equal radii the crossterms model reduces to the diagonal one,
+		// the crossterms model then uses the one-component Woodbury reduction
+		ThermalParticleSystem TPS(std::string(ThermalFIST_INPUT_FOLDER) + "/list/PDG2014/list.dat");
+		ThermalModelParameters params;
+		params.T = 0.155;
+		params.muB = 0.100;
+
+		ThermalModelEVCrossterms crs(&TPS, params);
+		ThermalModelEVDiagonal diag(&TPS, params);
+
+		// The second radius checks that the cached decomposition is updated
+		double radii[2] = { 0.3, 0.5 };
+		for (int ir = 0; ir < 2; ++ir) {
+			crs.SetRadius(radii[ir]);
+			diag.SetRadius(radii[ir]);
+			crs.SetParameters(params);
+			diag.SetParameters(params);
+			crs.CalculatePrimordialDensities();
+			diag.CalculatePrimordialDensities();
+			crs.CalculateFluctuations();
+			diag.CalculateFluctuations();
+
+			for (int i = 0; i < TPS.ComponentsNumber(); ++i) {
+				if (!(diag.Densities()[i] > 0.))
+					continue;
+				EXPECT_LT(std::abs(crs.Densities()[i] / diag.Densities()[i] - 1.), 1.e-6);
+				EXPECT_LT(std::abs(crs.ScaledVariancePrimordial(i) / diag.ScaledVariancePrimordial(i) - 1.), 1.e-4);
+			}
+
+			std::vector<double> chgs(TPS.ComponentsNumber());
+			for (int i = 0; i < TPS.ComponentsNumber(); ++i)
+				chgs[i] = TPS.Particle(i).BaryonCharge();
+			std::vector<double> chiB = crs.CalculateChargeFluctuations(chgs, 2);
+			std::vector<double> chiBdiag = diag.CalculateChargeFluctuations(chgs, 2);
+			EXPECT_LT(std::abs(chiB[1] / chiBdiag[1] - 1.), 1.e-4);
+		}
+
+		// Different radii for baryons and mesons change the components,
+		// compare with a model set up from scratch
+		std::vector<double> radii2(TPS.ComponentsNumber(), 0.3);
+		for (int i = 0; i < TPS.ComponentsNumber(); ++i)
+			if (TPS.Particle(i).BaryonCharge() != 0)
+				radii2[i] = 0.5;
+		crs.FillVirial(radii2);
+		crs.CalculatePrimordialDensities();
+		ThermalModelEVCrossterms crsnew(&TPS, params);
+		crsnew.FillVirial(radii2);
+		crsnew.CalculatePrimordialDensities();
+		for (int i = 0; i < TPS.ComponentsNumber(); ++i)
+			EXPECT_DOUBLE_EQ(crs.Densities()[i], crsnew.Densities()[i]);
+	}
+
+}
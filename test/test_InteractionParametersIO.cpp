@@ -0,0 +1,293 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2020 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "HRGBase.h"
+#include "HRGEV.h"
+#include "HRGVDW/ThermalModelVDW.h"
+#include "HRGEV/InteractionParametersIO.h"
+#include "ThermalFISTConfig.h"
+#include "gtest/gtest.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	// Contains excited nuclei with PDG codes which do not fit into 32 bits
+	const std::string ListFile = std::string(ThermalFIST_INPUT_FOLDER) + "/list/PDG2020/list-withexcitednuclei.dat";
+
+	typedef std::vector< std::vector<double> > Matrix;
+
+	Matrix ZeroMatrix(int N) {
+		return Matrix(N, std::vector<double>(N, 0.));
+	}
+
+	bool IsZero(const Matrix& mat) {
+		for (size_t i = 0; i < mat.size(); ++i)
+			for (size_t j = 0; j < mat[i].size(); ++j)
+				if (mat[i][j] != 0.)
+					return false;
+		return true;
+	}
+
+	std::vector<char> ReadFile(const std::string& filename) {
+		std::vector<char> ret;
+		FILE *f = fopen(filename.c_str(), "rb");
+		if (f == NULL)
+			return ret;
+		char buf[4096];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+			ret.insert(ret.end(), buf, buf + n);
+		fclose(f);
+		return ret;
+	}
+
+	void WriteFile(const std::string& filename, const std::vector<char>& content) {
+		FILE *f = fopen(filename.c_str(), "wb");
+		ASSERT_TRUE(f != NULL);
+		if (!content.empty())
+			fwrite(&content[0], 1, content.size(), f);
+		fclose(f);
+	}
+
+	// The layout field of the header, after the signature, the byte order mark, and the version
+	unsigned int FileLayout(const std::vector<char>& content) {
+		unsigned int ret = 0;
+		memcpy(&ret, &content[16], sizeof(ret));
+		return ret;
+	}
+
+	// Pairs of particles with PDG codes above 32 bits
+	void SetupExcitedNuclei(ThermalParticleSystem& TPS, int& ind1, int& ind2) {
+		long long pdg1 = 100002004001LL, pdg2 = 100002004002LL;
+		ind1 = TPS.PdgToId(pdg1);
+		ind2 = TPS.PdgToId(pdg2);
+		ASSERT_GE(ind1, 0);
+		ASSERT_GE(ind2, 0);
+	}
+
+	TEST(InteractionParametersIOTest, TextLongPdgCodes) {
+		ThermalParticleSystem TPS(ListFile);
+		int N = TPS.ComponentsNumber();
+		int ind1, ind2;
+		SetupExcitedNuclei(TPS, ind1, ind2);
+		int iproton = TPS.PdgToId(2212);
+		ASSERT_GE(iproton, 0);
+
+		const std::string filename = "test_InteractionParametersIO.dat";
+
+		// QvdW parameters
+		ThermalModelVDW vdw(&TPS);
+		vdw.SetVirial(ind1, ind2, 1.5);
+		vdw.SetAttraction(ind1, ind2, 0.25);
+		vdw.SetVirial(iproton, ind1, 0.75);
+		vdw.WriteInteractionParameters(filename);
+		EXPECT_FALSE(InteractionParametersIO::IsBinaryFile(filename));
+
+		ThermalModelVDW vdwread(&TPS);
+		vdwread.ReadInteractionParameters(filename);
+		for (int i = 0; i < N; ++i) {
+			for (int j = 0; j < N; ++j) {
+				EXPECT_EQ(vdwread.VirialCoefficient(i, j), vdw.VirialCoefficient(i, j));
+				EXPECT_EQ(vdwread.AttractionCoefficient(i, j), vdw.AttractionCoefficient(i, j));
+			}
+		}
+
+		// Crossterms excluded volume parameters
+		ThermalModelEVCrossterms ev(&TPS);
+		ev.SetVirial(ind2, ind1, 2.5);
+		ev.SetVirial(ind1, iproton, 0.5);
+		ev.WriteInteractionParameters(filename);
+
+		ThermalModelEVCrossterms evread(&TPS);
+		evread.ReadInteractionParameters(filename);
+		for (int i = 0; i < N; ++i)
+			for (int j = 0; j < N; ++j)
+				EXPECT_EQ(evread.VirialCoefficient(i, j), ev.VirialCoefficient(i, j));
+
+		// Diagonal excluded volume parameters
+		ThermalModelEVDiagonal diag(&TPS);
+		diag.SetVirial(ind1, ind1, 3.5);
+		diag.WriteInteractionParameters(filename);
+
+		ThermalModelEVDiagonal diagread(&TPS);
+		diagread.ReadInteractionParameters(filename);
+		EXPECT_EQ(diagread.VirialCoefficient(ind1, ind1), 3.5);
+
+		std::remove(filename.c_str());
+	}
+
+	TEST(InteractionParametersIOTest, SparseRoundTrip) {
+		ThermalParticleSystem TPS(ListFile);
+		int N = TPS.ComponentsNumber();
+		int ind1, ind2;
+		SetupExcitedNuclei(TPS, ind1, ind2);
+
+		Matrix b = ZeroMatrix(N), a = ZeroMatrix(N);
+		b[ind1][ind2] = 1.5;
+		b[ind2][ind1] = 2.5;
+		b[0][ind1] = 0.5;
+		a[ind1][ind2] = 0.25;
+		a[N - 1][N - 1] = 0.125;
+
+		const std::string filename = "test_InteractionParametersIO.bin";
+		ASSERT_TRUE(InteractionParametersIO::WriteBinary(filename, &TPS, b, &a));
+		EXPECT_TRUE(InteractionParametersIO::IsBinaryFile(filename));
+		std::vector<char> content = ReadFile(filename);
+		EXPECT_EQ(FileLayout(content), 0u);
+
+		Matrix bread, aread;
+		ASSERT_TRUE(InteractionParametersIO::ReadBinary(filename, &TPS, bread, &aread));
+		EXPECT_EQ(bread, b);
+		EXPECT_EQ(aread, a);
+
+		// Through the model
+		ThermalModelVDW vdw(&TPS);
+		vdw.ReadInteractionParameters(filename);
+		EXPECT_EQ(vdw.VirialCoefficient(ind1, ind2), 1.5);
+		EXPECT_EQ(vdw.AttractionCoefficient(ind1, ind2), 0.25);
+
+		// Excluded volume parameters only
+		ASSERT_TRUE(InteractionParametersIO::WriteBinary(filename, &TPS, b));
+		EXPECT_LT(ReadFile(filename).size(), content.size());
+		ASSERT_TRUE(InteractionParametersIO::ReadBinary(filename, &TPS, bread, &aread));
+		EXPECT_EQ(bread, b);
+		EXPECT_TRUE(IsZero(aread));
+
+		std::remove(filename.c_str());
+	}
+
+	TEST(InteractionParametersIOTest, BlockRoundTrip) {
+		ThermalParticleSystem TPS(ListFile);
+		int N = TPS.ComponentsNumber();
+
+		// QvdW interactions between the baryons and between the antibaryons, including the nuclei
+		Matrix b = ZeroMatrix(N), a = ZeroMatrix(N);
+		for (int i = 0; i < N; ++i) {
+			for (int j = 0; j < N; ++j) {
+				int Bi = TPS.Particle(i).BaryonCharge(), Bj = TPS.Particle(j).BaryonCharge();
+				if (Bi > 0 && Bj > 0) {
+					b[i][j] = 3.42;
+					a[i][j] = 0.329;
+				}
+				if (Bi < 0 && Bj < 0) {
+					b[i][j] = 3.42;
+					a[i][j] = 0.329;
+				}
+			}
+		}
+
+		const std::string filename = "test_InteractionParametersIO.bin";
+		ASSERT_TRUE(InteractionParametersIO::WriteBinary(filename, &TPS, b, &a));
+		std::vector<char> content = ReadFile(filename);
+		EXPECT_EQ(FileLayout(content), 1u);
+
+		Matrix bread, aread;
+		ASSERT_TRUE(InteractionParametersIO::ReadBinary(filename, &TPS, bread, &aread));
+		EXPECT_EQ(bread, b);
+		EXPECT_EQ(aread, a);
+
+		// The species missing from the particle list are skipped
+		ThermalParticleSystem TPSsmall(std::string(ThermalFIST_INPUT_FOLDER) + "/list/PDG2014/list.dat");
+		ASSERT_TRUE(InteractionParametersIO::ReadBinary(filename, &TPSsmall, bread, &aread));
+		int ip = TPSsmall.PdgToId(2212), ipbar = TPSsmall.PdgToId(-2212), ipi = TPSsmall.PdgToId(211);
+		ASSERT_GE(ip, 0);
+		EXPECT_EQ(bread[ip][ip], 3.42);
+		EXPECT_EQ(aread[ipbar][ipbar], 0.329);
+		EXPECT_EQ(bread[ip][ipbar], 0.);
+		EXPECT_EQ(bread[ipi][ip], 0.);
+
+		std::remove(filename.c_str());
+	}
+
+	TEST(InteractionParametersIOTest, CorruptFiles) {
+		ThermalParticleSystem TPS(ListFile);
+		int N = TPS.ComponentsNumber();
+		int ind1, ind2;
+		SetupExcitedNuclei(TPS, ind1, ind2);
+
+		const std::string filename = "test_InteractionParametersIO.bin";
+		const std::string corrupt = "test_InteractionParametersIO.corrupt.bin";
+
+		// Sparse and block files
+		Matrix bsparse = ZeroMatrix(N), bblock = ZeroMatrix(N);
+		bsparse[ind1][ind2] = 1.;
+		for (int i = 0; i < N; ++i)
+			for (int j = 0; j < N; ++j)
+				bblock[i][j] = (TPS.Particle(i).BaryonCharge() > 0 && TPS.Particle(j).BaryonCharge() > 0) ? 1. : 0.;
+		Matrix bs[] = { bsparse, bblock };
+
+		for (int layout = 0; layout < 2; ++layout) {
+			ASSERT_TRUE(InteractionParametersIO::WriteBinary(filename, &TPS, bs[layout]));
+			std::vector<char> content = ReadFile(filename);
+			ASSERT_EQ(FileLayout(content), static_cast<unsigned int>(layout));
+
+			std::vector< std::vector<char> > corrupted;
+
+			// Truncated
+			corrupted.push_back(std::vector<char>(content.begin(), content.end() - 1));
+			corrupted.push_back(std::vector<char>(content.begin(), content.begin() + content.size() / 2));
+			corrupted.push_back(std::vector<char>(content.begin(), content.begin() + 20));
+
+			// Trailing data
+			corrupted.push_back(content);
+			corrupted.back().push_back(0);
+
+			// Version and layout
+			corrupted.push_back(content);
+			corrupted.back()[12] = 99;
+			corrupted.push_back(content);
+			corrupted.back()[16] = 7;
+
+			// The other layout, the sizes then do not match
+			corrupted.push_back(content);
+			corrupted.back()[16] = 1 - layout;
+
+			// Negative number of entries
+			corrupted.push_back(content);
+			corrupted.back()[31] = -1;
+
+			// Class index out of range in the block layout
+			if (layout == 1) {
+				corrupted.push_back(content);
+				long long cl = 1000;
+				memcpy(&corrupted.back()[40 + sizeof(long long)], &cl, sizeof(cl));
+			}
+
+			for (size_t k = 0; k < corrupted.size(); ++k) {
+				WriteFile(corrupt, corrupted[k]);
+				EXPECT_TRUE(InteractionParametersIO::IsBinaryFile(corrupt));
+				Matrix bread;
+				EXPECT_FALSE(InteractionParametersIO::ReadBinary(corrupt, &TPS, bread)) << layout << " " << k;
+				ASSERT_EQ(static_cast<int>(bread.size()), N);
+				EXPECT_TRUE(IsZero(bread));
+			}
+
+			// Wrong signature, the file is then not recognized as binary
+			std::vector<char> nosignature = content;
+			nosignature[0] = 'X';
+			WriteFile(corrupt, nosignature);
+			EXPECT_FALSE(InteractionParametersIO::IsBinaryFile(corrupt));
+			Matrix bread;
+			EXPECT_FALSE(InteractionParametersIO::ReadBinary(corrupt, &TPS, bread));
+		}
+
+		// Missing file and mismatched matrices
+		std::remove(corrupt.c_str());
+		Matrix bread;
+		EXPECT_FALSE(InteractionParametersIO::IsBinaryFile(corrupt));
+		EXPECT_FALSE(InteractionParametersIO::ReadBinary(corrupt, &TPS, bread));
+		EXPECT_FALSE(InteractionParametersIO::WriteBinary(filename, &TPS, ZeroMatrix(N - 1)));
+
+		std::remove(filename.c_str());
+	}
+
+}
@@ -0,0 +1,176 @@
+/*
+ * Thermal-FIST package
+ * 
+ * Copyright (c) 2014-2018 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include "HRGEventGenerator/RandomGenerators.h"
+#include "HRGEventGenerator/FreezeoutModels.h"
+#include "HRGEventGenerator/SimpleParticle.h"
+#include "gtest/gtest.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	double TestAcceptance(double y, double pt) {
+		return exp(-(y - 0.3) * (y - 0.3)) * pt / (1. + pt);
+	}
+
+	// Monte Carlo estimate of the accepted fraction, for cross-checking the quadrature
+	double SampledAcceptedFraction(const RandomGenerators::ParticleMomentumGenerator& gen, double mass, int samples) {
+		double ret = 0.;
+		for (int i = 0; i < samples; ++i) {
+			std::vector<double> p = gen.GetMomentum(mass);
+			SimpleParticle part(p[0], p[1], p[2], mass);
+			ret += TestAcceptance(part.GetY(), part.GetPt());
+		}
+		return ret / samples;
+	}
+
+	TEST(MomentumGeneratorsTest, AcceptedFraction) {
+		RandomGenerators::SetSeed(1);
+		int samples = 400000;
+		double accuracy = 0.01;
+
+		for (int stat = -1; stat <= 1; ++stat) {
+			double mass = (stat == -1) ? 0.138 : 0.938;
+
+			RandomGenerators::SiemensRasmussenMomentumGeneratorGeneralized sr(0.120, 0.5, mass, stat, 0.);
+			double quad = sr.AcceptedFraction(TestAcceptance, mass);
+			EXPECT_GT(quad, 0.);
+			EXPECT_LT(std::abs(quad / SampledAcceptedFraction(sr, mass, samples) - 1.), accuracy);
+
+			RandomGenerators::BoostInvariantMomentumGenerator bi(new CylindricalBlastWaveParametrization(0.6, 1.), 0.120, 2.0, mass, stat, 0.);
+			quad = bi.AcceptedFraction(TestAcceptance, mass);
+			EXPECT_GT(quad, 0.);
+			EXPECT_LT(std::abs(quad / SampledAcceptedFraction(bi, mass, samples) - 1.), accuracy);
+		}
+	}
+
+	// Kolmogorov-Smirnov statistic of the samples with respect to the CDF
+	double KSStatistic(std::vector<double> samples, const std::function<double(double)>& cdf) {
+		std::sort(samples.begin(), samples.end());
+		double n = static_cast<double>(samples.size());
+		double ret = 0.;
+		for (size_t i = 0; i < samples.size(); ++i) {
+			double F = cdf(samples[i]);
+			ret = std::max(ret, std::max(std::abs(F - i / n), std::abs((i + 1) / n - F)));
+		}
+		return ret;
+	}
+
+	// CDF of the massless Boltzmann momentum distribution p^2 exp(-p/T)
+	double MasslessBoltzmannCDF(double p, double T) {
+		double x = p / T;
+		return 1. - exp(-x) * (1. + x + x * x / 2.);
+	}
+
+	TEST(InverseCDFTableTest, KolmogorovSmirnov) {
+		RandomGenerators::SetSeed(1);
+		const int samples = 100000;
+		// Critical value at a significance level of about 0.001
+		const double Dcrit = 1.95 / std::sqrt(static_cast<double>(samples));
+
+		double T = 0.150, pmax = 40. * T;
+		RandomGenerators::InverseCDFTable table([T](double p) { return p * p * exp(-p / T); }, 0., pmax);
+		ASSERT_TRUE(table.IsValid());
+		EXPECT_LT(table.Accuracy(), 1.e-6);
+		EXPECT_NEAR(table.Normalization(), 2. * T * T * T * MasslessBoltzmannCDF(pmax, T), 1.e-6 * table.Normalization());
+
+		std::vector<double> ps(samples);
+		for (int i = 0; i < samples; ++i)
+			ps[i] = table.GetRandom();
+		EXPECT_LT(KSStatistic(ps, [T, pmax](double p) { return MasslessBoltzmannCDF(p, T) / MasslessBoltzmannCDF(pmax, T); }), Dcrit);
+
+		// Samples of the momentum generator, which uses a cached table in the variable x = exp(-p)
+		RandomGenerators::ThermalMomentumGenerator gen(0., 0, T, 0.);
+		for (int i = 0; i < samples; ++i)
+			ps[i] = gen.GetP();
+		EXPECT_LT(KSStatistic(ps, [T](double p) { return MasslessBoltzmannCDF(p, T); }), Dcrit);
+
+		// A shifted distribution is rejected
+		EXPECT_GT(KSStatistic(ps, [T](double p) { return MasslessBoltzmannCDF(p, 1.02 * T); }), Dcrit);
+	}
+
+	TEST(InverseCDFTableTest, Cache) {
+		RandomGenerators::ClearInverseCDFTableCache();
+
+		int evaluations = 0;
+		std::function<std::shared_ptr<const RandomGenerators::InverseCDFTable>(double, double)> get =
+			[&evaluations](double mass, double T) {
+				std::vector<double> key(2);
+				key[0] = mass;
+				key[1] = T;
+				return RandomGenerators::GetCachedInverseCDFTable("TestMomentum", key,
+					[&evaluations, mass, T](double x) {
+						evaluations++;
+						double p = -log(x);
+						return p * p * exp(-sqrt(p * p + mass * mass) / T) / x;
+					}, 0., 1.);
+			};
+
+		std::shared_ptr<const RandomGenerators::InverseCDFTable> table = get(0.938, 0.150);
+		ASSERT_TRUE(table->IsValid());
+		EXPECT_GT(evaluations, 0);
+
+		// Identical parameters, the table is not rebuilt
+		int built = evaluations;
+		EXPECT_EQ(get(0.938, 0.150).get(), table.get());
+		EXPECT_EQ(evaluations, built);
+
+		// Changed temperature or mass
+		std::shared_ptr<const RandomGenerators::InverseCDFTable> tableT = get(0.938, 0.151);
+		std::shared_ptr<const RandomGenerators::InverseCDFTable> tablem = get(0.939, 0.150);
+		EXPECT_NE(tableT.get(), table.get());
+		EXPECT_NE(tablem.get(), table.get());
+		EXPECT_NE(tableT.get(), tablem.get());
+		EXPECT_GT(evaluations, built);
+
+		// A different tag with the same parameters
+		std::vector<double> key(2);
+		key[0] = 0.938;
+		key[1] = 0.150;
+		EXPECT_NE(RandomGenerators::GetCachedInverseCDFTable("TestOther", key, [](double x) { return x; }, 0., 1.).get(), table.get());
+
+		// Tables in use remain valid after the cache is cleared, new ones are built afterwards
+		RandomGenerators::ClearInverseCDFTableCache();
+		EXPECT_TRUE(table->IsValid());
+		EXPECT_NE(get(0.938, 0.150).get(), table.get());
+	}
+
+	TEST(InverseCDFTable2DTest, KolmogorovSmirnov) {
+		RandomGenerators::SetSeed(1);
+		const int samples = 100000;
+		const double Dcrit = 1.95 / std::sqrt(static_cast<double>(samples));
+
+		// (1 + 2x)(1 + 3y) on [0,1]x[0,2] is bilinear, thus reproduced exactly by the table
+		std::vector< std::vector<double> > f(5, std::vector<double>(9));
+		for (int ix = 0; ix <= 4; ++ix)
+			for (int iy = 0; iy <= 8; ++iy)
+				f[ix][iy] = (1. + 2. * ix / 4.) * (1. + 3. * 2. * iy / 8.);
+		RandomGenerators::InverseCDFTable2D table(f, 0., 1., 0., 2.);
+		ASSERT_TRUE(table.IsValid());
+		EXPECT_NEAR(table.Normalization(), 16., 1.e-12);
+
+		std::vector<double> xs(samples), ys(samples);
+		for (int i = 0; i < samples; ++i)
+			table.GetRandom(xs[i], ys[i]);
+		EXPECT_LT(KSStatistic(xs, [](double x) { return (x + x * x) / 2.; }), Dcrit);
+		EXPECT_LT(KSStatistic(ys, [](double y) { return (y + 1.5 * y * y) / 8.; }), Dcrit);
+
+		// The variables are independent
+		double mx = 0., my = 0., mxy = 0.;
+		for (int i = 0; i < samples; ++i) {
+			mx += xs[i] / samples;
+			my += ys[i] / samples;
+			mxy += xs[i] * ys[i] / samples;
+		}
+		EXPECT_NEAR(mxy - mx * my, 0., 5. * 0.29 * 0.57 / std::sqrt(static_cast<double>(samples)));
+	}
+
+}
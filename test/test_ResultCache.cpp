@@ -0,0 +1,106 @@
+/*
+ * Thermal-FIST package
+ * 
+ * Copyright (c) 2014-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "HRGBase/ThermalModelResultCache.h"
+#include "gtest/gtest.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	std::vector<double> Key(int i) {
+		return std::vector<double>(1, static_cast<double>(i));
+	}
+
+	ThermalModelCachedResult Result(int i) {
+		ThermalModelCachedResult ret;
+		ret.MaxDiff = 1.e-10 * i;
+		ret.Densities = std::vector<double>(5, 0.1 * i);
+		ret.TotalDensities = std::vector<double>(5, 0.2 * i);
+		return ret;
+	}
+
+	long FileSize(const std::string& filename) {
+		FILE *f = fopen(filename.c_str(), "rb");
+		fseek(f, 0, SEEK_END);
+		long ret = ftell(f);
+		fclose(f);
+		return ret;
+	}
+
+	// Appends the bytes [from, to) of the file source to the file dest
+	void AppendCopy(const std::string& source, const std::string& dest, long from, long to) {
+		FILE *f = fopen(source.c_str(), "rb");
+		std::vector<char> buf(to - from);
+		fseek(f, from, SEEK_SET);
+		ASSERT_EQ(fread(&buf[0], 1, buf.size(), f), buf.size());
+		fclose(f);
+		f = fopen(dest.c_str(), "ab");
+		fwrite(&buf[0], 1, buf.size(), f);
+		fclose(f);
+	}
+
+	TEST(ResultCacheTest, DiskStoreRecovery) {
+		std::string filename = "test_ResultCache.bin";
+		remove(filename.c_str());
+
+		ThermalModelResultCache writer;
+		ASSERT_TRUE(writer.SetDiskStore(filename));
+
+		std::vector<long> offsets;
+		for (int i = 1; i <= 3; ++i) {
+			offsets.push_back(FileSize(filename));
+			writer.Insert(Key(i), Result(i));
+		}
+		offsets.push_back(FileSize(filename));
+
+		// Corrupt a value of the second record
+		FILE *f = fopen(filename.c_str(), "r+b");
+		fseek(f, offsets[2] - 16, SEEK_SET);
+		fputc(0x7f, f);
+		fclose(f);
+
+		// A truncated record, as left by an interrupted write, followed by a complete one
+		AppendCopy(filename, filename, offsets[0], (offsets[0] + offsets[1]) / 2);
+		writer.Insert(Key(4), Result(4));
+
+		ThermalModelResultCache reader;
+		ASSERT_TRUE(reader.SetDiskStore(filename));
+		ThermalModelCachedResult result;
+		for (int i = 1; i <= 4; ++i) {
+			bool found = reader.Lookup(Key(i), result);
+			EXPECT_EQ(found, i != 2);
+			if (found) {
+				EXPECT_EQ(result.MaxDiff, Result(i).MaxDiff);
+				EXPECT_EQ(result.Densities, Result(i).Densities);
+				EXPECT_EQ(result.TotalDensities, Result(i).TotalDensities);
+			}
+		}
+
+		// A record still being written is picked up once it is complete
+		std::string othername = "test_ResultCache_other.bin";
+		remove(othername.c_str());
+		ThermalModelResultCache other;
+		ASSERT_TRUE(other.SetDiskStore(othername));
+		other.Insert(Key(5), Result(5));
+		long size = FileSize(othername);
+		AppendCopy(othername, filename, 8, 13);
+		EXPECT_FALSE(reader.Lookup(Key(5), result));
+		AppendCopy(othername, filename, 13, size / 2);
+		EXPECT_FALSE(reader.Lookup(Key(5), result));
+		AppendCopy(othername, filename, size / 2, size);
+		EXPECT_TRUE(reader.Lookup(Key(5), result));
+		EXPECT_EQ(result.Densities, Result(5).Densities);
+		remove(othername.c_str());
+
+		remove(filename.c_str());
+	}
+
+}
@@ -0,0 +1,235 @@
+/*
+ * Thermal-FIST package
+ * 
+ * Copyright (c) 2014-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "HRGBase.h"
+#include "ThermalFISTConfig.h"
+#include "gtest/gtest.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	const std::string ListFile = std::string(ThermalFIST_INPUT_FOLDER) + "/list/PDG2014/list.dat";
+
+	// Exposes the ratios of the partition functions
+	class CanonicalAccess : public ThermalModelCanonical {
+	public:
+		CanonicalAccess(ThermalParticleSystem *TPS) : ThermalModelCanonical(TPS) { }
+		const std::vector<double>& PartitionFunctionRatios() const { return m_Corr; }
+
+		// Spoil the cached values, the results show whether the cache is used
+		void SpoilChargeSectorSums() {
+			// Same as doubling the volume
+			for (size_t i = 0; i < m_Nsx1.size(); ++i) {
+				m_Nsx1[i] *= 2.;
+				m_Nsy1[i] *= 2.;
+			}
+		}
+		void SpoilPrecomputedPartitionFunctions() {
+			for (size_t i = 0; i < m_PrecomputedPartialZ.size(); ++i)
+				m_PrecomputedPartialZ[i].assign(m_PrecomputedPartialZ[i].size(), 1.);
+		}
+	};
+
+	void Calculate(CanonicalAccess& model, ThermalModelCanonical::PartitionFunctionMethod method, bool conserveQS) {
+		model.SetTemperature(0.155);
+		model.SetVolume(20.);
+		model.SetCanonicalVolume(20.);
+		model.SetBaryonCharge(2);
+		model.SetElectricCharge(1);
+		model.SetStrangeness(0);
+		model.ConserveElectricCharge(conserveQS);
+		model.ConserveStrangeness(conserveQS);
+		model.SetPartitionFunctionMethod(method);
+		model.CalculatePrimordialDensities();
+	}
+
+	void CompareMethods(bool conserveQS, bool quantum) {
+		ThermalParticleSystem TPS(ListFile);
+
+		CanonicalAccess quad(&TPS), rec(&TPS);
+		quad.SetStatistics(quantum);
+		rec.SetStatistics(quantum);
+		Calculate(quad, ThermalModelCanonical::Quadrature, conserveQS);
+		Calculate(rec, ThermalModelCanonical::Recursion, conserveQS);
+		ASSERT_EQ(quad.PartitionFunctionMethodUsed(), ThermalModelCanonical::Quadrature);
+		ASSERT_EQ(rec.PartitionFunctionMethodUsed(), ThermalModelCanonical::Recursion);
+
+		const std::vector<double>& Zquad = quad.PartitionFunctionRatios();
+		const std::vector<double>& Zrec = rec.PartitionFunctionRatios();
+		ASSERT_EQ(Zquad.size(), Zrec.size());
+		// The quadratures are accurate relative to the largest ratios
+		double Zmax = 0.;
+		for (size_t i = 0; i < Zquad.size(); ++i)
+			Zmax = std::max(Zmax, std::abs(Zquad[i]));
+		for (size_t i = 0; i < Zquad.size(); ++i)
+			EXPECT_NEAR(Zrec[i], Zquad[i], 1.e-6 * std::abs(Zquad[i]) + 1.e-7 * Zmax);
+
+		for (int i = 0; i < TPS.ComponentsNumber(); ++i)
+			EXPECT_NEAR(rec.Densities()[i], quad.Densities()[i], 1.e-7 * quad.Densities()[i]);
+
+		double squad = quad.CalculateEntropyDensity();
+		EXPECT_NEAR(rec.CalculateEntropyDensity(), squad, 1.e-8 * squad);
+	}
+
+	// All charges conserved, the baryon number integral is done analytically
+	TEST(ThermalModelCanonicalTest, RecursionMatchesQuadratureBQS) {
+		CompareMethods(true, false);
+	}
+
+	// Only the baryon number conserved, |B| <= 1 for all hadrons, the baryon number integral is done numerically
+	TEST(ThermalModelCanonicalTest, RecursionMatchesQuadratureB) {
+		CompareMethods(false, false);
+		CompareMethods(false, true);
+	}
+
+	void SetState(ThermalModelCanonical& model, double Vc, bool conserveQ) {
+		model.SetStatistics(false);
+		model.SetTemperature(0.155);
+		model.SetVolume(Vc);
+		model.SetCanonicalVolume(Vc);
+		model.SetBaryonCharge(2);
+		model.SetElectricCharge(1);
+		model.SetStrangeness(0);
+		model.ConserveElectricCharge(conserveQ);
+	}
+
+	void ExpectSameResults(ThermalModelCanonical& model, ThermalModelCanonical& fresh) {
+		EXPECT_EQ(model.PartitionFunctionMethodUsed(), fresh.PartitionFunctionMethodUsed());
+		for (size_t i = 0; i < model.Densities().size(); ++i)
+			EXPECT_NEAR(model.Densities()[i], fresh.Densities()[i], 1.e-12 * fresh.Densities()[i]);
+		double s = fresh.CalculateEntropyDensity();
+		EXPECT_NEAR(model.CalculateEntropyDensity(), s, 1.e-12 * s);
+	}
+
+	// Calls which differ only by the volume reuse the charge sector sums
+	TEST(ThermalModelCanonicalTest, CacheHitForVolumeChange) {
+		ThermalParticleSystem TPS(ListFile);
+		int id = TPS.PdgToId(2212);
+		ASSERT_GE(id, 0);
+
+		CanonicalAccess model(&TPS);
+		SetState(model, 20., true);
+		model.CalculatePrimordialDensities();
+		ASSERT_GT(model.Densities()[id], 0.);
+
+		model.SpoilChargeSectorSums();
+		model.SetCanonicalVolume(30.);
+		model.CalculatePrimordialDensities();
+		ThermalModelCanonical doubled(&TPS);
+		SetState(doubled, 60., true);
+		doubled.CalculatePrimordialDensities();
+		EXPECT_NEAR(model.Densities()[id], doubled.Densities()[id], 1.e-12 * doubled.Densities()[id]);
+
+		model.ClearPartitionFunctionsCache();
+		model.CalculatePrimordialDensities();
+		ThermalModelCanonical fresh(&TPS);
+		SetState(fresh, 30., true);
+		fresh.CalculatePrimordialDensities();
+		ExpectSameResults(model, fresh);
+	}
+
+	// Any change of the state invalidates the charge sector sums
+	TEST(ThermalModelCanonicalTest, CacheMissAfterChanges) {
+		for (int change = 0; change < 4; ++change) {
+			SCOPED_TRACE(change);
+			ThermalParticleSystem TPS(ListFile);
+			bool conserveQ = (change < 2);
+
+			CanonicalAccess model(&TPS);
+			SetState(model, 20., conserveQ);
+			model.CalculatePrimordialDensities();
+			model.SpoilChargeSectorSums();
+
+			ThermalModelCanonical fresh(&TPS);
+			SetState(fresh, 20., conserveQ);
+
+			if (change == 0) {
+				model.SetTemperature(0.140);
+				fresh.SetTemperature(0.140);
+			}
+			else if (change == 1) {
+				model.SetGammaS(0.8);
+				fresh.SetGammaS(0.8);
+			}
+			else if (change == 2) {
+				model.SetElectricChemicalPotential(-0.020);
+				fresh.SetElectricChemicalPotential(-0.020);
+			}
+			else {
+				model.SetStatistics(true);
+				fresh.SetStatistics(true);
+			}
+
+			model.CalculatePrimordialDensities();
+			fresh.CalculatePrimordialDensities();
+			ExpectSameResults(model, fresh);
+		}
+	}
+
+	// The precomputed partition functions are specific to the number of the integration points
+	TEST(ThermalModelCanonicalTest, PrecomputedAfterIntegrationIterationsChange) {
+		ThermalParticleSystem TPS(ListFile);
+		int id = TPS.PdgToId(2212);
+		ASSERT_GE(id, 0);
+
+		CanonicalAccess model(&TPS);
+		SetState(model, 20., true);
+		model.SetPartitionFunctionMethod(ThermalModelCanonical::Quadrature);
+		model.PrecomputePartitionFunctions(std::vector<double>(1, 20.));
+		model.SpoilPrecomputedPartitionFunctions();
+
+		ThermalModelCanonical fresh(&TPS);
+		SetState(fresh, 20., true);
+		fresh.SetPartitionFunctionMethod(ThermalModelCanonical::Quadrature);
+		fresh.CalculatePrimordialDensities();
+
+		model.CalculatePrimordialDensities();
+		EXPECT_NE(model.Densities()[id], fresh.Densities()[id]);
+
+		model.SetIntegrationIterationsMultiplier(2);
+		fresh.SetIntegrationIterationsMultiplier(2);
+		model.CalculatePrimordialDensities();
+		fresh.CalculatePrimordialDensities();
+		ExpectSameResults(model, fresh);
+	}
+
+	TEST(ThermalModelCanonicalTest, PrecomputedVolumesMatchDirectCalls) {
+		ThermalParticleSystem TPS(ListFile);
+
+		std::vector<double> Vcs;
+		Vcs.push_back(5.);
+		Vcs.push_back(20.);
+		Vcs.push_back(100.);
+
+		ThermalModelCanonical::PartitionFunctionMethod methods[3] = {
+			ThermalModelCanonical::Quadrature, ThermalModelCanonical::Recursion, ThermalModelCanonical::Auto };
+		for (int im = 0; im < 3; ++im) {
+			ThermalModelCanonical model(&TPS);
+			SetState(model, Vcs[0], true);
+			model.SetPartitionFunctionMethod(methods[im]);
+			model.PrecomputePartitionFunctions(Vcs);
+
+			for (size_t iV = 0; iV < Vcs.size(); ++iV) {
+				ThermalModelCanonical fresh(&TPS);
+				SetState(fresh, Vcs[iV], true);
+				fresh.SetPartitionFunctionMethod(methods[im]);
+				fresh.CalculatePrimordialDensities();
+
+				model.SetVolume(Vcs[iV]);
+				model.SetCanonicalVolume(Vcs[iV]);
+				model.CalculatePrimordialDensities();
+				ExpectSameResults(model, fresh);
+			}
+		}
+	}
+
+}
@@ -0,0 +1,215 @@
+/*
+ * Thermal-FIST package
+ *
+ * Copyright (c) 2014-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "HRGBase.h"
+#include "HRGFit.h"
+#include "HRGFit/ThermalModelFitMCMC.h"
+#include "ThermalFISTConfig.h"
+#include "gtest/gtest.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	const std::string ListFile = std::string(ThermalFIST_INPUT_FOLDER) + "/list/PDG2014/list.dat";
+
+	// Boltzmann gas without the chemical potentials of the electric charge and strangeness
+	void SetupModel(ThermalModelIdeal& model, double T, double muB, double R) {
+		model.SetStatistics(false);
+		model.ConstrainMuQ(false);
+		model.ConstrainMuS(false);
+		model.SetTemperature(T);
+		model.SetBaryonChemicalPotential(muB);
+		model.SetElectricChemicalPotential(0.);
+		model.SetStrangenessChemicalPotential(0.);
+		model.SetVolumeRadius(R);
+		model.CalculateDensities();
+	}
+
+	// Primordial yields of protons and antiprotons with relative errors,
+	// the chi2 in R and muB at fixed T is Gaussian up to the corrections of the order of the relative errors
+	void SetupProtonFit(ThermalModelFit& fit, ThermalModelIdeal& model, double relerr) {
+		long long pdgs[] = { 2212, -2212 };
+		std::vector<FittedQuantity> quantities;
+		for (int i = 0; i < 2; ++i) {
+			double yield = model.GetDensity(pdgs[i], Feeddown::Primordial) * model.Volume();
+			quantities.push_back(FittedQuantity(ExperimentMultiplicity(pdgs[i], yield, relerr * yield, Feeddown::Primordial)));
+		}
+		fit.SetQuantities(quantities);
+		fit.SetParameterFitFlag("T", false);
+	}
+
+	double Mean(const std::vector<double>& x) {
+		double ret = 0.;
+		for (size_t i = 0; i < x.size(); ++i)
+			ret += x[i];
+		return ret / x.size();
+	}
+
+	double StandardDeviation(const std::vector<double>& x) {
+		double mean = Mean(x), ret = 0.;
+		for (size_t i = 0; i < x.size(); ++i)
+			ret += (x[i] - mean) * (x[i] - mean);
+		return std::sqrt(ret / x.size());
+	}
+
+	TEST(ThermalModelFitMCMCTest, GaussianPosterior) {
+		ThermalParticleSystem TPS(ListFile);
+		ThermalModelIdeal model(&TPS);
+		double T = 0.155, muB = 0.050, R = 8.;
+		SetupModel(model, T, muB, R);
+
+		const double relerr = 0.01;
+		ThermalModelFit fit(&model);
+		SetupProtonFit(fit, model, relerr);
+		// Start away from the maximum of the posterior
+		fit.SetParameter("muB", muB + 0.005, 0.005, 0., 0.2);
+		fit.SetParameter("R", R * 1.01, 0.1, 1., 20.);
+
+		ThermalModelFitMCMC mcmc(&fit, 16);
+		mcmc.Initialize(1.);
+		ASSERT_EQ(mcmc.Dimension(), 2);
+		std::vector<std::string> names = mcmc.ParameterNames();
+		ASSERT_EQ(names[0], "muB");
+		ASSERT_EQ(names[1], "R");
+
+		const int burnin = 300, steps = 3000;
+		mcmc.Run(steps);
+		EXPECT_EQ(mcmc.Steps(), steps + 1);
+		EXPECT_GT(mcmc.AcceptanceFraction(), 0.2);
+		EXPECT_LT(mcmc.AcceptanceFraction(), 0.9);
+
+		// ln N(p) = ln N(pbar) + 2 muB / T and ln N(p) + ln N(pbar) = 6 ln R + const
+		double sigmas[] = { T * relerr / std::sqrt(2.), R * relerr / 3. / std::sqrt(2.) };
+		double means[] = { muB, R };
+		std::vector<double> taus = mcmc.AutocorrelationTimes(burnin);
+		for (int d = 0; d < 2; ++d) {
+			std::vector<double> samples = mcmc.Samples(d, burnin);
+			double neff = samples.size() / taus[d];
+			EXPECT_GT(neff, 200.);
+			EXPECT_NEAR(Mean(samples), means[d], 4. * sigmas[d] / std::sqrt(neff));
+			EXPECT_NEAR(StandardDeviation(samples), sigmas[d], 0.1 * sigmas[d]);
+		}
+
+		ThermalModelFitParameters posterior = mcmc.PosteriorParameters(burnin);
+		EXPECT_NEAR(posterior.muB.error, sigmas[0], 0.1 * sigmas[0]);
+		EXPECT_NEAR(posterior.R.error, sigmas[1], 0.1 * sigmas[1]);
+		EXPECT_LT(posterior.chi2, 0.01);
+	}
+
+	TEST(ThermalModelFitMCMCTest, PosteriorVsMinuit) {
+		ThermalParticleSystem TPS(ListFile);
+		ThermalModelIdeal model(&TPS);
+		model.SetTemperature(0.155);
+		model.SetBaryonChemicalPotential(0.100);
+		model.SetVolumeRadius(8.);
+		model.FillChemicalPotentials();
+		model.ConstrainChemicalPotentials();
+		model.CalculateDensities();
+
+		ThermalModelFit fit(&model);
+		long long pdgs[] = { 211, -211, 321, -321, 2212, -2212 };
+		std::vector<FittedQuantity> quantities;
+		for (int i = 0; i < 6; ++i) {
+			double yield = model.GetDensity(pdgs[i], Feeddown::StabilityFlag) * model.Volume();
+			quantities.push_back(FittedQuantity(ExperimentMultiplicity(pdgs[i], yield, 0.05 * yield)));
+		}
+		fit.SetQuantities(quantities);
+		fit.SetParameter("T", 0.150, 0.005, 0.100, 0.200);
+		fit.SetParameter("muB", 0.090, 0.010, 0., 0.300);
+		fit.SetParameter("R", 8.5, 0.5, 1., 20.);
+
+		ThermalModelFitParameters result = fit.PerformFit(false);
+		ASSERT_TRUE(result.T.error > 0. && result.muB.error > 0. && result.R.error > 0.);
+
+		// Start the walkers around the MINUIT minimum
+		fit.SetParameters(result);
+		ThermalModelFitMCMC mcmc(&fit, 16);
+		mcmc.Initialize(1.);
+		mcmc.Run(600);
+		ThermalModelFitParameters posterior = mcmc.PosteriorParameters(100);
+
+		std::string names[] = { "T", "muB", "R" };
+		for (int i = 0; i < 3; ++i) {
+			const FitParameter& par = result.GetParameter(names[i]);
+			const FitParameter& parmc = posterior.GetParameter(names[i]);
+			std::vector<double> samples = mcmc.Samples(i, 100);
+			EXPECT_NEAR(Mean(samples), par.value, par.error) << names[i];
+			EXPECT_NEAR(parmc.error, par.error, 0.3 * par.error) << names[i];
+		}
+	}
+
+	TEST(ThermalModelFitMCMCTest, ResumeChainFile) {
+		ThermalParticleSystem TPS(ListFile);
+		ThermalModelIdeal model(&TPS);
+		SetupModel(model, 0.155, 0.050, 8.);
+
+		ThermalModelFit fit(&model);
+		SetupProtonFit(fit, model, 0.01);
+
+		const std::string filename = "test_ThermalModelFitMCMC_chain.dat";
+		std::remove(filename.c_str());
+
+		ThermalModelFitMCMC mcmc(&fit, 8, 1);
+		ASSERT_TRUE(mcmc.SetOutputFile(filename));
+		mcmc.Run(20);
+
+		// The file contains the chain in memory
+		std::vector<int> indices;
+		int walkers = 0;
+		std::vector<double> chain, chi2;
+		ASSERT_TRUE(ThermalModelFitMCMC::ReadChainFile(filename, indices, walkers, chain, chi2));
+		EXPECT_EQ(walkers, mcmc.Walkers());
+		ASSERT_EQ(static_cast<int>(indices.size()), mcmc.Dimension());
+		ASSERT_EQ(static_cast<int>(chi2.size()), mcmc.Steps() * mcmc.Walkers());
+		for (int step = 0; step < mcmc.Steps(); ++step) {
+			for (int w = 0; w < walkers; ++w) {
+				EXPECT_EQ(chi2[step * walkers + w], mcmc.Chi2(step, w));
+				for (int d = 0; d < mcmc.Dimension(); ++d)
+					EXPECT_EQ(chain[(step * walkers + w) * mcmc.Dimension() + d], mcmc.Value(step, w, d));
+			}
+		}
+
+		// An incomplete last step, e.g. from an interrupted run
+		FILE *f = fopen(filename.c_str(), "ab");
+		ASSERT_TRUE(f != NULL);
+		double partial[3] = { 1., 2., 3. };
+		fwrite(partial, sizeof(double), 3, f);
+		fclose(f);
+
+		// The resumed chain continues from the file without evaluating the chi2 of the walkers
+		ThermalModelFitMCMC resumed(&fit, 8, 2);
+		ASSERT_TRUE(resumed.SetOutputFile(filename, true));
+		EXPECT_EQ(fit.Iters(), 0);
+		ASSERT_EQ(resumed.Steps(), mcmc.Steps());
+		for (int w = 0; w < walkers; ++w) {
+			EXPECT_EQ(resumed.Chi2(resumed.Steps() - 1, w), mcmc.Chi2(mcmc.Steps() - 1, w));
+			for (int d = 0; d < mcmc.Dimension(); ++d)
+				EXPECT_EQ(resumed.Value(resumed.Steps() - 1, w, d), mcmc.Value(mcmc.Steps() - 1, w, d));
+		}
+
+		// The new steps are appended after the incomplete one is dropped
+		resumed.Run(5);
+		ASSERT_TRUE(ThermalModelFitMCMC::ReadChainFile(filename, indices, walkers, chain, chi2));
+		ASSERT_EQ(static_cast<int>(chi2.size()), resumed.Steps() * walkers);
+		EXPECT_EQ(resumed.Steps(), mcmc.Steps() + 5);
+		for (int w = 0; w < walkers; ++w)
+			EXPECT_EQ(chi2[(resumed.Steps() - 1) * walkers + w], resumed.Chi2(resumed.Steps() - 1, w));
+
+		// A chain of a different ensemble is not resumed
+		ThermalModelFitMCMC other(&fit, 12, 3);
+		ASSERT_TRUE(other.SetOutputFile(filename, true));
+		EXPECT_EQ(other.Steps(), 1);
+
+		std::remove(filename.c_str());
+	}
+
+}
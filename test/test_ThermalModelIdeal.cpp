@@ -0,0 +1,261 @@
+/*
+ * Thermal-FIST package
+ * 
+ * Copyright (c) 2014-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include <cmath>
+#include <string>
+#include <vector>
+#include "HRGBase.h"
+#include "ThermalFISTConfig.h"
+#include "gtest/gtest.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	const std::string ListFile = std::string(ThermalFIST_INPUT_FOLDER) + "/list/PDG2014/list.dat";
+
+	void Calculate(ThermalModelBase& model, double T, double muB) {
+		model.SetTemperature(T);
+		model.SetBaryonChemicalPotential(muB);
+		model.FillChemicalPotentials();
+		model.CalculatePrimordialDensities();
+	}
+
+	// The densities rescaled from the previous chemical potentials have to
+	// reflect the changes of the branching ratio weights of the mass distribution
+	TEST(ThermalModelIdealTest, RescalingAfterDecayThresholdChange) {
+		ThermalParticleSystem TPS(ListFile);
+		TPS.SetResonanceWidthIntegrationType(ThermalParticle::FullIntervalWeighted);
+
+		ThermalModelIdeal model(&TPS);
+		model.SetUseWidth(true);
+		model.SetStatistics(false);
+		Calculate(model, 0.150, 0.100);
+
+		int id = TPS.PdgToId(2224);
+		ASSERT_GE(id, 0);
+		ThermalParticle &part = TPS.Particle(id);
+		for (size_t k = 0; k < part.Decays().size(); ++k)
+			part.Decays()[k].mM0 += 0.05;
+		part.FillCoefficients();
+		Calculate(model, 0.150, 0.200);
+
+		ThermalModelIdeal fresh(&TPS);
+		fresh.SetUseWidth(true);
+		fresh.SetStatistics(false);
+		Calculate(fresh, 0.150, 0.200);
+
+		EXPECT_DOUBLE_EQ(model.Densities()[id], fresh.Densities()[id]);
+	}
+
+	std::vector<ThermalModelParameters> BatchPoints() {
+		std::vector<ThermalModelParameters> ret;
+		for (int k = 0; k < 4; ++k) {
+			ThermalModelParameters params(0.120 + 0.015 * k, 0.050 + 0.100 * k, -0.010 * k, 0.020 * k);
+			params.gammaS = 1. - 0.1 * k;
+			ret.push_back(params);
+		}
+		return ret;
+	}
+
+	void ExpectRelativeNear(const std::vector<double>& a, const std::vector<double>& b, double tolerance) {
+		ASSERT_EQ(a.size(), b.size());
+		for (size_t i = 0; i < a.size(); ++i)
+			EXPECT_NEAR(a[i], b[i], tolerance * std::abs(b[i]));
+	}
+
+	// The batch evaluation has to agree with the evaluation point by point
+	// and leave the state of the model unchanged
+	TEST(ThermalModelIdealTest, DensitiesBatch) {
+		ThermalParticleSystem TPS(ListFile);
+		std::vector<ThermalModelParameters> points = BatchPoints();
+
+		for (int stats = 0; stats < 2; ++stats) {
+			ThermalModelIdeal model(&TPS);
+			model.SetUseWidth(true);
+			model.SetStatistics(stats == 1);
+			Calculate(model, 0.155, 0.);
+			std::vector<double> chem = model.ChemicalPotentials();
+
+			std::vector< std::vector<double> > primordial, totals;
+			model.CalculateDensitiesBatch(points, primordial, totals);
+			ASSERT_EQ(primordial.size(), points.size());
+			ASSERT_EQ(totals.size(), points.size());
+			EXPECT_EQ(model.Parameters().T, 0.155);
+			EXPECT_EQ(model.ChemicalPotentials(), chem);
+
+			ThermalModelIdeal reference(&TPS);
+			reference.SetUseWidth(true);
+			reference.SetStatistics(stats == 1);
+			for (size_t k = 0; k < points.size(); ++k) {
+				reference.SetParameters(points[k]);
+				reference.FillChemicalPotentials();
+				reference.CalculateDensities();
+				ExpectRelativeNear(primordial[k], reference.Densities(), 1.e-10);
+				ExpectRelativeNear(totals[k], reference.TotalDensities(), 1.e-10);
+			}
+		}
+	}
+
+	TEST(ThermalModelIdealTest, DensitiesBatchConstrained) {
+		ThermalParticleSystem TPS(ListFile);
+		std::vector<ThermalModelParameters> points = BatchPoints();
+
+		ThermalModelIdeal model(&TPS);
+		model.SetQoverB(0.4);
+		std::vector< std::vector<double> > primordial, totals;
+		model.CalculateDensitiesBatch(points, primordial, totals, true);
+
+		ThermalModelIdeal reference(&TPS);
+		reference.SetQoverB(0.4);
+		for (size_t k = 0; k < points.size(); ++k) {
+			reference.SetParameters(points[k]);
+			reference.ConstrainChemicalPotentials();
+			reference.CalculateDensities();
+			ExpectRelativeNear(primordial[k], reference.Densities(), 1.e-10);
+			ExpectRelativeNear(totals[k], reference.TotalDensities(), 1.e-10);
+		}
+	}
+
+	// In the eBW scheme the copy must not modify the thermal branching ratios
+	// stored in the particle list of the original model
+	TEST(ThermalModelIdealTest, CloneEnergyDependentWidths) {
+		ThermalParticleSystem TPS(ListFile);
+		ThermalModelIdeal model(&TPS);
+		model.SetUseWidth(ThermalParticle::eBW);
+		Calculate(model, 0.155, 0.);
+		model.CalculateDensities();
+
+		int id = TPS.PdgToId(2224);
+		ASSERT_GE(id, 0);
+		std::vector<double> bratios;
+		for (size_t k = 0; k < TPS.Particle(id).Decays().size(); ++k)
+			bratios.push_back(TPS.Particle(id).Decays()[k].mBratio);
+
+		ThermalModelBase *clone = model.Clone();
+		ASSERT_TRUE(clone != NULL);
+		EXPECT_NE(clone->TPS(), &TPS);
+		EXPECT_EQ(clone->TPS()->ComponentsNumber(), TPS.ComponentsNumber());
+		Calculate(*clone, 0.100, 0.);
+		clone->CalculateDensities();
+		for (size_t k = 0; k < bratios.size(); ++k)
+			EXPECT_EQ(TPS.Particle(id).Decays()[k].mBratio, bratios[k]);
+
+		// Same results as the model at the same parameters
+		Calculate(*clone, 0.155, 0.);
+		clone->CalculateDensities();
+		ExpectRelativeNear(clone->TotalDensities(), model.TotalDensities(), 1.e-12);
+
+		ThermalModelBase *clone2 = clone->Clone();
+		EXPECT_NE(clone2->TPS(), clone->TPS());
+		delete clone;
+		clone2->CalculateDensities();
+		ExpectRelativeNear(clone2->TotalDensities(), model.TotalDensities(), 1.e-12);
+		delete clone2;
+	}
+
+	std::vector<double> ChargeVector(const ThermalParticleSystem& TPS, ConservedCharge::Name chg) {
+		std::vector<double> ret;
+		for (int i = 0; i < TPS.ComponentsNumber(); ++i)
+			ret.push_back(TPS.Particles()[i].ConservedCharge(chg));
+		return ret;
+	}
+
+	// chi_{n+1} = T d chi_n / d mu, checked by central differences up to the 8th order
+	TEST(ThermalModelIdealTest, ChargeFluctuationsFiniteDifferences) {
+		ThermalParticleSystem TPS(ListFile);
+		std::vector< std::vector<double> > chgs;
+		chgs.push_back(ChargeVector(TPS, ConservedCharge::BaryonCharge));
+		chgs.push_back(ChargeVector(TPS, ConservedCharge::ElectricCharge));
+
+		const double T = 0.150, muB = 0.200, muQ = -0.020, h = 0.0002;
+		const int order = 8;
+
+		for (int stats = 0; stats < 2; ++stats) {
+			ThermalModelIdeal model(&TPS);
+			model.SetStatistics(stats == 1);
+			model.SetTemperature(T);
+			model.SetElectricChemicalPotential(muQ);
+			Calculate(model, T, muB);
+			std::vector< std::vector<double> > chis = model.CalculateChargeFluctuationsBatch(chgs, order);
+			ASSERT_EQ(chis.size(), chgs.size());
+
+			for (size_t k = 0; k < chgs.size(); ++k) {
+				ASSERT_EQ(chis[k].size(), static_cast<size_t>(order + 1));
+				EXPECT_EQ(model.CalculateChargeFluctuations(chgs[k], order), chis[k]);
+
+				std::vector< std::vector<double> > chisdiff[2];
+				for (int sign = 0; sign < 2; ++sign) {
+					double dmu = (sign == 0) ? -h : h;
+					model.SetBaryonChemicalPotential(muB + (k == 0 ? dmu : 0.));
+					model.SetElectricChemicalPotential(muQ + (k == 1 ? dmu : 0.));
+					model.FillChemicalPotentials();
+					model.CalculatePrimordialDensities();
+					chisdiff[sign] = model.CalculateChargeFluctuationsBatch(chgs, order);
+				}
+				model.SetBaryonChemicalPotential(muB);
+				model.SetElectricChemicalPotential(muQ);
+				model.FillChemicalPotentials();
+				model.CalculatePrimordialDensities();
+
+				for (int n = 1; n < order; ++n) {
+					double deriv = T * (chisdiff[1][k][n - 1] - chisdiff[0][k][n - 1]) / (2. * h);
+					EXPECT_NEAR(chis[k][n], deriv, 1.e-4 * std::abs(chis[k][n])) << "charge " << k << ", order " << n + 1;
+				}
+			}
+
+			// Second order agrees with the susceptibility matrix from the correlations
+			model.CalculateFluctuations();
+			EXPECT_NEAR(chis[0][1], model.Susc(ConservedCharge::BaryonCharge, ConservedCharge::BaryonCharge), 1.e-10 * chis[0][1]);
+			EXPECT_NEAR(chis[1][1], model.Susc(ConservedCharge::ElectricCharge, ConservedCharge::ElectricCharge), 1.e-10 * chis[1][1]);
+		}
+	}
+
+	// All the terms of the cluster expansion at once, with and without the finite widths
+	TEST(ThermalParticleTest, ClusterExpansionTerms) {
+		ThermalParticleSystem TPS(ListFile);
+		ThermalModelParameters params(0.155, 0.050, 0., 0.);
+		params.gammaS = 0.7;
+
+		IdealGasFunctions::Quantity quantities[4] = {
+			IdealGasFunctions::ParticleDensity, IdealGasFunctions::Pressure,
+			IdealGasFunctions::EnergyDensity, IdealGasFunctions::ScalarDensity };
+
+		long long pdgs[3] = { 2224, 213, 323 };
+		for (int ip = 0; ip < 3; ++ip) {
+			int id = TPS.PdgToId(pdgs[ip]);
+			ASSERT_GE(id, 0);
+			ThermalParticle &part = TPS.Particle(id);
+			part.UseStatistics(true);
+			part.SetCalculationType(IdealGasFunctions::ClusterExpansion);
+			part.SetClusterExpansionOrder(6);
+			double mu = 0.100 * part.BaryonCharge() + 0.020 * part.ElectricCharge();
+
+			ThermalParticle::ResonanceWidthIntegration types[3] = { ThermalParticle::ZeroWidth, ThermalParticle::BWTwoGamma, ThermalParticle::eBW };
+			for (int width = 0; width < 3; ++width) {
+				part.SetResonanceWidthIntegrationType(types[width]);
+				ASSERT_FALSE(part.ZeroWidthEnforced());
+
+				std::vector<IdealGasFunctions::IdealGasQuantities> terms;
+				part.ClusterExpansionTerms(params, terms, width != 0, mu);
+				ASSERT_EQ(terms.size(), 6U);
+				for (int n = 1; n <= 6; ++n) {
+					for (int iq = 0; iq < 4; ++iq) {
+						double ref = part.DensityCluster(n, params, quantities[iq], width != 0, mu);
+						EXPECT_NEAR(terms[n - 1].Value(quantities[iq]), ref, 1.e-12 * std::abs(ref))
+							<< "pdg " << pdgs[ip] << ", width " << width << ", term " << n << ", quantity " << iq;
+					}
+				}
+
+				// The widths do matter
+				if (width != 0)
+					EXPECT_GT(std::abs(terms[0].n / part.DensityCluster(1, params, IdealGasFunctions::ParticleDensity, false, mu) - 1.), 1.e-3);
+			}
+		}
+	}
+
+}
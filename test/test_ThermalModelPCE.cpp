@@ -0,0 +1,122 @@
+/*
+ * Thermal-FIST package
+ * 
+ * Copyright (c) 2014-2019 Volodymyr Vovchenko
+ *
+ * GNU General Public License (GPLv3 or later)
+ */
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "HRGBase.h"
+#include "HRGPCE.h"
+#include "ThermalFISTConfig.h"
+#include "gtest/gtest.h"
+
+using namespace thermalfist;
+
+namespace {
+
+	// Gives access to the PCE equations and their Jacobian
+	class PCEAccess : public ThermalModelPCE {
+	public:
+		PCEAccess(ThermalModelBase *model) : ThermalModelPCE(model) { }
+
+		std::vector<double> Variables(PCEMode mode) const { return PCEVariables(mode); }
+
+		std::vector<double> Equations(const std::vector<double> &x, PCEMode mode) {
+			BroydenEquationsPCE eqs(this, mode);
+			return eqs.Equations(x);
+		}
+
+		std::vector<double> Jacobian(const std::vector<double> &x, PCEMode mode) {
+			SetPCEVariables(x, mode);
+			std::vector<double> jacobian, dFdparam;
+			CalculateJacobian(mode, jacobian, dFdparam);
+			return jacobian;
+		}
+	};
+
+	void SetChemicalFreezeout(ThermalModelBase &model, ThermalModelPCE &pce) {
+		ThermalModelParameters params(0.155, 0.100);
+		params.V = 4000.;
+		model.SetParameters(params);
+		model.FillChemicalPotentials();
+		pce.SetChemicalFreezeout(model.Parameters());
+	}
+
+	TEST(ThermalModelPCETest, AnalyticJacobian) {
+		ThermalParticleSystem TPS(std::string(ThermalFIST_INPUT_FOLDER) + "/list/PDG2014/list.dat");
+
+		for (int stats = 0; stats < 2; ++stats) {
+			ThermalModelIdeal model(&TPS);
+			model.SetStatistics(stats == 1);
+			PCEAccess pce(&model);
+			SetChemicalFreezeout(model, pce);
+
+			ThermalModelPCE::PCEMode modes[2] = { ThermalModelPCE::AtFixedTemperature, ThermalModelPCE::AtFixedVolume };
+			for (int imode = 0; imode < 2; ++imode) {
+				ThermalModelPCE::PCEMode mode = modes[imode];
+				pce.CalculatePCE(mode == ThermalModelPCE::AtFixedTemperature ? 0.130 : 8000., mode);
+
+				std::vector<double> x = pce.Variables(mode);
+				int N = x.size();
+				std::vector<double> jacobian = pce.Jacobian(x, mode);
+				ASSERT_EQ(jacobian.size(), static_cast<size_t>(N * N));
+
+				// Central differences
+				for (int j = 0; j < N; ++j) {
+					double h = (j < N - 1) ? 1.e-5 : 1.e-5 * x[j];
+					std::vector<double> xp = x, xm = x;
+					xp[j] += h;
+					xm[j] -= h;
+					std::vector<double> Fp = pce.Equations(xp, mode), Fm = pce.Equations(xm, mode);
+					for (int i = 0; i < N; ++i) {
+						double scale = 0.;
+						for (int k = 0; k < N; ++k)
+							scale = std::max(scale, std::abs(jacobian[i * N + k]) * ((k < N - 1) ? 1. : x[k]));
+						double deriv = (Fp[i] - Fm[i]) / (2. * h);
+						double tolerance = 1.e-5 * scale / ((j < N - 1) ? 1. : x[j]);
+						EXPECT_NEAR(jacobian[i * N + j], deriv, tolerance) << "mode " << imode << ", row " << i << ", column " << j;
+					}
+				}
+			}
+		}
+	}
+
+	// The continuation along the trajectory gives the same solutions as the independent calculations
+	TEST(ThermalModelPCETest, Trajectory) {
+		ThermalParticleSystem TPS(std::string(ThermalFIST_INPUT_FOLDER) + "/list/PDG2014/list.dat");
+
+		std::vector<double> temperatures;
+		for (int k = 0; k < 6; ++k)
+			temperatures.push_back(0.150 - 0.008 * k);
+
+		ThermalModelIdeal model(&TPS);
+		ThermalModelPCE pce(&model);
+		SetChemicalFreezeout(model, pce);
+		std::vector<ThermalModelPCE::PCETrajectoryPoint> trajectory = pce.CalculatePCETrajectory(temperatures);
+		ASSERT_EQ(trajectory.size(), temperatures.size());
+
+		ThermalModelIdeal modelref(&TPS);
+		ThermalModelPCE pceref(&modelref);
+		pceref.UseAnalyticJacobian(false);
+		SetChemicalFreezeout(modelref, pceref);
+		for (size_t k = 0; k < temperatures.size(); ++k) {
+			pceref.CalculatePCE(temperatures[k]);
+			EXPECT_DOUBLE_EQ(trajectory[k].Parameters.T, temperatures[k]);
+			EXPECT_NEAR(trajectory[k].Parameters.V, pceref.Volume(), 1.e-6 * pceref.Volume());
+			for (int i = 0; i < TPS.ComponentsNumber(); ++i) {
+				EXPECT_NEAR(trajectory[k].ChemicalPotentials[i], pceref.ChemicalPotentials()[i], 1.e-7);
+				double yield = modelref.TotalDensities()[i] * pceref.Volume();
+				EXPECT_NEAR(trajectory[k].TotalYields[i], yield, 1.e-6 * yield);
+			}
+		}
+
+		// The model corresponds to the last point
+		EXPECT_DOUBLE_EQ(model.Parameters().T, temperatures.back());
+		EXPECT_EQ(pce.ChemicalPotentials(), trajectory.back().ChemicalPotentials);
+	}
+
+}